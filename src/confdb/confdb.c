@@ -1195,6 +1195,16 @@ static int confdb_get_domain_internal(struct confdb_ctx *cdb,
               domain->refresh_expired_interval);
     }
 
+    /* Only refresh entries reported as used by the responders */
+    ret = get_entry_as_uint32(res->msgs[0], &domain->refresh_hot_entries,
+                              CONFDB_DOMAIN_REFRESH_HOT_ENTRIES, 0);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Invalid value for [%s]\n",
+               CONFDB_DOMAIN_REFRESH_HOT_ENTRIES);
+        goto done;
+    }
+
     /* Set the PAM warning time, if specified. If not specified, pass on
      * the "not set" value of "-1" which means "use provider default". The
      * value 0 means "always display the warning if server sends one" */
@@ -57,6 +57,8 @@
 #define CONFDB_SERVICE_DEBUG_LEVEL_ALIAS "debug"
 #define CONFDB_SERVICE_DEBUG_TIMESTAMPS "debug_timestamps"
 #define CONFDB_SERVICE_DEBUG_MICROSECONDS "debug_microseconds"
+#define CONFDB_SERVICE_DEBUG_BUFFERED "debug_buffered"
+#define CONFDB_SERVICE_DEBUG_BACKTRACE "debug_backtrace"
 #define CONFDB_SERVICE_DEBUG_TO_FILES "debug_to_files"
 #define CONFDB_SERVICE_RECON_RETRIES "reconnection_retries"
 #define CONFDB_SERVICE_FD_LIMIT "fd_limit"
@@ -85,6 +87,8 @@
 #define CONFDB_RESPONDER_CLI_IDLE_TIMEOUT "client_idle_timeout"
 #define CONFDB_RESPONDER_CLI_IDLE_DEFAULT_TIMEOUT 60
 #define CONFDB_RESPONDER_LOCAL_NEG_TIMEOUT "local_negative_timeout"
+#define CONFDB_RESPONDER_PARALLEL_DOMAIN_LOOKUP "parallel_domain_lookup"
+#define CONFDB_RESPONDER_CACHE_READERS "cache_readers"
 
 /* NSS */
 #define CONFDB_NSS_CONF_ENTRY "config/nss"
@@ -104,6 +108,7 @@
 #define CONFDB_NSS_DEFAULT_SHELL "default_shell"
 #define CONFDB_MEMCACHE_TIMEOUT "memcache_timeout"
 #define CONFDB_NSS_HOMEDIR_SUBSTRING "homedir_substring"
+#define CONFDB_NSS_WORKER_PROCESSES "worker_processes"
 #define CONFDB_DEFAULT_HOMEDIR_SUBSTRING "/home"
 
 /* PAM */
@@ -200,9 +205,12 @@
 #define CONFDB_DOMAIN_SSH_HOST_CACHE_TIMEOUT "entry_cache_ssh_host_timeout"
 #define CONFDB_DOMAIN_PWD_EXPIRATION_WARNING "pwd_expiration_warning"
 #define CONFDB_DOMAIN_REFRESH_EXPIRED_INTERVAL "refresh_expired_interval"
+#define CONFDB_DOMAIN_REFRESH_HOT_ENTRIES "refresh_hot_entries"
 #define CONFDB_DOMAIN_OFFLINE_TIMEOUT "offline_timeout"
 #define CONFDB_DOMAIN_SUBDOMAIN_INHERIT "subdomain_inherit"
 #define CONFDB_DOMAIN_CACHED_AUTH_TIMEOUT "cached_auth_timeout"
+#define CONFDB_DOMAIN_DP_BINARY_TRANSPORT "dp_binary_transport"
+#define CONFDB_DOMAIN_DP_BATCH_WINDOW "dp_batch_window"
 
 /* Local Provider */
 #define CONFDB_LOCAL_DEFAULT_SHELL   "default_shell"
@@ -221,6 +229,9 @@
 
 /* Secrets Service */
 #define CONFDB_SEC_CONF_ENTRY "config/secrets"
+#define CONFDB_SEC_PROXY_MAX_CONNS "proxy_max_connections"
+#define CONFDB_SEC_PROXY_IDLE_TIMEOUT "proxy_idle_timeout"
+#define CONFDB_SEC_MAX_PAYLOAD_SIZE "max_payload_size"
 
 
 struct confdb_ctx;
@@ -283,6 +294,7 @@ struct sss_domain_info {
     uint32_t ssh_host_timeout;
 
     uint32_t refresh_expired_interval;
+    uint32_t refresh_hot_entries;
     uint32_t subdomain_refresh_interval;
     uint32_t cached_auth_timeout;
 
@@ -303,6 +303,8 @@ class SSSDConfigTestSSSDService(unittest.TestCase):
             'debug_level',
             'debug_timestamps',
             'debug_microseconds',
+            'debug_buffered',
+            'debug_backtrace',
             'debug_to_files',
             'command',
             'reconnection_retries',
@@ -524,10 +526,13 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'entry_cache_sudo_timeout',
             'entry_cache_ssh_host_timeout',
             'refresh_expired_interval',
+            'refresh_hot_entries',
             'lookup_family_order',
             'account_cache_expiration',
             'dns_resolver_timeout',
             'dns_discovery_domain',
+            'failover_parallel_connect',
+            'failover_latency_probe_interval',
             'dyndns_update',
             'dyndns_ttl',
             'dyndns_iface',
@@ -559,7 +564,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'subdomain_inherit',
             'full_name_format',
             're_expression',
-            'cached_auth_timeout']
+            'cached_auth_timeout',
+            'dp_binary_transport',
+            'dp_batch_window']
 
         self.assertTrue(type(options) == dict,
                         "Options should be a dictionary")
@@ -892,10 +899,13 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'entry_cache_sudo_timeout',
             'entry_cache_ssh_host_timeout',
             'refresh_expired_interval',
+            'refresh_hot_entries',
             'account_cache_expiration',
             'lookup_family_order',
             'dns_resolver_timeout',
             'dns_discovery_domain',
+            'failover_parallel_connect',
+            'failover_latency_probe_interval',
             'dyndns_update',
             'dyndns_ttl',
             'dyndns_iface',
@@ -927,7 +937,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'subdomain_inherit',
             'full_name_format',
             're_expression',
-            'cached_auth_timeout']
+            'cached_auth_timeout',
+            'dp_binary_transport',
+            'dp_batch_window']
 
         self.assertTrue(type(options) == dict,
                         "Options should be a dictionary")
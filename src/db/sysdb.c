@@ -27,6 +27,7 @@
 #include "db/sysdb_private.h"
 #include "confdb/confdb.h"
 #include "util/probes.h"
+#include "util/sss_metrics.h"
 #include <time.h>
 
 errno_t sysdb_dn_sanitize(TALLOC_CTX *mem_ctx, const char *input,
@@ -880,7 +881,11 @@ int sysdb_transaction_start(struct sysdb_ctx *sysdb)
 
     ret = ldb_transaction_start(sysdb->ldb);
     if (ret == LDB_SUCCESS) {
-        PROBE(SYSDB_TRANSACTION_START, sysdb->transaction_nesting);
+        PROBE(SYSDB_TRANSACTION_START, sysdb->transaction_nesting,
+              sss_trace_id);
+        if (sysdb->transaction_nesting == 0) {
+            sysdb->transaction_start = tevent_timeval_current();
+        }
         sysdb->transaction_nesting++;
     } else {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -896,11 +901,16 @@ int sysdb_transaction_commit(struct sysdb_ctx *sysdb)
     int commit_nesting = sysdb->transaction_nesting-1;
 #endif
 
-    PROBE(SYSDB_TRANSACTION_COMMIT_BEFORE, commit_nesting);
+    PROBE(SYSDB_TRANSACTION_COMMIT_BEFORE, commit_nesting, sss_trace_id);
     ret = ldb_transaction_commit(sysdb->ldb);
     if (ret == LDB_SUCCESS) {
         sysdb->transaction_nesting--;
-        PROBE(SYSDB_TRANSACTION_COMMIT_AFTER, sysdb->transaction_nesting);
+        PROBE(SYSDB_TRANSACTION_COMMIT_AFTER, sysdb->transaction_nesting,
+              sss_trace_id);
+        if (sysdb->transaction_nesting == 0) {
+            sss_metrics_add_time("sysdb", "transaction_commit",
+                                 &sysdb->transaction_start);
+        }
     } else {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Failed to commit ldb transaction! (%d)\n", ret);
@@ -915,7 +925,12 @@ int sysdb_transaction_cancel(struct sysdb_ctx *sysdb)
     ret = ldb_transaction_cancel(sysdb->ldb);
     if (ret == LDB_SUCCESS) {
         sysdb->transaction_nesting--;
-        PROBE(SYSDB_TRANSACTION_CANCEL, sysdb->transaction_nesting);
+        PROBE(SYSDB_TRANSACTION_CANCEL, sysdb->transaction_nesting,
+              sss_trace_id);
+        if (sysdb->transaction_nesting == 0) {
+            sss_metrics_add_time("sysdb", "transaction_cancel",
+                                 &sysdb->transaction_start);
+        }
     } else {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Failed to cancel ldb transaction! (%d)\n", ret);
@@ -869,6 +869,14 @@ int sysdb_set_entry_attr(struct sysdb_ctx *sysdb,
                          struct sysdb_attrs *attrs,
                          int mod_op);
 
+/* Expire all entries in msgs in one transaction. If the entries have
+ * a timestamp cache entry, only that one is modified. If initgroups is
+ * true, the initgroups expiration is reset as well. */
+errno_t sysdb_invalidate_cache_entries(struct sss_domain_info *domain,
+                                       struct ldb_message **msgs,
+                                       size_t count,
+                                       bool initgroups);
+
 /* Replace user attrs */
 int sysdb_set_user_attr(struct sss_domain_info *domain,
                         const char *name,
@@ -1260,6 +1260,142 @@ done:
     return ret;
 }
 
+/* =Expire-Cache-Entries================================================== */
+
+static errno_t sysdb_expire_msg_add(struct ldb_message *msg,
+                                    const char *attr)
+{
+    int lret;
+
+    lret = ldb_msg_add_empty(msg, attr, LDB_FLAG_MOD_REPLACE, NULL);
+    if (lret == LDB_SUCCESS) {
+        lret = ldb_msg_add_string(msg, attr, "1");
+    }
+
+    return sysdb_error_to_errno(lret);
+}
+
+errno_t sysdb_invalidate_cache_entries(struct sss_domain_info *domain,
+                                       struct ldb_message **msgs,
+                                       size_t count,
+                                       bool initgroups)
+{
+    struct sysdb_ctx *sysdb = domain->sysdb;
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_message *mod;
+    bool in_transaction = false;
+    bool in_ts_transaction = false;
+    size_t i;
+    errno_t ret;
+    errno_t sret;
+    int lret;
+
+    if (count == 0) {
+        return EOK;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    mod = ldb_msg_new(tmp_ctx);
+    if (mod == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sysdb_expire_msg_add(mod, SYSDB_CACHE_EXPIRE);
+    if (ret == EOK && initgroups) {
+        ret = sysdb_expire_msg_add(mod, SYSDB_INITGR_EXPIRE);
+    }
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot build the modify message\n");
+        goto done;
+    }
+
+    ret = sysdb_transaction_start(sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
+        goto done;
+    }
+    in_transaction = true;
+
+    if (sysdb->ldb_ts != NULL) {
+        lret = ldb_transaction_start(sysdb->ldb_ts);
+        if (lret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Failed to start timestamp cache transaction\n");
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+        in_ts_transaction = true;
+    }
+
+    for (i = 0; i < count; i++) {
+        mod->dn = msgs[i]->dn;
+
+        lret = LDB_ERR_NO_SUCH_OBJECT;
+        if (in_ts_transaction && is_ts_ldb_dn(mod->dn)) {
+            lret = ldb_modify(sysdb->ldb_ts, mod);
+        }
+
+        if (lret == LDB_ERR_NO_SUCH_OBJECT) {
+            /* There is no timestamp entry, expire the entry itself */
+            lret = ldb_modify(sysdb->ldb, mod);
+        }
+
+        if (lret == LDB_ERR_NO_SUCH_OBJECT) {
+            DEBUG(SSSDBG_TRACE_FUNC, "%s was removed meanwhile\n",
+                  ldb_dn_get_linearized(mod->dn));
+        } else if (lret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE, "Cannot expire %s: [%s](%d)[%s]\n",
+                  ldb_dn_get_linearized(mod->dn), ldb_strerror(lret), lret,
+                  ldb_errstring(sysdb->ldb));
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+    }
+
+    if (in_ts_transaction) {
+        lret = ldb_transaction_commit(sysdb->ldb_ts);
+        in_ts_transaction = false;
+        if (lret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Failed to commit timestamp cache transaction\n");
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+    }
+
+    ret = sysdb_transaction_commit(sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+        goto done;
+    }
+    in_transaction = false;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Expired %zu entries in domain %s\n",
+          count, domain->name);
+
+done:
+    if (in_ts_transaction) {
+        lret = ldb_transaction_cancel(sysdb->ldb_ts);
+        if (lret != LDB_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Could not cancel timestamp cache transaction\n");
+        }
+    }
+    if (in_transaction) {
+        sret = sysdb_transaction_cancel(sysdb);
+        if (sret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not cancel transaction\n");
+        }
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 /* =Replace-Attributes-On-User============================================ */
 
 int sysdb_set_user_attr(struct sss_domain_info *domain,
@@ -115,6 +115,8 @@ struct sysdb_ctx {
     char *ldb_ts_file;
 
     int transaction_nesting;
+    /* when the outermost transaction was started */
+    struct timeval transaction_start;
 };
 
 /* Internal utility functions */
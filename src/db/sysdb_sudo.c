@@ -480,9 +480,10 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
-                                           const char *attr_name,
-                                           time_t value)
+/* Sets an attribute of the sudo rules container */
+static errno_t sysdb_sudo_set_subdir_attr(struct sss_domain_info *domain,
+                                          const char *attr_name,
+                                          const char *value)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -538,7 +539,7 @@ static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
         }
     }
 
-    lret = ldb_msg_add_fmt(msg, attr_name, "%lld", (long long)value);
+    lret = ldb_msg_add_string(msg, attr_name, value);
     if (lret != LDB_SUCCESS) {
         ret = sysdb_error_to_errno(lret);
         goto done;
@@ -562,9 +563,30 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
+static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
                                            const char *attr_name,
-                                           time_t *value)
+                                           time_t value)
+{
+    char *str;
+    errno_t ret;
+
+    str = talloc_asprintf(NULL, "%lld", (long long)value);
+    if (str == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_sudo_set_subdir_attr(domain, attr_name, str);
+    talloc_free(str);
+
+    return ret;
+}
+
+/* Reads an attribute of the sudo rules container, *_msg is NULL if the
+ * container does not exist yet */
+static errno_t sysdb_sudo_get_subdir_attr(TALLOC_CTX *mem_ctx,
+                                          struct sss_domain_info *domain,
+                                          const char *attr_name,
+                                          struct ldb_message **_msg)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -598,7 +620,7 @@ static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
          * LDB does not need to have all of its parent
          * objects actually exist.
          */
-        *value = 0;
+        *_msg = NULL;
         ret = EOK;
         goto done;
     } else if (res->count != 1) {
@@ -608,7 +630,7 @@ static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
         goto done;
     }
 
-    *value = ldb_msg_find_attr_as_int(res->msgs[0], attr_name, 0);
+    *_msg = talloc_steal(mem_ctx, res->msgs[0]);
 
     ret = EOK;
 
@@ -617,6 +639,24 @@ done:
     return ret;
 }
 
+static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
+                                           const char *attr_name,
+                                           time_t *value)
+{
+    struct ldb_message *msg;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_subdir_attr(NULL, domain, attr_name, &msg);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *value = msg == NULL ? 0 : ldb_msg_find_attr_as_int64(msg, attr_name, 0);
+    talloc_free(msg);
+
+    return EOK;
+}
+
 errno_t sysdb_sudo_set_last_full_refresh(struct sss_domain_info *domain,
                                          time_t value)
 {
@@ -631,6 +671,67 @@ errno_t sysdb_sudo_get_last_full_refresh(struct sss_domain_info *domain,
                                        SYSDB_SUDO_AT_LAST_FULL_REFRESH, value);
 }
 
+/* The generation is a counter. It starts from the current time in
+ * microseconds so that it never repeats, not even after the whole sudo
+ * subtree was deleted by a full refresh and the previous value was lost. */
+errno_t sysdb_sudo_bump_rules_generation(struct sss_domain_info *domain)
+{
+    struct timeval tv;
+    uint64_t generation;
+    uint64_t now;
+    char *str;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_rules_generation(domain, &generation);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    gettimeofday(&tv, NULL);
+    now = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+
+    if (now > generation) {
+        generation = now;
+    } else {
+        generation++;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "New sudo rules generation: %"PRIu64"\n",
+          generation);
+
+    str = talloc_asprintf(NULL, "%"PRIu64, generation);
+    if (str == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_sudo_set_subdir_attr(domain, SYSDB_SUDO_AT_RULES_GENERATION,
+                                     str);
+    talloc_free(str);
+
+    return ret;
+}
+
+errno_t sysdb_sudo_get_rules_generation(struct sss_domain_info *domain,
+                                        uint64_t *_generation)
+{
+    struct ldb_message *msg;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_subdir_attr(NULL, domain,
+                                     SYSDB_SUDO_AT_RULES_GENERATION, &msg);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_generation = msg == NULL ? 0 :
+                   ldb_msg_find_attr_as_uint64(msg,
+                                               SYSDB_SUDO_AT_RULES_GENERATION,
+                                               0);
+    talloc_free(msg);
+
+    return EOK;
+}
+
 /* ====================  Purge functions ==================== */
 
 static const char *
@@ -1052,21 +1052,28 @@ done:
     return err;
 }
 
-enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
-                                            const char *sid,
-                                            uint32_t *_id)
+/* Same as sss_idmap_sid_to_unix() but additionally returns the primary
+ * slice the SID was mapped with, if any, so that bulk callers can try it
+ * first for the following SIDs. */
+static enum idmap_error_code
+idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
+                  const char *sid,
+                  uint32_t *_id,
+                  struct idmap_domain_info **_slice)
 {
     struct idmap_domain_info *idmap_domain_info;
     struct idmap_domain_info *matched_dom = NULL;
     size_t dom_len;
     long long rid;
 
+    if (_slice != NULL) {
+        *_slice = NULL;
+    }
+
     if (sid == NULL || _id == NULL) {
         return IDMAP_ERROR;
     }
 
-    CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
-
     idmap_domain_info = ctx->idmap_domain_info;
 
     if (sss_idmap_sid_is_builtin(sid)) {
@@ -1087,6 +1094,9 @@ enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
             }
 
             if (comp_id(&idmap_domain_info->range_params, rid, _id)) {
+                if (_slice != NULL) {
+                    *_slice = idmap_domain_info;
+                }
                 return IDMAP_SUCCESS;
             }
 
@@ -1103,6 +1113,67 @@ enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
     return matched_dom ? IDMAP_NO_RANGE : IDMAP_NO_DOMAIN;
 }
 
+enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
+                                            const char *sid,
+                                            uint32_t *_id)
+{
+    if (sid == NULL || _id == NULL) {
+        return IDMAP_ERROR;
+    }
+
+    CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
+
+    return idmap_sid_to_unix(ctx, sid, _id, NULL);
+}
+
+enum idmap_error_code sss_idmap_sids_to_unix(struct sss_idmap_ctx *ctx,
+                                             const char **sids,
+                                             size_t count,
+                                             uint32_t *ids,
+                                             enum idmap_error_code *errs,
+                                             size_t *_num_mapped)
+{
+    struct idmap_domain_info *slice = NULL;
+    struct idmap_domain_info *last_slice = NULL;
+    size_t num_mapped = 0;
+    size_t dom_len;
+    long long rid;
+    size_t c;
+
+    if (count != 0 && (sids == NULL || ids == NULL || errs == NULL)) {
+        return IDMAP_ERROR;
+    }
+
+    CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
+
+    for (c = 0; c < count; c++) {
+        /* The SIDs of a security descriptor typically belong to one or two
+         * domains, so the slice which mapped the previous SID is a good
+         * guess and saves walking the whole domain list. */
+        if (last_slice != NULL && sids[c] != NULL
+                && is_sid_from_dom(last_slice->sid, sids[c], &dom_len)
+                && parse_rid(sids[c], dom_len, &rid)
+                && comp_id(&last_slice->range_params, rid, &ids[c])) {
+            errs[c] = IDMAP_SUCCESS;
+        } else {
+            errs[c] = idmap_sid_to_unix(ctx, sids[c], &ids[c], &slice);
+            if (slice != NULL) {
+                last_slice = slice;
+            }
+        }
+
+        if (errs[c] == IDMAP_SUCCESS) {
+            num_mapped++;
+        }
+    }
+
+    if (_num_mapped != NULL) {
+        *_num_mapped = num_mapped;
+    }
+
+    return IDMAP_SUCCESS;
+}
+
 enum idmap_error_code sss_idmap_check_sid_unix(struct sss_idmap_ctx *ctx,
                                                const char *sid,
                                                uint32_t id)
@@ -1177,15 +1248,21 @@ static enum idmap_error_code generate_sid(struct sss_idmap_ctx *ctx,
     return IDMAP_SUCCESS;
 }
 
-enum idmap_error_code sss_idmap_unix_to_sid(struct sss_idmap_ctx *ctx,
-                                            uint32_t id,
-                                            char **_sid)
+/* Same as sss_idmap_unix_to_sid() but additionally returns the primary
+ * slice the ID was found in, if any. */
+static enum idmap_error_code
+idmap_unix_to_sid(struct sss_idmap_ctx *ctx,
+                  uint32_t id,
+                  char **_sid,
+                  struct idmap_domain_info **_slice)
 {
     struct idmap_domain_info *idmap_domain_info;
     uint32_t rid;
     enum idmap_error_code err;
 
-    CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
+    if (_slice != NULL) {
+        *_slice = NULL;
+    }
 
     idmap_domain_info = ctx->idmap_domain_info;
 
@@ -1197,6 +1274,10 @@ enum idmap_error_code sss_idmap_unix_to_sid(struct sss_idmap_ctx *ctx,
                 return IDMAP_EXTERNAL;
             }
 
+            if (_slice != NULL) {
+                *_slice = idmap_domain_info;
+            }
+
             return generate_sid(ctx, idmap_domain_info->sid, rid, _sid);
         }
 
@@ -1238,6 +1319,59 @@ enum idmap_error_code sss_idmap_unix_to_sid(struct sss_idmap_ctx *ctx,
     return IDMAP_NO_DOMAIN;
 }
 
+enum idmap_error_code sss_idmap_unix_to_sid(struct sss_idmap_ctx *ctx,
+                                            uint32_t id,
+                                            char **_sid)
+{
+    CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
+
+    return idmap_unix_to_sid(ctx, id, _sid, NULL);
+}
+
+enum idmap_error_code sss_idmap_unix_to_sids(struct sss_idmap_ctx *ctx,
+                                             const uint32_t *ids,
+                                             size_t count,
+                                             char **sids,
+                                             enum idmap_error_code *errs,
+                                             size_t *_num_mapped)
+{
+    struct idmap_domain_info *slice = NULL;
+    struct idmap_domain_info *last_slice = NULL;
+    size_t num_mapped = 0;
+    uint32_t rid;
+    size_t c;
+
+    if (count != 0 && (ids == NULL || sids == NULL || errs == NULL)) {
+        return IDMAP_ERROR;
+    }
+
+    CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
+
+    for (c = 0; c < count; c++) {
+        sids[c] = NULL;
+
+        if (last_slice != NULL
+                && id_is_in_range(ids[c], &last_slice->range_params, &rid)) {
+            errs[c] = generate_sid(ctx, last_slice->sid, rid, &sids[c]);
+        } else {
+            errs[c] = idmap_unix_to_sid(ctx, ids[c], &sids[c], &slice);
+            if (slice != NULL) {
+                last_slice = slice;
+            }
+        }
+
+        if (errs[c] == IDMAP_SUCCESS) {
+            num_mapped++;
+        }
+    }
+
+    if (_num_mapped != NULL) {
+        *_num_mapped = num_mapped;
+    }
+
+    return IDMAP_SUCCESS;
+}
+
 enum idmap_error_code sss_idmap_dom_sid_to_unix(struct sss_idmap_ctx *ctx,
                                                 struct sss_dom_sid *dom_sid,
                                                 uint32_t *id)
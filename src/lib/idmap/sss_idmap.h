@@ -437,6 +437,38 @@ enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
                                             const char *sid,
                                             uint32_t *id);
 
+/**
+ * @brief Translate a list of SIDs to unix UIDs or GIDs
+ *
+ * This is the vectorized version of sss_idmap_sid_to_unix() meant for
+ * callers which have to map many SIDs at once, e.g. all SIDs of a security
+ * descriptor. Each SID is mapped independently, the result of the mapping
+ * of the SID with index i is returned in errs[i] and, on success, in ids[i].
+ *
+ * @param[in] ctx         Idmap context
+ * @param[in] sids        Array of zero-terminated string representations
+ *                        of SIDs
+ * @param[in] count       Number of elements in sids
+ * @param[out] ids        Array with at least count elements for the returned
+ *                        unix UIDs or GIDs
+ * @param[out] errs       Array with at least count elements for the status
+ *                        of the individual mappings, see
+ *                        sss_idmap_sid_to_unix() for possible values
+ * @param[out] num_mapped Number of successfully mapped SIDs, may be NULL
+ *
+ * @return
+ *  - #IDMAP_SUCCESS:         All elements were processed, check errs for
+ *                            the individual results
+ *  - #IDMAP_ERROR:           Invalid arguments
+ *  - #IDMAP_CONTEXT_INVALID: Invalid idmap context
+ */
+enum idmap_error_code sss_idmap_sids_to_unix(struct sss_idmap_ctx *ctx,
+                                             const char **sids,
+                                             size_t count,
+                                             uint32_t *ids,
+                                             enum idmap_error_code *errs,
+                                             size_t *num_mapped);
+
 /**
  * @brief Translate a SID stucture to a unix UID or GID
  *
@@ -586,6 +618,38 @@ enum idmap_error_code sss_idmap_unix_to_sid(struct sss_idmap_ctx *ctx,
                                             uint32_t id,
                                             char **sid);
 
+/**
+ * @brief Translate a list of unix UIDs or GIDs to SIDs
+ *
+ * This is the vectorized version of sss_idmap_unix_to_sid(). The result of
+ * the mapping of the ID with index i is returned in errs[i] and, on success,
+ * in sids[i], otherwise sids[i] is set to NULL.
+ *
+ * @param[in] ctx         Idmap context
+ * @param[in] ids         Array of unix UIDs or GIDs
+ * @param[in] count       Number of elements in ids
+ * @param[out] sids       Array with at least count elements for the
+ *                        zero-terminated string representations of the SIDs,
+ *                        each must be freed with sss_idmap_free_sid() if not
+ *                        needed anymore
+ * @param[out] errs       Array with at least count elements for the status
+ *                        of the individual mappings, see
+ *                        sss_idmap_unix_to_sid() for possible values
+ * @param[out] num_mapped Number of successfully mapped IDs, may be NULL
+ *
+ * @return
+ *  - #IDMAP_SUCCESS:         All elements were processed, check errs for
+ *                            the individual results
+ *  - #IDMAP_ERROR:           Invalid arguments
+ *  - #IDMAP_CONTEXT_INVALID: Invalid idmap context
+ */
+enum idmap_error_code sss_idmap_unix_to_sids(struct sss_idmap_ctx *ctx,
+                                             const uint32_t *ids,
+                                             size_t count,
+                                             char **sids,
+                                             enum idmap_error_code *errs,
+                                             size_t *num_mapped);
+
 /**
  * @brief Translate unix UID or GID to a SID structure
  *
@@ -142,19 +142,57 @@ enum hbac_eval_result_int hbac_evaluate_rule(struct hbac_rule *rule,
                                              struct hbac_eval_req *hbac_req,
                                              enum hbac_error_code *error);
 
-enum hbac_eval_result hbac_evaluate(struct hbac_rule **rules,
-                                    struct hbac_eval_req *hbac_req,
-                                    struct hbac_info **info)
+/* Evaluates a single rule and records the outcome in result and info.
+ * Returns true if the evaluation is finished, i.e. the rule either granted
+ * access or could not be evaluated.
+ */
+static bool hbac_evaluate_rule_result(struct hbac_rule *rule,
+                                      struct hbac_eval_req *hbac_req,
+                                      struct hbac_info **info,
+                                      enum hbac_eval_result *result)
 {
-    uint32_t i;
-
     enum hbac_error_code ret;
-    enum hbac_eval_result result = HBAC_EVAL_DENY;
     enum hbac_eval_result_int intermediate_result;
 
-    HBAC_DEBUG(HBAC_DBG_INFO, "[< hbac_evaluate()\n");
-    hbac_req_debug_print(hbac_req);
+    hbac_rule_debug_print(rule);
+    intermediate_result = hbac_evaluate_rule(rule, hbac_req, &ret);
+    if (intermediate_result == HBAC_EVAL_UNMATCHED) {
+        /* This rule did not match at all. Skip it */
+        HBAC_DEBUG(HBAC_DBG_INFO, "The rule [%s] did not match.\n",
+                   rule->name);
+        return false;
+    } else if (intermediate_result == HBAC_EVAL_MATCHED) {
+        HBAC_DEBUG(HBAC_DBG_INFO, "ALLOWED by rule [%s].\n", rule->name);
+        *result = HBAC_EVAL_ALLOW;
+        if (info) {
+            (*info)->code = HBAC_SUCCESS;
+            (*info)->rule_name = strdup(rule->name);
+            if (!(*info)->rule_name) {
+                HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+                *result = HBAC_EVAL_ERROR;
+                (*info)->code = HBAC_ERROR_OUT_OF_MEMORY;
+            }
+        }
+        return true;
+    }
 
+    /* An error occurred processing this rule */
+    HBAC_DEBUG(HBAC_DBG_ERROR,
+               "Error %d occurred during evaluating of rule [%s].\n",
+               ret, rule->name);
+    *result = HBAC_EVAL_ERROR;
+    if (info) {
+        (*info)->code = ret;
+        (*info)->rule_name = strdup(rule->name);
+    }
+    /* Explicitly not checking the result of strdup(), since if
+     * it's NULL, we can't do anything anyway.
+     */
+    return true;
+}
+
+static enum hbac_eval_result hbac_alloc_info(struct hbac_info **info)
+{
     if (info) {
         *info = malloc(sizeof(struct hbac_info));
         if (!*info) {
@@ -165,49 +203,33 @@ enum hbac_eval_result hbac_evaluate(struct hbac_rule **rules,
         (*info)->rule_name = NULL;
     }
 
+    return HBAC_EVAL_DENY;
+}
+
+enum hbac_eval_result hbac_evaluate(struct hbac_rule **rules,
+                                    struct hbac_eval_req *hbac_req,
+                                    struct hbac_info **info)
+{
+    uint32_t i;
+    enum hbac_eval_result result;
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "[< hbac_evaluate()\n");
+    hbac_req_debug_print(hbac_req);
+
+    result = hbac_alloc_info(info);
+    if (result == HBAC_EVAL_OOM) {
+        return result;
+    }
+
     for (i = 0; rules[i]; i++) {
-        hbac_rule_debug_print(rules[i]);
-        intermediate_result = hbac_evaluate_rule(rules[i], hbac_req, &ret);
-        if (intermediate_result == HBAC_EVAL_UNMATCHED) {
-            /* This rule did not match at all. Skip it */
-            HBAC_DEBUG(HBAC_DBG_INFO, "The rule [%s] did not match.\n",
-                       rules[i]->name);
-            continue;
-        } else if (intermediate_result == HBAC_EVAL_MATCHED) {
-            HBAC_DEBUG(HBAC_DBG_INFO, "ALLOWED by rule [%s].\n", rules[i]->name);
-            result = HBAC_EVAL_ALLOW;
-            if (info) {
-                (*info)->code = HBAC_SUCCESS;
-                (*info)->rule_name = strdup(rules[i]->name);
-                if (!(*info)->rule_name) {
-                    HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
-                    result = HBAC_EVAL_ERROR;
-                    (*info)->code = HBAC_ERROR_OUT_OF_MEMORY;
-                }
-            }
+        if (hbac_evaluate_rule_result(rules[i], hbac_req, info, &result)) {
             break;
-        } else {
-            /* An error occurred processing this rule */
-            HBAC_DEBUG(HBAC_DBG_ERROR,
-                       "Error %d occurred during evaluating of rule [%s].\n",
-                       ret, rules[i]->name);
-            result = HBAC_EVAL_ERROR;
-            if (info) {
-                (*info)->code = ret;
-                (*info)->rule_name = strdup(rules[i]->name);
-            }
-            /* Explicitly not checking the result of strdup(), since if
-             * it's NULL, we can't do anything anyway.
-             */
-            goto done;
         }
     }
 
     /* If we've reached the end of the loop, we have either set the
-     * result to ALLOW explicitly or we'll stick with the default DENY.
+     * result explicitly or we'll stick with the default DENY.
      */
-done:
-
     HBAC_DEBUG(HBAC_DBG_INFO, "hbac_evaluate() >]\n");
     return result;
 }
@@ -356,6 +378,588 @@ static errno_t hbac_evaluate_element(struct hbac_rule_element *rule_el,
     return EOK;
 }
 
+/* Compiled rule sets
+ *
+ * A compiled rule set keeps, for each of the four rule elements, a hash
+ * index from (ASCII lower-cased) names and group names to the rules that
+ * mention them, plus a bitmap of rules that have to be checked regardless
+ * of the request (category "all", names that are not plain ASCII or rules
+ * that are missing an element). Evaluating a request intersects the
+ * candidate bitmaps of all elements and runs hbac_evaluate_rule() only on
+ * the remaining rules, in their original order. Rules that are not
+ * candidates are guaranteed not to match, so the result is identical to
+ * running hbac_evaluate() on the same rules.
+ *
+ * Requests containing non-ASCII strings are evaluated against all rules,
+ * because a case-insensitive Unicode comparison cannot be reduced to an
+ * exact lookup.
+ */
+
+#define HBAC_INDEX_MIN_BUCKETS 16
+#define HBAC_BITMAP_BITS 32
+
+enum hbac_rule_element_type {
+    HBAC_ELEMENT_USERS = 0,
+    HBAC_ELEMENT_SERVICES,
+    HBAC_ELEMENT_TARGETHOSTS,
+    HBAC_ELEMENT_SRCHOSTS,
+
+    HBAC_ELEMENT_SENTINEL
+};
+
+struct hbac_index_entry {
+    char *key;
+    uint32_t hash;
+    size_t *rules;
+    size_t count;
+    size_t alloc;
+    struct hbac_index_entry *next;
+};
+
+struct hbac_index {
+    struct hbac_index_entry **buckets;
+    size_t num_buckets;
+};
+
+struct hbac_element_index {
+    struct hbac_index names;
+    struct hbac_index groups;
+    /* Rules that are candidates for any request */
+    uint32_t *always;
+};
+
+struct hbac_compiled_rules {
+    /* NULL-terminated list of the enabled rules */
+    struct hbac_rule **rules;
+    size_t num_rules;
+    size_t num_words;
+    struct hbac_element_index elements[HBAC_ELEMENT_SENTINEL];
+};
+
+static char hbac_ascii_tolower(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A' + 'a';
+    }
+
+    return c;
+}
+
+static bool hbac_is_ascii(const char *str)
+{
+    const unsigned char *c;
+
+    for (c = (const unsigned char *) str; *c != '\0'; c++) {
+        if (*c > 0x7F) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool hbac_strings_are_ascii(const char **list)
+{
+    size_t i;
+
+    if (list == NULL) {
+        return true;
+    }
+
+    for (i = 0; list[i] != NULL; i++) {
+        if (!hbac_is_ascii(list[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* FNV-1a over the ASCII lower-cased string */
+static uint32_t hbac_index_hash(const char *str)
+{
+    uint32_t hash = 2166136261U;
+
+    for (; *str != '\0'; str++) {
+        hash ^= (unsigned char) hbac_ascii_tolower(*str);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static bool hbac_index_key_eq(const char *key, const char *str)
+{
+    for (; *key != '\0' && *str != '\0'; key++, str++) {
+        if (*key != hbac_ascii_tolower(*str)) {
+            return false;
+        }
+    }
+
+    return *key == *str;
+}
+
+static size_t hbac_count_strings(const char **list)
+{
+    size_t i;
+
+    if (list == NULL) {
+        return 0;
+    }
+
+    for (i = 0; list[i] != NULL; i++);
+
+    return i;
+}
+
+static errno_t hbac_index_init(struct hbac_index *index, size_t num_keys)
+{
+    index->num_buckets = HBAC_INDEX_MIN_BUCKETS;
+    while (index->num_buckets < num_keys * 2) {
+        index->num_buckets *= 2;
+    }
+
+    index->buckets = calloc(index->num_buckets,
+                            sizeof(struct hbac_index_entry *));
+    if (index->buckets == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static void hbac_index_free(struct hbac_index *index)
+{
+    struct hbac_index_entry *entry;
+    struct hbac_index_entry *next;
+    size_t i;
+
+    if (index->buckets == NULL) {
+        return;
+    }
+
+    for (i = 0; i < index->num_buckets; i++) {
+        for (entry = index->buckets[i]; entry != NULL; entry = next) {
+            next = entry->next;
+            free(entry->key);
+            free(entry->rules);
+            free(entry);
+        }
+    }
+
+    free(index->buckets);
+    index->buckets = NULL;
+}
+
+static struct hbac_index_entry *hbac_index_find(struct hbac_index *index,
+                                                const char *name)
+{
+    struct hbac_index_entry *entry;
+    uint32_t hash;
+
+    hash = hbac_index_hash(name);
+    for (entry = index->buckets[hash & (index->num_buckets - 1)];
+         entry != NULL;
+         entry = entry->next) {
+        if (entry->hash == hash && hbac_index_key_eq(entry->key, name)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static errno_t hbac_index_add(struct hbac_index *index,
+                              const char *name,
+                              size_t rule_idx)
+{
+    struct hbac_index_entry *entry;
+    size_t *rules;
+    size_t len;
+    size_t i;
+
+    entry = hbac_index_find(index, name);
+    if (entry == NULL) {
+        entry = calloc(1, sizeof(struct hbac_index_entry));
+        if (entry == NULL) {
+            return ENOMEM;
+        }
+
+        len = strlen(name);
+        entry->key = malloc(len + 1);
+        if (entry->key == NULL) {
+            free(entry);
+            return ENOMEM;
+        }
+        for (i = 0; i < len; i++) {
+            entry->key[i] = hbac_ascii_tolower(name[i]);
+        }
+        entry->key[len] = '\0';
+
+        entry->hash = hbac_index_hash(name);
+        entry->next = index->buckets[entry->hash & (index->num_buckets - 1)];
+        index->buckets[entry->hash & (index->num_buckets - 1)] = entry;
+    }
+
+    /* Rules are added in ascending order, so a duplicate name within the
+     * same rule is always the last one recorded */
+    if (entry->count > 0 && entry->rules[entry->count - 1] == rule_idx) {
+        return EOK;
+    }
+
+    if (entry->count == entry->alloc) {
+        entry->alloc = entry->alloc ? entry->alloc * 2 : 4;
+        rules = realloc(entry->rules, entry->alloc * sizeof(size_t));
+        if (rules == NULL) {
+            return ENOMEM;
+        }
+        entry->rules = rules;
+    }
+
+    entry->rules[entry->count] = rule_idx;
+    entry->count++;
+
+    return EOK;
+}
+
+static void hbac_bitmap_set(uint32_t *bitmap, size_t bit)
+{
+    bitmap[bit / HBAC_BITMAP_BITS] |= 1U << (bit % HBAC_BITMAP_BITS);
+}
+
+static void hbac_bitmap_set_entry(uint32_t *bitmap,
+                                  struct hbac_index_entry *entry)
+{
+    size_t i;
+
+    if (entry == NULL) {
+        return;
+    }
+
+    for (i = 0; i < entry->count; i++) {
+        hbac_bitmap_set(bitmap, entry->rules[i]);
+    }
+}
+
+static struct hbac_rule_element *
+hbac_rule_get_element(struct hbac_rule *rule, enum hbac_rule_element_type type)
+{
+    switch (type) {
+    case HBAC_ELEMENT_USERS:
+        return rule->users;
+    case HBAC_ELEMENT_SERVICES:
+        return rule->services;
+    case HBAC_ELEMENT_TARGETHOSTS:
+        return rule->targethosts;
+    case HBAC_ELEMENT_SRCHOSTS:
+        return rule->srchosts;
+    case HBAC_ELEMENT_SENTINEL:
+        break;
+    }
+
+    return NULL;
+}
+
+static struct hbac_request_element *
+hbac_req_get_element(struct hbac_eval_req *req,
+                     enum hbac_rule_element_type type)
+{
+    switch (type) {
+    case HBAC_ELEMENT_USERS:
+        return req->user;
+    case HBAC_ELEMENT_SERVICES:
+        return req->service;
+    case HBAC_ELEMENT_TARGETHOSTS:
+        return req->targethost;
+    case HBAC_ELEMENT_SRCHOSTS:
+        return req->srchost;
+    case HBAC_ELEMENT_SENTINEL:
+        break;
+    }
+
+    return NULL;
+}
+
+/* Returns true if the rule must be evaluated for every request because
+ * its element cannot be matched through the index */
+static bool hbac_rule_element_is_wildcard(struct hbac_rule *rule,
+                                          struct hbac_rule_element *el)
+{
+    /* Incomplete rules have to be reached by the evaluation so that
+     * the same error as with hbac_evaluate() is reported */
+    if (!rule->users
+     || !rule->services
+     || !rule->targethosts
+     || !rule->srchosts) {
+        return true;
+    }
+
+    if (el->category & HBAC_CATEGORY_ALL) return true;
+
+    return !hbac_strings_are_ascii(el->names)
+            || !hbac_strings_are_ascii(el->groups);
+}
+
+static errno_t hbac_compile_element(struct hbac_compiled_rules *compiled,
+                                    enum hbac_rule_element_type type)
+{
+    struct hbac_element_index *index = &compiled->elements[type];
+    struct hbac_rule_element *el;
+    size_t num_names = 0;
+    size_t num_groups = 0;
+    size_t i, j;
+    errno_t ret;
+
+    index->always = calloc(compiled->num_words, sizeof(uint32_t));
+    if (index->always == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < compiled->num_rules; i++) {
+        el = hbac_rule_get_element(compiled->rules[i], type);
+        if (!hbac_rule_element_is_wildcard(compiled->rules[i], el)) {
+            num_names += hbac_count_strings(el->names);
+            num_groups += hbac_count_strings(el->groups);
+        }
+    }
+
+    ret = hbac_index_init(&index->names, num_names);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = hbac_index_init(&index->groups, num_groups);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    for (i = 0; i < compiled->num_rules; i++) {
+        el = hbac_rule_get_element(compiled->rules[i], type);
+        if (hbac_rule_element_is_wildcard(compiled->rules[i], el)) {
+            hbac_bitmap_set(index->always, i);
+            continue;
+        }
+
+        for (j = 0; el->names != NULL && el->names[j] != NULL; j++) {
+            ret = hbac_index_add(&index->names, el->names[j], i);
+            if (ret != EOK) {
+                return ret;
+            }
+        }
+
+        for (j = 0; el->groups != NULL && el->groups[j] != NULL; j++) {
+            ret = hbac_index_add(&index->groups, el->groups[j], i);
+            if (ret != EOK) {
+                return ret;
+            }
+        }
+    }
+
+    return EOK;
+}
+
+enum hbac_error_code hbac_compile_rules(struct hbac_rule **rules,
+                                        struct hbac_compiled_rules **_compiled)
+{
+    struct hbac_compiled_rules *compiled;
+    size_t num_rules;
+    size_t i;
+    int type;
+    errno_t ret;
+
+    if (rules == NULL || _compiled == NULL) {
+        return HBAC_ERROR_UNKNOWN;
+    }
+
+    compiled = calloc(1, sizeof(struct hbac_compiled_rules));
+    if (compiled == NULL) {
+        return HBAC_ERROR_OUT_OF_MEMORY;
+    }
+
+    for (num_rules = 0; rules[num_rules] != NULL; num_rules++);
+
+    compiled->rules = calloc(num_rules + 1, sizeof(struct hbac_rule *));
+    if (compiled->rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Disabled rules never match, leave them out entirely */
+    for (i = 0; i < num_rules; i++) {
+        if (rules[i]->enabled) {
+            compiled->rules[compiled->num_rules] = rules[i];
+            compiled->num_rules++;
+        }
+    }
+    compiled->rules[compiled->num_rules] = NULL;
+    compiled->num_words = compiled->num_rules / HBAC_BITMAP_BITS + 1;
+
+    for (type = 0; type < HBAC_ELEMENT_SENTINEL; type++) {
+        ret = hbac_compile_element(compiled, type);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "Compiled %lu enabled out of %lu rules.\n",
+               (unsigned long) compiled->num_rules,
+               (unsigned long) num_rules);
+
+    *_compiled = compiled;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+        hbac_free_compiled_rules(compiled);
+        return HBAC_ERROR_OUT_OF_MEMORY;
+    }
+
+    return HBAC_SUCCESS;
+}
+
+void hbac_free_compiled_rules(struct hbac_compiled_rules *compiled)
+{
+    int type;
+
+    if (compiled == NULL) return;
+
+    for (type = 0; type < HBAC_ELEMENT_SENTINEL; type++) {
+        hbac_index_free(&compiled->elements[type].names);
+        hbac_index_free(&compiled->elements[type].groups);
+        free(compiled->elements[type].always);
+    }
+
+    free(compiled->rules);
+    free(compiled);
+}
+
+static bool hbac_req_is_indexable(struct hbac_eval_req *req)
+{
+    struct hbac_request_element *el;
+    int type;
+
+    for (type = 0; type < HBAC_ELEMENT_SENTINEL; type++) {
+        el = hbac_req_get_element(req, type);
+        if (el == NULL) {
+            continue;
+        }
+
+        if (el->name != NULL && !hbac_is_ascii(el->name)) {
+            return false;
+        }
+
+        if (!hbac_strings_are_ascii(el->groups)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Narrows candidates down to the rules whose element of the given type
+ * can match the request element */
+static void hbac_filter_candidates(struct hbac_element_index *index,
+                                   struct hbac_request_element *req_el,
+                                   size_t num_words,
+                                   uint32_t *matching,
+                                   uint32_t *candidates)
+{
+    size_t i;
+
+    memcpy(matching, index->always, num_words * sizeof(uint32_t));
+
+    /* Without a request element only rules that do not look at it
+     * can match */
+    if (req_el != NULL) {
+        if (req_el->name != NULL) {
+            hbac_bitmap_set_entry(matching,
+                                  hbac_index_find(&index->names,
+                                                  req_el->name));
+        }
+
+        for (i = 0; req_el->groups != NULL && req_el->groups[i] != NULL; i++) {
+            hbac_bitmap_set_entry(matching,
+                                  hbac_index_find(&index->groups,
+                                                  req_el->groups[i]));
+        }
+    }
+
+    for (i = 0; i < num_words; i++) {
+        candidates[i] &= matching[i];
+    }
+}
+
+enum hbac_eval_result
+hbac_evaluate_compiled(struct hbac_compiled_rules *compiled,
+                       struct hbac_eval_req *hbac_req,
+                       struct hbac_info **info)
+{
+    enum hbac_eval_result result;
+    uint32_t *candidates = NULL;
+    uint32_t *matching = NULL;
+    uint32_t word;
+    size_t i;
+    int type;
+
+    if (!hbac_req_is_indexable(hbac_req)) {
+        HBAC_DEBUG(HBAC_DBG_TRACE,
+                   "Request cannot use the rule index, checking all rules\n");
+        return hbac_evaluate(compiled->rules, hbac_req, info);
+    }
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "[< hbac_evaluate_compiled()\n");
+    hbac_req_debug_print(hbac_req);
+
+    result = hbac_alloc_info(info);
+    if (result == HBAC_EVAL_OOM) {
+        return result;
+    }
+
+    candidates = malloc(compiled->num_words * sizeof(uint32_t));
+    matching = malloc(compiled->num_words * sizeof(uint32_t));
+    if (candidates == NULL || matching == NULL) {
+        HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+        if (info) {
+            hbac_free_info(*info);
+            *info = NULL;
+        }
+        result = HBAC_EVAL_OOM;
+        goto done;
+    }
+    memset(candidates, 0xFF, compiled->num_words * sizeof(uint32_t));
+
+    for (type = 0; type < HBAC_ELEMENT_SENTINEL; type++) {
+        hbac_filter_candidates(&compiled->elements[type],
+                               hbac_req_get_element(hbac_req, type),
+                               compiled->num_words, matching, candidates);
+    }
+
+    for (i = 0; i < compiled->num_rules; i++) {
+        word = candidates[i / HBAC_BITMAP_BITS];
+        if (word == 0) {
+            /* Skip the whole word */
+            i |= HBAC_BITMAP_BITS - 1;
+            continue;
+        }
+
+        if ((word & (1U << (i % HBAC_BITMAP_BITS))) == 0) {
+            continue;
+        }
+
+        if (hbac_evaluate_rule_result(compiled->rules[i], hbac_req,
+                                      info, &result)) {
+            break;
+        }
+    }
+
+done:
+    free(candidates);
+    free(matching);
+    HBAC_DEBUG(HBAC_DBG_INFO, "hbac_evaluate_compiled() >]\n");
+    return result;
+}
+
 const char *hbac_result_string(enum hbac_eval_result result)
 {
     switch (result) {
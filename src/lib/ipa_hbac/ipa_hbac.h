@@ -309,6 +309,54 @@ const char *hbac_error_string(enum hbac_error_code code);
  */
 void hbac_free_info(struct hbac_info *info);
 
+/**
+ * Opaque set of HBAC rules prepared for repeated evaluation
+ */
+struct hbac_compiled_rules;
+
+/**
+ * @brief Prepare a set of HBAC rules for repeated evaluation
+ *
+ * Builds lookup indexes from the user, service and host names and groups
+ * referenced by the rules so that #hbac_evaluate_compiled only needs to
+ * look at the rules that can possibly match a request. This is worthwhile
+ * when the same rules are evaluated many times.
+ *
+ * @param[in] rules     A NULL-terminated list of rules. The rules are not
+ *                      copied and must not be modified or freed before the
+ *                      compiled rule set is freed.
+ * @param[out] compiled The compiled rule set, free it with
+ *                      #hbac_free_compiled_rules
+ * @return
+ *  - #HBAC_SUCCESS:              The rules were compiled
+ *  - #HBAC_ERROR_OUT_OF_MEMORY:  Insufficient memory
+ *  - #HBAC_ERROR_UNKNOWN:        Invalid arguments
+ */
+enum hbac_error_code hbac_compile_rules(struct hbac_rule **rules,
+                                        struct hbac_compiled_rules **compiled);
+
+/**
+ * @brief Evaluate an authorization request against a compiled rule set
+ *
+ * The result, including the rule reported in @p info, is the same as
+ * the result of #hbac_evaluate with the rules the set was compiled from.
+ *
+ * @param[in] compiled A rule set returned by #hbac_compile_rules
+ * @param[in] hbac_req A user authorization request
+ * @param[out] info    Extended information, see #hbac_evaluate
+ * @return See #hbac_evaluate
+ */
+enum hbac_eval_result
+hbac_evaluate_compiled(struct hbac_compiled_rules *compiled,
+                       struct hbac_eval_req *hbac_req,
+                       struct hbac_info **info);
+
+/**
+ * @brief Free a rule set returned by #hbac_compile_rules
+ * @param compiled The compiled rule set, the rules themselves are not freed
+ */
+void hbac_free_compiled_rules(struct hbac_compiled_rules *compiled);
+
 /** User element */
 #define HBAC_RULE_ELEMENT_USERS       0x01
 
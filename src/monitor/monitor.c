@@ -50,6 +50,7 @@
 #include "sbus/sssd_dbus.h"
 #include "monitor/monitor_interfaces.h"
 #include "responder/common/responder_sbus.h"
+#include "util/sss_metrics.h"
 
 #ifdef USE_KEYRING
 #include <keyutils.h>
@@ -298,8 +299,142 @@ static int client_registration(struct sbus_request *dbus_req, void *data)
                                    DBUS_TYPE_INVALID);
 
 done:
-    /* init complete, get rid of temp init context */
-    talloc_zfree(mini);
+    /* init complete, the init context stays with the connection as the
+     * data of the monitor interface */
+    return EOK;
+}
+
+/* Collects the metrics of all running services for one getStats call. */
+struct get_stats_state {
+    struct sbus_request *dbus_req;
+    char *stats;
+
+    DBusPendingCall **pending;
+    int num_pending;
+};
+
+static int get_stats_state_destructor(struct get_stats_state *state)
+{
+    int i;
+
+    /* the caller went away, do not let the replies use this state */
+    for (i = 0; i < state->num_pending; i++) {
+        if (state->pending[i] != NULL) {
+            dbus_pending_call_cancel(state->pending[i]);
+            dbus_pending_call_unref(state->pending[i]);
+        }
+    }
+
+    return 0;
+}
+
+static void get_stats_reply(DBusPendingCall *pending, void *data)
+{
+    struct get_stats_state *state;
+    DBusMessage *reply;
+    const char *stats;
+    bool done = true;
+    errno_t ret;
+    int i;
+
+    state = talloc_get_type(data, struct get_stats_state);
+
+    for (i = 0; i < state->num_pending; i++) {
+        if (state->pending[i] == pending) {
+            state->pending[i] = NULL;
+        } else if (state->pending[i] != NULL) {
+            done = false;
+        }
+    }
+
+    reply = dbus_pending_call_steal_reply(pending);
+    dbus_pending_call_unref(pending);
+    if (reply != NULL) {
+        ret = sbus_parse_reply(reply, DBUS_TYPE_STRING, &stats);
+        if (ret == EOK && state->stats != NULL) {
+            state->stats = talloc_strdup_append_buffer(state->stats, stats);
+        } else if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to get service metrics "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+        }
+        dbus_message_unref(reply);
+    }
+
+    if (!done) {
+        return;
+    }
+
+    if (state->stats == NULL) {
+        sbus_request_fail_and_finish(state->dbus_req, NULL);
+        return;
+    }
+
+    mon_srv_iface_getStats_finish(state->dbus_req, state->stats);
+}
+
+static int get_stats(struct sbus_request *dbus_req, void *data)
+{
+    struct get_stats_state *state;
+    struct mon_init_conn *mini;
+    struct mt_svc *svc;
+    DBusMessage *msg;
+    int num_svcs = 0;
+    errno_t ret;
+
+    mini = talloc_get_type(data, struct mon_init_conn);
+    if (!mini) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Connection holds no valid init data\n");
+        return EINVAL;
+    }
+
+    state = talloc_zero(dbus_req, struct get_stats_state);
+    if (state == NULL) {
+        return ENOMEM;
+    }
+    state->dbus_req = dbus_req;
+
+    ret = sss_metrics_dump(state, debug_prg_name, &state->stats);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    for (svc = mini->ctx->svc_list; svc != NULL; svc = svc->next) {
+        num_svcs++;
+    }
+
+    state->pending = talloc_zero_array(state, DBusPendingCall *, num_svcs);
+    if (state->pending == NULL) {
+        return ENOMEM;
+    }
+    talloc_set_destructor(state, get_stats_state_destructor);
+
+    for (svc = mini->ctx->svc_list; svc != NULL; svc = svc->next) {
+        if (svc->conn == NULL) {
+            /* not running or the local provider */
+            continue;
+        }
+
+        msg = dbus_message_new_method_call(NULL, MONITOR_PATH, MON_CLI_IFACE,
+                                           MON_CLI_IFACE_GETSTATS);
+        if (msg == NULL) {
+            return ENOMEM;
+        }
+
+        ret = sbus_conn_send(svc->conn, msg, mini->ctx->service_id_timeout,
+                             get_stats_reply, state,
+                             &state->pending[state->num_pending]);
+        dbus_message_unref(msg);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to ask [%s] for metrics "
+                  "[%d]: %s\n", svc->name, ret, sss_strerror(ret));
+            continue;
+        }
+        state->num_pending++;
+    }
+
+    if (state->num_pending == 0) {
+        return mon_srv_iface_getStats_finish(dbus_req, state->stats);
+    }
 
     return EOK;
 }
@@ -511,6 +646,7 @@ struct mon_srv_iface monitor_methods = {
     { &mon_srv_iface_meta, 0 },
     .getVersion = get_monitor_version,
     .RegisterService = client_registration,
+    .getStats = get_stats,
 };
 
 /* monitor_dbus_init
@@ -2318,6 +2454,7 @@ static void service_startup_handler(struct tevent_context *ev,
         return;
     }
 
+    sss_debug_prepare_fork();
     mt_svc->pid = fork();
     if (mt_svc->pid != 0) {
         if (mt_svc->pid == -1) {
@@ -6,6 +6,19 @@
 #include "sbus/sssd_dbus_invokers.h"
 #include "monitor_iface_generated.h"
 
+/* arguments for org.freedesktop.sssd.monitor.getStats */
+const struct sbus_arg_meta mon_srv_iface_getStats__out[] = {
+    { "stats", "s" },
+    { NULL, }
+};
+
+int mon_srv_iface_getStats_finish(struct sbus_request *req, const char *arg_stats)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_STRING, &arg_stats,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.monitor */
 const struct sbus_method_meta mon_srv_iface__methods[] = {
     {
@@ -22,6 +35,13 @@ const struct sbus_method_meta mon_srv_iface__methods[] = {
         offsetof(struct mon_srv_iface, RegisterService),
         NULL, /* no invoker */
     },
+    {
+        "getStats", /* name */
+        NULL, /* no in_args */
+        mon_srv_iface_getStats__out,
+        offsetof(struct mon_srv_iface, getStats),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
@@ -34,6 +54,19 @@ const struct sbus_interface_meta mon_srv_iface_meta = {
     sbus_invoke_get_all, /* GetAll invoker */
 };
 
+/* arguments for org.freedesktop.sssd.service.getStats */
+const struct sbus_arg_meta mon_cli_iface_getStats__out[] = {
+    { "stats", "s" },
+    { NULL, }
+};
+
+int mon_cli_iface_getStats_finish(struct sbus_request *req, const char *arg_stats)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_STRING, &arg_stats,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.service */
 const struct sbus_method_meta mon_cli_iface__methods[] = {
     {
@@ -99,6 +132,13 @@ const struct sbus_method_meta mon_cli_iface__methods[] = {
         offsetof(struct mon_cli_iface, sysbusReconnect),
         NULL, /* no invoker */
     },
+    {
+        "getStats", /* name */
+        NULL, /* no in_args */
+        mon_cli_iface_getStats__out,
+        offsetof(struct mon_cli_iface, getStats),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
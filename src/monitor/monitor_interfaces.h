@@ -40,6 +40,7 @@ int monitor_common_send_id(struct sbus_connection *conn,
                            const char *name, uint16_t version);
 int monitor_common_pong(struct sbus_request *dbus_req, void *data);
 int monitor_common_res_init(struct sbus_request *dbus_req, void *data);
+int monitor_common_get_stats(struct sbus_request *dbus_req, void *data);
 
 errno_t sss_monitor_init(TALLOC_CTX *mem_ctx,
                          struct tevent_context *ev,
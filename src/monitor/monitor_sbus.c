@@ -29,6 +29,7 @@
 #include "sbus/sssd_dbus.h"
 #include "sbus/sbus_client.h"
 #include "monitor/monitor_interfaces.h"
+#include "util/sss_metrics.h"
 
 int monitor_get_sbus_address(TALLOC_CTX *mem_ctx, char **address)
 {
@@ -162,6 +163,19 @@ int monitor_common_res_init(struct sbus_request *dbus_req, void *data)
     return sbus_request_return_and_finish(dbus_req, DBUS_TYPE_INVALID);
 }
 
+int monitor_common_get_stats(struct sbus_request *dbus_req, void *data)
+{
+    char *stats;
+    errno_t ret;
+
+    ret = sss_metrics_dump(dbus_req, debug_prg_name, &stats);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return mon_cli_iface_getStats_finish(dbus_req, stats);
+}
+
 errno_t sss_monitor_init(TALLOC_CTX *mem_ctx,
                          struct tevent_context *ev,
                          struct mon_cli_iface *mon_iface,
@@ -34,6 +34,8 @@ struct ad_access_ctx {
         GPO_ACCESS_CONTROL_ENFORCING
     } gpo_access_control_mode;
     int gpo_cache_timeout;
+    /* cached GPO access decisions, NULL if disabled */
+    struct be_access_cache *gpo_decision_cache;
     /* supported GPO map options */
     enum gpo_map_type {
         GPO_MAP_INTERACTIVE = 0,
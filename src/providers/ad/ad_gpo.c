@@ -40,6 +40,7 @@
 #include "util/child_common.h"
 #include "providers/data_provider.h"
 #include "providers/backend.h"
+#include "providers/be_access_cache.h"
 #include "providers/ad/ad_access.h"
 #include "providers/ad/ad_common.h"
 #include "providers/ad/ad_domain_info.h"
@@ -1569,6 +1570,9 @@ struct ad_gpo_access_state {
     struct gp_gpo **cse_filtered_gpos;
     int num_cse_filtered_gpos;
     int cse_gpo_index;
+    const char *service;
+    uint64_t membership;
+    bool cache_decision;
 };
 
 static void ad_gpo_connect_done(struct tevent_req *subreq);
@@ -1579,6 +1583,71 @@ static void ad_gpo_process_gpo_done(struct tevent_req *subreq);
 static errno_t ad_gpo_cse_step(struct tevent_req *req);
 static void ad_gpo_cse_done(struct tevent_req *subreq);
 
+/*
+ * Computes a fingerprint of the user's SID and group SIDs, so that cached
+ * decisions are not reused once the user's group membership changed.
+ */
+static errno_t
+ad_gpo_membership_fingerprint(const char *user,
+                              struct sss_domain_info *domain,
+                              uint64_t *_fingerprint)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *user_sid = NULL;
+    const char **group_sids = NULL;
+    const char **sids;
+    int group_size = 0;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = ad_gpo_get_sids(tmp_ctx, user, domain, &user_sid,
+                          &group_sids, &group_size);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    sids = talloc_array(tmp_ctx, const char *, group_size + 1);
+    if (sids == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    sids[0] = user_sid;
+    if (group_size > 0) {
+        memcpy(&sids[1], group_sids, group_size * sizeof(const char *));
+    }
+
+    *_fingerprint = be_access_cache_fingerprint(sids, group_size + 1);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static void
+ad_gpo_cache_decision(struct ad_gpo_access_state *state, errno_t result)
+{
+    errno_t ret;
+
+    if (!state->cache_decision) {
+        return;
+    }
+
+    ret = be_access_cache_store(state->access_ctx->gpo_decision_cache,
+                                state->user, state->service, NULL,
+                                state->membership, result);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to cache GPO access decision [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+}
+
 struct tevent_req *
 ad_gpo_access_send(TALLOC_CTX *mem_ctx,
                    struct tevent_context *ev,
@@ -1591,6 +1660,7 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
     struct tevent_req *subreq;
     struct ad_gpo_access_state *state;
     errno_t ret;
+    errno_t cached_ret;
     int hret;
     hash_key_t key;
     hash_value_t val;
@@ -1658,6 +1728,32 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
     state->user_domain = domain;
     state->host_domain = get_domains_head(domain);
 
+    state->cache_decision = false;
+    if (ctx->gpo_decision_cache != NULL) {
+        ret = ad_gpo_membership_fingerprint(user, domain, &state->membership);
+        if (ret == EOK) {
+            ret = be_access_cache_lookup(ctx->gpo_decision_cache, user,
+                                         service, NULL, state->membership,
+                                         &cached_ret);
+            if (ret == EOK) {
+                ret = cached_ret;
+                goto immediately;
+            }
+            state->cache_decision = true;
+        } else {
+            DEBUG(SSSDBG_TRACE_FUNC,
+                  "Unable to fingerprint group membership of %s, "
+                  "not caching the decision [%d]: %s\n",
+                  user, ret, sss_strerror(ret));
+        }
+    }
+
+    state->service = talloc_strdup(state, service);
+    if (state->service == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
     state->gpo_map_type = gpo_map_type;
     state->dacl_filtered_gpos = NULL;
     state->num_dacl_filtered_gpos = 0;
@@ -1769,6 +1865,7 @@ ad_gpo_connect_done(struct tevent_req *subreq)
                                        state->user_domain,
                                        state->host_domain,
                                        state->gpo_map_type);
+            ad_gpo_cache_decision(state, ret);
 
             if (ret == EOK) {
                 DEBUG(SSSDBG_TRACE_FUNC, "process_offline_gpos succeeded\n");
@@ -1891,6 +1988,7 @@ ad_gpo_target_dn_retrieval_done(struct tevent_req *subreq)
                                        state->user_domain,
                                        state->host_domain,
                                        state->gpo_map_type);
+            ad_gpo_cache_decision(state, ret);
 
             if (ret == EOK) {
                 DEBUG(SSSDBG_TRACE_FUNC, "process_offline_gpos succeeded\n");
@@ -2362,6 +2460,11 @@ ad_gpo_cse_done(struct tevent_req *subreq)
         goto done;
     }
 
+    if (cse_filtered_gpo->send_to_child) {
+        /* the policy was refreshed from the server */
+        be_access_cache_invalidate(state->access_ctx->gpo_decision_cache);
+    }
+
     state->cse_gpo_index++;
     ret = ad_gpo_cse_step(req);
 
@@ -2373,6 +2476,7 @@ ad_gpo_cse_done(struct tevent_req *subreq)
                                              state->user,
                                              state->user_domain,
                                              state->host_domain);
+        ad_gpo_cache_decision(state, ret);
         if (ret != EOK) {
             DEBUG(SSSDBG_OP_FAILURE, "HBAC processing failed: [%d](%s}\n",
                   ret, sss_strerror(ret));
@@ -4263,6 +4367,7 @@ gpo_fork_child(struct tevent_req *req)
         goto fail;
     }
 
+    sss_debug_prepare_fork();
     pid = fork();
 
     if (pid == 0) { /* child */
@@ -39,6 +39,7 @@
 #include "providers/ad/ad_id.h"
 #include "providers/ad/ad_srv.h"
 #include "providers/be_dyndns.h"
+#include "providers/be_access_cache.h"
 #include "providers/ad/ad_subdomains.h"
 #include "providers/ad/ad_domain_info.h"
 
@@ -286,6 +287,17 @@ static errno_t ad_init_gpo(struct ad_access_ctx *access_ctx)
     gpo_cache_timeout = dp_opt_get_int(options, AD_GPO_CACHE_TIMEOUT);
     access_ctx->gpo_cache_timeout = gpo_cache_timeout;
 
+    /* GPO decision cache */
+    ret = be_access_cache_init(access_ctx,
+                               dp_opt_get_int(options,
+                                              AD_GPO_DECISION_CACHE_TIMEOUT),
+                               &access_ctx->gpo_decision_cache);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Could not create GPO decision cache "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
     /* GPO logon maps */
     ret = sss_hash_create(access_ctx, 10, &access_ctx->gpo_map_options_table);
     if (ret != EOK) {
@@ -178,6 +178,7 @@ ad_machine_account_password_renewal_send(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    sss_debug_prepare_fork();
     child_pid = fork();
     if (child_pid == 0) { /* child */
         exec_child_ex(state, pipefd_to_child, pipefd_from_child,
@@ -0,0 +1,273 @@
+/*
+    SSSD
+
+    Access decision cache
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <time.h>
+#include <dhash.h>
+
+#include "util/util.h"
+#include "util/murmurhash3.h"
+#include "providers/be_access_cache.h"
+
+/* The whole table is dropped once it grows beyond this size, entries
+ * that belong to an older generation or that expired are otherwise only
+ * removed when they are looked up again. */
+#define BE_ACCESS_CACHE_MAX_ENTRIES 4096
+#define BE_ACCESS_CACHE_HASH_SEED 0xdeadbeef
+
+struct be_access_cache {
+    hash_table_t *table;
+    time_t timeout;
+    uint64_t generation;
+};
+
+struct be_access_cache_entry {
+    uint64_t generation;
+    uint64_t membership;
+    time_t expire;
+    errno_t result;
+};
+
+errno_t be_access_cache_init(TALLOC_CTX *mem_ctx,
+                             time_t timeout,
+                             struct be_access_cache **_cache)
+{
+    struct be_access_cache *cache;
+    errno_t ret;
+
+    if (timeout <= 0) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Access decision cache is disabled\n");
+        *_cache = NULL;
+        return EOK;
+    }
+
+    cache = talloc_zero(mem_ctx, struct be_access_cache);
+    if (cache == NULL) {
+        return ENOMEM;
+    }
+
+    cache->timeout = timeout;
+
+    ret = sss_hash_create(cache, 0, &cache->table);
+    if (ret != EOK) {
+        talloc_free(cache);
+        return ret;
+    }
+
+    *_cache = cache;
+    return EOK;
+}
+
+void be_access_cache_invalidate(struct be_access_cache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Invalidating cached access decisions\n");
+    cache->generation++;
+}
+
+uint64_t be_access_cache_fingerprint(const char **values, size_t count)
+{
+    uint32_t sum_hash = 0;
+    uint32_t xor_hash = 0;
+    uint32_t hash;
+    size_t i;
+
+    /* Combine the hashes of the individual values so that the fingerprint
+     * does not depend on the order in which the values were returned */
+    for (i = 0; i < count; i++) {
+        if (values[i] == NULL) {
+            continue;
+        }
+
+        hash = murmurhash3(values[i], strlen(values[i]),
+                           BE_ACCESS_CACHE_HASH_SEED);
+        sum_hash += hash;
+        xor_hash ^= hash;
+    }
+
+    return ((uint64_t) sum_hash << 32) | (xor_hash ^ (uint32_t) count);
+}
+
+static char *be_access_cache_key(TALLOC_CTX *mem_ctx,
+                                 const char *user,
+                                 const char *service,
+                                 const char *host)
+{
+    /* Use a separator that cannot appear in any of the names */
+    return talloc_asprintf(mem_ctx, "%s\x1f%s\x1f%s",
+                           user, service != NULL ? service : "",
+                           host != NULL ? host : "");
+}
+
+static void be_access_cache_remove(struct be_access_cache *cache,
+                                   hash_key_t *key,
+                                   struct be_access_cache_entry *entry)
+{
+    int hret;
+
+    hret = hash_delete(cache->table, key);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to remove cache entry [%s]\n",
+              hash_error_string(hret));
+    }
+
+    talloc_free(entry);
+}
+
+errno_t be_access_cache_lookup(struct be_access_cache *cache,
+                               const char *user,
+                               const char *service,
+                               const char *host,
+                               uint64_t membership,
+                               errno_t *_result)
+{
+    struct be_access_cache_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (cache == NULL || user == NULL) {
+        return ENOENT;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = be_access_cache_key(NULL, user, service, host);
+    if (key.str == NULL) {
+        return ENOMEM;
+    }
+
+    hret = hash_lookup(cache->table, &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        ret = ENOENT;
+        goto done;
+    } else if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to look up cache entry [%s]\n",
+              hash_error_string(hret));
+        ret = EIO;
+        goto done;
+    }
+
+    entry = talloc_get_type(value.ptr, struct be_access_cache_entry);
+    if (entry->generation != cache->generation
+            || entry->expire < time(NULL)) {
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Cached decision for [%s] is stale\n",
+              user);
+        be_access_cache_remove(cache, &key, entry);
+        ret = ENOENT;
+        goto done;
+    }
+
+    if (entry->membership != membership) {
+        DEBUG(SSSDBG_TRACE_INTERNAL,
+              "Group membership of [%s] changed since the decision was "
+              "cached\n", user);
+        be_access_cache_remove(cache, &key, entry);
+        ret = ENOENT;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Using cached access decision for [%s]: %s\n",
+          user, sss_strerror(entry->result));
+    *_result = entry->result;
+    ret = EOK;
+
+done:
+    talloc_free(key.str);
+    return ret;
+}
+
+errno_t be_access_cache_store(struct be_access_cache *cache,
+                              const char *user,
+                              const char *service,
+                              const char *host,
+                              uint64_t membership,
+                              errno_t result)
+{
+    struct be_access_cache_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (cache == NULL || user == NULL) {
+        return EOK;
+    }
+
+    if (result != EOK && result != ERR_ACCESS_DENIED) {
+        /* Do not cache errors, they are usually transient */
+        return EOK;
+    }
+
+    if (hash_count(cache->table) >= BE_ACCESS_CACHE_MAX_ENTRIES) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Access decision cache is full, flushing\n");
+        talloc_zfree(cache->table);
+        ret = sss_hash_create(cache, 0, &cache->table);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    entry = talloc_zero(cache->table, struct be_access_cache_entry);
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+
+    entry->generation = cache->generation;
+    entry->membership = membership;
+    entry->expire = time(NULL) + cache->timeout;
+    entry->result = result;
+
+    key.type = HASH_KEY_STRING;
+    key.str = be_access_cache_key(entry, user, service, host);
+    if (key.str == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Free the entry that is about to be replaced */
+    hret = hash_lookup(cache->table, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        be_access_cache_remove(cache, &key, value.ptr);
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = entry;
+
+    hret = hash_enter(cache->table, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to store cache entry [%s]\n",
+              hash_error_string(hret));
+        ret = EIO;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(entry);
+    }
+    return ret;
+}
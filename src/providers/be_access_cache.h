@@ -0,0 +1,82 @@
+/*
+    SSSD
+
+    Access decision cache
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _BE_ACCESS_CACHE_H_
+#define _BE_ACCESS_CACHE_H_
+
+#include <stdint.h>
+#include <talloc.h>
+#include <time.h>
+
+#include "util/util_errors.h"
+
+/**
+ * Cache of access control decisions keyed by (user, service, host).
+ *
+ * An entry is only valid if it was stored with the same rule set
+ * generation and the same group membership fingerprint of the user and
+ * if it is not older than the timeout. The provider bumps the generation
+ * with be_access_cache_invalidate() every time its rules or policies
+ * change.
+ */
+struct be_access_cache;
+
+/**
+ * Create a new cache. A timeout of 0 disables caching, in that case
+ * *_cache is set to NULL and all other functions are no-ops.
+ */
+errno_t be_access_cache_init(TALLOC_CTX *mem_ctx,
+                             time_t timeout,
+                             struct be_access_cache **_cache);
+
+/**
+ * Drop all cached decisions.
+ */
+void be_access_cache_invalidate(struct be_access_cache *cache);
+
+/**
+ * Compute an order independent fingerprint of a list of values,
+ * e.g. the group memberships of a user.
+ */
+uint64_t be_access_cache_fingerprint(const char **values, size_t count);
+
+/**
+ * Look up a cached decision. Returns EOK and the cached result in
+ * _result, ENOENT if there is no valid entry.
+ */
+errno_t be_access_cache_lookup(struct be_access_cache *cache,
+                               const char *user,
+                               const char *service,
+                               const char *host,
+                               uint64_t membership,
+                               errno_t *_result);
+
+/**
+ * Store a decision. Only EOK and ERR_ACCESS_DENIED are cached.
+ */
+errno_t be_access_cache_store(struct be_access_cache *cache,
+                              const char *user,
+                              const char *service,
+                              const char *host,
+                              uint64_t membership,
+                              errno_t result);
+
+#endif /* _BE_ACCESS_CACHE_H_ */
@@ -957,6 +957,7 @@ struct tevent_req *be_nsupdate_send(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    sss_debug_prepare_fork();
     child_pid = fork();
 
     if (child_pid == 0) { /* child */
@@ -138,6 +138,9 @@ struct be_refresh_cb {
 
 struct be_refresh_ctx {
     struct be_refresh_cb callbacks[BE_REFRESH_TYPE_SENTINEL];
+
+    /* names reported as used by the responders since the last refresh */
+    hash_table_t *hints[BE_REFRESH_TYPE_SENTINEL];
 };
 
 struct be_refresh_ctx *be_refresh_ctx_init(TALLOC_CTX *mem_ctx)
@@ -179,11 +182,74 @@ errno_t be_refresh_add_cb(struct be_refresh_ctx *ctx,
     return EOK;
 }
 
+errno_t be_refresh_hint(struct be_refresh_ctx *ctx,
+                        enum be_refresh_type type,
+                        const char **names,
+                        size_t num_names)
+{
+    hash_key_t key;
+    hash_value_t value;
+    size_t i;
+    errno_t ret;
+    int hret;
+
+    if (ctx == NULL || type >= BE_REFRESH_TYPE_SENTINEL) {
+        return EINVAL;
+    }
+
+    if (ctx->hints[type] == NULL) {
+        ret = sss_hash_create(ctx, num_names, &ctx->hints[type]);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    key.type = HASH_KEY_STRING;
+    value.type = HASH_VALUE_UNDEF;
+
+    for (i = 0; i < num_names; i++) {
+        key.str = discard_const(names[i]);
+
+        hret = hash_enter(ctx->hints[type], &key, &value);
+        if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to store refresh hint [%s]\n",
+                  hash_error_string(hret));
+            return EIO;
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Received %zu %s to refresh\n",
+          num_names, ctx->callbacks[type].name);
+
+    return EOK;
+}
+
+/* Keep only the values that were reported as used. */
+static void be_refresh_filter_hot(hash_table_t *hints, char **values)
+{
+    hash_key_t key;
+    size_t i;
+    size_t j;
+
+    key.type = HASH_KEY_STRING;
+
+    for (i = 0, j = 0; values[i] != NULL; i++) {
+        key.str = values[i];
+        if (hints != NULL && hash_has_key(hints, &key)) {
+            values[j] = values[i];
+            j++;
+        }
+    }
+
+    values[j] = NULL;
+}
+
 struct be_refresh_state {
     struct tevent_context *ev;
     struct be_ctx *be_ctx;
     struct be_refresh_ctx *ctx;
     struct be_refresh_cb *cb;
+    hash_table_t *hints[BE_REFRESH_TYPE_SENTINEL];
 
     struct sss_domain_info *domain;
     enum be_refresh_type index;
@@ -201,6 +267,7 @@ struct tevent_req *be_refresh_send(TALLOC_CTX *mem_ctx,
 {
     struct be_refresh_state *state = NULL;
     struct tevent_req *req = NULL;
+    enum be_refresh_type type;
     errno_t ret;
 
     req = tevent_req_create(mem_ctx, &state,
@@ -220,6 +287,12 @@ struct tevent_req *be_refresh_send(TALLOC_CTX *mem_ctx,
         goto immediately;
     }
 
+    /* Start collecting hints for the next run. */
+    for (type = 0; type < BE_REFRESH_TYPE_SENTINEL; type++) {
+        state->hints[type] = talloc_steal(state, state->ctx->hints[type]);
+        state->ctx->hints[type] = NULL;
+    }
+
     ret = be_refresh_step(req);
     if (ret == EOK) {
         goto immediately;
@@ -279,6 +352,10 @@ static errno_t be_refresh_step(struct tevent_req *req)
             goto done;
         }
 
+        if (state->be_ctx->domain->refresh_hot_entries > 0) {
+            be_refresh_filter_hot(state->hints[state->index], values);
+        }
+
         DEBUG(SSSDBG_TRACE_FUNC, "Refreshing %s in domain %s\n",
               state->cb->name, state->domain->name);
 
@@ -60,6 +60,15 @@ errno_t be_refresh_add_cb(struct be_refresh_ctx *ctx,
                           be_refresh_recv_t recv_fn,
                           void *pvt);
 
+/**
+ * Record names that the responders report as used. If refresh_hot_entries
+ * is set, the next refresh only refreshes expired records found here.
+ */
+errno_t be_refresh_hint(struct be_refresh_ctx *ctx,
+                        enum be_refresh_type type,
+                        const char **names,
+                        size_t num_names);
+
 struct tevent_req *be_refresh_send(TALLOC_CTX *mem_ctx,
                                    struct tevent_context *ev,
                                    struct be_ctx *be_ctx,
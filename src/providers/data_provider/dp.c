@@ -61,7 +61,10 @@ static int dp_destructor(struct data_provider *provider)
     dp_terminate_active_requests(provider);
 
     for (client = 0; client != DP_CLIENT_SENTINEL; client++) {
-        talloc_zfree(provider->clients[client]);
+        /* The destructor removes the client from the list. */
+        while (provider->clients[client] != NULL) {
+            talloc_free(provider->clients[client]);
+        }
     }
 
     return 0;
@@ -73,7 +76,7 @@ errno_t dp_init(struct tevent_context *ev,
                 gid_t gid)
 {
     struct data_provider *provider;
-
+    bool use_bin;
     errno_t ret;
 
     provider = talloc_zero(be_ctx, struct data_provider);
@@ -108,6 +111,22 @@ errno_t dp_init(struct tevent_context *ev,
         goto done;
     }
 
+    ret = confdb_get_bool(be_ctx->cdb, be_ctx->conf_path,
+                          CONFDB_DOMAIN_DP_BINARY_TRANSPORT, false, &use_bin);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to read %s [%d]: %s\n",
+              CONFDB_DOMAIN_DP_BINARY_TRANSPORT, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    if (use_bin) {
+        /* Responders fall back to D-Bus if this is not available. */
+        ret = dp_bin_init(provider);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Binary transport is disabled\n");
+        }
+    }
+
     be_ctx->provider = provider;
 
     ret = dp_init_modules(provider, &provider->modules);
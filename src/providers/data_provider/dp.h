@@ -80,6 +80,7 @@ enum dp_methods {
     DPM_AUTOFS_HANDLER,
     DPM_HOSTID_HANDLER,
     DPM_DOMAINS_HANDLER,
+    DPM_ACCOUNT_BATCH_HANDLER,
 
     DP_METHOD_SENTINEL
 };
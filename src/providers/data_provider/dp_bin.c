@@ -0,0 +1,936 @@
+/*
+    SSSD
+
+    Binary transport between responders and data provider - server
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "providers/data_provider/dp_private.h"
+#include "providers/data_provider/dp_request.h"
+#include "providers/data_provider/dp_bin.h"
+#include "providers/backend.h"
+#include "util/util.h"
+
+struct dp_bin_server {
+    struct data_provider *provider;
+    char *path;
+    int fd;
+    struct tevent_fd *fde;
+};
+
+struct dp_bin_out {
+    struct dp_bin_out *prev;
+    struct dp_bin_out *next;
+
+    uint8_t *frame;
+    size_t len;
+    size_t written;
+};
+
+struct dp_bin_conn {
+    struct dp_bin_server *server;
+    int fd;
+    struct tevent_fd *fde;
+
+    enum dp_clients client;
+    pid_t pid;
+
+    uint8_t *in;
+    size_t in_len;
+    struct dp_bin_out *out;
+};
+
+struct dp_bin_call {
+    struct dp_bin_conn *conn;
+    struct tevent_req *req;
+    uint32_t id;
+};
+
+struct dp_bin_batch_entry {
+    uint32_t id;
+    struct dp_id_data *data;
+};
+
+/* Account requests from one batch frame that can be looked up at once. */
+struct dp_bin_batch_call {
+    struct dp_bin_conn *conn;
+    struct tevent_req *req;
+    uint32_t dp_flags;
+
+    size_t count;
+    struct dp_bin_batch_entry *entries;
+};
+
+/* Largest number of values sent to the batch handler at once, it must not
+ * exceed the wildcard size limit of the providers. */
+#define DP_BIN_BATCH_MAX 64
+
+static errno_t dp_bin_conn_write(struct dp_bin_conn *conn);
+
+static errno_t dp_bin_queue_frame(struct dp_bin_conn *conn,
+                                  uint8_t *frame, size_t len)
+{
+    struct dp_bin_out *out;
+    bool idle;
+
+    out = talloc_zero(conn, struct dp_bin_out);
+    if (out == NULL) {
+        return ENOMEM;
+    }
+
+    out->frame = talloc_steal(out, frame);
+    out->len = len;
+
+    idle = conn->out == NULL;
+    DLIST_ADD_END(conn->out, out, struct dp_bin_out *);
+
+    /* Most replies fit into the socket buffer, try to send them without
+     * another round trip through the main loop. */
+    if (idle) {
+        return dp_bin_conn_write(conn);
+    }
+
+    return EOK;
+}
+
+/* On failure the caller must close the connection, otherwise the responder
+ * would wait for the reply forever. */
+static errno_t dp_bin_reply(struct dp_bin_conn *conn,
+                            uint32_t id,
+                            uint32_t status,
+                            const struct dp_bin_reply *reply)
+{
+    uint8_t *frame;
+    size_t len;
+
+    frame = dp_bin_pack_reply(conn, id, status, reply, &len);
+    if (frame == NULL) {
+        return ENOMEM;
+    }
+
+    return dp_bin_queue_frame(conn, frame, len);
+}
+
+static void dp_bin_orphan_done(struct tevent_req *req)
+{
+    talloc_free(req);
+}
+
+static int dp_bin_call_destructor(struct dp_bin_call *call)
+{
+    /* The connection went away, let the request finish on its own so
+     * that its result is still written to the cache. */
+    if (call->req != NULL) {
+        tevent_req_set_callback(call->req, dp_bin_orphan_done, NULL);
+    }
+
+    return 0;
+}
+
+static int dp_bin_batch_call_destructor(struct dp_bin_batch_call *call)
+{
+    if (call->req != NULL) {
+        tevent_req_set_callback(call->req, dp_bin_orphan_done, NULL);
+    }
+
+    return 0;
+}
+
+static struct dp_client *dp_bin_client(struct dp_bin_conn *conn)
+{
+    /* Each process of a responder has its own D-Bus client. */
+    return dp_client_find(conn->server->provider, conn->client, conn->pid);
+}
+
+static errno_t dp_bin_account_parse(TALLOC_CTX *mem_ctx,
+                                    const uint8_t *frame,
+                                    size_t len,
+                                    uint32_t *_dp_flags,
+                                    struct dp_id_data **_data)
+{
+    struct dp_bin_account_req areq;
+    struct dp_id_data *data;
+    errno_t ret;
+
+    ret = dp_bin_unpack_account_req(frame, len, &areq);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* Continue the client request of the responder. */
+    sss_trace_id = areq.trace_id;
+
+    /* Initgroups update the memory cache of the NSS responder through
+     * D-Bus when finished, they are not served here. */
+    if ((areq.entry_type & BE_REQ_TYPE_MASK) == BE_REQ_INITGROUPS) {
+        return ENOTSUP;
+    }
+
+    /* The strings point into the input buffer which is reused for the
+     * next frame. */
+    data = talloc_zero(mem_ctx, struct dp_id_data);
+    if (data == NULL) {
+        return ENOMEM;
+    }
+
+    ret = dp_id_data_init(data, areq.entry_type, areq.attr_type,
+                          talloc_strdup(data, areq.filter),
+                          talloc_strdup(data, areq.domain),
+                          talloc_strdup(data, areq.extra));
+    if (ret != EOK) {
+        talloc_free(data);
+        return ret;
+    }
+
+    DEBUG(SSSDBG_FUNC_DATA,
+          "Got binary request for [%#"PRIx32"][%s][%"PRId32"][%s]\n",
+          data->entry_type, be_req2str(data->entry_type),
+          data->attr_type, areq.filter);
+
+    *_dp_flags = areq.dp_flags;
+    *_data = data;
+
+    return EOK;
+}
+
+static void dp_bin_account_done(struct tevent_req *req);
+
+static errno_t dp_bin_account_start(struct dp_bin_conn *conn,
+                                    uint32_t id,
+                                    uint32_t dp_flags,
+                                    struct dp_id_data *data)
+{
+    struct data_provider *provider = conn->server->provider;
+    struct dp_bin_call *call;
+    errno_t ret;
+
+    /* The call takes over data even on failure. */
+    call = talloc_zero(conn, struct dp_bin_call);
+    if (call == NULL) {
+        talloc_free(data);
+        return ENOMEM;
+    }
+    call->conn = conn;
+    call->id = id;
+
+    talloc_steal(call, data);
+
+    call->req = dp_req_send(call, provider, dp_bin_client(conn),
+                            data->domain, "Account", DPT_ID,
+                            DPM_ACCOUNT_HANDLER, dp_flags, data, NULL);
+    if (call->req == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Requests are owned by the provider like the ones that come over
+     * D-Bus, the call only waits for the result. */
+    talloc_steal(provider, call->req);
+    tevent_req_set_callback(call->req, dp_bin_account_done, call);
+    talloc_set_destructor(call, dp_bin_call_destructor);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(call);
+    }
+
+    return ret;
+}
+
+static errno_t dp_bin_account(struct dp_bin_conn *conn,
+                              uint32_t id,
+                              const uint8_t *frame,
+                              size_t len)
+{
+    struct dp_id_data *data;
+    uint32_t dp_flags;
+    errno_t ret;
+
+    ret = dp_bin_account_parse(conn, frame, len, &dp_flags, &data);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return dp_bin_account_start(conn, id, dp_flags, data);
+}
+
+static void dp_bin_account_done(struct tevent_req *req)
+{
+    struct dp_bin_call *call;
+    struct dp_bin_conn *conn;
+    struct dp_reply_std reply;
+    struct dp_bin_reply bin_reply;
+    errno_t ret;
+
+    call = tevent_req_callback_data(req, struct dp_bin_call);
+    conn = call->conn;
+
+    ret = dp_req_recv(call, req, struct dp_reply_std, &reply);
+    talloc_zfree(call->req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Binary request failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        ret = dp_bin_reply(conn, call->id, ret, NULL);
+    } else {
+        bin_reply.dp_error = reply.dp_error;
+        bin_reply.error = reply.error;
+        bin_reply.message = reply.message;
+        ret = dp_bin_reply(conn, call->id, EOK, &bin_reply);
+    }
+
+    talloc_free(call);
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to send reply, closing "
+              "connection [%d]: %s\n", ret, sss_strerror(ret));
+        talloc_free(conn);
+    }
+}
+
+static bool dp_bin_batchable(struct dp_id_data *data)
+{
+    switch (data->entry_type & BE_REQ_TYPE_MASK) {
+    case BE_REQ_USER:
+    case BE_REQ_GROUP:
+        break;
+    default:
+        return false;
+    }
+
+    if (data->filter_type != BE_FILTER_NAME
+            && data->filter_type != BE_FILTER_IDNUM) {
+        return false;
+    }
+
+    /* e.g. lookups by user principal name */
+    return data->extra_value == NULL && data->domain != NULL;
+}
+
+static struct dp_bin_batch_call *
+dp_bin_batch_find(struct dp_bin_batch_call **calls,
+                  size_t num_calls,
+                  uint32_t dp_flags,
+                  struct dp_id_data *data)
+{
+    struct dp_id_data *first;
+    size_t i;
+
+    for (i = 0; i < num_calls; i++) {
+        first = calls[i]->entries[0].data;
+        if (calls[i]->dp_flags == dp_flags
+                && calls[i]->count < DP_BIN_BATCH_MAX
+                && first->entry_type == data->entry_type
+                && first->filter_type == data->filter_type
+                && strcmp(first->domain, data->domain) == 0) {
+            return calls[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void dp_bin_batch_done(struct tevent_req *req);
+
+static errno_t dp_bin_batch_start(struct dp_bin_batch_call *call)
+{
+    struct data_provider *provider = call->conn->server->provider;
+    struct dp_id_batch_data *data;
+    struct dp_id_data *first;
+    size_t i;
+
+    first = call->entries[0].data;
+
+    /* The request may outlive the call, copy the values. */
+    data = talloc_zero(call, struct dp_id_batch_data);
+    if (data == NULL) {
+        return ENOMEM;
+    }
+
+    data->entry_type = first->entry_type;
+    data->filter_type = first->filter_type;
+    data->count = call->count;
+    data->domain = talloc_strdup(data, first->domain);
+    data->values = talloc_zero_array(data, const char *, call->count);
+    if (data->domain == NULL || data->values == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < call->count; i++) {
+        data->values[i] = talloc_strdup(data->values,
+                                        call->entries[i].data->filter_value);
+        if (data->values[i] == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Looking up %zu entries of type [%s] at once\n",
+          call->count, be_req2str(data->entry_type));
+
+    call->req = dp_req_send(call, provider, dp_bin_client(call->conn),
+                            data->domain, "Account batch", DPT_ID,
+                            DPM_ACCOUNT_BATCH_HANDLER, call->dp_flags,
+                            data, NULL);
+    if (call->req == NULL) {
+        return ENOMEM;
+    }
+
+    talloc_steal(provider, call->req);
+    tevent_req_set_callback(call->req, dp_bin_batch_done, call);
+    talloc_set_destructor(call, dp_bin_batch_call_destructor);
+
+    return EOK;
+}
+
+static void dp_bin_batch_done(struct tevent_req *req)
+{
+    struct dp_bin_reply found_reply = { DP_ERR_OK, EOK, NULL };
+    struct dp_id_batch_reply *reply = NULL;
+    struct dp_bin_batch_call *call;
+    struct dp_bin_conn *conn;
+    size_t num_found = 0;
+    size_t i;
+    errno_t ret;
+
+    call = tevent_req_callback_data(req, struct dp_bin_batch_call);
+    conn = call->conn;
+
+    ret = dp_req_recv_ptr(call, req, struct dp_id_batch_reply, &reply);
+    talloc_zfree(call->req);
+    if (ret != EOK || reply->dp_error != DP_ERR_OK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Batch lookup failed, looking up "
+              "entries one by one\n");
+        reply = NULL;
+    }
+
+    /* Entries that were not found need to go through the account handler
+     * so they are removed from the cache or reported as missing. */
+    for (i = 0; i < call->count; i++) {
+        if (reply != NULL && i < reply->count && reply->found[i]) {
+            num_found++;
+            ret = dp_bin_reply(conn, call->entries[i].id, EOK, &found_reply);
+        } else {
+            ret = dp_bin_account_start(conn, call->entries[i].id,
+                                       call->dp_flags,
+                                       call->entries[i].data);
+            call->entries[i].data = NULL;
+        }
+
+        if (ret != EOK) {
+            break;
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Batch lookup found %zu of %zu entries\n",
+          num_found, call->count);
+
+    talloc_free(call);
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to finish batch, closing "
+              "connection [%d]: %s\n", ret, sss_strerror(ret));
+        talloc_free(conn);
+    }
+}
+
+static errno_t dp_bin_dispatch(struct dp_bin_conn *conn,
+                               const struct dp_bin_header *hdr,
+                               const uint8_t *frame);
+
+static errno_t dp_bin_batch(struct dp_bin_conn *conn,
+                            const uint8_t *frame,
+                            size_t len)
+{
+    struct data_provider *provider = conn->server->provider;
+    struct dp_bin_batch_call **calls;
+    struct dp_bin_batch_call *call;
+    struct dp_bin_header hdr;
+    struct dp_id_data *data;
+    const uint8_t *sub;
+    uint32_t dp_flags;
+    size_t num_calls = 0;
+    size_t offset = 0;
+    bool enabled;
+    size_t i;
+    errno_t ret;
+
+    enabled = dp_method_enabled(provider, DPT_ID, DPM_ACCOUNT_BATCH_HANDLER);
+
+    calls = talloc_zero_array(conn, struct dp_bin_batch_call *,
+                              len / DP_BIN_HEADER_SIZE);
+    if (calls == NULL) {
+        return ENOMEM;
+    }
+
+    while ((ret = dp_bin_batch_next(frame, len, &offset, &hdr, &sub)) == EOK) {
+        if (!enabled || hdr.code != DP_BIN_GET_ACCOUNT_INFO) {
+            ret = dp_bin_dispatch(conn, &hdr, sub);
+            if (ret != EOK) {
+                goto done;
+            }
+            continue;
+        }
+
+        ret = dp_bin_account_parse(conn, sub, hdr.length, &dp_flags, &data);
+        if (ret == EINVAL || ret == EBADMSG || ret == ENOTSUP) {
+            ret = dp_bin_reply(conn, hdr.id, ret, NULL);
+            if (ret != EOK) {
+                goto done;
+            }
+            continue;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        if (!dp_bin_batchable(data)) {
+            ret = dp_bin_account_start(conn, hdr.id, dp_flags, data);
+            if (ret != EOK) {
+                goto done;
+            }
+            continue;
+        }
+
+        call = dp_bin_batch_find(calls, num_calls, dp_flags, data);
+        if (call == NULL) {
+            call = talloc_zero(calls, struct dp_bin_batch_call);
+            if (call == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+            call->conn = conn;
+            call->dp_flags = dp_flags;
+            call->entries = talloc_zero_array(call, struct dp_bin_batch_entry,
+                                              DP_BIN_BATCH_MAX);
+            if (call->entries == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+            calls[num_calls++] = call;
+        }
+
+        call->entries[call->count].id = hdr.id;
+        call->entries[call->count].data = talloc_steal(call->entries, data);
+        call->count++;
+    }
+
+    if (ret != ENOENT) {
+        /* the stream is not in sync any more */
+        DEBUG(SSSDBG_CRIT_FAILURE, "Malformed batch [%d]: %s\n",
+              ret, sss_strerror(ret));
+        ret = EIO;
+        goto done;
+    }
+
+    for (i = 0; i < num_calls; i++) {
+        call = talloc_steal(conn, calls[i]);
+        calls[i] = NULL;
+
+        if (call->count == 1) {
+            ret = dp_bin_account_start(conn, call->entries[0].id,
+                                       call->dp_flags, call->entries[0].data);
+            call->entries[0].data = NULL;
+            talloc_free(call);
+        } else {
+            ret = dp_bin_batch_start(call);
+            if (ret != EOK) {
+                talloc_free(call);
+            }
+        }
+
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(calls);
+    return ret;
+}
+
+static errno_t dp_bin_register(struct dp_bin_conn *conn,
+                               uint32_t id,
+                               const uint8_t *frame,
+                               size_t len)
+{
+    struct dp_bin_reply reply = { DP_ERR_OK, EOK, NULL };
+    const char *client_name;
+    enum dp_clients client;
+    errno_t ret;
+
+    ret = dp_bin_unpack_register(frame, len, &client_name);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    for (client = 0; client != DP_CLIENT_SENTINEL; client++) {
+        if (client_name != NULL
+                && strcasecmp(client_name, dp_client_to_string(client)) == 0) {
+            break;
+        }
+    }
+
+    if (client == DP_CLIENT_SENTINEL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unknown binary client [%s]\n",
+              client_name == NULL ? "(null)" : client_name);
+        return EINVAL;
+    }
+
+    DEBUG(SSSDBG_CONF_SETTINGS, "Added binary connection for %s\n",
+          dp_client_to_string(client));
+    conn->client = client;
+
+    return dp_bin_reply(conn, id, EOK, &reply);
+}
+
+static errno_t dp_bin_dispatch(struct dp_bin_conn *conn,
+                               const struct dp_bin_header *hdr,
+                               const uint8_t *frame)
+{
+    errno_t ret;
+
+    switch (hdr->code) {
+    case DP_BIN_REGISTER:
+        return dp_bin_register(conn, hdr->id, frame, hdr->length);
+    case DP_BIN_GET_ACCOUNT_INFO:
+        ret = dp_bin_account(conn, hdr->id, frame, hdr->length);
+        break;
+    case DP_BIN_BATCH:
+        return dp_bin_batch(conn, frame, hdr->length);
+    default:
+        ret = ENOTSUP;
+        break;
+    }
+
+    if (ret == EINVAL || ret == EBADMSG || ret == ENOTSUP) {
+        /* Refuse this request only, the stream is still in sync. */
+        DEBUG(SSSDBG_OP_FAILURE, "Refusing binary request %"PRIu32
+              " [%d]: %s\n", hdr->id, ret, sss_strerror(ret));
+        ret = dp_bin_reply(conn, hdr->id, ret, NULL);
+    }
+
+    return ret;
+}
+
+static void dp_bin_conn_read(struct dp_bin_conn *conn)
+{
+    struct dp_bin_header hdr;
+    size_t done = 0;
+    ssize_t len;
+    errno_t ret;
+
+    len = recv(conn->fd, conn->in + conn->in_len,
+               DP_BIN_MAX_FRAME_SIZE - conn->in_len, 0);
+    if (len == -1) {
+        ret = errno;
+        if (ret == EAGAIN || ret == EINTR) {
+            return;
+        }
+
+        DEBUG(SSSDBG_OP_FAILURE, "recv() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        talloc_free(conn);
+        return;
+    } else if (len == 0) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Binary client disconnected\n");
+        talloc_free(conn);
+        return;
+    }
+
+    conn->in_len += len;
+
+    /* Process all complete frames, a partial one stays in the buffer. */
+    while (true) {
+        ret = dp_bin_parse_header(conn->in + done, conn->in_len - done, &hdr);
+        if (ret == EAGAIN) {
+            break;
+        } else if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Invalid frame, closing connection\n");
+            talloc_free(conn);
+            return;
+        }
+
+        if (conn->in_len - done < hdr.length) {
+            break;
+        }
+
+        ret = dp_bin_dispatch(conn, &hdr, conn->in + done);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to process request, closing "
+                  "connection [%d]: %s\n", ret, sss_strerror(ret));
+            talloc_free(conn);
+            return;
+        }
+
+        done += hdr.length;
+    }
+
+    if (done > 0) {
+        memmove(conn->in, conn->in + done, conn->in_len - done);
+        conn->in_len -= done;
+    }
+}
+
+static errno_t dp_bin_conn_write(struct dp_bin_conn *conn)
+{
+    struct dp_bin_out *out;
+    ssize_t len;
+    errno_t ret;
+
+    while ((out = conn->out) != NULL) {
+        len = send(conn->fd, out->frame + out->written,
+                   out->len - out->written, MSG_NOSIGNAL);
+        if (len == -1) {
+            ret = errno;
+            if (ret == EAGAIN || ret == EINTR) {
+                TEVENT_FD_WRITEABLE(conn->fde);
+                return EOK;
+            }
+
+            DEBUG(SSSDBG_OP_FAILURE, "send() failed [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            return ret;
+        }
+
+        out->written += len;
+        if (out->written < out->len) {
+            TEVENT_FD_WRITEABLE(conn->fde);
+            return EOK;
+        }
+
+        DLIST_REMOVE(conn->out, out);
+        talloc_free(out);
+    }
+
+    TEVENT_FD_NOT_WRITEABLE(conn->fde);
+    return EOK;
+}
+
+static void dp_bin_conn_handler(struct tevent_context *ev,
+                                struct tevent_fd *fde,
+                                uint16_t flags, void *ptr)
+{
+    struct dp_bin_conn *conn = talloc_get_type(ptr, struct dp_bin_conn);
+    errno_t ret;
+
+    if (flags & TEVENT_FD_WRITE) {
+        ret = dp_bin_conn_write(conn);
+        if (ret != EOK) {
+            talloc_free(conn);
+        }
+        return;
+    }
+
+    if (flags & TEVENT_FD_READ) {
+        dp_bin_conn_read(conn);
+    }
+}
+
+static int dp_bin_conn_destructor(struct dp_bin_conn *conn)
+{
+    talloc_zfree(conn->fde);
+    if (conn->fd != -1) {
+        close(conn->fd);
+    }
+
+    return 0;
+}
+
+static errno_t dp_bin_check_peer(struct dp_bin_conn *conn)
+{
+    struct dp_bin_server *server = conn->server;
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    errno_t ret;
+
+    ret = getsockopt(conn->fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len);
+    if (ret != 0) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "getsockopt() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (cred.uid != 0 && cred.uid != server->provider->uid) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Refusing binary connection from "
+              "uid %"SPRIuid"\n", cred.uid);
+        return EACCES;
+    }
+
+    conn->pid = cred.pid;
+
+    return EOK;
+}
+
+static void dp_bin_accept(struct tevent_context *ev,
+                          struct tevent_fd *fde,
+                          uint16_t flags, void *ptr)
+{
+    struct dp_bin_server *server = talloc_get_type(ptr, struct dp_bin_server);
+    struct dp_bin_conn *conn;
+    int fd;
+    errno_t ret;
+
+    fd = accept4(server->fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_OP_FAILURE, "accept() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return;
+    }
+
+    conn = talloc_zero(server, struct dp_bin_conn);
+    if (conn == NULL) {
+        close(fd);
+        return;
+    }
+    conn->server = server;
+    conn->fd = fd;
+    conn->client = DP_CLIENT_SENTINEL;
+    talloc_set_destructor(conn, dp_bin_conn_destructor);
+
+    ret = dp_bin_check_peer(conn);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_fd_nonblocking(fd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    conn->in = talloc_size(conn, DP_BIN_MAX_FRAME_SIZE);
+    if (conn->in == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    conn->fde = tevent_add_fd(ev, conn, fd, TEVENT_FD_READ,
+                              dp_bin_conn_handler, conn);
+    if (conn->fde == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(conn);
+    }
+}
+
+static int dp_bin_server_destructor(struct dp_bin_server *server)
+{
+    talloc_zfree(server->fde);
+    if (server->fd != -1) {
+        close(server->fd);
+        unlink(server->path);
+    }
+
+    return 0;
+}
+
+errno_t dp_bin_init(struct data_provider *provider)
+{
+    struct dp_bin_server *server;
+    struct sockaddr_un addr;
+    errno_t ret;
+
+    server = talloc_zero(provider, struct dp_bin_server);
+    if (server == NULL) {
+        return ENOMEM;
+    }
+    server->provider = provider;
+    server->fd = -1;
+
+    server->path = talloc_asprintf(server, "%s/%s_%s", PIPE_PATH,
+                                   DP_BIN_PIPE,
+                                   provider->be_ctx->domain->name);
+    if (server->path == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(server->path) >= sizeof(addr.sun_path)) {
+        ret = ENAMETOOLONG;
+        goto done;
+    }
+    strncpy(addr.sun_path, server->path, sizeof(addr.sun_path) - 1);
+
+    server->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->fd == -1) {
+        ret = errno;
+        goto done;
+    }
+    talloc_set_destructor(server, dp_bin_server_destructor);
+
+    ret = sss_fd_nonblocking(server->fd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* make sure we have no old sockets around */
+    unlink(server->path);
+
+    if (bind(server->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1
+            || listen(server->fd, 10) == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    if (chmod(server->path, S_IRUSR | S_IWUSR) == -1
+            || chown(server->path, provider->uid, provider->gid) == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    server->fde = tevent_add_fd(provider->ev, server, server->fd,
+                                TEVENT_FD_READ, dp_bin_accept, server);
+    if (server->fde == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Listening for binary requests on %s\n",
+          server->path);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to set up binary transport "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        talloc_free(server);
+    }
+
+    return ret;
+}
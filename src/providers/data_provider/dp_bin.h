@@ -0,0 +1,129 @@
+/*
+    SSSD
+
+    Binary transport between responders and data provider
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _DP_BIN_H_
+#define _DP_BIN_H_
+
+#include <stdint.h>
+#include <talloc.h>
+
+#include "util/util_errors.h"
+
+/* The binary transport is a private alternative to D-Bus for the hottest
+ * data provider methods. It is a stream of frames over a unix socket,
+ * both peers run on the same host so integers are in host byte order.
+ *
+ * Each frame starts with a header:
+ *     uint32_t length   length of the whole frame including the header
+ *     uint32_t id       request identifier chosen by the responder
+ *     uint32_t code     method on request, status (errno) on reply
+ *
+ * Replies carry the id of the request so more requests can be in progress
+ * at once and their replies may come in any order. Strings are sent as
+ * uint32_t length including the terminating zero followed by the string,
+ * NULL is sent as length 0. Unpacked strings point into the frame. */
+
+#define DP_BIN_PIPE "private/dp-bin"
+
+#define DP_BIN_HEADER_SIZE (3 * sizeof(uint32_t))
+#define DP_BIN_MAX_FRAME_SIZE (64 * 1024)
+
+enum dp_bin_method {
+    /* payload: client name; reply: struct dp_bin_reply */
+    DP_BIN_REGISTER = 1,
+    /* payload: struct dp_bin_account_req; reply: struct dp_bin_reply */
+    DP_BIN_GET_ACCOUNT_INFO = 2,
+    /* payload: complete DP_BIN_GET_ACCOUNT_INFO frames; each of them is
+     * replied separately, the batch itself has no reply */
+    DP_BIN_BATCH = 3,
+};
+
+struct dp_bin_header {
+    uint32_t length;
+    uint32_t id;
+    uint32_t code;
+};
+
+struct dp_bin_account_req {
+    uint32_t dp_flags;
+    uint32_t entry_type;
+    uint32_t attr_type;
+    const char *filter;
+    const char *domain;
+    const char *extra;
+    /* sss_trace_id of the client request, 0 if there is none */
+    uint64_t trace_id;
+};
+
+struct dp_bin_reply {
+    uint16_t dp_error;
+    uint32_t error;
+    const char *message;
+};
+
+/* Returns EAGAIN if the buffer does not contain the whole header yet and
+ * EBADMSG if the header announces a frame of invalid size. */
+errno_t dp_bin_parse_header(const uint8_t *buf, size_t len,
+                            struct dp_bin_header *hdr);
+
+/* Rewrites the id of a packed frame. */
+void dp_bin_set_id(uint8_t *frame, uint32_t id);
+
+uint8_t *dp_bin_pack_register(TALLOC_CTX *mem_ctx,
+                              uint32_t id,
+                              const char *client_name,
+                              size_t *_len);
+
+errno_t dp_bin_unpack_register(const uint8_t *frame, size_t len,
+                               const char **_client_name);
+
+uint8_t *dp_bin_pack_account_req(TALLOC_CTX *mem_ctx,
+                                 uint32_t id,
+                                 const struct dp_bin_account_req *req,
+                                 size_t *_len);
+
+errno_t dp_bin_unpack_account_req(const uint8_t *frame, size_t len,
+                                  struct dp_bin_account_req *req);
+
+/* Reply is ignored and may be NULL when status is not EOK. */
+uint8_t *dp_bin_pack_reply(TALLOC_CTX *mem_ctx,
+                           uint32_t id,
+                           uint32_t status,
+                           const struct dp_bin_reply *reply,
+                           size_t *_len);
+
+errno_t dp_bin_unpack_reply(const uint8_t *frame, size_t len,
+                            struct dp_bin_reply *reply);
+
+uint8_t *dp_bin_pack_batch(TALLOC_CTX *mem_ctx,
+                           uint8_t **frames,
+                           size_t *lens,
+                           size_t count,
+                           size_t *_len);
+
+/* Iterate over frames in a batch, *_offset must be initialized to 0.
+ * Returns ENOENT when there are no more frames. */
+errno_t dp_bin_batch_next(const uint8_t *frame, size_t len,
+                          size_t *_offset,
+                          struct dp_bin_header *hdr,
+                          const uint8_t **_sub);
+
+#endif /* _DP_BIN_H_ */
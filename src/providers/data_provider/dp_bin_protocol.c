@@ -0,0 +1,309 @@
+/*
+    SSSD
+
+    Binary transport between responders and data provider - framing
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <talloc.h>
+
+#include "util/util.h"
+#include "providers/data_provider/dp_bin.h"
+
+static size_t dp_bin_string_size(const char *str)
+{
+    return sizeof(uint32_t) + (str == NULL ? 0 : strlen(str) + 1);
+}
+
+static void dp_bin_put_string(uint8_t *frame, const char *str, size_t *_p)
+{
+    uint32_t size;
+
+    size = str == NULL ? 0 : strlen(str) + 1;
+    SAFEALIGN_SET_UINT32(&frame[*_p], size, _p);
+    if (size != 0) {
+        safealign_memcpy(&frame[*_p], str, size, _p);
+    }
+}
+
+static errno_t dp_bin_get_string(const uint8_t *frame, size_t len,
+                                 size_t *_p, const char **_str)
+{
+    uint32_t size;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&size, &frame[*_p], len, _p);
+    if (size == 0) {
+        *_str = NULL;
+        return EOK;
+    }
+
+    if (size > len - *_p || frame[*_p + size - 1] != '\0'
+            || strlen((const char *) &frame[*_p]) != size - 1) {
+        return EBADMSG;
+    }
+
+    *_str = (const char *) &frame[*_p];
+    *_p += size;
+    return EOK;
+}
+
+static uint8_t *dp_bin_frame_new(TALLOC_CTX *mem_ctx,
+                                 uint32_t id,
+                                 uint32_t code,
+                                 size_t payload_len,
+                                 size_t *_p)
+{
+    uint8_t *frame;
+    size_t len;
+
+    len = DP_BIN_HEADER_SIZE + payload_len;
+    if (len > DP_BIN_MAX_FRAME_SIZE) {
+        DEBUG(SSSDBG_OP_FAILURE, "Frame of %zu bytes is too large\n", len);
+        return NULL;
+    }
+
+    frame = talloc_size(mem_ctx, len);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    *_p = 0;
+    SAFEALIGN_SET_UINT32(&frame[*_p], len, _p);
+    SAFEALIGN_SET_UINT32(&frame[*_p], id, _p);
+    SAFEALIGN_SET_UINT32(&frame[*_p], code, _p);
+
+    return frame;
+}
+
+errno_t dp_bin_parse_header(const uint8_t *buf, size_t len,
+                            struct dp_bin_header *hdr)
+{
+    size_t p = 0;
+
+    if (len < DP_BIN_HEADER_SIZE) {
+        return EAGAIN;
+    }
+
+    SAFEALIGN_COPY_UINT32(&hdr->length, &buf[p], &p);
+    SAFEALIGN_COPY_UINT32(&hdr->id, &buf[p], &p);
+    SAFEALIGN_COPY_UINT32(&hdr->code, &buf[p], &p);
+
+    if (hdr->length < DP_BIN_HEADER_SIZE
+            || hdr->length > DP_BIN_MAX_FRAME_SIZE) {
+        return EBADMSG;
+    }
+
+    return EOK;
+}
+
+void dp_bin_set_id(uint8_t *frame, uint32_t id)
+{
+    size_t p = sizeof(uint32_t);
+
+    SAFEALIGN_SET_UINT32(&frame[p], id, &p);
+}
+
+uint8_t *dp_bin_pack_register(TALLOC_CTX *mem_ctx,
+                              uint32_t id,
+                              const char *client_name,
+                              size_t *_len)
+{
+    uint8_t *frame;
+    size_t p;
+
+    frame = dp_bin_frame_new(mem_ctx, id, DP_BIN_REGISTER,
+                             dp_bin_string_size(client_name), &p);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    dp_bin_put_string(frame, client_name, &p);
+
+    *_len = p;
+    return frame;
+}
+
+errno_t dp_bin_unpack_register(const uint8_t *frame, size_t len,
+                               const char **_client_name)
+{
+    size_t p = DP_BIN_HEADER_SIZE;
+
+    return dp_bin_get_string(frame, len, &p, _client_name);
+}
+
+uint8_t *dp_bin_pack_account_req(TALLOC_CTX *mem_ctx,
+                                 uint32_t id,
+                                 const struct dp_bin_account_req *req,
+                                 size_t *_len)
+{
+    uint8_t *frame;
+    size_t p;
+
+    frame = dp_bin_frame_new(mem_ctx, id, DP_BIN_GET_ACCOUNT_INFO,
+                             3 * sizeof(uint32_t) + sizeof(uint64_t)
+                             + dp_bin_string_size(req->filter)
+                             + dp_bin_string_size(req->domain)
+                             + dp_bin_string_size(req->extra), &p);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    SAFEALIGN_SET_UINT32(&frame[p], req->dp_flags, &p);
+    SAFEALIGN_SET_UINT32(&frame[p], req->entry_type, &p);
+    SAFEALIGN_SET_UINT32(&frame[p], req->attr_type, &p);
+    SAFEALIGN_SET_UINT64(&frame[p], req->trace_id, &p);
+    dp_bin_put_string(frame, req->filter, &p);
+    dp_bin_put_string(frame, req->domain, &p);
+    dp_bin_put_string(frame, req->extra, &p);
+
+    *_len = p;
+    return frame;
+}
+
+errno_t dp_bin_unpack_account_req(const uint8_t *frame, size_t len,
+                                  struct dp_bin_account_req *req)
+{
+    size_t p = DP_BIN_HEADER_SIZE;
+    errno_t ret;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&req->dp_flags, &frame[p], len, &p);
+    SAFEALIGN_COPY_UINT32_CHECK(&req->entry_type, &frame[p], len, &p);
+    SAFEALIGN_COPY_UINT32_CHECK(&req->attr_type, &frame[p], len, &p);
+    SAFEALIGN_COPY_UINT64_CHECK(&req->trace_id, &frame[p], len, &p);
+
+    ret = dp_bin_get_string(frame, len, &p, &req->filter);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = dp_bin_get_string(frame, len, &p, &req->domain);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return dp_bin_get_string(frame, len, &p, &req->extra);
+}
+
+uint8_t *dp_bin_pack_reply(TALLOC_CTX *mem_ctx,
+                           uint32_t id,
+                           uint32_t status,
+                           const struct dp_bin_reply *reply,
+                           size_t *_len)
+{
+    uint8_t *frame;
+    size_t p;
+
+    if (status != EOK) {
+        frame = dp_bin_frame_new(mem_ctx, id, status, 0, &p);
+        if (frame == NULL) {
+            return NULL;
+        }
+
+        *_len = p;
+        return frame;
+    }
+
+    frame = dp_bin_frame_new(mem_ctx, id, status,
+                             2 * sizeof(uint32_t)
+                             + dp_bin_string_size(reply->message), &p);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    SAFEALIGN_SET_UINT32(&frame[p], reply->dp_error, &p);
+    SAFEALIGN_SET_UINT32(&frame[p], reply->error, &p);
+    dp_bin_put_string(frame, reply->message, &p);
+
+    *_len = p;
+    return frame;
+}
+
+errno_t dp_bin_unpack_reply(const uint8_t *frame, size_t len,
+                            struct dp_bin_reply *reply)
+{
+    size_t p = DP_BIN_HEADER_SIZE;
+    uint32_t dp_error;
+
+    SAFEALIGN_COPY_UINT32_CHECK(&dp_error, &frame[p], len, &p);
+    SAFEALIGN_COPY_UINT32_CHECK(&reply->error, &frame[p], len, &p);
+    reply->dp_error = dp_error;
+
+    return dp_bin_get_string(frame, len, &p, &reply->message);
+}
+
+uint8_t *dp_bin_pack_batch(TALLOC_CTX *mem_ctx,
+                           uint8_t **frames,
+                           size_t *lens,
+                           size_t count,
+                           size_t *_len)
+{
+    uint8_t *frame;
+    size_t payload_len = 0;
+    size_t p;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        payload_len += lens[i];
+    }
+
+    frame = dp_bin_frame_new(mem_ctx, 0, DP_BIN_BATCH, payload_len, &p);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        safealign_memcpy(&frame[p], frames[i], lens[i], &p);
+    }
+
+    *_len = p;
+    return frame;
+}
+
+errno_t dp_bin_batch_next(const uint8_t *frame, size_t len,
+                          size_t *_offset,
+                          struct dp_bin_header *hdr,
+                          const uint8_t **_sub)
+{
+    size_t p = *_offset;
+    errno_t ret;
+
+    if (p == 0) {
+        p = DP_BIN_HEADER_SIZE;
+    }
+
+    if (p >= len) {
+        return ENOENT;
+    }
+
+    ret = dp_bin_parse_header(&frame[p], len - p, hdr);
+    if (ret == EAGAIN || (ret == EOK && hdr->length > len - p)) {
+        return EBADMSG;
+    } else if (ret != EOK) {
+        return ret;
+    }
+
+    if (hdr->code == DP_BIN_BATCH) {
+        /* nested batches are not allowed */
+        return EBADMSG;
+    }
+
+    *_sub = &frame[p];
+    *_offset = p + hdr->length;
+
+    return EOK;
+}
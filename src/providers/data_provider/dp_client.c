@@ -28,10 +28,15 @@
 #include "util/util.h"
 
 struct dp_client {
+    struct dp_client *prev;
+    struct dp_client *next;
+
     struct data_provider *provider;
     struct sbus_connection *conn;
     struct tevent_timer *timeout;
     const char *name;
+    enum dp_clients client;
+    pid_t pid;
     bool initialized;
 };
 
@@ -69,18 +74,20 @@ static int dp_client_destructor(struct dp_client *dp_cli)
     }
 
     provider = dp_cli->provider;
-
-    for (client = 0; client != DP_CLIENT_SENTINEL; client++) {
-        if (provider->clients[client] == dp_cli) {
-            provider->clients[client] = NULL;
-            DEBUG(SSSDBG_TRACE_FUNC, "Removed %s client\n",
-                  dp_client_to_string(client));
-            break;
-        }
-    }
+    client = dp_cli->client;
 
     if (client == DP_CLIENT_SENTINEL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unknown client removed...\n");
+        return 0;
+    }
+
+    DLIST_REMOVE(provider->clients[client], dp_cli);
+    DEBUG(SSSDBG_TRACE_FUNC, "Removed %s client\n",
+          dp_client_to_string(client));
+
+    if (provider->clients[client] != NULL) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Another %s client is still connected\n",
+              dp_client_to_string(client));
     }
 
     return 0;
@@ -95,6 +102,7 @@ dp_client_register(struct sbus_request *sbus_req,
     struct dp_client *dp_cli;
     struct DBusError *error;
     enum dp_clients client;
+    unsigned long pid;
     errno_t ret;
 
     dp_cli = talloc_get_type(data, struct dp_client);
@@ -110,12 +118,20 @@ dp_client_register(struct sbus_request *sbus_req,
         return ENOMEM;
     }
 
+    /* Used to pair the client with its binary transport connection. */
+    if (!dbus_connection_get_unix_process_id(sbus_get_connection(dp_cli->conn),
+                                             &pid)) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to get pid of client [%s]\n",
+              client_name);
+        pid = 0;
+    }
+    dp_cli->pid = pid;
+
     DEBUG(SSSDBG_CONF_SETTINGS, "Cancel DP ID timeout [%p]\n", dp_cli->timeout);
     talloc_zfree(dp_cli->timeout);
 
     for (client = 0; client != DP_CLIENT_SENTINEL; client++) {
         if (strcasecmp(client_name, dp_client_to_string(client)) == 0) {
-            provider->clients[client] = dp_cli;
             break;
         }
     }
@@ -130,6 +146,15 @@ dp_client_register(struct sbus_request *sbus_req,
         return sbus_request_fail_and_finish(sbus_req, error);
     }
 
+    /* A responder that runs in several processes registers once from each
+     * of them. The most recent registration is used first, the others
+     * take over when it disconnects. */
+    if (dp_cli->client != DP_CLIENT_SENTINEL) {
+        DLIST_REMOVE(provider->clients[dp_cli->client], dp_cli);
+    }
+    dp_cli->client = client;
+    DLIST_ADD(provider->clients[client], dp_cli);
+
     talloc_set_destructor(dp_cli, dp_client_destructor);
 
     ret = iface_dp_client_Register_finish(sbus_req);
@@ -188,6 +213,7 @@ errno_t dp_client_init(struct sbus_connection *conn, void *data)
 
     dp_cli->provider = provider;
     dp_cli->conn = conn;
+    dp_cli->client = DP_CLIENT_SENTINEL;
     dp_cli->initialized = false;
     dp_cli->timeout = NULL;
 
@@ -228,6 +254,26 @@ errno_t dp_client_init(struct sbus_connection *conn, void *data)
     return ret;
 }
 
+struct dp_client *
+dp_client_find(struct data_provider *provider,
+               enum dp_clients client,
+               pid_t pid)
+{
+    struct dp_client *dp_cli;
+
+    if (client == DP_CLIENT_SENTINEL) {
+        return NULL;
+    }
+
+    DLIST_FOR_EACH(dp_cli, provider->clients[client]) {
+        if (dp_cli->pid == pid) {
+            return dp_cli;
+        }
+    }
+
+    return NULL;
+}
+
 struct data_provider *
 dp_client_provider(struct dp_client *dp_cli)
 {
@@ -52,6 +52,17 @@ struct dp_id_data {
     const char *domain;
 };
 
+/* Several lookups of the same entry type and filter type at once. The
+ * handler only needs to store entries it found in the cache, values that
+ * were not found are looked up again by the account handler. */
+struct dp_id_batch_data {
+    uint32_t entry_type;
+    uint32_t filter_type;
+    const char *domain;
+    size_t count;
+    const char **values;
+};
+
 /* Reply private data. */
 
 struct dp_reply_std {
@@ -60,6 +71,15 @@ struct dp_reply_std {
     const char *message;
 };
 
+struct dp_id_batch_reply {
+    int dp_error;
+    int error;
+
+    /* found[i] is true if values[i] was stored in the cache */
+    size_t count;
+    bool *found;
+};
+
 void dp_reply_std_set(struct dp_reply_std *reply,
                       int dp_error,
                       int error,
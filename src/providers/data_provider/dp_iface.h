@@ -38,7 +38,14 @@ errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
                                     uint32_t attr_type,
                                     const char *filter,
                                     const char *domain,
-                                    const char *extra);
+                                    const char *extra,
+                                    uint64_t trace_id);
+
+errno_t dp_refresh_hint_handler(struct sbus_request *sbus_req,
+                                void *dp_cli,
+                                uint32_t entry_type,
+                                const char **names,
+                                int num_names);
 
 errno_t dp_pam_handler(struct sbus_request *sbus_req, void *dp_cli);
 
@@ -15,8 +15,11 @@ static int invoke_us_method(struct sbus_request *dbus_req, void *function_ptr);
 /* invokes a handler with a 'uss' DBus signature */
 static int invoke_uss_method(struct sbus_request *dbus_req, void *function_ptr);
 
-/* invokes a handler with a 'uuusss' DBus signature */
-static int invoke_uuusss_method(struct sbus_request *dbus_req, void *function_ptr);
+/* invokes a handler with a 'uuussst' DBus signature */
+static int invoke_uuussst_method(struct sbus_request *dbus_req, void *function_ptr);
+
+/* invokes a handler with a 'uas' DBus signature */
+static int invoke_uas_method(struct sbus_request *dbus_req, void *function_ptr);
 
 /* arguments for org.freedesktop.sssd.DataProvider.Client.Register */
 const struct sbus_arg_meta iface_dp_client_Register__in[] = {
@@ -264,6 +267,7 @@ const struct sbus_arg_meta iface_dp_getAccountInfo__in[] = {
     { "filter", "s" },
     { "domain", "s" },
     { "extra", "s" },
+    { "trace_id", "t" },
     { NULL, }
 };
 
@@ -284,6 +288,19 @@ int iface_dp_getAccountInfo_finish(struct sbus_request *req, uint16_t arg_dp_err
                                          DBUS_TYPE_INVALID);
 }
 
+/* arguments for org.freedesktop.sssd.dataprovider.refreshHint */
+const struct sbus_arg_meta iface_dp_refreshHint__in[] = {
+    { "entry_type", "u" },
+    { "names", "as" },
+    { NULL, }
+};
+
+int iface_dp_refreshHint_finish(struct sbus_request *req)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.dataprovider */
 const struct sbus_method_meta iface_dp__methods[] = {
     {
@@ -326,7 +343,14 @@ const struct sbus_method_meta iface_dp__methods[] = {
         iface_dp_getAccountInfo__in,
         iface_dp_getAccountInfo__out,
         offsetof(struct iface_dp, getAccountInfo),
-        invoke_uuusss_method,
+        invoke_uuussst_method,
+    },
+    {
+        "refreshHint", /* name */
+        iface_dp_refreshHint__in,
+        NULL, /* no out_args */
+        offsetof(struct iface_dp, refreshHint),
+        invoke_uas_method,
     },
     { NULL, }
 };
@@ -378,24 +402,17 @@ static int invoke_uss_method(struct sbus_request *dbus_req, void *function_ptr)
                      arg_2);
 }
 
-/* invokes a handler with a 'uuusss' DBus signature */
-static int invoke_uuusss_method(struct sbus_request *dbus_req, void *function_ptr)
+/* invokes a handler with a 'uas' DBus signature */
+static int invoke_uas_method(struct sbus_request *dbus_req, void *function_ptr)
 {
     uint32_t arg_0;
-    uint32_t arg_1;
-    uint32_t arg_2;
-    const char * arg_3;
-    const char * arg_4;
-    const char * arg_5;
-    int (*handler)(struct sbus_request *, void *, uint32_t, uint32_t, uint32_t, const char *, const char *, const char *) = function_ptr;
+    const char * *arg_1;
+    int len_1;
+    int (*handler)(struct sbus_request *, void *, uint32_t, const char *[], int) = function_ptr;
 
     if (!sbus_request_parse_or_finish(dbus_req,
                                DBUS_TYPE_UINT32, &arg_0,
-                               DBUS_TYPE_UINT32, &arg_1,
-                               DBUS_TYPE_UINT32, &arg_2,
-                               DBUS_TYPE_STRING, &arg_3,
-                               DBUS_TYPE_STRING, &arg_4,
-                               DBUS_TYPE_STRING, &arg_5,
+                               DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &arg_1, &len_1,
                                DBUS_TYPE_INVALID)) {
          return EOK; /* request handled */
     }
@@ -403,10 +420,7 @@ static int invoke_uuusss_method(struct sbus_request *dbus_req, void *function_pt
     return (handler)(dbus_req, dbus_req->intf->handler_data,
                      arg_0,
                      arg_1,
-                     arg_2,
-                     arg_3,
-                     arg_4,
-                     arg_5);
+                     len_1);
 }
 
 /* invokes a handler with a 'us' DBus signature */
@@ -427,3 +441,37 @@ static int invoke_us_method(struct sbus_request *dbus_req, void *function_ptr)
                      arg_0,
                      arg_1);
 }
+
+/* invokes a handler with a 'uuussst' DBus signature */
+static int invoke_uuussst_method(struct sbus_request *dbus_req, void *function_ptr)
+{
+    uint32_t arg_0;
+    uint32_t arg_1;
+    uint32_t arg_2;
+    const char * arg_3;
+    const char * arg_4;
+    const char * arg_5;
+    uint64_t arg_6;
+    int (*handler)(struct sbus_request *, void *, uint32_t, uint32_t, uint32_t, const char *, const char *, const char *, uint64_t) = function_ptr;
+
+    if (!sbus_request_parse_or_finish(dbus_req,
+                               DBUS_TYPE_UINT32, &arg_0,
+                               DBUS_TYPE_UINT32, &arg_1,
+                               DBUS_TYPE_UINT32, &arg_2,
+                               DBUS_TYPE_STRING, &arg_3,
+                               DBUS_TYPE_STRING, &arg_4,
+                               DBUS_TYPE_STRING, &arg_5,
+                               DBUS_TYPE_UINT64, &arg_6,
+                               DBUS_TYPE_INVALID)) {
+         return EOK; /* request handled */
+    }
+
+    return (handler)(dbus_req, dbus_req->intf->handler_data,
+                     arg_0,
+                     arg_1,
+                     arg_2,
+                     arg_3,
+                     arg_4,
+                     arg_5,
+                     arg_6);
+}
@@ -65,6 +65,36 @@ void _dp_set_method(struct dp_method *methods,
     methods[method].output_size = output_size;
 }
 
+const char *dp_method_to_string(enum dp_methods method)
+{
+    switch (method) {
+    case DPM_CHECK_ONLINE:
+        return "check_online";
+    case DPM_ACCOUNT_HANDLER:
+        return "account_handler";
+    case DPM_AUTH_HANDLER:
+        return "auth_handler";
+    case DPM_ACCESS_HANDLER:
+        return "access_handler";
+    case DPM_SELINUX_HANDLER:
+        return "selinux_handler";
+    case DPM_SUDO_HANDLER:
+        return "sudo_handler";
+    case DPM_AUTOFS_HANDLER:
+        return "autofs_handler";
+    case DPM_HOSTID_HANDLER:
+        return "hostid_handler";
+    case DPM_DOMAINS_HANDLER:
+        return "domains_handler";
+    case DPM_ACCOUNT_BATCH_HANDLER:
+        return "account_batch_handler";
+    case DP_METHOD_SENTINEL:
+        return NULL;
+    }
+
+    return NULL;
+}
+
 bool dp_method_enabled(struct data_provider *provider,
                        enum dp_targets target,
                        enum dp_methods method)
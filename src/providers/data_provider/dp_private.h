@@ -79,6 +79,8 @@ struct data_provider {
     struct be_ctx *be_ctx;
     struct tevent_context *ev;
     struct sbus_connection *srv_conn;
+    /* Lists of the registered clients of each type, the most recent
+     * registration first. */
     struct dp_client *clients[DP_CLIENT_SENTINEL];
     bool terminating;
 
@@ -115,6 +117,7 @@ struct dp_module *dp_load_module(TALLOC_CTX *mem_ctx,
 errno_t dp_init_modules(TALLOC_CTX *mem_ctx, struct dp_module ***_modules);
 
 const char *dp_target_to_string(enum dp_targets target);
+const char *dp_method_to_string(enum dp_methods method);
 
 bool dp_target_initialized(struct dp_target **targets, enum dp_targets type);
 
@@ -238,9 +241,25 @@ void _dp_req_with_reply(struct dp_client *dp_cli,
                          method, dp_flags, req_data, NULL, NULL, void,        \
                          reply_fn, output_dtype)
 
+/* Parse account request arguments into data. */
+errno_t dp_id_data_init(struct dp_id_data *data,
+                        uint32_t entry_type,
+                        uint32_t attr_type,
+                        const char *filter,
+                        const char *domain,
+                        const char *extra);
+
+/* Binary transport for the most frequent requests, see dp_bin.h. */
+errno_t dp_bin_init(struct data_provider *provider);
+
 /* Client shared functions. */
 
+const char *dp_client_to_string(enum dp_clients client);
 errno_t dp_client_init(struct sbus_connection *conn, void *data);
+/* Returns the client of the given type registered by process pid or NULL. */
+struct dp_client *dp_client_find(struct data_provider *provider,
+                                 enum dp_clients client,
+                                 pid_t pid);
 struct data_provider *dp_client_provider(struct dp_client *dp_cli);
 struct be_ctx *dp_client_be(struct dp_client *dp_cli);
 struct sbus_connection *dp_client_conn(struct dp_client *dp_cli);
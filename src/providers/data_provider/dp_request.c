@@ -27,6 +27,7 @@
 #include "providers/backend.h"
 #include "util/dlinklist.h"
 #include "util/util.h"
+#include "util/sss_metrics.h"
 
 struct dp_req {
     struct data_provider *provider;
@@ -40,6 +41,8 @@ struct dp_req {
     struct dp_method *execute;
     const char *name;
     uint32_t num;
+    struct timeval start;
+    uint64_t trace_id;
 
     struct tevent_req *req;
     struct tevent_req *handler_req;
@@ -160,6 +163,8 @@ dp_req_new(TALLOC_CTX *mem_ctx,
     dp_req->method = method;
     dp_req->request_data = request_data;
     dp_req->req = req;
+    dp_req->start = tevent_timeval_current();
+    dp_req->trace_id = sss_trace_id;
 
     ret = dp_attach_req(dp_req, provider, name, dp_flags);
     if (ret != EOK) {
@@ -352,10 +357,13 @@ static void dp_req_done(struct tevent_req *subreq)
 {
     struct dp_req_state *state;
     struct tevent_req *req;
+    struct timeval now;
+    struct timeval diff;
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct dp_req_state);
+    sss_trace_id = state->dp_req->trace_id;
 
     ret = state->recv_fn(state->output_data, subreq, state->output_data);
 
@@ -363,8 +371,15 @@ static void dp_req_done(struct tevent_req *subreq)
     talloc_zfree(subreq);
     state->dp_req->handler_req = NULL;
 
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(&state->dp_req->start, &now);
+    sss_metrics_add_usec("dp", dp_method_to_string(state->dp_req->method),
+                         diff.tv_sec * 1000000ULL + diff.tv_usec);
+
     DP_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->dp_req->name,
-                 "Request handler finished [%d]: %s", ret, sss_strerror(ret));
+                 "Request handler finished in %ld.%06ld seconds [%d]: %s",
+                 (long)diff.tv_sec, (long)diff.tv_usec,
+                 ret, sss_strerror(ret));
 
     if (ret != EOK) {
         tevent_req_error(req, ret);
@@ -163,6 +163,8 @@ static void dp_req_initgr_pp(const char *req_name,
     dbus_bool_t dbret;
     int num;
 
+    /* The memory cache is shared by all NSS processes, any of them can
+     * update it. */
     dp_cli = provider->clients[DPC_NSS];
     if (dp_cli == NULL) {
         return;
@@ -250,6 +252,28 @@ done:
     return ret;
 }
 
+errno_t dp_id_data_init(struct dp_id_data *data,
+                        uint32_t entry_type,
+                        uint32_t attr_type,
+                        const char *filter,
+                        const char *domain,
+                        const char *extra)
+{
+    if (!check_attr_type(attr_type)) {
+        return EINVAL;
+    }
+
+    data->entry_type = entry_type;
+    data->attr_type = attr_type;
+    data->domain = domain;
+
+    if (!check_and_parse_filter(data, filter, extra)) {
+        return EINVAL;
+    }
+
+    return EOK;
+}
+
 errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
                                     void *dp_cli,
                                     uint32_t dp_flags,
@@ -257,27 +281,23 @@ errno_t dp_get_account_info_handler(struct sbus_request *sbus_req,
                                     uint32_t attr_type,
                                     const char *filter,
                                     const char *domain,
-                                    const char *extra)
+                                    const char *extra,
+                                    uint64_t trace_id)
 {
     struct dp_id_data *data;
     const char *key;
     errno_t ret;
 
-    if (!check_attr_type(attr_type)) {
-        return EINVAL;
-    }
+    /* Continue the client request of the responder. */
+    sss_trace_id = trace_id;
 
     data = talloc_zero(sbus_req, struct dp_id_data);
     if (data == NULL) {
         return ENOMEM;
     }
 
-    data->entry_type = entry_type;
-    data->attr_type = attr_type;
-    data->domain = domain;
-
-    if (!check_and_parse_filter(data, filter, extra)) {
-        ret = EINVAL;
+    ret = dp_id_data_init(data, entry_type, attr_type, filter, domain, extra);
+    if (ret != EOK) {
         goto done;
     }
 
@@ -313,3 +333,41 @@ done:
 
     return ret;
 }
+
+errno_t dp_refresh_hint_handler(struct sbus_request *sbus_req,
+                                void *dp_cli,
+                                uint32_t entry_type,
+                                const char **names,
+                                int num_names)
+{
+    struct be_ctx *be_ctx;
+    enum be_refresh_type type;
+    errno_t ret;
+
+    be_ctx = dp_client_be(dp_cli);
+
+    switch (entry_type & BE_REQ_TYPE_MASK) {
+    case BE_REQ_USER:
+        type = BE_REFRESH_TYPE_USERS;
+        break;
+    case BE_REQ_GROUP:
+        type = BE_REFRESH_TYPE_GROUPS;
+        break;
+    case BE_REQ_NETGROUP:
+        type = BE_REFRESH_TYPE_NETGROUPS;
+        break;
+    default:
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unsupported entry type [%s]\n",
+              be_req2str(entry_type));
+        return EINVAL;
+    }
+
+    ret = be_refresh_hint(be_ctx->refresh_ctx, type, names, num_names);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to record refresh hints [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return iface_dp_refreshHint_finish(sbus_req);
+}
@@ -65,6 +65,7 @@ struct mon_cli_iface monitor_be_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .getStats = monitor_common_get_stats,
 };
 
 bool be_is_offline(struct be_ctx *ctx)
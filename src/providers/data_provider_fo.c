@@ -49,6 +49,10 @@ static int be_fo_get_options(struct be_ctx *ctx,
     opts->retry_timeout = 30;
     opts->srv_retry_neg_timeout = 15;
     opts->family_order = ctx->be_res->family_order;
+    opts->parallel_connect = dp_opt_get_int(ctx->be_res->opts,
+                                            DP_RES_OPT_PARALLEL_CONNECT);
+    opts->latency_probe_interval = dp_opt_get_int(ctx->be_res->opts,
+                                            DP_RES_OPT_LATENCY_PROBE_INTERVAL);
 
     return EOK;
 }
@@ -127,11 +131,123 @@ static struct be_svc_data *be_fo_find_svc_data(struct be_ctx *ctx,
     return 0;
 }
 
+struct be_latency_probe_ctx {
+    struct be_ctx *bctx;
+    struct be_svc_data *svc;
+    int interval;
+};
+
+static errno_t be_fo_latency_probe_schedule(struct be_latency_probe_ctx *ctx);
+static void be_fo_latency_probe_done(struct tevent_req *subreq);
+
+static void
+be_fo_latency_probe_timeout(struct tevent_context *ev,
+                            struct tevent_timer *te,
+                            struct timeval tv, void *pvt)
+{
+    struct be_latency_probe_ctx *ctx;
+    struct tevent_req *subreq;
+    errno_t ret;
+
+    ctx = talloc_get_type(pvt, struct be_latency_probe_ctx);
+
+    if (be_is_offline(ctx->bctx)) {
+        goto schedule;
+    }
+
+    subreq = fo_probe_service_send(ctx, ev, ctx->bctx->be_fo->be_res->resolv,
+                                   ctx->bctx->be_fo->fo_ctx,
+                                   ctx->svc->fo_service);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "fo_probe_service_send() failed\n");
+        goto schedule;
+    }
+    tevent_req_set_callback(subreq, be_fo_latency_probe_done, ctx);
+    return;
+
+schedule:
+    /* Try again at the next interval */
+    ret = be_fo_latency_probe_schedule(ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Could not schedule latency probe [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+}
+
+static void be_fo_latency_probe_done(struct tevent_req *subreq)
+{
+    struct be_latency_probe_ctx *ctx;
+    errno_t ret;
+
+    ctx = tevent_req_callback_data(subreq, struct be_latency_probe_ctx);
+
+    ret = fo_probe_service_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to probe servers of service '%s' [%d]: %s\n",
+              ctx->svc->name, ret, sss_strerror(ret));
+    }
+
+    ret = be_fo_latency_probe_schedule(ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Could not schedule latency probe [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+}
+
+static errno_t be_fo_latency_probe_schedule(struct be_latency_probe_ctx *ctx)
+{
+    struct tevent_timer *te;
+    struct timeval tv;
+
+    tv = tevent_timeval_current_ofs(ctx->interval, 0);
+    te = tevent_add_timer(ctx->bctx->ev, ctx, tv,
+                          be_fo_latency_probe_timeout, ctx);
+    if (te == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+/* Periodically measure the servers of the service for the latency aware
+ * server selection. The probes go away together with svc. */
+static errno_t be_fo_latency_probe_init(struct be_ctx *bctx,
+                                        struct be_svc_data *svc,
+                                        int interval)
+{
+    struct be_latency_probe_ctx *ctx;
+    errno_t ret;
+
+    ctx = talloc_zero(svc, struct be_latency_probe_ctx);
+    if (ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ctx->bctx = bctx;
+    ctx->svc = svc;
+    ctx->interval = interval;
+
+    ret = be_fo_latency_probe_schedule(ctx);
+    if (ret != EOK) {
+        talloc_free(ctx);
+        return ret;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Servers of service '%s' will be probed "
+          "every %d seconds\n", svc->name, interval);
+    return EOK;
+}
+
 int be_fo_add_service(struct be_ctx *ctx, const char *service_name,
                       datacmp_fn user_data_cmp)
 {
     struct fo_service *service;
     struct be_svc_data *svc;
+    int interval;
     int ret;
 
     svc = be_fo_find_svc_data(ctx, service_name);
@@ -165,6 +281,16 @@ int be_fo_add_service(struct be_ctx *ctx, const char *service_name,
     }
     svc->fo_service = service;
 
+    interval = dp_opt_get_int(ctx->be_res->opts,
+                              DP_RES_OPT_LATENCY_PROBE_INTERVAL);
+    if (interval > 0) {
+        ret = be_fo_latency_probe_init(ctx, svc, interval);
+        if (ret != EOK) {
+            talloc_zfree(svc);
+            return ret;
+        }
+    }
+
     DLIST_ADD(ctx->be_fo->svcs, svc);
 
     return EOK;
@@ -824,6 +950,8 @@ static struct dp_option dp_res_default_opts[] = {
     { "dns_resolver_timeout", DP_OPT_NUMBER, { .number = 6 }, NULL_NUMBER },
     { "dns_resolver_op_timeout", DP_OPT_NUMBER, { .number = 6 }, NULL_NUMBER },
     { "dns_discovery_domain", DP_OPT_STRING, NULL_STRING, NULL_STRING },
+    { "failover_parallel_connect", DP_OPT_NUMBER, { .number = 0 }, NULL_NUMBER },
+    { "failover_latency_probe_interval", DP_OPT_NUMBER, { .number = 0 }, NULL_NUMBER },
     DP_OPTION_TERMINATOR
 };
 
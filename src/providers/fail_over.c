@@ -24,6 +24,7 @@
 */
 
 #include <sys/time.h>
+#include <sys/socket.h>
 
 #include <errno.h>
 #include <stdbool.h>
@@ -43,6 +44,21 @@
 #define DEFAULT_SERVER_STATUS SERVER_NAME_NOT_RESOLVED
 #define DEFAULT_SRV_STATUS SRV_NEUTRAL
 
+/* Connection Attempt Delay of RFC 8305 */
+#define FO_RACE_ATTEMPT_DELAY_MS 250
+/* A probe that is not answered in time counts as a failed connection */
+#define FO_PROBE_TIMEOUT 5
+
+/* New samples weigh 1/8 in the server statistics, as in TCP SRTT */
+#define FO_STATS_WEIGHT 8
+/* The active server is replaced only by a server that is this many
+ * percent faster, so that similar servers do not keep flapping */
+#define FO_LATENCY_SWITCH_MARGIN 20
+
+/* Kerberos ports, clients use UDP by default */
+#define FO_KRB5_KDC_PORT 88
+#define FO_KRB5_KPASSWD_PORT 464
+
 enum srv_lookup_status {
     SRV_NEUTRAL,        /* We didn't try this SRV lookup yet */
     SRV_RESOLVED,       /* This SRV lookup is resolved       */
@@ -78,6 +94,15 @@ struct fo_service {
     datacmp_fn user_data_cmp;
 };
 
+/* Exponentially weighted moving averages of the TCP connect round trip
+ * time and of the error rate (per mille) of the operations sent to a
+ * server. */
+struct fo_server_stats {
+    uint64_t rtt_usec;
+    unsigned int error_rate;
+    size_t rtt_samples;
+};
+
 struct fo_server {
     REFCOUNT_COMMON;
 
@@ -85,6 +110,8 @@ struct fo_server {
     struct fo_server *next;
 
     bool primary;
+    /* SRV priority, 0 for servers that are not discovered in DNS */
+    unsigned short priority;
     void *user_data;
     int port;
     enum port_status port_status;
@@ -92,6 +119,7 @@ struct fo_server {
     struct fo_service *service;
     struct timeval last_status_change;
     struct server_common *common;
+    struct fo_server_stats stats;
 
     TALLOC_CTX *fo_internal_owner;
 };
@@ -159,6 +187,8 @@ fo_context_init(TALLOC_CTX *mem_ctx, struct fo_options *opts)
     ctx->opts->retry_timeout = opts->retry_timeout;
     ctx->opts->family_order  = opts->family_order;
     ctx->opts->service_resolv_timeout = opts->service_resolv_timeout;
+    ctx->opts->parallel_connect = opts->parallel_connect;
+    ctx->opts->latency_probe_interval = opts->latency_probe_interval;
 
     DEBUG(SSSDBG_TRACE_FUNC,
           "Created new fail over context, retry timeout is %ld\n",
@@ -570,6 +600,8 @@ fo_server_alloc(struct fo_service *service, int port,
     server->service = service;
     server->port_status = DEFAULT_PORT_STATUS;
     server->primary = primary;
+    server->priority = 0;
+    memset(&server->stats, 0, sizeof(server->stats));
 
     return server;
 }
@@ -811,6 +843,7 @@ static errno_t fo_add_server_list(struct fo_service *service,
         }
 
         server->srv_data = srv_data;
+        server->priority = servers[i].priority;
 
         ret = fo_add_server_to_list(&srv_list, service->server_list,
                                     server, service->name);
@@ -863,20 +896,121 @@ void fo_ref_server(TALLOC_CTX *ref_ctx,
     }
 }
 
+static uint64_t
+fo_server_score(struct fo_server *server)
+{
+    /* An error rate of 100 % makes the server look five times slower. */
+    return server->stats.rtt_usec
+           + server->stats.rtt_usec * server->stats.error_rate / 250;
+}
+
+/* Servers of the same class are interchangeable, the configured order or
+ * the SRV weight only decides which one is tried first. */
+static bool
+fo_server_same_class(struct fo_server *server, struct fo_server *other)
+{
+    return server->primary == other->primary
+           && server->priority == other->priority;
+}
+
+/* Returns the first working primary server or, if no primary server
+ * works, the first working backup server. */
+static struct fo_server *
+fo_first_working_server(struct fo_service *service)
+{
+    struct fo_server *server;
+    struct fo_server *first = NULL;
+
+    DLIST_FOR_EACH(server, service->server_list) {
+        if (!service_works(server)) {
+            continue;
+        }
+
+        if (server->primary) {
+            return server;
+        }
+
+        if (first == NULL) {
+            first = server;
+        }
+    }
+
+    return first;
+}
+
+/* Returns the working server with the best statistics from the class of
+ * the first working server. Servers that were never measured are not
+ * considered. */
+static struct fo_server *
+fo_fastest_server(struct fo_service *service)
+{
+    struct fo_server *server;
+    struct fo_server *first;
+    struct fo_server *fastest = NULL;
+
+    first = fo_first_working_server(service);
+    if (first == NULL) {
+        return NULL;
+    }
+
+    DLIST_FOR_EACH(server, service->server_list) {
+        if (!fo_server_same_class(server, first)
+                || server->stats.rtt_samples == 0
+                || !service_works(server)) {
+            continue;
+        }
+
+        if (fastest == NULL
+                || fo_server_score(server) < fo_server_score(fastest)) {
+            fastest = server;
+        }
+    }
+
+    return fastest;
+}
+
+static bool
+fo_server_clearly_faster(struct fo_server *server, struct fo_server *than)
+{
+    if (than->stats.rtt_samples == 0) {
+        return true;
+    }
+
+    return fo_server_score(server) * 100
+           < fo_server_score(than) * (100 - FO_LATENCY_SWITCH_MARGIN);
+}
+
 static int
 get_first_server_entity(struct fo_service *service, struct fo_server **_server)
 {
     struct fo_server *server;
+    struct fo_server *fastest = NULL;
+
+    if (service->ctx->opts->latency_probe_interval > 0) {
+        fastest = fo_fastest_server(service);
+    }
 
     /* If we already have a working server, use that one. */
     server = service->active_server;
     if (server != NULL) {
         if (service_works(server) && fo_is_server_primary(server)) {
+            if (fastest != NULL && fastest != server
+                    && fo_server_clearly_faster(fastest, server)) {
+                DEBUG(SSSDBG_TRACE_FUNC, "Server '%s' is faster than the "
+                      "active server '%s', switching\n",
+                      SERVER_NAME(fastest), SERVER_NAME(server));
+                server = fastest;
+            }
             goto done;
         }
         service->active_server = NULL;
     }
 
+    if (fastest != NULL) {
+        server = fastest;
+        goto done;
+    }
+
     /*
      * Otherwise iterate through the server list.
      */
@@ -996,6 +1130,18 @@ resolve_srv_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
 static int
 resolve_srv_recv(struct tevent_req *req, struct fo_server **server);
 
+/* Forward declarations for racing connection attempts */
+static size_t
+fo_race_candidates(TALLOC_CTX *mem_ctx, struct fo_server *first,
+                   size_t max, struct fo_server ***_candidates);
+static struct tevent_req *
+fo_race_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+             struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+             struct fo_server **candidates, size_t num_candidates);
+static errno_t
+fo_race_recv(struct tevent_req *req, struct fo_server **_winner);
+static void fo_resolve_service_race_done(struct tevent_req *subreq);
+
 struct tevent_req *
 fo_resolve_service_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
                         struct resolv_ctx *resolv, struct fo_ctx *ctx,
@@ -1120,44 +1266,83 @@ fo_resolve_service_cont(struct tevent_req *subreq)
     fo_resolve_service_server(req);
 }
 
-static bool
-fo_resolve_service_server(struct tevent_req *req)
+/* Returns EAGAIN if req is finished later, when the name of the server
+ * is resolved, or EOK if the name is resolved already. */
+static errno_t
+fo_resolve_server_name(struct tevent_context *ev, struct resolv_ctx *resolv,
+                       struct fo_ctx *fo_ctx, struct fo_server *server,
+                       struct tevent_req *req)
 {
-    struct resolve_service_state *state = tevent_req_data(req,
-                                        struct resolve_service_state);
     struct tevent_req *subreq;
     int ret;
 
-    switch (get_server_status(state->server)) {
+    switch (get_server_status(server)) {
     case SERVER_NAME_NOT_RESOLVED: /* Request name resolution. */
-        subreq = resolv_gethostbyname_send(state->server->common,
-                                           state->ev, state->resolv,
-                                           state->server->common->name,
-                                           state->fo_ctx->opts->family_order,
+        subreq = resolv_gethostbyname_send(server->common,
+                                           ev, resolv,
+                                           server->common->name,
+                                           fo_ctx->opts->family_order,
                                            default_host_dbs);
         if (subreq == NULL) {
-            tevent_req_error(req, ENOMEM);
-            return true;
+            return ENOMEM;
         }
         tevent_req_set_callback(subreq, fo_resolve_service_done,
-                                state->server->common);
-        fo_set_server_status(state->server, SERVER_RESOLVING_NAME);
+                                server->common);
+        fo_set_server_status(server, SERVER_RESOLVING_NAME);
         /* FALLTHROUGH */
     case SERVER_RESOLVING_NAME:
         /* Name resolution is already under way. Just add ourselves into the
          * waiting queue so we get notified after the operation is finished. */
-        ret = set_lookup_hook(state->ev, state->server, req);
+        ret = set_lookup_hook(ev, server, req);
         if (ret != EOK) {
-            tevent_req_error(req, ret);
-            return true;
+            return ret;
         }
-        break;
-    default: /* The name is already resolved. Return immediately. */
+        return EAGAIN;
+    default: /* The name is already resolved. */
+        return EOK;
+    }
+}
+
+static bool
+fo_resolve_service_server(struct tevent_req *req)
+{
+    struct resolve_service_state *state = tevent_req_data(req,
+                                        struct resolve_service_state);
+    struct fo_server **candidates;
+    struct tevent_req *subreq;
+    size_t num_candidates;
+    int ret;
+
+    if (state->fo_ctx->opts->parallel_connect > 1) {
+        num_candidates = fo_race_candidates(state, state->server,
+                                            state->fo_ctx->opts->parallel_connect,
+                                            &candidates);
+        if (num_candidates > 1) {
+            subreq = fo_race_send(state, state->ev, state->resolv,
+                                  state->fo_ctx, candidates, num_candidates);
+            if (subreq == NULL) {
+                tevent_req_error(req, ENOMEM);
+                return true;
+            }
+            tevent_req_set_callback(subreq, fo_resolve_service_race_done, req);
+            return false;
+        }
+        talloc_free(candidates);
+    }
+
+    ret = fo_resolve_server_name(state->ev, state->resolv, state->fo_ctx,
+                                 state->server, req);
+    switch (ret) {
+    case EAGAIN:
+        return false;
+    case EOK:
+        /* The name is already resolved. Return immediately. */
         tevent_req_done(req);
         return true;
+    default:
+        tevent_req_error(req, ret);
+        return true;
     }
-
-    return false;
 }
 
 static void
@@ -1234,6 +1419,635 @@ fo_resolve_service_recv(struct tevent_req *req,
     return EOK;
 }
 
+static void
+fo_resolve_service_race_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct resolve_service_state *state = tevent_req_data(req,
+                                        struct resolve_service_state);
+    struct fo_server *winner;
+    int ret;
+
+    ret = fo_race_recv(subreq, &winner);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        /* The servers that failed were marked as not working already,
+         * state->server is returned so that the caller asks for another. */
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    state->server = winner;
+    winner->service->last_tried_server = winner;
+    tevent_req_done(req);
+}
+
+/*******************************************************************
+ * Race connection attempts to several servers, RFC 8305 style.    *
+ *******************************************************************/
+
+/* The probe is a TCP connection, it tells nothing about servers that are
+ * used over UDP, e.g. Kerberos KDCs found in _udp SRV records. Servers that
+ * come from SRV records carry the protocol, configured servers are used
+ * over TCP unless they listen on a Kerberos port. */
+static bool fo_server_uses_tcp(struct fo_server *server)
+{
+    if (server->srv_data != NULL) {
+        return server->srv_data->proto != NULL
+               && strcasecmp(server->srv_data->proto, FO_PROTO_TCP) == 0;
+    }
+
+    return server->port != FO_KRB5_KDC_PORT
+           && server->port != FO_KRB5_KPASSWD_PORT;
+}
+
+static size_t
+fo_race_candidates(TALLOC_CTX *mem_ctx, struct fo_server *first,
+                   size_t max, struct fo_server ***_candidates)
+{
+    struct fo_server **candidates;
+    struct fo_server *server;
+    size_t num = 0;
+
+    candidates = talloc_zero_array(mem_ctx, struct fo_server *, max);
+    if (candidates == NULL) {
+        *_candidates = NULL;
+        return 0;
+    }
+
+    /* Only TCP servers we can connect to without knowing the default port
+     * of the service, and only servers of the same class as the first one
+     * so that a server with a worse SRV priority never wins. The servers
+     * are already sorted by priority and weight. */
+    DLIST_FOR_EACH(server, first) {
+        if (num == max) {
+            break;
+        }
+
+        if (server->common == NULL || server->port == 0
+                || !fo_server_uses_tcp(server)
+                || !fo_server_same_class(server, first)
+                || !service_works(server)) {
+            if (server == first) {
+                break;
+            }
+            continue;
+        }
+
+        candidates[num++] = server;
+    }
+
+    *_candidates = candidates;
+    return num;
+}
+
+static uint64_t fo_elapsed_usec(const struct timeval *start)
+{
+    struct timeval now = tevent_timeval_current();
+    struct timeval diff = tevent_timeval_until(start, &now);
+
+    return diff.tv_sec * 1000000ULL + diff.tv_usec;
+}
+
+struct fo_resolve_name_state {
+    struct fo_server *server;
+};
+
+static struct tevent_req *
+fo_resolve_name_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                     struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+                     struct fo_server *server)
+{
+    struct fo_resolve_name_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct fo_resolve_name_state);
+    if (req == NULL) {
+        return NULL;
+    }
+    state->server = server;
+
+    ret = fo_resolve_server_name(ev, resolv, fo_ctx, server, req);
+    if (ret == EAGAIN) {
+        return req;
+    }
+
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+    return req;
+}
+
+static errno_t
+fo_resolve_name_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+struct fo_probe_state {
+    struct tevent_context *ev;
+    struct fo_server *server;
+
+    struct timeval start;
+    uint64_t rtt_usec;
+    int sd;
+    struct tevent_fd *fde;
+    struct tevent_timer *timeout_te;
+};
+
+static int fo_probe_state_destroy(void *data)
+{
+    struct fo_probe_state *state = talloc_get_type(data,
+                                                   struct fo_probe_state);
+
+    talloc_zfree(state->fde);
+    if (state->sd != -1) {
+        close(state->sd);
+    }
+
+    return 0;
+}
+
+static void fo_probe_name_done(struct tevent_req *subreq);
+static errno_t fo_probe_connect(struct tevent_req *req);
+static void fo_probe_connected(struct tevent_context *ev,
+                               struct tevent_fd *fde,
+                               uint16_t flags, void *pvt);
+static void fo_probe_timeout(struct tevent_context *ev,
+                             struct tevent_timer *te,
+                             struct timeval tv, void *pvt);
+
+/* Resolves the name of the server and checks that it accepts a TCP
+ * connection on its port. The connection is closed right away. */
+static struct tevent_req *
+fo_probe_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+              struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+              struct fo_server *server)
+{
+    struct fo_probe_state *state;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+
+    req = tevent_req_create(mem_ctx, &state, struct fo_probe_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->server = server;
+    state->sd = -1;
+    talloc_set_destructor((TALLOC_CTX *) state, fo_probe_state_destroy);
+
+    subreq = fo_resolve_name_send(state, ev, resolv, fo_ctx, server);
+    if (subreq == NULL) {
+        talloc_free(req);
+        return NULL;
+    }
+    tevent_req_set_callback(subreq, fo_probe_name_done, req);
+
+    return req;
+}
+
+static void fo_probe_name_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    errno_t ret;
+
+    ret = fo_resolve_name_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = fo_probe_connect(req);
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+    }
+}
+
+static errno_t fo_probe_connect(struct tevent_req *req)
+{
+    struct fo_probe_state *state = tevent_req_data(req,
+                                                   struct fo_probe_state);
+    struct resolv_hostent *hostent;
+    struct sockaddr_storage *addr;
+    socklen_t addr_len;
+    errno_t ret;
+
+    hostent = fo_get_server_hostent(state->server);
+    if (hostent == NULL) {
+        return EIO;
+    }
+
+    addr = resolv_get_sockaddr_address(state, hostent, state->server->port);
+    if (addr == NULL) {
+        return ENOMEM;
+    }
+    addr_len = addr->ss_family == AF_INET6 ? sizeof(struct sockaddr_in6)
+                                           : sizeof(struct sockaddr_in);
+    state->start = tevent_timeval_current();
+
+    state->sd = socket(addr->ss_family, SOCK_STREAM, 0);
+    if (state->sd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_OP_FAILURE, "socket failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    ret = sss_fd_nonblocking(state->sd);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = connect(state->sd, (struct sockaddr *) addr, addr_len);
+    if (ret == 0) {
+        state->rtt_usec = fo_elapsed_usec(&state->start);
+        return EOK;
+    }
+
+    ret = errno;
+    if (ret != EINPROGRESS) {
+        return ret;
+    }
+
+    state->fde = tevent_add_fd(state->ev, state, state->sd, TEVENT_FD_WRITE,
+                               fo_probe_connected, req);
+    if (state->fde == NULL) {
+        return ENOMEM;
+    }
+
+    state->timeout_te = tevent_add_timer(state->ev, state,
+                                tevent_timeval_current_ofs(FO_PROBE_TIMEOUT, 0),
+                                fo_probe_timeout, req);
+    if (state->timeout_te == NULL) {
+        return ENOMEM;
+    }
+
+    return EAGAIN;
+}
+
+static void fo_probe_timeout(struct tevent_context *ev,
+                             struct tevent_timer *te,
+                             struct timeval tv, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct fo_probe_state *state = tevent_req_data(req,
+                                                   struct fo_probe_state);
+
+    /* tevent frees the timer when the handler returns */
+    state->timeout_te = NULL;
+    talloc_zfree(state->fde);
+
+    DEBUG(SSSDBG_MINOR_FAILURE, "Connection to server '%s' timed out\n",
+          SERVER_NAME(state->server));
+    tevent_req_error(req, ETIMEDOUT);
+}
+
+static void fo_probe_connected(struct tevent_context *ev,
+                               struct tevent_fd *fde,
+                               uint16_t flags, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct fo_probe_state *state = tevent_req_data(req,
+                                                   struct fo_probe_state);
+    socklen_t optlen;
+    int optval;
+    int ret;
+
+    talloc_zfree(state->fde);
+    talloc_zfree(state->timeout_te);
+
+    optlen = sizeof(optval);
+    ret = getsockopt(state->sd, SOL_SOCKET, SO_ERROR, &optval, &optlen);
+    if (ret != 0) {
+        tevent_req_error(req, errno);
+        return;
+    }
+
+    if (optval != 0) {
+        tevent_req_error(req, optval);
+        return;
+    }
+
+    state->rtt_usec = fo_elapsed_usec(&state->start);
+    tevent_req_done(req);
+}
+
+static errno_t fo_probe_recv(struct tevent_req *req,
+                             struct fo_server **_server,
+                             uint64_t *_rtt_usec)
+{
+    struct fo_probe_state *state = tevent_req_data(req,
+                                                   struct fo_probe_state);
+
+    *_server = state->server;
+    *_rtt_usec = state->rtt_usec;
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+struct fo_race_state {
+    struct tevent_context *ev;
+    struct resolv_ctx *resolv;
+    struct fo_ctx *fo_ctx;
+
+    struct fo_server **candidates;
+    size_t num_candidates;
+    size_t next;
+
+    /* parent of the connection attempts in progress */
+    TALLOC_CTX *probes;
+    size_t num_running;
+    struct tevent_timer *attempt_te;
+    errno_t error;
+
+    struct fo_server *winner;
+};
+
+static errno_t fo_race_next(struct tevent_req *req);
+static void fo_race_attempt_delay(struct tevent_context *ev,
+                                  struct tevent_timer *te,
+                                  struct timeval tv, void *pvt);
+static void fo_race_probe_done(struct tevent_req *subreq);
+
+/* Tries to connect to the candidates one after another, each attempt is
+ * started when the previous one fails or after a short delay, whatever
+ * comes first. The first server that accepts the connection wins.
+ *
+ * The race only measures which server accepts a TCP connection first.
+ * The connections are closed and the consumer of the fail over service
+ * opens its own connection to the winner, which costs one more round
+ * trip. */
+static struct tevent_req *
+fo_race_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+             struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+             struct fo_server **candidates, size_t num_candidates)
+{
+    struct fo_race_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct fo_race_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->resolv = resolv;
+    state->fo_ctx = fo_ctx;
+    state->candidates = talloc_steal(state, candidates);
+    state->num_candidates = num_candidates;
+    state->error = ENOENT;
+
+    state->probes = talloc_new(state);
+    if (state->probes == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Racing connections to %zu servers\n", num_candidates);
+
+    ret = fo_race_next(req);
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+    return req;
+}
+
+static errno_t fo_race_next(struct tevent_req *req)
+{
+    struct fo_race_state *state = tevent_req_data(req, struct fo_race_state);
+    struct fo_server *server;
+    struct tevent_req *subreq;
+    struct timeval tv;
+
+    talloc_zfree(state->attempt_te);
+
+    server = state->candidates[state->next++];
+    DEBUG(SSSDBG_TRACE_FUNC, "Trying to connect to server '%s' port %d\n",
+          SERVER_NAME(server), server->port);
+
+    subreq = fo_probe_send(state->probes, state->ev, state->resolv,
+                           state->fo_ctx, server);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+    tevent_req_set_callback(subreq, fo_race_probe_done, req);
+    state->num_running++;
+
+    if (state->next < state->num_candidates) {
+        tv = tevent_timeval_current_ofs(0, FO_RACE_ATTEMPT_DELAY_MS * 1000);
+        state->attempt_te = tevent_add_timer(state->ev, state, tv,
+                                             fo_race_attempt_delay, req);
+        if (state->attempt_te == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    return EOK;
+}
+
+static void fo_race_attempt_delay(struct tevent_context *ev,
+                                  struct tevent_timer *te,
+                                  struct timeval tv, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct fo_race_state *state = tevent_req_data(req, struct fo_race_state);
+    errno_t ret;
+
+    /* tevent frees the timer when the handler returns */
+    state->attempt_te = NULL;
+
+    ret = fo_race_next(req);
+    if (ret != EOK) {
+        talloc_zfree(state->probes);
+        tevent_req_error(req, ret);
+    }
+}
+
+static void fo_race_probe_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct fo_race_state *state = tevent_req_data(req, struct fo_race_state);
+    struct fo_server *server;
+    uint64_t rtt_usec;
+    errno_t ret;
+
+    ret = fo_probe_recv(subreq, &server, &rtt_usec);
+    talloc_zfree(subreq);
+    state->num_running--;
+
+    if (ret == EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Server '%s' accepted the connection first\n",
+              SERVER_NAME(server));
+        fo_record_server_rtt(server, rtt_usec);
+        fo_record_server_op(server, true);
+        state->winner = server;
+
+        /* Cancels the attempts that are still in progress */
+        talloc_zfree(state->attempt_te);
+        talloc_zfree(state->probes);
+        tevent_req_done(req);
+        return;
+    }
+
+    DEBUG(SSSDBG_MINOR_FAILURE, "Cannot connect to server '%s' [%d]: %s\n",
+          SERVER_NAME(server), ret, sss_strerror(ret));
+    /* including ETIMEDOUT of a probe that was not answered */
+    if (ret != ENOMEM) {
+        fo_set_port_status(server, PORT_NOT_WORKING);
+    }
+    state->error = ret;
+
+    /* A failed attempt does not wait for the delay to start the next one */
+    if (state->next < state->num_candidates) {
+        ret = fo_race_next(req);
+        if (ret != EOK) {
+            talloc_zfree(state->attempt_te);
+            talloc_zfree(state->probes);
+            tevent_req_error(req, ret);
+        }
+        return;
+    }
+
+    if (state->num_running == 0) {
+        tevent_req_error(req, state->error);
+    }
+}
+
+static errno_t
+fo_race_recv(struct tevent_req *req, struct fo_server **_winner)
+{
+    struct fo_race_state *state = tevent_req_data(req, struct fo_race_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_winner = state->winner;
+    return EOK;
+}
+
+/*******************************************************************
+ * Measure the round trip time of the servers of a service.        *
+ *******************************************************************/
+
+struct fo_probe_service_state {
+    size_t num_running;
+};
+
+static void fo_probe_service_done(struct tevent_req *subreq);
+
+struct tevent_req *
+fo_probe_service_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                      struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+                      struct fo_service *service)
+{
+    struct fo_probe_service_state *state;
+    struct fo_server *server;
+    struct fo_server *first;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct fo_probe_service_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    /* Only the servers that fo_fastest_server() chooses from are
+     * interesting. */
+    first = fo_first_working_server(service);
+
+    DLIST_FOR_EACH(server, service->server_list) {
+        if (first == NULL || !fo_server_same_class(server, first)
+                || server->common == NULL
+                || server->port == 0 || !fo_server_uses_tcp(server)
+                || !service_works(server)) {
+            continue;
+        }
+
+        subreq = fo_probe_send(state, ev, resolv, fo_ctx, server);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        tevent_req_set_callback(subreq, fo_probe_service_done, req);
+        state->num_running++;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Probing %zu servers of service '%s'\n",
+          state->num_running, service->name);
+
+    ret = state->num_running == 0 ? EOK : EAGAIN;
+
+done:
+    if (ret == EOK) {
+        tevent_req_done(req);
+        tevent_req_post(req, ev);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
+static void fo_probe_service_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct fo_probe_service_state *state = tevent_req_data(req,
+                                            struct fo_probe_service_state);
+    struct fo_server *server;
+    uint64_t rtt_usec;
+    errno_t ret;
+
+    ret = fo_probe_recv(subreq, &server, &rtt_usec);
+    talloc_zfree(subreq);
+    if (ret == EOK) {
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Server '%s' answered in %"PRIu64" us\n",
+              SERVER_NAME(server), rtt_usec);
+        fo_record_server_rtt(server, rtt_usec);
+        fo_record_server_op(server, true);
+    } else if (ret != ENOMEM) {
+        /* Only statistics, the server is marked as not working by
+         * its consumers when they really fail to use it. */
+        DEBUG(SSSDBG_MINOR_FAILURE, "Cannot probe server '%s' [%d]: %s\n",
+              SERVER_NAME(server), ret, sss_strerror(ret));
+        fo_record_server_op(server, false);
+    }
+
+    state->num_running--;
+    if (state->num_running == 0) {
+        tevent_req_done(req);
+    }
+}
+
+errno_t fo_probe_service_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
 /*******************************************************************
  * Resolve the server to connect to using a SRV query.             *
  *******************************************************************/
@@ -1524,6 +2338,40 @@ fo_set_port_status(struct fo_server *server, enum port_status status)
     }
 }
 
+void fo_record_server_rtt(struct fo_server *server, uint64_t rtt_usec)
+{
+    struct fo_server_stats *stats;
+
+    if (server == NULL) {
+        return;
+    }
+    stats = &server->stats;
+
+    if (stats->rtt_samples == 0) {
+        stats->rtt_usec = rtt_usec;
+    } else {
+        stats->rtt_usec = stats->rtt_usec - stats->rtt_usec / FO_STATS_WEIGHT
+                          + rtt_usec / FO_STATS_WEIGHT;
+    }
+    stats->rtt_samples++;
+}
+
+void fo_record_server_op(struct fo_server *server, bool success)
+{
+    struct fo_server_stats *stats;
+
+    if (server == NULL) {
+        return;
+    }
+    stats = &server->stats;
+
+    if (success) {
+        stats->error_rate -= stats->error_rate / FO_STATS_WEIGHT;
+    } else {
+        stats->error_rate += (1000 - stats->error_rate) / FO_STATS_WEIGHT;
+    }
+}
+
 struct fo_server *fo_get_active_server(struct fo_service *service)
 {
     return service->active_server;
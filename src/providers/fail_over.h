@@ -76,12 +76,25 @@ struct fo_server;
  *
  * The family_order member specifies the order of address families to
  * try when looking up the service.
+ *
+ * The 'parallel_connect' member specifies how many servers of the same
+ * kind are probed at once when looking for a working one. Connection
+ * attempts are started one after another with a short delay and the first
+ * server that accepts the connection is returned. 0 or 1 disables probing.
+ *
+ * The 'latency_probe_interval' member enables latency aware selection
+ * when set above 0. The fastest working server of the same priority class
+ * is then preferred, even to the active server when it is considerably
+ * faster. The servers are expected to be probed every that many seconds
+ * with fo_probe_service_send().
  */
 struct fo_options {
     time_t srv_retry_neg_timeout;
     time_t retry_timeout;
     int service_resolv_timeout;
     enum restrict_family family_order;
+    int parallel_connect;
+    int latency_probe_interval;
 };
 
 /*
@@ -179,6 +192,32 @@ void fo_set_server_status(struct fo_server *server,
 void fo_set_port_status(struct fo_server *server,
                         enum port_status status);
 
+/*
+ * Feed the time it took to open a TCP connection to the server into its
+ * statistics used by the latency aware selection. Only the connect round
+ * trip time is used, so that servers are compared by the same measure no
+ * matter what operations their consumers send.
+ */
+void fo_record_server_rtt(struct fo_server *server, uint64_t rtt_usec);
+
+/*
+ * Record the result of an operation sent to the server. Operations that
+ * fail or time out raise the error rate of the server, which makes it
+ * look slower to the latency aware selection.
+ */
+void fo_record_server_op(struct fo_server *server, bool success);
+
+/*
+ * Measure how long it takes to connect to each working server of the
+ * service and record it with fo_record_server_rtt().
+ */
+struct tevent_req *
+fo_probe_service_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                      struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+                      struct fo_service *service);
+
+errno_t fo_probe_service_recv(struct tevent_req *req);
+
 /*
  * Instruct fail-over to try next server on the next connect attempt.
  * Should be used after connection to service was unexpectedly dropped
@@ -120,6 +120,7 @@ static void ipa_fetch_hbac_hostinfo_done(struct tevent_req *subreq);
 static void ipa_fetch_hbac_services_done(struct tevent_req *subreq);
 static void ipa_fetch_hbac_rules_done(struct tevent_req *subreq);
 static errno_t ipa_purge_hbac(struct sss_domain_info *domain);
+static void ipa_hbac_rules_invalidate(struct ipa_access_ctx *access_ctx);
 static errno_t ipa_save_hbac(struct sss_domain_info *domain,
                              struct ipa_fetch_hbac_state *state);
 
@@ -438,6 +439,7 @@ static void ipa_fetch_hbac_rules_done(struct tevent_req *subreq)
 
     if (found == false) {
         /* No rules were found that apply to this host. */
+        ipa_hbac_rules_invalidate(state->access_ctx);
         ret = ipa_purge_hbac(state->be_ctx->domain);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to remove HBAC rules\n");
@@ -557,6 +559,7 @@ static errno_t ipa_save_hbac(struct sss_domain_info *domain,
     in_transaction = false;
 
     state->access_ctx->last_update = time(NULL);
+    ipa_hbac_rules_invalidate(state->access_ctx);
 
     ret = EOK;
 
@@ -571,16 +574,30 @@ done:
     return ret;
 }
 
-errno_t ipa_hbac_evaluate_rules(struct be_ctx *be_ctx,
-                                struct dp_option *ipa_options,
-                                struct pam_data *pd)
+struct ipa_hbac_rules {
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled;
+};
+
+static int ipa_hbac_rules_destructor(struct ipa_hbac_rules *hbac_rules)
+{
+    hbac_free_compiled_rules(hbac_rules->compiled);
+    return 0;
+}
+
+static void ipa_hbac_rules_invalidate(struct ipa_access_ctx *access_ctx)
+{
+    talloc_zfree(access_ctx->hbac_rules);
+    be_access_cache_invalidate(access_ctx->decision_cache);
+}
+
+static errno_t ipa_hbac_compile_rules(TALLOC_CTX *mem_ctx,
+                                      struct hbac_ctx *hbac_ctx,
+                                      struct ipa_hbac_rules **_hbac_rules)
 {
     TALLOC_CTX *tmp_ctx;
-    struct hbac_ctx hbac_ctx;
-    struct hbac_rule **hbac_rules;
-    struct hbac_eval_req *eval_req;
-    enum hbac_eval_result result;
-    struct hbac_info *info = NULL;
+    struct ipa_hbac_rules *hbac_rules;
+    enum hbac_error_code code;
     errno_t ret;
 
     tmp_ctx = talloc_new(NULL);
@@ -588,32 +605,116 @@ errno_t ipa_hbac_evaluate_rules(struct be_ctx *be_ctx,
         return ENOMEM;
     }
 
-    hbac_ctx.be_ctx = be_ctx;
-    hbac_ctx.ipa_options = ipa_options;
-    hbac_ctx.pd = pd;
-
     /* Get HBAC rules from the sysdb */
-    ret = hbac_get_cached_rules(tmp_ctx, be_ctx->domain,
-                                &hbac_ctx.rule_count, &hbac_ctx.rules);
+    ret = hbac_get_cached_rules(tmp_ctx, hbac_ctx->be_ctx->domain,
+                                &hbac_ctx->rule_count, &hbac_ctx->rules);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Could not retrieve rules from the cache\n");
         goto done;
     }
 
-    ret = hbac_ctx_to_rules(tmp_ctx, &hbac_ctx, &hbac_rules, &eval_req);
+    hbac_rules = talloc_zero(tmp_ctx, struct ipa_hbac_rules);
+    if (hbac_rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = hbac_ctx_to_rules(hbac_rules, hbac_ctx, &hbac_rules->rules);
     if (ret == EPERM) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "DENY rules detected. Denying access to all users\n");
-        ret = ERR_ACCESS_DENIED;
         goto done;
     } else if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct HBAC rules\n");
         goto done;
     }
 
+    code = hbac_compile_rules(hbac_rules->rules, &hbac_rules->compiled);
+    if (code != HBAC_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not compile HBAC rules [%s]\n",
+              hbac_error_string(code));
+        ret = code == HBAC_ERROR_OUT_OF_MEMORY ? ENOMEM : EIO;
+        goto done;
+    }
+    talloc_set_destructor(hbac_rules, ipa_hbac_rules_destructor);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Compiled %zu HBAC rules\n",
+          hbac_ctx->rule_count);
+
+    *_hbac_rules = talloc_steal(mem_ctx, hbac_rules);
+    ret = EOK;
+
+done:
+    hbac_ctx->rules = NULL;
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t ipa_hbac_evaluate_rules(struct be_ctx *be_ctx,
+                                       struct ipa_access_ctx *access_ctx,
+                                       struct pam_data *pd)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct hbac_ctx hbac_ctx = { 0 };
+    struct ipa_hbac_rules *hbac_rules;
+    struct hbac_eval_req *eval_req;
+    enum hbac_eval_result result;
+    struct hbac_info *info = NULL;
+    uint64_t membership;
+    bool cacheable = false;
+    errno_t cached_ret;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    hbac_ctx.be_ctx = be_ctx;
+    hbac_ctx.ipa_options = access_ctx->ipa_options;
+    hbac_ctx.pd = pd;
+
+    if (access_ctx->decision_cache != NULL) {
+        ret = hbac_user_membership_fingerprint(&hbac_ctx, &membership);
+        if (ret == EOK) {
+            ret = be_access_cache_lookup(access_ctx->decision_cache,
+                                         pd->user, pd->service, pd->rhost,
+                                         membership, &cached_ret);
+            if (ret == EOK) {
+                ret = cached_ret;
+                goto done;
+            }
+            cacheable = true;
+        }
+    }
+
     hbac_enable_debug(hbac_debug_messages);
 
-    result = hbac_evaluate(hbac_rules, eval_req, &info);
+    hbac_rules = access_ctx->hbac_rules;
+    if (hbac_rules == NULL) {
+        ret = ipa_hbac_compile_rules(tmp_ctx, &hbac_ctx, &hbac_rules);
+        if (ret == EPERM) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "DENY rules detected. Denying access to all users\n");
+            ret = ERR_ACCESS_DENIED;
+            goto done;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        /* Members that could not be resolved to a cached user may be
+         * resolvable the next time, so only keep a complete rule set
+         * around until the rules are refreshed. */
+        if (!hbac_ctx.unresolved_users) {
+            access_ctx->hbac_rules = talloc_steal(access_ctx, hbac_rules);
+        }
+    }
+
+    ret = hbac_ctx_to_eval_request(tmp_ctx, &hbac_ctx, &eval_req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct eval request\n");
+        goto done;
+    }
+
+    result = hbac_evaluate_compiled(hbac_rules->compiled, eval_req, &info);
     if (result == HBAC_EVAL_ALLOW) {
         DEBUG(SSSDBG_MINOR_FAILURE, "Access granted by HBAC rule [%s]\n",
               info->rule_name);
@@ -634,6 +735,13 @@ errno_t ipa_hbac_evaluate_rules(struct be_ctx *be_ctx,
     ret = ERR_ACCESS_DENIED;
 
 done:
+    if (cacheable) {
+        if (be_access_cache_store(access_ctx->decision_cache,
+                                  pd->user, pd->service, pd->rhost,
+                                  membership, ret) != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to cache access decision\n");
+        }
+    }
     hbac_free_info(info);
     talloc_free(tmp_ctx);
     return ret;
@@ -822,8 +930,8 @@ static void ipa_pam_access_handler_done(struct tevent_req *subreq)
         goto done;
     }
 
-    ret = ipa_hbac_evaluate_rules(state->be_ctx,
-                                  state->access_ctx->ipa_options, state->pd);
+    ret = ipa_hbac_evaluate_rules(state->be_ctx, state->access_ctx,
+                                  state->pd);
     if (ret == EOK) {
         state->pd->pam_status = PAM_SUCCESS;
     } else if (ret == ERR_ACCESS_DENIED) {
@@ -26,6 +26,7 @@
 #define _IPA_ACCESS_H_
 
 #include "providers/ldap/ldap_common.h"
+#include "providers/be_access_cache.h"
 
 enum ipa_access_mode {
     IPA_ACCESS_DENY = 0,
@@ -43,6 +44,10 @@ struct ipa_access_ctx {
     struct sdap_attr_map *hostgroup_map;
     struct sdap_search_base **host_search_bases;
     struct sdap_search_base **hbac_search_bases;
+
+    /* Compiled cached rules, rebuilt after each rule refresh */
+    struct ipa_hbac_rules *hbac_rules;
+    struct be_access_cache *decision_cache;
 };
 
 struct hbac_ctx {
@@ -51,6 +56,9 @@ struct hbac_ctx {
     struct pam_data *pd;
     size_t rule_count;
     struct sysdb_attrs **rules;
+
+    /* Set if a rule refers to a member that could not be resolved */
+    bool unresolved_users;
 };
 
 struct tevent_req *
@@ -50,6 +50,7 @@ enum ipa_basic_opt {
     IPA_HBAC_REFRESH,
     IPA_SELINUX_REFRESH,
     IPA_HBAC_SUPPORT_SRCHOST,
+    IPA_HBAC_DECISION_CACHE_TIMEOUT,
     IPA_AUTOMOUNT_LOCATION,
     IPA_RANGES_SEARCH_BASE,
     IPA_ENABLE_DNS_SITES,
@@ -197,34 +197,22 @@ hbac_attrs_to_rule(TALLOC_CTX *mem_ctx,
                    size_t index,
                    struct hbac_rule **rule);
 
-static errno_t
-hbac_ctx_to_eval_request(TALLOC_CTX *mem_ctx,
-                         struct hbac_ctx *hbac_ctx,
-                         struct hbac_eval_req **request);
-
 errno_t
 hbac_ctx_to_rules(TALLOC_CTX *mem_ctx,
                   struct hbac_ctx *hbac_ctx,
-                  struct hbac_rule ***rules,
-                  struct hbac_eval_req **request)
+                  struct hbac_rule ***rules)
 {
     errno_t ret;
     struct hbac_rule **new_rules;
-    struct hbac_eval_req *new_request = NULL;
     size_t i;
-    TALLOC_CTX *tmp_ctx = NULL;
-
-    if (!rules || !request) return EINVAL;
 
-    tmp_ctx = talloc_new(mem_ctx);
-    if (tmp_ctx == NULL) return ENOMEM;
+    if (!rules) return EINVAL;
 
     /* First create an array of rules */
-    new_rules = talloc_array(tmp_ctx, struct hbac_rule *,
+    new_rules = talloc_array(mem_ctx, struct hbac_rule *,
                              hbac_ctx->rule_count + 1);
     if (new_rules == NULL) {
-        ret = ENOMEM;
-        goto done;
+        return ENOMEM;
     }
 
     /* Create each rule one at a time */
@@ -239,19 +227,11 @@ hbac_ctx_to_rules(TALLOC_CTX *mem_ctx,
     }
     new_rules[i] = NULL;
 
-    /* Create the eval request */
-    ret = hbac_ctx_to_eval_request(tmp_ctx, hbac_ctx, &new_request);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct eval request\n");
-        goto done;
-    }
-
-    *rules = talloc_steal(mem_ctx, new_rules);
-    *request = talloc_steal(mem_ctx, new_request);
+    *rules = new_rules;
     ret = EOK;
 
 done:
-    talloc_free(tmp_ctx);
+    if (ret != EOK) talloc_free(new_rules);
     return ret;
 }
 
@@ -307,7 +287,8 @@ hbac_attrs_to_rule(TALLOC_CTX *mem_ctx,
     ret = hbac_user_attrs_to_rule(new_rule, hbac_ctx->be_ctx->domain,
                                   new_rule->name,
                                   hbac_ctx->rules[idx],
-                                  &new_rule->users);
+                                  &new_rule->users,
+                                  &hbac_ctx->unresolved_users);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Could not parse users for rule [%s]\n",
                   new_rule->name);
@@ -416,6 +397,81 @@ hbac_eval_host_element(TALLOC_CTX *mem_ctx,
                        struct hbac_request_element **host_element);
 
 static errno_t
+hbac_get_user_domain(struct hbac_ctx *hbac_ctx,
+                     struct sss_domain_info **_user_dom)
+{
+    struct sss_domain_info *domain = hbac_ctx->be_ctx->domain;
+    struct sss_domain_info *user_dom;
+
+    if (strcasecmp(hbac_ctx->pd->domain, domain->name) == 0) {
+        *_user_dom = domain;
+        return EOK;
+    }
+
+    user_dom = find_domain_by_name(domain, hbac_ctx->pd->domain, true);
+    if (user_dom == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "find_domain_by_name failed.\n");
+        return ENOMEM;
+    }
+
+    *_user_dom = user_dom;
+    return EOK;
+}
+
+errno_t
+hbac_user_membership_fingerprint(struct hbac_ctx *hbac_ctx,
+                                 uint64_t *_fingerprint)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_domain_info *user_dom;
+    struct ldb_message *msg;
+    struct ldb_message_element *el;
+    const char *attrs[] = { SYSDB_ORIG_MEMBEROF, NULL };
+    const char **values;
+    unsigned int i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) return ENOMEM;
+
+    ret = hbac_get_user_domain(hbac_ctx, &user_dom);
+    if (ret != EOK) goto done;
+
+    ret = sysdb_search_user_by_name(tmp_ctx, user_dom, hbac_ctx->pd->user,
+                                    attrs, &msg);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Could not determine user memberships for [%s]\n",
+              hbac_ctx->pd->user);
+        goto done;
+    }
+
+    el = ldb_msg_find_element(msg, SYSDB_ORIG_MEMBEROF);
+    if (el == NULL || el->num_values == 0) {
+        *_fingerprint = be_access_cache_fingerprint(NULL, 0);
+        ret = EOK;
+        goto done;
+    }
+
+    values = talloc_array(tmp_ctx, const char *, el->num_values);
+    if (values == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        values[i] = (const char *) el->values[i].data;
+    }
+
+    *_fingerprint = be_access_cache_fingerprint(values, el->num_values);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t
 hbac_ctx_to_eval_request(TALLOC_CTX *mem_ctx,
                          struct hbac_ctx *hbac_ctx,
                          struct hbac_eval_req **request)
@@ -442,19 +498,11 @@ hbac_ctx_to_eval_request(TALLOC_CTX *mem_ctx,
 
     /* Get user the user name and groups,
      * take care of subdomain users as well */
-    if (strcasecmp(pd->domain, domain->name) != 0) {
-        user_dom = find_domain_by_name(domain, pd->domain, true);
-        if (user_dom == NULL) {
-            DEBUG(SSSDBG_OP_FAILURE, "find_domain_by_name failed.\n");
-            ret = ENOMEM;
-            goto done;
-        }
-        ret = hbac_eval_user_element(eval_req, user_dom, pd->user,
-                                     &eval_req->user);
-    } else {
-        ret = hbac_eval_user_element(eval_req, domain, pd->user,
-                                     &eval_req->user);
-    }
+    ret = hbac_get_user_domain(hbac_ctx, &user_dom);
+    if (ret != EOK) goto done;
+
+    ret = hbac_eval_user_element(eval_req, user_dom, pd->user,
+                                 &eval_req->user);
     if (ret != EOK) goto done;
 
     /* Get the PAM service and service groups */
@@ -79,8 +79,14 @@ replace_attribute_name(const char *old_name,
 
 errno_t hbac_ctx_to_rules(TALLOC_CTX *mem_ctx,
                           struct hbac_ctx *hbac_ctx,
-                          struct hbac_rule ***rules,
-                          struct hbac_eval_req **request);
+                          struct hbac_rule ***rules);
+
+errno_t hbac_ctx_to_eval_request(TALLOC_CTX *mem_ctx,
+                                 struct hbac_ctx *hbac_ctx,
+                                 struct hbac_eval_req **request);
+
+errno_t hbac_user_membership_fingerprint(struct hbac_ctx *hbac_ctx,
+                                         uint64_t *_fingerprint);
 
 errno_t
 hbac_get_category(struct sysdb_attrs *attrs,
@@ -141,7 +147,8 @@ hbac_user_attrs_to_rule(TALLOC_CTX *mem_ctx,
                         struct sss_domain_info *domain,
                         const char *rule_name,
                         struct sysdb_attrs *rule_attrs,
-                        struct hbac_rule_element **users);
+                        struct hbac_rule_element **users,
+                        bool *_unresolved);
 
 errno_t
 get_ipa_groupname(TALLOC_CTX *mem_ctx,
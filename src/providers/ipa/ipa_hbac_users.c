@@ -163,7 +163,8 @@ hbac_user_attrs_to_rule(TALLOC_CTX *mem_ctx,
                         struct sss_domain_info *domain,
                         const char *rule_name,
                         struct sysdb_attrs *rule_attrs,
-                        struct hbac_rule_element **users)
+                        struct hbac_rule_element **users,
+                        bool *_unresolved)
 {
     errno_t ret;
     TALLOC_CTX *tmp_ctx = NULL;
@@ -343,10 +344,14 @@ hbac_user_attrs_to_rule(TALLOC_CTX *mem_ctx,
                               new_users->groups[num_groups], rule_name);
                     num_groups++;
                 } else {
-                    /* Not a group, so we don't care about it */
+                    /* Not a group, so we don't care about it. It might
+                     * be a user that is not cached yet, though. */
                     DEBUG(SSSDBG_CRIT_FAILURE,
                           "[%s] does not map to either a user or group. "
                               "Skipping\n", member_dn);
+                    if (_unresolved != NULL) {
+                        *_unresolved = true;
+                    }
                 }
             }
         }
@@ -807,6 +807,15 @@ errno_t sssm_ipa_access_init(TALLOC_CTX *mem_ctx,
     access_ctx->sdap_access_ctx->access_rule[0] = LDAP_ACCESS_EXPIRE;
     access_ctx->sdap_access_ctx->access_rule[1] = LDAP_ACCESS_EMPTY;
 
+    ret = be_access_cache_init(access_ctx,
+                               dp_opt_get_int(access_ctx->ipa_options,
+                                              IPA_HBAC_DECISION_CACHE_TIMEOUT),
+                               &access_ctx->decision_cache);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "be_access_cache_init() failed.\n");
+        goto done;
+    }
+
     dp_set_method(dp_methods, DPM_ACCESS_HANDLER,
                   ipa_pam_access_handler_send, ipa_pam_access_handler_recv, access_ctx,
                   struct ipa_access_ctx, struct pam_data, struct pam_data *);
@@ -979,26 +979,40 @@ done:
     return ret;
 }
 
+/* Number of extended operations one list request keeps outstanding */
+#define IPA_S2N_LIST_MAX_PENDING 10
+
 struct ipa_s2n_get_list_state {
     struct tevent_context *ev;
     struct ipa_id_ctx *ipa_ctx;
     struct sss_domain_info *dom;
     struct sdap_handle *sh;
-    struct req_input req_input;
+    enum req_input_type list_type;
     char **list;
     size_t list_idx;
+    size_t num_pending;
     int exop_timeout;
     int entry_type;
     enum request_types request_type;
+    /* names and SIDs this request already looked up */
+    hash_table_t *resolved;
+};
+
+/* A single object of the list that is being looked up */
+struct ipa_s2n_get_list_item {
+    struct tevent_req *req;
+    struct req_input req_input;
     struct resp_attrs *attrs;
     struct sss_domain_info *obj_domain;
     struct sysdb_attrs *override_attrs;
 };
 
 static errno_t ipa_s2n_get_list_step(struct tevent_req *req);
+static errno_t ipa_s2n_get_list_item_send(struct tevent_req *req,
+                                          const char *value);
 static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq);
 static void ipa_s2n_get_list_next(struct tevent_req *subreq);
-static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req);
+static errno_t ipa_s2n_get_list_save_step(struct ipa_s2n_get_list_item *item);
 
 static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
                                                 struct tevent_context *ev,
@@ -1034,22 +1048,29 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
     state->sh = sh;
     state->list = list;
     state->list_idx = 0;
-    state->req_input.type = list_type;
-    state->req_input.inp.name = NULL;
+    state->num_pending = 0;
+    state->list_type = list_type;
     state->exop_timeout = exop_timeout;
     state->entry_type = entry_type;
     state->request_type = request_type;
-    state->attrs = NULL;
-    state->override_attrs = NULL;
 
-    ret = ipa_s2n_get_list_step(req);
+    ret = sss_hash_create(state, 0, &state->resolved);
     if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "sss_hash_create failed.\n");
+        goto done;
+    }
+
+    ret = ipa_s2n_get_list_step(req);
+    if (ret != EOK && ret != EAGAIN) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
         goto done;
     }
 
 done:
-    if (ret != EOK) {
+    if (ret == EOK) {
+        tevent_req_done(req);
+        tevent_req_post(req, ev);
+    } else if (ret != EAGAIN) {
         tevent_req_error(req, ret);
         tevent_req_post(req, ev);
     }
@@ -1057,11 +1078,74 @@ done:
     return req;
 }
 
+static bool ipa_s2n_get_list_is_resolved(struct ipa_s2n_get_list_state *state,
+                                         const char *value)
+{
+    hash_key_t key;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(value);
+
+    return hash_has_key(state->resolved, &key);
+}
+
+static void ipa_s2n_get_list_set_resolved(struct ipa_s2n_get_list_state *state,
+                                          const char *value)
+{
+    hash_key_t key;
+    hash_value_t val;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(value);
+    val.type = HASH_VALUE_UNDEF;
+
+    hret = hash_enter(state->resolved, &key, &val);
+    if (hret != HASH_SUCCESS) {
+        /* only a duplicate lookup may happen */
+        DEBUG(SSSDBG_MINOR_FAILURE, "hash_enter failed [%s].\n",
+                                    hash_error_string(hret));
+    }
+}
+
+/* Sends lookups for the next objects of the list until
+ * IPA_S2N_LIST_MAX_PENDING of them are outstanding. Returns EOK when
+ * the whole list was processed and EAGAIN if replies are pending. */
 static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
 {
     int ret;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
+    const char *value;
+
+    while (state->num_pending < IPA_S2N_LIST_MAX_PENDING
+                && state->list[state->list_idx] != NULL) {
+        value = state->list[state->list_idx];
+        state->list_idx++;
+
+        if (ipa_s2n_get_list_is_resolved(state, value)) {
+            DEBUG(SSSDBG_TRACE_ALL, "[%s] was already looked up.\n", value);
+            continue;
+        }
+        ipa_s2n_get_list_set_resolved(state, value);
+
+        ret = ipa_s2n_get_list_item_send(req, value);
+        if (ret != EOK) {
+            return ret;
+        }
+        state->num_pending++;
+    }
+
+    return state->num_pending == 0 ? EOK : EAGAIN;
+}
+
+static errno_t ipa_s2n_get_list_item_send(struct tevent_req *req,
+                                          const char *value)
+{
+    int ret;
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_item *item;
     struct berval *bv_req;
     struct tevent_req *subreq;
     struct sss_domain_info *parent_domain;
@@ -1071,91 +1155,135 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
     char *endptr;
     bool need_v1 = false;
 
+    item = talloc_zero(state, struct ipa_s2n_get_list_item);
+    if (item == NULL) {
+        return ENOMEM;
+    }
+    item->req = req;
+    item->req_input.type = state->list_type;
+
     parent_domain = get_domains_head(state->dom);
-    switch (state->req_input.type) {
+    switch (item->req_input.type) {
     case REQ_INP_NAME:
 
-        ret = sss_parse_name(state, state->dom->names, state->list[state->list_idx],
+        ret = sss_parse_name(item, state->dom->names, value,
                              &domain_name, &short_name);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse name '%s' [%d]: %s\n",
-                                        state->list[state->list_idx],
-                                        ret, sss_strerror(ret));
-            return ret;
+                                        value, ret, sss_strerror(ret));
+            goto done;
         }
 
         if (domain_name) {
-            state->obj_domain = find_domain_by_name(parent_domain,
-                                                    domain_name, true);
-            if (state->obj_domain == NULL) {
+            item->obj_domain = find_domain_by_name(parent_domain,
+                                                   domain_name, true);
+            if (item->obj_domain == NULL) {
                 DEBUG(SSSDBG_OP_FAILURE, "find_domain_by_name failed.\n");
-                return ENOMEM;
+                ret = ENOMEM;
+                goto done;
             }
         } else {
-            state->obj_domain = parent_domain;
+            item->obj_domain = parent_domain;
         }
 
-        state->req_input.inp.name = short_name;
+        item->req_input.inp.name = short_name;
 
         break;
     case REQ_INP_ID:
         errno = 0;
-        id = strtouint32(state->list[state->list_idx], &endptr, 10);
-        if (errno != 0 || *endptr != '\0'
-                || (state->list[state->list_idx] == endptr)) {
+        id = strtouint32(value, &endptr, 10);
+        if (errno != 0 || *endptr != '\0' || (value == endptr)) {
             DEBUG(SSSDBG_OP_FAILURE, "strtouint32 failed.\n");
-            return EINVAL;
+            ret = EINVAL;
+            goto done;
         }
-        state->req_input.inp.id = id;
-        state->obj_domain = state->dom;
+        item->req_input.inp.id = id;
+        item->obj_domain = state->dom;
 
         break;
     case REQ_INP_SECID:
-        state->req_input.inp.secid = state->list[state->list_idx];
-        state->obj_domain = find_domain_by_sid(parent_domain,
-                                               state->req_input.inp.secid);
-        if (state->obj_domain == NULL) {
+        item->req_input.inp.secid = value;
+        item->obj_domain = find_domain_by_sid(parent_domain,
+                                              item->req_input.inp.secid);
+        if (item->obj_domain == NULL) {
             DEBUG(SSSDBG_OP_FAILURE,
                   "find_domain_by_sid failed for SID [%s].\n",
-                  state->req_input.inp.secid);
-            return EINVAL;
+                  item->req_input.inp.secid);
+            ret = EINVAL;
+            goto done;
         }
 
         break;
     default:
         DEBUG(SSSDBG_OP_FAILURE, "Unexpected inoput type [%d].\n",
-                                 state->req_input.type);
-        return EINVAL;
+                                 item->req_input.type);
+        ret = EINVAL;
+        goto done;
     }
 
-    ret = s2n_encode_request(state, state->obj_domain->name, state->entry_type,
+    ret = s2n_encode_request(item, item->obj_domain->name, state->entry_type,
                              state->request_type,
-                             &state->req_input, &bv_req);
+                             &item->req_input, &bv_req);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_encode_request failed.\n");
-        return ret;
+        goto done;
     }
 
     if (state->request_type == REQ_FULL_WITH_MEMBERS) {
         need_v1 = true;
     }
 
-    subreq = ipa_s2n_exop_send(state, state->ev, state->sh, need_v1,
+    subreq = ipa_s2n_exop_send(item, state->ev, state->sh, need_v1,
                                state->exop_timeout, bv_req);
     if (subreq == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_exop_send failed.\n");
-        return ENOMEM;
+        ret = ENOMEM;
+        goto done;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_next, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_next, item);
 
-    return EOK;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(item);
+    }
+
+    return ret;
+}
+
+static void ipa_s2n_get_list_item_done(struct ipa_s2n_get_list_item *item)
+{
+    int ret;
+    struct tevent_req *req = item->req;
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+
+    ret = ipa_s2n_get_list_save_step(item);
+    talloc_free(item);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    state->num_pending--;
+
+    ret = ipa_s2n_get_list_step(req);
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else if (ret != EAGAIN) {
+        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
+        tevent_req_error(req, ret);
+    }
 }
 
 static void ipa_s2n_get_list_next(struct tevent_req *subreq)
 {
     int ret;
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
+    struct ipa_s2n_get_list_item *item = tevent_req_callback_data(subreq,
+                                               struct ipa_s2n_get_list_item);
+    struct tevent_req *req = item->req;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
     char *retoid = NULL;
@@ -1163,47 +1291,39 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
     const char *sid_str;
     struct dp_id_data *ar;
 
-    ret = ipa_s2n_exop_recv(subreq, state, &retoid, &retdata);
+    ret = ipa_s2n_exop_recv(subreq, item, &retoid, &retdata);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n exop request failed.\n");
         goto fail;
     }
 
-    talloc_zfree(state->attrs);
-    ret = s2n_response_to_attrs(state, state->dom, retoid, retdata,
-                                &state->attrs);
+    ret = s2n_response_to_attrs(item, state->dom, retoid, retdata,
+                                &item->attrs);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_response_to_attrs failed.\n");
         goto fail;
     }
 
     if (is_default_view(state->ipa_ctx->view_name)) {
-        ret = ipa_s2n_get_list_save_step(req);
-        if (ret == EOK) {
-            tevent_req_done(req);
-        } else if (ret != EAGAIN) {
-            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
-            goto fail;
-        }
-
+        ipa_s2n_get_list_item_done(item);
         return;
     }
 
-    ret = sysdb_attrs_get_string(state->attrs->sysdb_attrs, SYSDB_SID_STR,
+    ret = sysdb_attrs_get_string(item->attrs->sysdb_attrs, SYSDB_SID_STR,
                                  &sid_str);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "sysdb_attrs_get_string failed.\n");
         goto fail;
     }
 
-    ret = get_dp_id_data_for_sid(state, sid_str, state->obj_domain->name, &ar);
+    ret = get_dp_id_data_for_sid(item, sid_str, item->obj_domain->name, &ar);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "get_dp_id_data_for_sid failed.\n");
         goto fail;
     }
 
-    subreq = ipa_get_ad_override_send(state, state->ev,
+    subreq = ipa_get_ad_override_send(item, state->ev,
                            state->ipa_ctx->sdap_id_ctx,
                            state->ipa_ctx->ipa_options,
                            dp_opt_get_string(state->ipa_ctx->ipa_options->basic,
@@ -1215,7 +1335,7 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
         ret = ENOMEM;
         goto fail;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_get_override_done, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_get_override_done, item);
 
     return;
 
@@ -1227,59 +1347,43 @@ fail:
 static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq)
 {
     int ret;
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
-    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
-                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_item *item = tevent_req_callback_data(subreq,
+                                               struct ipa_s2n_get_list_item);
 
-    ret = ipa_get_ad_override_recv(subreq, NULL, state, &state->override_attrs);
+    ret = ipa_get_ad_override_recv(subreq, NULL, item, &item->override_attrs);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "IPA override lookup failed: %d\n", ret);
-        goto fail;
-    }
-
-    ret = ipa_s2n_get_list_save_step(req);
-    if (ret == EOK) {
-        tevent_req_done(req);
-    } else if (ret != EAGAIN) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
-        goto fail;
+        tevent_req_error(item->req, ret);
+        return;
     }
 
-    return;
-
-fail:
-    tevent_req_error(req,ret);
-    return;
+    ipa_s2n_get_list_item_done(item);
 }
 
-static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req)
+/* The object is saved as soon as its reply arrives */
+static errno_t ipa_s2n_get_list_save_step(struct ipa_s2n_get_list_item *item)
 {
     int ret;
-    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+    struct ipa_s2n_get_list_state *state = tevent_req_data(item->req,
                                                struct ipa_s2n_get_list_state);
+    const char *sid_str;
 
-    ret = ipa_s2n_save_objects(state->dom, &state->req_input, state->attrs,
+    ret = ipa_s2n_save_objects(state->dom, &item->req_input, item->attrs,
                                NULL, state->ipa_ctx->view_name,
-                               state->override_attrs, false);
+                               item->override_attrs, false);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_save_objects failed.\n");
         return ret;
     }
 
-    state->list_idx++;
-    if (state->list[state->list_idx] == NULL) {
-        return EOK;
-    }
-
-    ret = ipa_s2n_get_list_step(req);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
-        return ret;
+    ret = sysdb_attrs_get_string(item->attrs->sysdb_attrs, SYSDB_SID_STR,
+                                 &sid_str);
+    if (ret == EOK) {
+        ipa_s2n_get_list_set_resolved(state, sid_str);
     }
 
-    return EAGAIN;
+    return EOK;
 }
 
 static int ipa_s2n_get_list_recv(struct tevent_req *req)
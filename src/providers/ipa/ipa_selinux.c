@@ -707,6 +707,7 @@ static errno_t selinux_fork_child(struct selinux_child_state *state)
         return ret;
     }
 
+    sss_debug_prepare_fork();
     pid = fork();
 
     if (pid == 0) { /* child */
@@ -385,6 +385,7 @@ static struct tevent_req *ipa_getkeytab_send(TALLOC_CTX *mem_ctx,
           "Retrieving keytab for %s from %s into %s using ccache %s\n",
           principal, server, keytab, ccache);
 
+    sss_debug_prepare_fork();
     child_pid = fork();
     if (child_pid == 0) { /* child */
         ipa_getkeytab_exec(ccache, server, principal, keytab);
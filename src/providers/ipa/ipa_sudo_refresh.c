@@ -111,6 +111,12 @@ ipa_sudo_full_refresh_done(struct tevent_req *subreq)
                                     "a successful full refresh\n");
     }
 
+    ret = sysdb_sudo_bump_rules_generation(state->domain);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to update sudo rules "
+                                    "generation\n");
+    }
+
     DEBUG(SSSDBG_TRACE_FUNC, "Successful full refresh of sudo rules\n");
 
 done:
@@ -137,6 +143,7 @@ ipa_sudo_full_refresh_recv(struct tevent_req *req,
 }
 
 struct ipa_sudo_smart_refresh_state {
+    struct sss_domain_info *domain;
     int dp_error;
 };
 
@@ -163,6 +170,8 @@ ipa_sudo_smart_refresh_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
+    state->domain = sudo_ctx->id_ctx->be->domain;
+
     /* Download all rules from LDAP that are newer than usn */
     if (srv_opts == NULL || srv_opts->max_sudo_value == 0) {
         DEBUG(SSSDBG_TRACE_FUNC, "USN value is unknown, assuming zero.\n");
@@ -216,17 +225,26 @@ static void ipa_sudo_smart_refresh_done(struct tevent_req *subreq)
 {
     struct tevent_req *req = NULL;
     struct ipa_sudo_smart_refresh_state *state = NULL;
+    size_t num_rules;
     int ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ipa_sudo_smart_refresh_state);
 
-    ret = ipa_sudo_refresh_recv(subreq, &state->dp_error, NULL);
+    ret = ipa_sudo_refresh_recv(subreq, &state->dp_error, &num_rules);
     talloc_zfree(subreq);
     if (ret != EOK || state->dp_error != DP_ERR_OK) {
         goto done;
     }
 
+    if (num_rules > 0) {
+        ret = sysdb_sudo_bump_rules_generation(state->domain);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to update sudo rules "
+                                        "generation\n");
+        }
+    }
+
     DEBUG(SSSDBG_TRACE_FUNC, "Successful smart refresh of sudo rules\n");
 
 done:
@@ -2124,6 +2124,7 @@ static krb5_error_code check_fast_ccache(TALLOC_CTX *mem_ctx,
     }
 
     /* Need to recreate the FAST ccache */
+    sss_debug_prepare_fork();
     fchild_pid = fork();
     switch (fchild_pid) {
         case -1:
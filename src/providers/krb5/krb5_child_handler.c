@@ -24,6 +24,7 @@
 
 #include "util/util.h"
 #include "util/child_common.h"
+#include "util/probes.h"
 #include "providers/krb5/krb5_common.h"
 #include "providers/krb5/krb5_auth.h"
 #include "src/providers/krb5/krb5_utils.h"
@@ -51,6 +52,8 @@ struct handle_child_state {
     pid_t child_pid;
 
     struct child_io_fds *io;
+
+    uint64_t trace_id;
 };
 
 static errno_t pack_authtok(struct io_buffer *buf, size_t *rp,
@@ -305,6 +308,7 @@ static errno_t fork_child(struct tevent_req *req)
         goto fail;
     }
 
+    sss_debug_prepare_fork();
     pid = fork();
 
     if (pid == 0) { /* child */
@@ -376,6 +380,7 @@ struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
     state->len = 0;
     state->child_pid = -1;
     state->timeout_handler = NULL;
+    state->trace_id = sss_trace_id;
 
     state->io = talloc(state, struct child_io_fds);
     if (state->io == NULL) {
@@ -399,6 +404,9 @@ struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    PROBE(KRB5_CHILD_SEND, kr->pd->cmd, PROBE_SAFE_STR(kr->upn),
+          state->child_pid, state->trace_id);
+
     subreq = write_pipe_send(state, ev, buf->data, buf->size,
                              state->io->write_to_child_fd);
     if (!subreq) {
@@ -469,6 +477,9 @@ int handle_child_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
     struct handle_child_state *state = tevent_req_data(req,
                                                     struct handle_child_state);
 
+    PROBE(KRB5_CHILD_RECV, state->kr->pd->cmd, PROBE_SAFE_STR(state->kr->upn),
+          state->child_pid, state->trace_id);
+
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
     *buf = talloc_move(mem_ctx, &state->buf);
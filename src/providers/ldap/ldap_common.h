@@ -105,6 +105,16 @@ errno_t sdap_account_info_handler_recv(TALLOC_CTX *mem_ctx,
                                        struct tevent_req *req,
                                        struct dp_reply_std *data);
 
+struct tevent_req *
+sdap_account_batch_handler_send(TALLOC_CTX *mem_ctx,
+                                struct sdap_id_ctx *id_ctx,
+                                struct dp_id_batch_data *data,
+                                struct dp_req_params *params);
+
+errno_t sdap_account_batch_handler_recv(TALLOC_CTX *mem_ctx,
+                                        struct tevent_req *req,
+                                        struct dp_id_batch_reply *data);
+
 /* Set up enumeration and/or cleanup */
 int ldap_id_setup_tasks(struct sdap_id_ctx *ctx);
 int sdap_id_setup_tasks(struct be_ctx *be_ctx,
@@ -249,6 +259,23 @@ struct tevent_req *groups_get_send(TALLOC_CTX *memctx,
                                    bool no_members);
 int groups_get_recv(struct tevent_req *req, int *dp_error_out, int *sdap_ret);
 
+/* The request is finished with groups_get_recv() */
+struct tevent_req *groups_get_by_sids_send(TALLOC_CTX *memctx,
+                                           struct tevent_context *ev,
+                                           struct sdap_id_ctx *ctx,
+                                           struct sdap_domain *sdom,
+                                           struct sdap_id_conn_ctx *conn,
+                                           const char **sids,
+                                           size_t num_sids,
+                                           bool no_members);
+
+/* Builds the filter used by groups_get_by_sids_send() */
+errno_t groups_get_by_sids_filter(TALLOC_CTX *mem_ctx,
+                                  struct sdap_options *opts,
+                                  const char **sids,
+                                  size_t num_sids,
+                                  char **_filter);
+
 struct tevent_req *ldap_netgroup_get_send(TALLOC_CTX *memctx,
                                           struct tevent_context *ev,
                                           struct sdap_id_ctx *ctx,
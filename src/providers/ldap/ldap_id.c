@@ -629,6 +629,7 @@ struct groups_get_state {
 
     const char *filter_value;
     int filter_type;
+    enum sdap_entry_lookup_type lookup_type;
 
     char *filter;
     const char **attrs;
@@ -646,6 +647,55 @@ static void groups_get_posix_check_done(struct tevent_req *subreq);
 static void groups_get_search(struct tevent_req *req);
 static void groups_get_done(struct tevent_req *subreq);
 
+/* Setup shared by all requests that are finished with groups_get_recv() */
+static errno_t groups_get_state_init(struct groups_get_state *state,
+                                     struct tevent_context *ev,
+                                     struct sdap_id_ctx *ctx,
+                                     struct sdap_domain *sdom,
+                                     struct sdap_id_conn_ctx *conn,
+                                     bool noexist_delete,
+                                     bool no_members)
+{
+    state->ev = ev;
+    state->ctx = ctx;
+    state->sdom = sdom;
+    state->conn = conn;
+    state->dp_error = DP_ERR_FATAL;
+    state->noexist_delete = noexist_delete;
+    state->no_members = no_members;
+    state->domain = sdom->dom;
+    state->sysdb = sdom->dom->sysdb;
+
+    state->use_id_mapping = sdap_idmap_domain_has_algorithmic_mapping(
+                                                          ctx->opts->idmap_ctx,
+                                                          sdom->dom->name,
+                                                          sdom->dom->domain_id);
+
+    state->op = sdap_id_op_create(state, state->conn->conn_cache);
+    if (!state->op) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed\n");
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static errno_t groups_get_build_attrs(struct groups_get_state *state)
+{
+    const char *member_filter[2];
+
+    member_filter[0] = (const char *)state->ctx->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+    member_filter[1] = NULL;
+
+    /* TODO: handle attrs_type */
+    return build_attrs_from_map(state, state->ctx->opts->group_map,
+                                SDAP_OPTS_GROUP,
+                                (state->domain->ignore_group_members
+                                    || state->no_members) ?
+                                    (const char **)member_filter : NULL,
+                                &state->attrs, NULL);
+}
+
 struct tevent_req *groups_get_send(TALLOC_CTX *memctx,
                                    struct tevent_context *ev,
                                    struct sdap_id_ctx *ctx,
@@ -667,36 +717,21 @@ struct tevent_req *groups_get_send(TALLOC_CTX *memctx,
     gid_t gid;
     enum idmap_error_code err;
     char *sid;
-    const char *member_filter[2];
     char *oc_list;
 
     req = tevent_req_create(memctx, &state, struct groups_get_state);
     if (!req) return NULL;
 
-    state->ev = ev;
-    state->ctx = ctx;
-    state->sdom = sdom;
-    state->conn = conn;
-    state->dp_error = DP_ERR_FATAL;
-    state->noexist_delete = noexist_delete;
-    state->no_members = no_members;
-
-    state->op = sdap_id_op_create(state, state->conn->conn_cache);
-    if (!state->op) {
-        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed\n");
-        ret = ENOMEM;
+    ret = groups_get_state_init(state, ev, ctx, sdom, conn,
+                                noexist_delete, no_members);
+    if (ret != EOK) {
         goto done;
     }
 
-    state->domain = sdom->dom;
-    state->sysdb = sdom->dom->sysdb;
     state->filter_value = filter_value;
     state->filter_type = filter_type;
-
-    state->use_id_mapping = sdap_idmap_domain_has_algorithmic_mapping(
-                                                          ctx->opts->idmap_ctx,
-                                                          sdom->dom->name,
-                                                          sdom->dom->domain_id);
+    state->lookup_type = filter_type == BE_FILTER_WILDCARD ?
+                                SDAP_LOOKUP_WILDCARD : SDAP_LOOKUP_SINGLE;
 
     switch(filter_type) {
     case BE_FILTER_WILDCARD:
@@ -836,16 +871,137 @@ struct tevent_req *groups_get_send(TALLOC_CTX *memctx,
         goto done;
     }
 
-    member_filter[0] = (const char *)ctx->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
-    member_filter[1] = NULL;
+    ret = groups_get_build_attrs(state);
+    if (ret != EOK) goto done;
 
-    /* TODO: handle attrs_type */
-    ret = build_attrs_from_map(state, ctx->opts->group_map, SDAP_OPTS_GROUP,
-                               (state->domain->ignore_group_members
-                                    || state->no_members) ?
-                                   (const char **)member_filter : NULL,
-                               &state->attrs, NULL);
+    ret = groups_get_retry(req);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    return req;
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+    } else {
+        tevent_req_done(req);
+    }
+    return tevent_req_post(req, ev);
+}
+
+errno_t groups_get_by_sids_filter(TALLOC_CTX *mem_ctx,
+                                  struct sdap_options *opts,
+                                  const char **sids,
+                                  size_t num_sids,
+                                  char **_filter)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *attr_name;
+    char *sid_filter;
+    char *clean_value;
+    char *oc_list;
+    char *filter;
+    size_t i;
+    errno_t ret;
+
+    if (num_sids == 0) {
+        return EINVAL;
+    }
+
+    attr_name = opts->group_map[SDAP_AT_GROUP_OBJECTSID].name;
+    if (attr_name == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "Missing search attribute name.\n");
+        return EINVAL;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    sid_filter = talloc_strdup(tmp_ctx, "");
+    if (sid_filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_sids; i++) {
+        ret = sss_filter_sanitize(tmp_ctx, sids[i], &clean_value);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        sid_filter = talloc_asprintf_append_buffer(sid_filter, "(%s=%s)",
+                                                   attr_name, clean_value);
+        talloc_zfree(clean_value);
+        if (sid_filter == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    oc_list = sdap_make_oc_list(tmp_ctx, opts->group_map);
+    if (oc_list == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to create objectClass list.\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Groups without a GID are wanted, as with a single SID lookup */
+    filter = talloc_asprintf(tmp_ctx, "(&(|%s)(%s)(%s=*))",
+                             sid_filter, oc_list,
+                             opts->group_map[SDAP_AT_GROUP_NAME].name);
+    if (filter == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to build filter\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    *_filter = talloc_steal(mem_ctx, filter);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* Looks up several groups by their SIDs with a single search. All SIDs
+ * must belong to the domain of sdom. Groups that are not found are not
+ * removed from the cache. */
+struct tevent_req *groups_get_by_sids_send(TALLOC_CTX *memctx,
+                                           struct tevent_context *ev,
+                                           struct sdap_id_ctx *ctx,
+                                           struct sdap_domain *sdom,
+                                           struct sdap_id_conn_ctx *conn,
+                                           const char **sids,
+                                           size_t num_sids,
+                                           bool no_members)
+{
+    struct tevent_req *req;
+    struct groups_get_state *state;
+    int ret;
+
+    req = tevent_req_create(memctx, &state, struct groups_get_state);
+    if (!req) return NULL;
+
+    ret = groups_get_state_init(state, ev, ctx, sdom, conn,
+                                false, no_members);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    state->filter_type = BE_FILTER_SECID;
+    /* more than one entry is expected */
+    state->lookup_type = SDAP_LOOKUP_WILDCARD;
+
+    ret = groups_get_by_sids_filter(state, ctx->opts, sids, num_sids,
+                                    &state->filter);
+    if (ret != EOK) {
+        goto done;
+    }
 
+    ret = groups_get_build_attrs(state);
     if (ret != EOK) goto done;
 
     ret = groups_get_retry(req);
@@ -966,13 +1122,6 @@ static void groups_get_search(struct tevent_req *req)
     struct groups_get_state *state = tevent_req_data(req,
                                                      struct groups_get_state);
     struct tevent_req *subreq;
-    enum sdap_entry_lookup_type lookup_type;
-
-    if (state->filter_type == BE_FILTER_WILDCARD) {
-        lookup_type = SDAP_LOOKUP_WILDCARD;
-    } else {
-        lookup_type = SDAP_LOOKUP_SINGLE;
-    }
 
     subreq = sdap_get_groups_send(state, state->ev,
                                   state->sdom,
@@ -981,7 +1130,7 @@ static void groups_get_search(struct tevent_req *req)
                                   state->attrs, state->filter,
                                   dp_opt_get_int(state->ctx->opts->basic,
                                                  SDAP_SEARCH_TIMEOUT),
-                                  lookup_type,
+                                  state->lookup_type,
                                   state->no_members);
     if (!subreq) {
         tevent_req_error(req, ENOMEM);
@@ -1382,6 +1531,7 @@ struct sdap_handle_acct_req_state {
     const char *err;
     int dp_error;
     int sdap_ret;
+    uint64_t trace_id;
 };
 
 static void sdap_handle_acct_req_done(struct tevent_req *subreq);
@@ -1413,10 +1563,11 @@ sdap_handle_acct_req_send(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    state->trace_id = sss_trace_id;
     PROBE(SDAP_ACCT_REQ_SEND,
           state->ar->entry_type & BE_REQ_TYPE_MASK,
           state->ar->filter_type, state->ar->filter_value,
-          PROBE_SAFE_STR(state->ar->extra_value));
+          PROBE_SAFE_STR(state->ar->extra_value), state->trace_id);
 
     switch (ar->entry_type & BE_REQ_TYPE_MASK) {
     case BE_REQ_USER: /* user */
@@ -1642,7 +1793,7 @@ sdap_handle_acct_req_recv(struct tevent_req *req,
     PROBE(SDAP_ACCT_REQ_RECV,
           state->ar->entry_type & BE_REQ_TYPE_MASK,
           state->ar->filter_type, state->ar->filter_value,
-          PROBE_SAFE_STR(state->ar->extra_value));
+          PROBE_SAFE_STR(state->ar->extra_value), state->trace_id);
 
     if (_dp_error) {
         *_dp_error = state->dp_error;
@@ -0,0 +1,449 @@
+/*
+    SSSD
+
+    LDAP Identity Backend Module - batched lookups
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <time.h>
+
+#include "util/util.h"
+#include "util/strtonum.h"
+#include "db/sysdb.h"
+#include "providers/ldap/ldap_common.h"
+#include "providers/ldap/sdap_async.h"
+#include "providers/ldap/sdap_idmap.h"
+
+/* Batched lookups only look up and store the entries that exist. The data
+ * provider falls back to the account handler for every value that was not
+ * found, so deleting missing entries from the cache and all the special
+ * cases (UPN lookups, local user fallback, nested groups, ...) remain in
+ * users_get_send() and groups_get_send(). */
+
+static bool sdap_batch_supported(struct sdap_id_ctx *id_ctx,
+                                 struct sss_domain_info *domain,
+                                 struct dp_id_batch_data *data)
+{
+    struct sdap_options *opts = id_ctx->opts;
+
+    if (opts->schema_type == SDAP_SCHEMA_AD) {
+        /* may require a POSIX attributes check first */
+        return false;
+    }
+
+    if (sdap_idmap_domain_has_algorithmic_mapping(opts->idmap_ctx,
+                                                  domain->name,
+                                                  domain->domain_id)) {
+        return false;
+    }
+
+    switch (data->entry_type & BE_REQ_TYPE_MASK) {
+    case BE_REQ_USER:
+        break;
+    case BE_REQ_GROUP:
+        /* Other schemas need to resolve nested group membership of each
+         * group separately. */
+        if (opts->schema_type != SDAP_SCHEMA_RFC2307) {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    return data->filter_type == BE_FILTER_NAME
+            || data->filter_type == BE_FILTER_IDNUM;
+}
+
+static errno_t sdap_batch_value_filter(TALLOC_CTX *mem_ctx,
+                                       const char *attr_name,
+                                       struct dp_id_batch_data *data,
+                                       char **_filter)
+{
+    TALLOC_CTX *tmp_ctx;
+    char *filter;
+    char *shortname;
+    char *clean_value;
+    const char *value;
+    char *endptr;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    filter = talloc_strdup(tmp_ctx, "(|");
+    if (filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < data->count; i++) {
+        if (data->filter_type == BE_FILTER_NAME) {
+            ret = sss_parse_internal_fqname(tmp_ctx, data->values[i],
+                                            &shortname, NULL);
+            if (ret != EOK) {
+                DEBUG(SSSDBG_OP_FAILURE, "Cannot parse %s\n",
+                      data->values[i]);
+                goto done;
+            }
+            value = shortname;
+        } else {
+            strtouint32(data->values[i], &endptr, 10);
+            if (errno != 0 || *endptr != '\0') {
+                ret = EINVAL;
+                goto done;
+            }
+            value = data->values[i];
+        }
+
+        ret = sss_filter_sanitize(tmp_ctx, value, &clean_value);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        filter = talloc_asprintf_append_buffer(filter, "(%s=%s)",
+                                               attr_name, clean_value);
+        if (filter == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    filter = talloc_asprintf_append_buffer(filter, ")");
+    if (filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    *_filter = talloc_steal(mem_ctx, filter);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+struct sdap_account_batch_handler_state {
+    struct tevent_context *ev;
+    struct sdap_id_ctx *id_ctx;
+    struct sdap_domain *sdom;
+    struct sdap_id_op *op;
+    struct dp_id_batch_data *data;
+    time_t start;
+
+    bool groups;
+    char *filter;
+    const char **attrs;
+
+    bool *found;
+    int dp_error;
+};
+
+static errno_t sdap_account_batch_handler_retry(struct tevent_req *req);
+static void sdap_account_batch_handler_connect_done(struct tevent_req *subreq);
+static void sdap_account_batch_handler_done(struct tevent_req *subreq);
+
+struct tevent_req *
+sdap_account_batch_handler_send(TALLOC_CTX *mem_ctx,
+                                struct sdap_id_ctx *id_ctx,
+                                struct dp_id_batch_data *data,
+                                struct dp_req_params *params)
+{
+    struct sdap_account_batch_handler_state *state;
+    struct sdap_options *opts = id_ctx->opts;
+    const char *member_filter[2];
+    const char *attr_name;
+    char *values;
+    char *oc_list;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct sdap_account_batch_handler_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->ev = params->ev;
+    state->id_ctx = id_ctx;
+    state->data = data;
+    state->start = time(NULL);
+    state->dp_error = DP_ERR_FATAL;
+    state->groups = (data->entry_type & BE_REQ_TYPE_MASK) == BE_REQ_GROUP;
+
+    state->found = talloc_zero_array(state, bool, data->count);
+    if (state->found == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    state->sdom = sdap_domain_get(opts, params->domain);
+    if (state->sdom == NULL
+            || !sdap_batch_supported(id_ctx, params->domain, data)) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Batch lookup is not supported here, "
+              "falling back to single lookups\n");
+        state->dp_error = DP_ERR_OK;
+        ret = EOK;
+        goto immediately;
+    }
+
+    if (state->groups) {
+        attr_name = data->filter_type == BE_FILTER_NAME
+                        ? opts->group_map[SDAP_AT_GROUP_NAME].name
+                        : opts->group_map[SDAP_AT_GROUP_GID].name;
+    } else {
+        attr_name = data->filter_type == BE_FILTER_NAME
+                        ? opts->user_map[SDAP_AT_USER_NAME].name
+                        : opts->user_map[SDAP_AT_USER_UID].name;
+    }
+
+    ret = sdap_batch_value_filter(state, attr_name, data, &values);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    /* Same restrictions as for single lookups without ID mapping. */
+    if (state->groups) {
+        oc_list = sdap_make_oc_list(state, opts->group_map);
+        if (oc_list == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Failed to create objectClass list.\n");
+            ret = ENOMEM;
+            goto immediately;
+        }
+
+        state->filter = talloc_asprintf(state,
+                                        "(&%s(%s)(%s=*)(&(%s=*)(!(%s=0))))",
+                                        values, oc_list,
+                                        opts->group_map[SDAP_AT_GROUP_NAME].name,
+                                        opts->group_map[SDAP_AT_GROUP_GID].name,
+                                        opts->group_map[SDAP_AT_GROUP_GID].name);
+    } else {
+        state->filter = talloc_asprintf(state,
+                                        "(&%s(objectclass=%s)(%s=*)(&(%s=*)(!(%s=0))))",
+                                        values,
+                                        opts->user_map[SDAP_OC_USER].name,
+                                        opts->user_map[SDAP_AT_USER_NAME].name,
+                                        opts->user_map[SDAP_AT_USER_UID].name,
+                                        opts->user_map[SDAP_AT_USER_UID].name);
+    }
+    talloc_free(values);
+    if (state->filter == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to build the base filter\n");
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    if (state->groups) {
+        member_filter[0] = opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+        member_filter[1] = NULL;
+
+        ret = build_attrs_from_map(state, opts->group_map, SDAP_OPTS_GROUP,
+                                   params->domain->ignore_group_members ?
+                                       member_filter : NULL,
+                                   &state->attrs, NULL);
+    } else {
+        ret = build_attrs_from_map(state, opts->user_map, opts->user_map_cnt,
+                                   NULL, &state->attrs, NULL);
+    }
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    state->op = sdap_id_op_create(state, id_ctx->conn->conn_cache);
+    if (state->op == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed\n");
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Looking up %zu %s in one search\n",
+          data->count, state->groups ? "groups" : "users");
+
+    ret = sdap_account_batch_handler_retry(req);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    return req;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, params->ev);
+
+    return req;
+}
+
+static errno_t sdap_account_batch_handler_retry(struct tevent_req *req)
+{
+    struct sdap_account_batch_handler_state *state;
+    struct tevent_req *subreq;
+    errno_t ret = EOK;
+
+    state = tevent_req_data(req, struct sdap_account_batch_handler_state);
+
+    subreq = sdap_id_op_connect_send(state->op, state, &ret);
+    if (subreq == NULL) {
+        return ret;
+    }
+
+    tevent_req_set_callback(subreq, sdap_account_batch_handler_connect_done,
+                            req);
+    return EOK;
+}
+
+static void sdap_account_batch_handler_connect_done(struct tevent_req *subreq)
+{
+    struct sdap_account_batch_handler_state *state;
+    struct sdap_options *opts;
+    struct tevent_req *req;
+    int timeout;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sdap_account_batch_handler_state);
+    opts = state->id_ctx->opts;
+
+    ret = sdap_id_op_connect_recv(subreq, &state->dp_error);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    timeout = dp_opt_get_int(opts->basic, SDAP_SEARCH_TIMEOUT);
+
+    /* A wildcard lookup stores every returned entry and allows paging. */
+    if (state->groups) {
+        subreq = sdap_get_groups_send(state, state->ev, state->sdom, opts,
+                                      sdap_id_op_handle(state->op),
+                                      state->attrs, state->filter, timeout,
+                                      SDAP_LOOKUP_WILDCARD, false);
+    } else {
+        subreq = sdap_get_users_send(state, state->ev, state->sdom->dom,
+                                     state->sdom->dom->sysdb, opts,
+                                     state->sdom->user_search_bases,
+                                     sdap_id_op_handle(state->op),
+                                     state->attrs, state->filter, timeout,
+                                     SDAP_LOOKUP_WILDCARD);
+    }
+    if (subreq == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+
+    tevent_req_set_callback(subreq, sdap_account_batch_handler_done, req);
+}
+
+static bool sdap_batch_stored(struct sdap_account_batch_handler_state *state,
+                              const char *value)
+{
+    const char *attrs[] = { SYSDB_LAST_UPDATE, NULL };
+    struct sss_domain_info *dom = state->sdom->dom;
+    struct ldb_message *msg = NULL;
+    uint32_t id;
+    bool stored = false;
+    errno_t ret;
+
+    if (state->data->filter_type == BE_FILTER_NAME) {
+        ret = state->groups
+                ? sysdb_search_group_by_name(state, dom, value, attrs, &msg)
+                : sysdb_search_user_by_name(state, dom, value, attrs, &msg);
+    } else {
+        id = strtouint32(value, NULL, 10);
+        ret = state->groups
+                ? sysdb_search_group_by_gid(state, dom, id, attrs, &msg)
+                : sysdb_search_user_by_uid(state, dom, id, attrs, &msg);
+    }
+
+    if (ret == EOK) {
+        stored = ldb_msg_find_attr_as_uint64(msg, SYSDB_LAST_UPDATE, 0)
+                    >= state->start;
+    }
+
+    talloc_free(msg);
+    return stored;
+}
+
+static void sdap_account_batch_handler_done(struct tevent_req *subreq)
+{
+    struct sdap_account_batch_handler_state *state;
+    struct tevent_req *req;
+    size_t i;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sdap_account_batch_handler_state);
+
+    if (state->groups) {
+        ret = sdap_get_groups_recv(subreq, NULL, NULL);
+    } else {
+        ret = sdap_get_users_recv(subreq, NULL, NULL);
+    }
+    talloc_zfree(subreq);
+
+    ret = sdap_id_op_done(state->op, ret, &state->dp_error);
+    if (state->dp_error == DP_ERR_OK && ret != EOK) {
+        /* retry */
+        ret = sdap_account_batch_handler_retry(req);
+        if (ret != EOK) {
+            tevent_req_error(req, ret);
+        }
+        return;
+    }
+
+    if (ret == ENOENT) {
+        /* nothing was found, all values fall back to single lookups */
+        tevent_req_done(req);
+        return;
+    } else if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    for (i = 0; i < state->data->count; i++) {
+        state->found[i] = sdap_batch_stored(state, state->data->values[i]);
+    }
+
+    tevent_req_done(req);
+}
+
+errno_t sdap_account_batch_handler_recv(TALLOC_CTX *mem_ctx,
+                                        struct tevent_req *req,
+                                        struct dp_id_batch_reply *data)
+{
+    struct sdap_account_batch_handler_state *state = NULL;
+
+    state = tevent_req_data(req, struct sdap_account_batch_handler_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    data->dp_error = state->dp_error;
+    data->error = EOK;
+    data->count = state->data->count;
+    data->found = talloc_steal(mem_ctx, state->found);
+
+    return EOK;
+}
@@ -45,6 +45,14 @@ struct sdap_op {
     int msgid;
     bool done;
 
+    /* when the request was sent */
+    struct timeval start;
+    /* the result was reported to the fail over statistics */
+    bool recorded;
+
+    /* client request this operation belongs to */
+    uint64_t trace_id;
+
     sdap_op_callback_t *callback;
     void *data;
 
@@ -88,6 +96,10 @@ struct sdap_handle {
 
     struct sdap_op *ops;
 
+    /* fail over server the handle is connected to, the response times
+     * of the operations are fed into its statistics */
+    struct fo_server *srv;
+
     /* during release we need to lock access to the handler
      * from the destructor to avoid recursion */
     bool destructor_lock;
@@ -24,6 +24,7 @@
 #include "util/util.h"
 #include "util/strtonum.h"
 #include "util/probes.h"
+#include "util/sss_metrics.h"
 #include "providers/ldap/sdap_async_private.h"
 
 #define REPLY_REALLOC_INCREMENT 10
@@ -252,6 +253,46 @@ static const char *sdap_ldap_result_str(int msgtype)
     return "Unknown result type!";
 }
 
+/* feed the error rate in the fail over statistics with the result of the
+ * operation, the server is compared by the connect time measured by fail
+ * over itself and not by how long the operations take */
+static void sdap_op_record_result(struct sdap_op *op, bool success)
+{
+    op->recorded = true;
+    fo_record_server_op(op->sh->srv, success);
+}
+
+/* Records the duration of the whole operation per server and result type. */
+static void sdap_op_record_metrics(struct sdap_op *op, int msgtype)
+{
+    const char *server = NULL;
+    char group[256];
+    struct timeval now;
+    struct timeval diff;
+    int ret;
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(&op->start, &now);
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "Operation %d [%s] finished in %ld.%06ld seconds\n",
+          op->msgid, sdap_ldap_result_str(msgtype),
+          (long)diff.tv_sec, (long)diff.tv_usec);
+
+    if (op->sh->srv != NULL) {
+        server = fo_get_server_name(op->sh->srv);
+    }
+
+    ret = snprintf(group, sizeof(group), "ldap.%s",
+                   server == NULL ? "unknown" : server);
+    if (ret < 0 || ret >= sizeof(group)) {
+        return;
+    }
+
+    sss_metrics_add_usec(group, sdap_ldap_result_str(msgtype),
+                         diff.tv_sec * 1000000ULL + diff.tv_usec);
+}
+
 /* process a messgae calling the right operation callback.
  * msg is completely taken care of (including freeeing it)
  * NOTE: this function may even end up freeing the sdap_handle
@@ -287,6 +328,8 @@ static void sdap_process_message(struct tevent_context *ev,
         return;
     }
 
+    sss_trace_id = op->trace_id;
+
     /* shouldn't happen */
     if (op->done) {
         DEBUG(SSSDBG_OP_FAILURE,
@@ -298,6 +341,10 @@ static void sdap_process_message(struct tevent_context *ev,
     DEBUG(SSSDBG_TRACE_ALL,
           "Message type: [%s]\n", sdap_ldap_result_str(msgtype));
 
+    if (!op->recorded) {
+        sdap_op_record_result(op, true);
+    }
+
     switch (msgtype) {
     case LDAP_RES_SEARCH_ENTRY:
     case LDAP_RES_SEARCH_REFERENCE:
@@ -315,6 +362,7 @@ static void sdap_process_message(struct tevent_context *ev,
     case LDAP_RES_INTERMEDIATE:
         /* no more results expected with this msgid */
         op->done = true;
+        sdap_op_record_metrics(op, msgtype);
         break;
 
     default:
@@ -394,6 +442,7 @@ static void sdap_process_next_reply(struct tevent_context *ev,
 {
     struct sdap_op *op = talloc_get_type(pvt, struct sdap_op);
 
+    sss_trace_id = op->trace_id;
     op->callback(op, op->list, EOK, op->data);
 }
 
@@ -424,12 +473,18 @@ static void sdap_op_timeout(struct tevent_req *req)
 {
     struct sdap_op *op = tevent_req_callback_data(req, struct sdap_op);
 
+    sss_trace_id = op->trace_id;
+
     /* should never happen, but just in case */
     if (op->done) {
         DEBUG(SSSDBG_OP_FAILURE, "Timeout happened after op was finished !?\n");
         return;
     }
 
+    if (!op->recorded) {
+        sdap_op_record_result(op, false);
+    }
+
     /* signal the caller that we have a timeout */
     DEBUG(SSSDBG_TRACE_LIBS, "Issuing timeout for %d\n", op->msgid);
     op->callback(op, NULL, ETIMEDOUT, op->data);
@@ -450,6 +505,8 @@ int sdap_op_add(TALLOC_CTX *memctx, struct tevent_context *ev,
     op->callback = callback;
     op->data = data;
     op->ev = ev;
+    op->start = tevent_timeval_current();
+    op->trace_id = sss_trace_id;
 
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "New operation %d timeout %d\n", op->msgid, timeout);
@@ -1177,6 +1234,7 @@ struct sdap_get_generic_ext_state {
     void *cb_data;
 
     unsigned int flags;
+    uint64_t trace_id;
 };
 
 static errno_t sdap_get_generic_ext_step(struct tevent_req *req);
@@ -1296,8 +1354,9 @@ sdap_get_generic_ext_send(TALLOC_CTX *memctx,
     }
     state->serverctrls[i] = NULL;
 
+    state->trace_id = sss_trace_id;
     PROBE(SDAP_GET_GENERIC_EXT_SEND, state->search_base,
-          state->scope, state->filter);
+          state->scope, state->filter, state->trace_id);
 
     ret = sdap_get_generic_ext_step(req);
     if (ret != EOK) {
@@ -1637,7 +1696,7 @@ sdap_get_generic_ext_recv(struct tevent_req *req,
             tevent_req_data(req, struct sdap_get_generic_ext_state);
 
     PROBE(SDAP_GET_GENERIC_EXT_RECV, state->search_base,
-          state->scope, state->filter);
+          state->scope, state->filter, state->trace_id);
 
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
@@ -2065,6 +2065,9 @@ int sdap_cli_connect_recv(struct tevent_req *req,
 
         be_fo_set_port_status(state->be, state->service->name,
                               state->srv, PORT_WORKING);
+
+        state->sh->srv = state->srv;
+        fo_ref_server(state->sh, state->srv);
     }
 
     if (gsh) {
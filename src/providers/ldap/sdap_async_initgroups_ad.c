@@ -20,6 +20,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <sys/param.h>
+
 #include "util/util.h"
 #include "providers/ldap/sdap_async.h"
 #include "providers/ldap/sdap_async_ad.h"
@@ -531,36 +533,41 @@ done:
     return ret;
 }
 
-struct sdap_ad_resolve_sids_state {
+/* Number of SIDs looked up with one search */
+#define SDAP_AD_RESOLVE_SIDS_BATCH 50
+
+/* Resolves SIDs that belong to one domain, SDAP_AD_RESOLVE_SIDS_BATCH of
+ * them at a time. */
+struct sdap_ad_resolve_dom_sids_state {
     struct tevent_context *ev;
     struct sdap_id_ctx *id_ctx;
     struct sdap_id_conn_ctx *conn;
-    struct sdap_options *opts;
-    struct sss_domain_info *domain;
-    char **sids;
+    struct sdap_domain *sdom;
+    const char **sids;
+    size_t num_sids;
 
-    const char *current_sid;
-    int index;
+    size_t index;
+    size_t batch;
 };
 
-static errno_t sdap_ad_resolve_sids_step(struct tevent_req *req);
-static void sdap_ad_resolve_sids_done(struct tevent_req *subreq);
+static errno_t sdap_ad_resolve_dom_sids_step(struct tevent_req *req);
+static void sdap_ad_resolve_dom_sids_done(struct tevent_req *subreq);
 
-struct tevent_req *
-sdap_ad_resolve_sids_send(TALLOC_CTX *mem_ctx,
-                          struct tevent_context *ev,
-                          struct sdap_id_ctx *id_ctx,
-                          struct sdap_id_conn_ctx *conn,
-                          struct sdap_options *opts,
-                          struct sss_domain_info *domain,
-                          char **sids)
+static struct tevent_req *
+sdap_ad_resolve_dom_sids_send(TALLOC_CTX *mem_ctx,
+                              struct tevent_context *ev,
+                              struct sdap_id_ctx *id_ctx,
+                              struct sdap_id_conn_ctx *conn,
+                              struct sdap_domain *sdom,
+                              const char **sids,
+                              size_t num_sids)
 {
-    struct sdap_ad_resolve_sids_state *state = NULL;
+    struct sdap_ad_resolve_dom_sids_state *state = NULL;
     struct tevent_req *req = NULL;
     errno_t ret;
 
     req = tevent_req_create(mem_ctx, &state,
-                            struct sdap_ad_resolve_sids_state);
+                            struct sdap_ad_resolve_dom_sids_state);
     if (req == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
         return NULL;
@@ -569,17 +576,12 @@ sdap_ad_resolve_sids_send(TALLOC_CTX *mem_ctx,
     state->ev = ev;
     state->id_ctx = id_ctx;
     state->conn = conn;
-    state->opts = opts;
-    state->domain = get_domains_head(domain);
+    state->sdom = sdom;
     state->sids = sids;
+    state->num_sids = num_sids;
     state->index = 0;
 
-    if (state->sids == NULL || state->sids[0] == NULL) {
-        ret = EOK;
-        goto immediately;
-    }
-
-    ret = sdap_ad_resolve_sids_step(req);
+    ret = sdap_ad_resolve_dom_sids_step(req);
     if (ret != EAGAIN) {
         goto immediately;
     }
@@ -597,80 +599,70 @@ immediately:
     return req;
 }
 
-static errno_t sdap_ad_resolve_sids_step(struct tevent_req *req)
+static errno_t sdap_ad_resolve_dom_sids_step(struct tevent_req *req)
 {
-    struct sdap_ad_resolve_sids_state *state = NULL;
+    struct sdap_ad_resolve_dom_sids_state *state = NULL;
     struct tevent_req *subreq = NULL;
-    struct sdap_domain *sdap_domain = NULL;
-    struct sss_domain_info *domain = NULL;
-
-    state = tevent_req_data(req, struct sdap_ad_resolve_sids_state);
 
-    do {
-        state->current_sid = state->sids[state->index];
-        if (state->current_sid == NULL) {
-            return EOK;
-        }
-        state->index++;
+    state = tevent_req_data(req, struct sdap_ad_resolve_dom_sids_state);
 
-        domain = sss_get_domain_by_sid_ldap_fallback(state->domain,
-                                                     state->current_sid);
+    if (state->index >= state->num_sids) {
+        return EOK;
+    }
 
-        if (domain == NULL) {
-            DEBUG(SSSDBG_MINOR_FAILURE, "SID %s does not belong to any known "
-                                         "domain\n", state->current_sid);
-        }
-    } while (domain == NULL);
+    state->batch = MIN(state->num_sids - state->index,
+                       SDAP_AD_RESOLVE_SIDS_BATCH);
 
-    sdap_domain = sdap_domain_get(state->opts, domain);
-    if (sdap_domain == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "SDAP domain does not exist?\n");
-        return ERR_INTERNAL;
-    }
+    DEBUG(SSSDBG_TRACE_FUNC, "Resolving %zu SIDs in domain %s\n",
+          state->batch, state->sdom->dom->name);
 
-    subreq = groups_get_send(state, state->ev, state->id_ctx, sdap_domain,
-                             state->conn, state->current_sid,
-                             BE_FILTER_SECID, BE_ATTR_CORE, false, true);
+    subreq = groups_get_by_sids_send(state, state->ev, state->id_ctx,
+                                     state->sdom, state->conn,
+                                     &state->sids[state->index],
+                                     state->batch, true);
     if (subreq == NULL) {
         return ENOMEM;
     }
 
-    tevent_req_set_callback(subreq, sdap_ad_resolve_sids_done, req);
+    tevent_req_set_callback(subreq, sdap_ad_resolve_dom_sids_done, req);
 
     return EAGAIN;
 }
 
-static void sdap_ad_resolve_sids_done(struct tevent_req *subreq)
+static void sdap_ad_resolve_dom_sids_done(struct tevent_req *subreq)
 {
-    struct sdap_ad_resolve_sids_state *state = NULL;
+    struct sdap_ad_resolve_dom_sids_state *state = NULL;
     struct tevent_req *req = NULL;
     int dp_error;
     int sdap_error;
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct sdap_ad_resolve_sids_state);
+    state = tevent_req_data(req, struct sdap_ad_resolve_dom_sids_state);
 
     ret = groups_get_recv(subreq, &dp_error, &sdap_error);
     talloc_zfree(subreq);
 
     if (ret == EOK && sdap_error == ENOENT && dp_error == DP_ERR_OK) {
-        /* Group was not found, we will ignore the error and continue with
-         * next group. This may happen for example if the group is built-in,
-         * but a custom search base is provided. */
+        /* None of the groups were found, we will ignore the error and
+         * continue with the next batch. This may happen for example if the
+         * groups are built-in, but a custom search base is provided. */
         DEBUG(SSSDBG_CRIT_FAILURE,
-              "Unable to resolve SID %s - will try next sid.\n",
-              state->current_sid);
+              "Unable to resolve %zu SIDs starting with %s - will try "
+              "next SIDs.\n", state->batch, state->sids[state->index]);
     } else if (ret != EOK || sdap_error != EOK || dp_error != DP_ERR_OK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to resolve SID %s [dp_error: %d, "
-              "sdap_error: %d, ret: %d]: %s\n", state->current_sid, dp_error,
-              sdap_error, ret, strerror(ret));
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to resolve SIDs starting with %s "
+              "[dp_error: %d, sdap_error: %d, ret: %d]: %s\n",
+              state->sids[state->index], dp_error, sdap_error, ret,
+              strerror(ret));
         goto done;
     }
 
-    ret = sdap_ad_resolve_sids_step(req);
+    state->index += state->batch;
+
+    ret = sdap_ad_resolve_dom_sids_step(req);
     if (ret == EAGAIN) {
-        /* continue with next SID */
+        /* continue with next batch */
         return;
     }
 
@@ -683,6 +675,162 @@ done:
     tevent_req_done(req);
 }
 
+static errno_t sdap_ad_resolve_dom_sids_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+struct sdap_ad_resolve_sids_dom {
+    struct sdap_domain *sdom;
+    const char **sids;
+    size_t num_sids;
+};
+
+struct sdap_ad_resolve_sids_state {
+    size_t num_pending;
+};
+
+static void sdap_ad_resolve_sids_done(struct tevent_req *subreq);
+
+/* The SIDs are grouped by the domain they belong to. Each domain is then
+ * searched with multi-valued objectSid filters and the domains are searched
+ * in parallel. */
+struct tevent_req *
+sdap_ad_resolve_sids_send(TALLOC_CTX *mem_ctx,
+                          struct tevent_context *ev,
+                          struct sdap_id_ctx *id_ctx,
+                          struct sdap_id_conn_ctx *conn,
+                          struct sdap_options *opts,
+                          struct sss_domain_info *domain,
+                          char **sids)
+{
+    struct sdap_ad_resolve_sids_state *state = NULL;
+    struct sdap_ad_resolve_sids_dom *doms = NULL;
+    struct sss_domain_info *head = NULL;
+    struct sss_domain_info *sid_dom = NULL;
+    struct sdap_domain *sdom = NULL;
+    struct tevent_req *req = NULL;
+    struct tevent_req *subreq = NULL;
+    size_t num_doms = 0;
+    size_t num_sids;
+    size_t i;
+    size_t d;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct sdap_ad_resolve_sids_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    if (sids == NULL || sids[0] == NULL) {
+        ret = EOK;
+        goto immediately;
+    }
+
+    for (num_sids = 0; sids[num_sids] != NULL; num_sids++);
+
+    doms = talloc_zero_array(state, struct sdap_ad_resolve_sids_dom,
+                             num_sids);
+    if (doms == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    head = get_domains_head(domain);
+
+    for (i = 0; i < num_sids; i++) {
+        sid_dom = sss_get_domain_by_sid_ldap_fallback(head, sids[i]);
+        if (sid_dom == NULL) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "SID %s does not belong to any known "
+                                         "domain\n", sids[i]);
+            continue;
+        }
+
+        sdom = sdap_domain_get(opts, sid_dom);
+        if (sdom == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "SDAP domain does not exist?\n");
+            ret = ERR_INTERNAL;
+            goto immediately;
+        }
+
+        for (d = 0; d < num_doms; d++) {
+            if (doms[d].sdom == sdom) {
+                break;
+            }
+        }
+
+        if (d == num_doms) {
+            doms[d].sdom = sdom;
+            doms[d].sids = talloc_zero_array(doms, const char *, num_sids);
+            if (doms[d].sids == NULL) {
+                ret = ENOMEM;
+                goto immediately;
+            }
+            num_doms++;
+        }
+
+        doms[d].sids[doms[d].num_sids] = sids[i];
+        doms[d].num_sids++;
+    }
+
+    for (d = 0; d < num_doms; d++) {
+        subreq = sdap_ad_resolve_dom_sids_send(state, ev, id_ctx, conn,
+                                               doms[d].sdom, doms[d].sids,
+                                               doms[d].num_sids);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto immediately;
+        }
+
+        tevent_req_set_callback(subreq, sdap_ad_resolve_sids_done, req);
+        state->num_pending++;
+    }
+
+    if (state->num_pending == 0) {
+        ret = EOK;
+        goto immediately;
+    }
+
+    return req;
+
+immediately:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+static void sdap_ad_resolve_sids_done(struct tevent_req *subreq)
+{
+    struct sdap_ad_resolve_sids_state *state = NULL;
+    struct tevent_req *req = NULL;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sdap_ad_resolve_sids_state);
+
+    ret = sdap_ad_resolve_dom_sids_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        /* the remaining domains are cancelled when req is freed */
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    state->num_pending--;
+    if (state->num_pending == 0) {
+        tevent_req_done(req);
+    }
+}
+
 errno_t sdap_ad_resolve_sids_recv(struct tevent_req *req)
 {
     TEVENT_REQ_RETURN_ON_ERROR(req);
@@ -105,6 +105,7 @@ static errno_t sdap_fork_child(struct tevent_context *ev,
         goto fail;
     }
 
+    sss_debug_prepare_fork();
     pid = fork();
 
     if (pid == 0) { /* child */
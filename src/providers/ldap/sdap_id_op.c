@@ -54,6 +54,8 @@ struct sdap_id_op {
      * This member is cleared when sdap_id_op_connect_state
      * associated with request is destroyed */
     struct tevent_req *connect_req;
+    /* client request this operation belongs to */
+    uint64_t trace_id;
 };
 
 /* LDAP connection cache connection attempt/established connection data */
@@ -296,6 +298,7 @@ struct sdap_id_op *sdap_id_op_create(TALLOC_CTX *memctx, struct sdap_id_conn_cac
     }
 
     op->conn_cache = conn_cache;
+    op->trace_id = sss_trace_id;
 
     talloc_set_destructor((void*)op, sdap_id_op_destroy);
     return op;
@@ -768,6 +771,9 @@ static void sdap_id_op_connect_req_complete(struct sdap_id_op *op, int dp_error,
 
     op->connect_req = NULL;
 
+    /* The connection may be shared by operations of several requests. */
+    sss_trace_id = op->trace_id;
+
     state = tevent_req_data(req, struct sdap_id_op_connect_state);
     state->dp_error = dp_error;
     state->result = ret;
@@ -125,6 +125,12 @@ static void sdap_sudo_full_refresh_done(struct tevent_req *subreq)
          * which would cause problems in the consumers */
     }
 
+    ret = sysdb_sudo_bump_rules_generation(state->domain);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to update sudo rules "
+                                    "generation\n");
+    }
+
     DEBUG(SSSDBG_TRACE_FUNC, "Successful full refresh of sudo rules\n");
 
 done:
@@ -152,6 +158,7 @@ int sdap_sudo_full_refresh_recv(struct tevent_req *req,
 struct sdap_sudo_smart_refresh_state {
     struct sdap_id_ctx *id_ctx;
     struct sysdb_ctx *sysdb;
+    struct sss_domain_info *domain;
     int dp_error;
 };
 
@@ -178,6 +185,7 @@ struct tevent_req *sdap_sudo_smart_refresh_send(TALLOC_CTX *mem_ctx,
 
     state->id_ctx = id_ctx;
     state->sysdb = id_ctx->be->domain->sysdb;
+    state->domain = id_ctx->be->domain;
 
     /* Download all rules from LDAP that are newer than usn */
     if (srv_opts == NULL || srv_opts->max_sudo_value == 0) {
@@ -227,17 +235,26 @@ static void sdap_sudo_smart_refresh_done(struct tevent_req *subreq)
 {
     struct tevent_req *req = NULL;
     struct sdap_sudo_smart_refresh_state *state = NULL;
+    size_t num_rules;
     int ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct sdap_sudo_smart_refresh_state);
 
-    ret = sdap_sudo_refresh_recv(state, subreq, &state->dp_error, NULL);
+    ret = sdap_sudo_refresh_recv(state, subreq, &state->dp_error, &num_rules);
     talloc_zfree(subreq);
     if (ret != EOK || state->dp_error != DP_ERR_OK) {
         goto done;
     }
 
+    if (num_rules > 0) {
+        ret = sysdb_sudo_bump_rules_generation(state->domain);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to update sudo rules "
+                                        "generation\n");
+        }
+    }
+
     DEBUG(SSSDBG_TRACE_FUNC, "Successful smart refresh of sudo rules\n");
 
 done:
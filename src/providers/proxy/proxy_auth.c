@@ -189,6 +189,7 @@ static struct tevent_req *proxy_child_init_send(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_LIBS,
           "Starting proxy child with args [%s]\n", state->command);
 
+    sss_debug_prepare_fork();
     pid = fork();
     if (pid < 0) {
         ret = errno;
@@ -61,6 +61,10 @@
 
 #define RESOLV_TIMEOUTMS  2000
 
+/* How long to remember that a name does not exist */
+#define RESOLV_NEGATIVE_TTL 30
+#define RESOLV_CACHE_MAX_ENTRIES 256
+
 enum host_database default_host_dbs[] = { DB_FILES, DB_DNS, DB_SENTINEL };
 
 struct fd_watch {
@@ -86,6 +90,47 @@ struct resolv_ctx {
      * if our pending requests didn't timeout. */
     int pending_requests;
     struct tevent_timer *timeout_watcher;
+
+    /* Answers shared by all requests that use this context, most recently
+     * used first, and the queries that are being sent to the server. */
+    struct resolv_cache_entry *cache;
+    int num_cache_entries;
+    struct resolv_inflight_query *inflight;
+};
+
+struct resolv_cache_entry {
+    struct resolv_cache_entry *prev;
+    struct resolv_cache_entry *next;
+
+    bool search;
+    int type;
+    char *name;
+
+    time_t expire;
+    /* ARES_SUCCESS with the answer or the status of a negative answer */
+    int status;
+    unsigned char *abuf;
+    int alen;
+};
+
+struct resolv_query_waiter {
+    struct resolv_query_waiter *prev;
+    struct resolv_query_waiter *next;
+
+    ares_callback callback;
+    void *arg;
+};
+
+struct resolv_inflight_query {
+    struct resolv_inflight_query *prev;
+    struct resolv_inflight_query *next;
+    struct resolv_ctx *ctx;
+
+    bool search;
+    int type;
+    char *name;
+
+    struct resolv_query_waiter *waiters;
 };
 
 struct request_watch {
@@ -485,12 +530,258 @@ done:
     return ret;
 }
 
+static void
+resolv_cache_flush(struct resolv_ctx *ctx)
+{
+    struct resolv_cache_entry *entry;
+
+    while ((entry = ctx->cache) != NULL) {
+        DLIST_REMOVE(ctx->cache, entry);
+        talloc_free(entry);
+    }
+    ctx->num_cache_entries = 0;
+}
+
 void
 resolv_reread_configuration(struct resolv_ctx *ctx)
 {
+    /* The answers may come from servers that are no longer configured */
+    resolv_cache_flush(ctx);
     recreate_ares_channel(ctx);
 }
 
+/* =================== Cache of DNS answers ===============================*/
+static bool
+resolv_answer_ttl(unsigned char *abuf, const int alen, uint32_t max_ttl,
+                  uint32_t *_ttl);
+
+static struct resolv_cache_entry *
+resolv_cache_find(struct resolv_ctx *ctx, bool search,
+                  const char *name, int type)
+{
+    struct resolv_cache_entry *entry;
+    struct resolv_cache_entry *next;
+    time_t now = time(NULL);
+
+    for (entry = ctx->cache; entry != NULL; entry = next) {
+        next = entry->next;
+
+        if (entry->expire <= now) {
+            DLIST_REMOVE(ctx->cache, entry);
+            ctx->num_cache_entries--;
+            talloc_free(entry);
+            continue;
+        }
+
+        if (entry->search == search && entry->type == type
+                && strcasecmp(entry->name, name) == 0) {
+            DLIST_PROMOTE(ctx->cache, entry);
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+resolv_cache_store(struct resolv_ctx *ctx, bool search, const char *name,
+                   int type, int status, unsigned char *abuf, int alen)
+{
+    struct resolv_cache_entry *entry;
+    struct resolv_cache_entry *last;
+    uint32_t ttl;
+
+    switch (status) {
+    case ARES_SUCCESS:
+        if (!resolv_answer_ttl(abuf, alen, 0, &ttl) || ttl == 0) {
+            return;
+        }
+        break;
+    case ARES_ENOTFOUND:
+    case ARES_ENODATA:
+        ttl = RESOLV_NEGATIVE_TTL;
+        break;
+    default:
+        /* Timeouts and server failures say nothing about the name */
+        return;
+    }
+
+    /* Drops a previous answer and the expired ones */
+    entry = resolv_cache_find(ctx, search, name, type);
+    if (entry != NULL) {
+        DLIST_REMOVE(ctx->cache, entry);
+        ctx->num_cache_entries--;
+        talloc_free(entry);
+    }
+
+    if (ctx->num_cache_entries >= RESOLV_CACHE_MAX_ENTRIES) {
+        for (last = ctx->cache; last->next != NULL; last = last->next);
+        DLIST_REMOVE(ctx->cache, last);
+        ctx->num_cache_entries--;
+        talloc_free(last);
+    }
+
+    entry = talloc_zero(ctx, struct resolv_cache_entry);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->search = search;
+    entry->type = type;
+    entry->status = status;
+    entry->expire = time(NULL) + ttl;
+    entry->name = talloc_strdup(entry, name);
+    if (entry->name == NULL) {
+        talloc_free(entry);
+        return;
+    }
+
+    if (status == ARES_SUCCESS) {
+        entry->abuf = talloc_memdup(entry, abuf, alen);
+        if (entry->abuf == NULL) {
+            talloc_free(entry);
+            return;
+        }
+        entry->alen = alen;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "Caching %s answer for '%s' type %d for %"PRIu32" seconds\n",
+          status == ARES_SUCCESS ? "positive" : "negative", name, type, ttl);
+
+    DLIST_ADD(ctx->cache, entry);
+    ctx->num_cache_entries++;
+}
+
+static void
+resolv_cache_reply(struct resolv_cache_entry *entry,
+                   ares_callback callback, void *arg)
+{
+    unsigned char *abuf;
+    time_t remaining;
+
+    if (entry->status != ARES_SUCCESS) {
+        callback(arg, entry->status, 0, NULL, 0);
+        return;
+    }
+
+    /* The consumers read the TTLs from the answer, they must not
+     * outlive the time the answer was cached for */
+    abuf = talloc_memdup(NULL, entry->abuf, entry->alen);
+    if (abuf == NULL) {
+        callback(arg, ARES_ENOMEM, 0, NULL, 0);
+        return;
+    }
+
+    remaining = entry->expire - time(NULL);
+    resolv_answer_ttl(abuf, entry->alen, remaining > 0 ? remaining : 1, NULL);
+
+    callback(arg, ARES_SUCCESS, 0, abuf, entry->alen);
+    talloc_free(abuf);
+}
+
+static void
+resolv_inflight_query_done(void *arg, int status, int timeouts,
+                           unsigned char *abuf, int alen)
+{
+    struct resolv_inflight_query *query =
+        talloc_get_type(arg, struct resolv_inflight_query);
+    struct resolv_query_waiter *waiter;
+    struct resolv_query_waiter *next;
+
+    DLIST_REMOVE(query->ctx->inflight, query);
+
+    if (query->ctx->channel != NULL) {
+        resolv_cache_store(query->ctx, query->search, query->name,
+                           query->type, status, abuf, alen);
+    }
+
+    for (waiter = query->waiters; waiter != NULL; waiter = next) {
+        next = waiter->next;
+        waiter->callback(waiter->arg, status, timeouts, abuf, alen);
+    }
+
+    talloc_free(query);
+}
+
+/*
+ * Resolves the name with ares_search() or ares_query(). An answer that is
+ * still valid is given to the callback without asking the server, and a
+ * query that is already on its way to the server is not sent again,
+ * the callback is called when its answer arrives instead.
+ */
+static void
+resolv_query(struct resolv_ctx *ctx, bool search, const char *name,
+             int type, ares_callback callback, void *arg)
+{
+    struct resolv_cache_entry *entry;
+    struct resolv_inflight_query *query;
+    struct resolv_query_waiter *waiter;
+
+    entry = resolv_cache_find(ctx, search, name, type);
+    if (entry != NULL) {
+        DEBUG(SSSDBG_TRACE_INTERNAL,
+              "Using cached answer for '%s' type %d\n", name, type);
+        resolv_cache_reply(entry, callback, arg);
+        return;
+    }
+
+    DLIST_FOR_EACH(query, ctx->inflight) {
+        if (query->search == search && query->type == type
+                && strcasecmp(query->name, name) == 0) {
+            break;
+        }
+    }
+
+    if (query == NULL) {
+        query = talloc_zero(ctx, struct resolv_inflight_query);
+        if (query == NULL) {
+            callback(arg, ARES_ENOMEM, 0, NULL, 0);
+            return;
+        }
+
+        query->ctx = ctx;
+        query->search = search;
+        query->type = type;
+        query->name = talloc_strdup(query, name);
+        if (query->name == NULL) {
+            talloc_free(query);
+            callback(arg, ARES_ENOMEM, 0, NULL, 0);
+            return;
+        }
+    } else {
+        DEBUG(SSSDBG_TRACE_INTERNAL,
+              "Query for '%s' type %d already in progress\n", name, type);
+    }
+
+    waiter = talloc_zero(query, struct resolv_query_waiter);
+    if (waiter == NULL) {
+        if (query->waiters == NULL) {
+            talloc_free(query);
+        }
+        callback(arg, ARES_ENOMEM, 0, NULL, 0);
+        return;
+    }
+    waiter->callback = callback;
+    waiter->arg = arg;
+
+    if (query->waiters != NULL) {
+        DLIST_ADD_END(query->waiters, waiter, struct resolv_query_waiter *);
+        return;
+    }
+
+    DLIST_ADD(query->waiters, waiter);
+    DLIST_ADD(ctx->inflight, query);
+
+    if (search) {
+        ares_search(ctx->channel, query->name, ns_c_in, type,
+                    resolv_inflight_query_done, query);
+    } else {
+        ares_query(ctx->channel, query->name, ns_c_in, type,
+                   resolv_inflight_query_done, query);
+    }
+}
+
 static errno_t
 resolv_copy_in_addr(TALLOC_CTX *mem_ctx, struct resolv_addr *ret,
                     struct ares_addrttl *attl)
@@ -868,10 +1159,9 @@ resolv_gethostbyname_dns_query(struct tevent_req *req,
         return;
     }
 
-    ares_search(state->resolv_ctx->channel,
-                state->name, ns_c_in,
-                (state->family == AF_INET) ? ns_t_a : ns_t_aaaa,
-                resolv_gethostbyname_dns_query_done, rreq);
+    resolv_query(state->resolv_ctx, true, state->name,
+                 (state->family == AF_INET) ? ns_t_a : ns_t_aaaa,
+                 resolv_gethostbyname_dns_query_done, rreq);
 }
 
 static void
@@ -1632,11 +1922,15 @@ resolv_getsrv_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
  *
  *  On success, returns true and sets the TTL in the _ttl parameter. On
  *  failure, returns false and _ttl is undefined.
+ *
+ *  If max_ttl is not zero, TTLs that are larger are lowered to max_ttl in
+ *  the answer itself. This is used when an answer is served from the cache.
  */
 static bool
-resolv_get_ttl(const unsigned char *abuf, const int alen, uint32_t *_ttl)
+resolv_answer_ttl(unsigned char *abuf, const int alen, uint32_t max_ttl,
+                  uint32_t *_ttl)
 {
-    const unsigned char *aptr;
+    unsigned char *aptr;
     int ret;
     char *name = NULL;
     long len;
@@ -1691,6 +1985,14 @@ resolv_get_ttl(const unsigned char *abuf, const int alen, uint32_t *_ttl)
         if (aptr + rr_len > abuf + alen) {
             return false;
         }
+
+        if (max_ttl > 0 && rr_ttl > max_ttl) {
+            rr_ttl = max_ttl;
+            aptr[4] = (rr_ttl >> 24) & 0xff;
+            aptr[5] = (rr_ttl >> 16) & 0xff;
+            aptr[6] = (rr_ttl >> 8) & 0xff;
+            aptr[7] = rr_ttl & 0xff;
+        }
         aptr += NS_RRFIXEDSZ + rr_len;
 
         if (ttl > 0) {
@@ -1700,10 +2002,18 @@ resolv_get_ttl(const unsigned char *abuf, const int alen, uint32_t *_ttl)
         }
     }
 
-    *_ttl = ttl;
+    if (_ttl) {
+        *_ttl = ttl;
+    }
     return true;
 }
 
+static bool
+resolv_get_ttl(const unsigned char *abuf, const int alen, uint32_t *_ttl)
+{
+    return resolv_answer_ttl(discard_const(abuf), alen, 0, _ttl);
+}
+
 static void
 resolv_getsrv_done(void *arg, int status, int timeouts, unsigned char *abuf, int alen)
 {
@@ -1824,8 +2134,8 @@ resolv_getsrv_query(struct tevent_req *req,
         return;
     }
 
-    ares_query(state->resolv_ctx->channel, state->query,
-               ns_c_in, ns_t_srv, resolv_getsrv_done, rreq);
+    resolv_query(state->resolv_ctx, false, state->query,
+                 ns_t_srv, resolv_getsrv_done, rreq);
 }
 
 /* TXT parsing is not used anywhere in the code yet, so we disable it
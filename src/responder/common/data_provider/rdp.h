@@ -77,4 +77,23 @@ void _rdp_message_send_and_reply(struct sbus_request *sbus_req,
 errno_t rdp_register_client(struct be_conn *be_conn,
                             const char *client_name);
 
+struct dp_bin_account_req;
+
+/**
+ * Return true if account requests can be sent to this data provider over
+ * the binary transport, connecting to it if needed. Otherwise D-Bus must
+ * be used.
+ */
+bool rdp_bin_available(struct be_conn *be_conn);
+
+struct tevent_req *rdp_bin_account_send(TALLOC_CTX *mem_ctx,
+                                        struct be_conn *be_conn,
+                                        const struct dp_bin_account_req *areq);
+
+errno_t rdp_bin_account_recv(TALLOC_CTX *mem_ctx,
+                             struct tevent_req *req,
+                             uint16_t *_dp_err,
+                             uint32_t *_dp_ret,
+                             char **_err_msg);
+
 #endif /* _RDP_CALLS_H_ */
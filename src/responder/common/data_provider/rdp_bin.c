@@ -0,0 +1,622 @@
+/*
+    SSSD
+
+    Binary transport between responders and data provider - client
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "responder/common/data_provider/rdp.h"
+#include "providers/data_provider/dp_bin.h"
+#include "util/util.h"
+
+/* Do not try to connect more often than this when the data provider
+ * does not listen on the binary socket. */
+#define RDP_BIN_RETRY_INTERVAL 30
+
+/* Reserved for the registration of the client. */
+#define RDP_BIN_REGISTER_ID 0
+
+/* Largest number of requests coalesced into one batch. */
+#define RDP_BIN_BATCH_MAX 64
+
+struct rdp_bin_out {
+    struct rdp_bin_out *prev;
+    struct rdp_bin_out *next;
+
+    uint8_t *frame;
+    size_t len;
+    size_t written;
+};
+
+struct rdp_bin_account_state;
+
+struct rdp_bin_conn {
+    struct be_conn *be_conn;
+    int fd;
+    struct tevent_fd *fde;
+
+    uint32_t next_id;
+    uint8_t *in;
+    size_t in_len;
+    struct rdp_bin_out *out;
+
+    /* requests waiting for the end of the batch window */
+    struct rdp_bin_out *batch;
+    size_t batch_count;
+    size_t batch_len;
+    struct tevent_timer *batch_te;
+
+    struct rdp_bin_account_state *pending;
+};
+
+struct rdp_bin_account_state {
+    struct rdp_bin_account_state *prev;
+    struct rdp_bin_account_state *next;
+
+    struct rdp_bin_conn *conn;
+    struct tevent_req *req;
+    uint32_t id;
+
+    uint16_t dp_err;
+    uint32_t dp_ret;
+    char *err_msg;
+};
+
+static errno_t rdp_bin_write(struct rdp_bin_conn *conn)
+{
+    struct rdp_bin_out *out;
+    ssize_t len;
+    errno_t ret;
+
+    while ((out = conn->out) != NULL) {
+        len = send(conn->fd, out->frame + out->written,
+                   out->len - out->written, MSG_NOSIGNAL);
+        if (len == -1) {
+            ret = errno;
+            if (ret == EAGAIN || ret == EINTR) {
+                TEVENT_FD_WRITEABLE(conn->fde);
+                return EOK;
+            }
+
+            return ret;
+        }
+
+        out->written += len;
+        if (out->written < out->len) {
+            TEVENT_FD_WRITEABLE(conn->fde);
+            return EOK;
+        }
+
+        DLIST_REMOVE(conn->out, out);
+        talloc_free(out);
+    }
+
+    TEVENT_FD_NOT_WRITEABLE(conn->fde);
+    return EOK;
+}
+
+static errno_t rdp_bin_queue_frame(struct rdp_bin_conn *conn,
+                                   uint8_t *frame, size_t len)
+{
+    struct rdp_bin_out *out;
+    bool idle;
+    errno_t ret;
+
+    out = talloc_zero(conn, struct rdp_bin_out);
+    if (out == NULL) {
+        return ENOMEM;
+    }
+
+    out->frame = talloc_steal(out, frame);
+    out->len = len;
+
+    idle = conn->out == NULL;
+    DLIST_ADD_END(conn->out, out, struct rdp_bin_out *);
+
+    if (idle) {
+        ret = rdp_bin_write(conn);
+        if (ret != EOK) {
+            /* The error is reported to all pending requests from the
+             * fd handler, not to this caller. */
+            TEVENT_FD_WRITEABLE(conn->fde);
+        }
+    }
+
+    return EOK;
+}
+
+static errno_t rdp_bin_batch_flush(struct rdp_bin_conn *conn)
+{
+    uint8_t *frames[RDP_BIN_BATCH_MAX];
+    size_t lens[RDP_BIN_BATCH_MAX];
+    struct rdp_bin_out *item;
+    uint8_t *frame;
+    size_t count = 0;
+    size_t len;
+    errno_t ret;
+
+    talloc_zfree(conn->batch_te);
+
+    if (conn->batch == NULL) {
+        return EOK;
+    }
+
+    if (conn->batch_count == 1) {
+        item = conn->batch;
+        DLIST_REMOVE(conn->batch, item);
+        conn->batch_count = 0;
+        conn->batch_len = 0;
+
+        frame = talloc_steal(conn, item->frame);
+        len = item->len;
+        talloc_free(item);
+
+        return rdp_bin_queue_frame(conn, frame, len);
+    }
+
+    for (item = conn->batch; item != NULL; item = item->next) {
+        frames[count] = item->frame;
+        lens[count] = item->len;
+        count++;
+    }
+
+    frame = dp_bin_pack_batch(conn, frames, lens, count, &len);
+    if (frame == NULL) {
+        return ENOMEM;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Sending batch of %zu requests\n", count);
+
+    while ((item = conn->batch) != NULL) {
+        DLIST_REMOVE(conn->batch, item);
+        talloc_free(item);
+    }
+    conn->batch_count = 0;
+    conn->batch_len = 0;
+
+    ret = rdp_bin_queue_frame(conn, frame, len);
+    if (ret != EOK) {
+        talloc_free(frame);
+    }
+
+    return ret;
+}
+
+static void rdp_bin_conn_fail(struct rdp_bin_conn *conn, errno_t error);
+
+static void rdp_bin_batch_timeout(struct tevent_context *ev,
+                                  struct tevent_timer *te,
+                                  struct timeval tv,
+                                  void *pvt)
+{
+    struct rdp_bin_conn *conn = talloc_get_type(pvt, struct rdp_bin_conn);
+    errno_t ret;
+
+    conn->batch_te = NULL;
+
+    ret = rdp_bin_batch_flush(conn);
+    if (ret != EOK) {
+        rdp_bin_conn_fail(conn, ret);
+    }
+}
+
+/* Coalesce requests that arrive within the batch window so the data
+ * provider can look them up together. */
+static errno_t rdp_bin_batch_add(struct rdp_bin_conn *conn,
+                                 uint8_t *frame, size_t len)
+{
+    struct be_conn *be_conn = conn->be_conn;
+    struct rdp_bin_out *item;
+    struct timeval tv;
+    errno_t ret;
+
+    if (conn->batch_count == RDP_BIN_BATCH_MAX
+            || DP_BIN_HEADER_SIZE + conn->batch_len + len
+                    > DP_BIN_MAX_FRAME_SIZE) {
+        ret = rdp_bin_batch_flush(conn);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    item = talloc_zero(conn, struct rdp_bin_out);
+    if (item == NULL) {
+        return ENOMEM;
+    }
+
+    item->frame = talloc_steal(item, frame);
+    item->len = len;
+
+    DLIST_ADD_END(conn->batch, item, struct rdp_bin_out *);
+    conn->batch_count++;
+    conn->batch_len += len;
+
+    if (conn->batch_te == NULL) {
+        tv = tevent_timeval_current_ofs(0, be_conn->bin_batch_window * 1000);
+        conn->batch_te = tevent_add_timer(be_conn->rctx->ev, conn, tv,
+                                          rdp_bin_batch_timeout, conn);
+        if (conn->batch_te == NULL) {
+            /* Nothing would ever send the request, the caller fails it. */
+            DLIST_REMOVE(conn->batch, item);
+            conn->batch_count--;
+            conn->batch_len -= len;
+            talloc_free(item);
+            return ENOMEM;
+        }
+    }
+
+    return EOK;
+}
+
+static void rdp_bin_conn_fail(struct rdp_bin_conn *conn, errno_t error)
+{
+    struct be_conn *be_conn = conn->be_conn;
+    struct rdp_bin_account_state *state;
+
+    DEBUG(SSSDBG_MINOR_FAILURE, "Binary connection to the data provider "
+          "failed [%d]: %s\n", error, sss_strerror(error));
+
+    /* New requests go through D-Bus from now on. */
+    be_conn->bin = NULL;
+    be_conn->bin_retry = time(NULL) + RDP_BIN_RETRY_INTERVAL;
+    talloc_zfree(conn->fde);
+
+    while ((state = conn->pending) != NULL) {
+        DLIST_REMOVE(conn->pending, state);
+        state->conn = NULL;
+        tevent_req_error(state->req, error);
+    }
+
+    talloc_free(conn);
+}
+
+static void rdp_bin_dispatch(struct rdp_bin_conn *conn,
+                             const struct dp_bin_header *hdr,
+                             const uint8_t *frame)
+{
+    struct rdp_bin_account_state *state;
+    struct dp_bin_reply reply;
+    errno_t ret;
+
+    if (hdr->id == RDP_BIN_REGISTER_ID) {
+        if (hdr->code != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to register binary client "
+                  "[%"PRIu32"]: %s\n", hdr->code, sss_strerror(hdr->code));
+        }
+        return;
+    }
+
+    for (state = conn->pending; state != NULL; state = state->next) {
+        if (state->id == hdr->id) {
+            break;
+        }
+    }
+
+    if (state == NULL) {
+        /* The request was cancelled. */
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Ignoring reply to %"PRIu32"\n",
+              hdr->id);
+        return;
+    }
+
+    DLIST_REMOVE(conn->pending, state);
+    state->conn = NULL;
+
+    if (hdr->code != EOK) {
+        tevent_req_error(state->req, hdr->code);
+        return;
+    }
+
+    ret = dp_bin_unpack_reply(frame, hdr->length, &reply);
+    if (ret != EOK) {
+        tevent_req_error(state->req, ret);
+        return;
+    }
+
+    state->dp_err = reply.dp_error;
+    state->dp_ret = reply.error;
+    if (reply.message != NULL) {
+        state->err_msg = talloc_strdup(state, reply.message);
+    }
+
+    tevent_req_done(state->req);
+}
+
+static void rdp_bin_read(struct rdp_bin_conn *conn)
+{
+    struct dp_bin_header hdr;
+    size_t done = 0;
+    ssize_t len;
+    errno_t ret;
+
+    len = recv(conn->fd, conn->in + conn->in_len,
+               DP_BIN_MAX_FRAME_SIZE - conn->in_len, 0);
+    if (len == -1) {
+        ret = errno;
+        if (ret == EAGAIN || ret == EINTR) {
+            return;
+        }
+
+        rdp_bin_conn_fail(conn, ret);
+        return;
+    } else if (len == 0) {
+        rdp_bin_conn_fail(conn, EPIPE);
+        return;
+    }
+
+    conn->in_len += len;
+
+    while (true) {
+        ret = dp_bin_parse_header(conn->in + done, conn->in_len - done, &hdr);
+        if (ret == EAGAIN) {
+            break;
+        } else if (ret != EOK) {
+            rdp_bin_conn_fail(conn, ret);
+            return;
+        }
+
+        if (conn->in_len - done < hdr.length) {
+            break;
+        }
+
+        rdp_bin_dispatch(conn, &hdr, conn->in + done);
+        done += hdr.length;
+    }
+
+    if (done > 0) {
+        memmove(conn->in, conn->in + done, conn->in_len - done);
+        conn->in_len -= done;
+    }
+}
+
+static void rdp_bin_handler(struct tevent_context *ev,
+                            struct tevent_fd *fde,
+                            uint16_t flags, void *ptr)
+{
+    struct rdp_bin_conn *conn = talloc_get_type(ptr, struct rdp_bin_conn);
+    errno_t ret;
+
+    if (flags & TEVENT_FD_WRITE) {
+        ret = rdp_bin_write(conn);
+        if (ret != EOK) {
+            rdp_bin_conn_fail(conn, ret);
+        }
+        return;
+    }
+
+    if (flags & TEVENT_FD_READ) {
+        rdp_bin_read(conn);
+    }
+}
+
+static int rdp_bin_conn_destructor(struct rdp_bin_conn *conn)
+{
+    talloc_zfree(conn->fde);
+    if (conn->fd != -1) {
+        close(conn->fd);
+    }
+
+    return 0;
+}
+
+static errno_t rdp_bin_connect(struct be_conn *be_conn)
+{
+    struct rdp_bin_conn *conn;
+    struct sockaddr_un addr;
+    uint8_t *frame;
+    size_t len;
+    char *path;
+    errno_t ret;
+
+    conn = talloc_zero(be_conn, struct rdp_bin_conn);
+    if (conn == NULL) {
+        return ENOMEM;
+    }
+    conn->be_conn = be_conn;
+    conn->fd = -1;
+    conn->next_id = RDP_BIN_REGISTER_ID + 1;
+    talloc_set_destructor(conn, rdp_bin_conn_destructor);
+
+    path = talloc_asprintf(conn, "%s/%s_%s", PIPE_PATH, DP_BIN_PIPE,
+                           be_conn->domain->name);
+    if (path == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        ret = ENAMETOOLONG;
+        goto done;
+    }
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    conn->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (conn->fd == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    /* Connecting to a local socket does not block. */
+    if (connect(conn->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    ret = sss_fd_nonblocking(conn->fd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    conn->in = talloc_size(conn, DP_BIN_MAX_FRAME_SIZE);
+    if (conn->in == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    conn->fde = tevent_add_fd(be_conn->rctx->ev, conn, conn->fd,
+                              TEVENT_FD_READ, rdp_bin_handler, conn);
+    if (conn->fde == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    frame = dp_bin_pack_register(conn, RDP_BIN_REGISTER_ID,
+                                 be_conn->cli_name, &len);
+    if (frame == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = rdp_bin_queue_frame(conn, frame, len);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Connected to %s\n", path);
+    be_conn->bin = conn;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to connect to %s [%d]: %s\n",
+              path == NULL ? "(null)" : path, ret, sss_strerror(ret));
+        talloc_free(conn);
+    }
+
+    return ret;
+}
+
+bool rdp_bin_available(struct be_conn *be_conn)
+{
+    errno_t ret;
+
+    if (!be_conn->use_bin) {
+        return false;
+    }
+
+    if (be_conn->bin != NULL) {
+        return true;
+    }
+
+    if (time(NULL) < be_conn->bin_retry) {
+        return false;
+    }
+
+    ret = rdp_bin_connect(be_conn);
+    if (ret != EOK) {
+        be_conn->bin_retry = time(NULL) + RDP_BIN_RETRY_INTERVAL;
+        return false;
+    }
+
+    return true;
+}
+
+static int rdp_bin_account_destructor(struct rdp_bin_account_state *state)
+{
+    /* The reply will be ignored when it arrives. */
+    if (state->conn != NULL) {
+        DLIST_REMOVE(state->conn->pending, state);
+    }
+
+    return 0;
+}
+
+struct tevent_req *rdp_bin_account_send(TALLOC_CTX *mem_ctx,
+                                        struct be_conn *be_conn,
+                                        const struct dp_bin_account_req *areq)
+{
+    struct rdp_bin_account_state *state;
+    struct rdp_bin_conn *conn;
+    struct tevent_req *req;
+    uint8_t *frame;
+    size_t len;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct rdp_bin_account_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    conn = be_conn->bin;
+    if (conn == NULL) {
+        ret = ENOTCONN;
+        goto immediately;
+    }
+
+    state->req = req;
+    state->id = conn->next_id++;
+    if (conn->next_id == RDP_BIN_REGISTER_ID) {
+        conn->next_id++;
+    }
+
+    frame = dp_bin_pack_account_req(state, state->id, areq, &len);
+    if (frame == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    if (be_conn->bin_batch_window > 0) {
+        ret = rdp_bin_batch_add(conn, frame, len);
+    } else {
+        ret = rdp_bin_queue_frame(conn, frame, len);
+    }
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    state->conn = conn;
+    DLIST_ADD(conn->pending, state);
+    talloc_set_destructor(state, rdp_bin_account_destructor);
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, be_conn->rctx->ev);
+
+    return req;
+}
+
+errno_t rdp_bin_account_recv(TALLOC_CTX *mem_ctx,
+                             struct tevent_req *req,
+                             uint16_t *_dp_err,
+                             uint32_t *_dp_ret,
+                             char **_err_msg)
+{
+    struct rdp_bin_account_state *state;
+    state = tevent_req_data(req, struct rdp_bin_account_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_dp_err = state->dp_err;
+    *_dp_ret = state->dp_ret;
+    *_err_msg = talloc_steal(mem_ctx, state->err_msg);
+
+    return EOK;
+}
@@ -20,6 +20,8 @@
 */
 
 #include "util/util.h"
+#include "util/sss_metrics.h"
+#include "util/probes.h"
 #include "confdb/confdb.h"
 #include "responder/common/negcache_files.h"
 #include "responder/common/responder.h"
@@ -61,6 +63,15 @@ static int string_to_tdb_data(char *str, TDB_DATA *ret)
     return EOK;
 }
 
+static int sss_ncache_destructor(struct sss_nc_ctx *ctx)
+{
+    if (ctx->tdb != NULL) {
+        tdb_close(ctx->tdb);
+    }
+
+    return 0;
+}
+
 int sss_ncache_init(TALLOC_CTX *memctx, uint32_t timeout,
                     uint32_t local_timeout, struct sss_nc_ctx **_ctx)
 {
@@ -73,6 +84,7 @@ int sss_ncache_init(TALLOC_CTX *memctx, uint32_t timeout,
     /* open a memory only tdb with default hash size */
     ctx->tdb = tdb_open("memcache", 0, TDB_INTERNAL, O_RDWR|O_CREAT, 0);
     if (!ctx->tdb) return errno;
+    talloc_set_destructor(ctx, sss_ncache_destructor);
 
     ctx->timeout = timeout;
     ctx->local_timeout = local_timeout;
@@ -81,6 +93,31 @@ int sss_ncache_init(TALLOC_CTX *memctx, uint32_t timeout,
     return EOK;
 };
 
+int sss_ncache_share(struct sss_nc_ctx *ctx, const char *path)
+{
+    struct tdb_context *tdb;
+    int ret;
+
+    /* The file is emptied by the first process that opens it, the
+     * others see the entries it already holds. */
+    errno = 0;
+    tdb = tdb_open(path, 0, TDB_CLEAR_IF_FIRST | TDB_NOSYNC,
+                   O_RDWR|O_CREAT, 0600);
+    if (!tdb) {
+        ret = errno == 0 ? EIO : errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to open negative cache file %s [%d]: %s\n",
+              path, ret, sss_strerror(ret));
+        return ret;
+    }
+
+    /* entries added so far are dropped */
+    tdb_close(ctx->tdb);
+    ctx->tdb = tdb;
+
+    return EOK;
+}
+
 uint32_t sss_ncache_get_timeout(struct sss_nc_ctx *ctx)
 {
     return ctx->timeout;
@@ -138,6 +175,9 @@ done:
         ret = ENOENT;
     }
 
+    sss_metrics_inc("negcache", ret == EEXIST ? "hit" : "miss");
+    PROBE(NCACHE_CHECK, str, ret, sss_trace_id);
+
     free(data.dptr);
     return ret;
 }
@@ -177,6 +217,8 @@ static int sss_ncache_set_str(struct sss_nc_ctx *ctx, char *str,
     DEBUG(SSSDBG_TRACE_FUNC, "Adding [%s] to negative cache%s\n",
               str, permanent?" permanently":"");
 
+    PROBE(NCACHE_SET, str, permanent, sss_trace_id);
+
     ret = tdb_store(ctx->tdb, key, data, TDB_REPLACE);
     if (ret != 0) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Negative cache failed to set entry: [%s]\n",
@@ -28,6 +28,10 @@ struct sss_nc_ctx;
 int sss_ncache_init(TALLOC_CTX *memctx, uint32_t timeout,
                     uint32_t local_timeout, struct sss_nc_ctx **_ctx);
 
+/* move the negative cache to the tdb file at path so that it is shared
+ * by all processes that do the same */
+int sss_ncache_share(struct sss_nc_ctx *ctx, const char *path);
+
 uint32_t sss_ncache_get_timeout(struct sss_nc_ctx *ctx);
 
 /* check if the user is expired according to the passed in time to live */
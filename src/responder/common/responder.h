@@ -60,6 +60,12 @@ struct cli_request {
 
     /* reply data */
     struct sss_packet *out;
+
+    /* when the request was read completely */
+    struct timeval start;
+
+    /* identifies the request in debug messages of all processes */
+    uint64_t trace_id;
 };
 
 struct cli_protocol_version {
@@ -86,6 +92,16 @@ struct be_conn {
 
     char *sbus_address;
     struct sbus_connection *conn;
+
+    /* binary transport, see rdp_bin.c */
+    bool use_bin;
+    struct rdp_bin_conn *bin;
+    time_t bin_retry;
+    /* milliseconds */
+    int bin_batch_window;
+
+    /* see responder_access_stats.c */
+    struct sss_access_stats *access_stats;
 };
 
 struct resp_ctx {
@@ -106,6 +122,8 @@ struct resp_ctx {
     struct sss_domain_info *domains;
     int domains_timeout;
     int client_idle_timeout;
+    bool parallel_domain_lookup;
+    struct sss_cache_reader_pool *cache_readers;
 
     struct sss_cmd_table *sss_cmds;
     const char *sss_pipe_name;
@@ -311,6 +329,48 @@ sss_dp_get_account_recv(TALLOC_CTX *mem_ctx,
                         dbus_uint32_t *err_min,
                         char **err_msg);
 
+/* Count a cache hit so frequently used entries can be reported to the
+ * data provider for background refresh (refresh_hot_entries). */
+void sss_access_stats_record(struct resp_ctx *rctx,
+                             struct sss_domain_info *domain,
+                             enum sss_dp_acct_type dp_type,
+                             struct ldb_message *msg);
+
+/* Cache searches that can run in a cache reader process,
+ * see responder_cache_reader.c */
+enum sss_cache_reader_op {
+    SSS_CACHE_READER_USER_BY_NAME = 1,
+    SSS_CACHE_READER_USER_BY_ID,
+    SSS_CACHE_READER_GROUP_BY_NAME,
+    SSS_CACHE_READER_GROUP_BY_ID,
+    SSS_CACHE_READER_INITGROUPS,
+};
+
+struct sss_cache_reader_pool;
+
+/* Must be called before the responder opens the cache so that each
+ * reader gets its own handle. */
+errno_t sss_cache_reader_pool_init(TALLOC_CTX *mem_ctx,
+                                   struct resp_ctx *rctx,
+                                   int num_readers,
+                                   struct sss_cache_reader_pool **_pool);
+
+/* The search gives the same result as the sysdb_*_with_views() call for
+ * op. It fails if no reader is available, the caller is expected to
+ * search the cache on its own then. */
+struct tevent_req *
+sss_cache_reader_search_send(TALLOC_CTX *mem_ctx,
+                             struct tevent_context *ev,
+                             struct sss_cache_reader_pool *pool,
+                             struct sss_domain_info *domain,
+                             enum sss_cache_reader_op op,
+                             const char *name,
+                             uint32_t id);
+
+errno_t sss_cache_reader_search_recv(TALLOC_CTX *mem_ctx,
+                                     struct tevent_req *req,
+                                     struct ldb_result **_result);
+
 bool sss_utf8_check(const uint8_t *s, size_t n);
 
 void responder_set_fd_limit(rlim_t fd_limit);
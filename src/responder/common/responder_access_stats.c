@@ -0,0 +1,315 @@
+/*
+    SSSD
+
+    Report frequently used cache entries to the data provider
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <sys/param.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "db/sysdb.h"
+#include "providers/data_provider.h"
+#include "responder/common/responder.h"
+#include "responder/common/data_provider/rdp.h"
+
+/* Names are only counted until the table holds this many times
+ * refresh_hot_entries of them, to bound memory between two reports. */
+#define SSS_ACCESS_STATS_MAX_FACTOR 10
+
+enum sss_access_type {
+    SSS_ACCESS_USERS,
+    SSS_ACCESS_GROUPS,
+    SSS_ACCESS_NETGROUPS,
+
+    SSS_ACCESS_SENTINEL
+};
+
+static const uint32_t sss_access_entry_type[SSS_ACCESS_SENTINEL] = {
+    BE_REQ_USER,
+    BE_REQ_GROUP,
+    BE_REQ_NETGROUP
+};
+
+static const char *sss_access_type_name[SSS_ACCESS_SENTINEL] = {
+    "users",
+    "groups",
+    "netgroups"
+};
+
+struct sss_access_stats {
+    struct resp_ctx *rctx;
+    struct sss_domain_info *domain;
+    struct tevent_timer *te;
+
+    hash_table_t *counters[SSS_ACCESS_SENTINEL];
+};
+
+static void sss_access_stats_sent(struct tevent_req *req)
+{
+    errno_t ret;
+
+    ret = rdp_message_recv(req);
+    talloc_free(req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to send refresh hints "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+}
+
+static int sss_access_stats_cmp(const void *a, const void *b)
+{
+    const hash_entry_t *ea = a;
+    const hash_entry_t *eb = b;
+
+    /* most used first */
+    if (ea->value.ul > eb->value.ul) {
+        return -1;
+    } else if (ea->value.ul < eb->value.ul) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static errno_t sss_access_stats_send(struct sss_access_stats *stats,
+                                     enum sss_access_type type)
+{
+    hash_table_t *table;
+    hash_entry_t *entries = NULL;
+    unsigned long count;
+    const char **names;
+    struct tevent_req *req;
+    uint32_t entry_type;
+    size_t num_names;
+    size_t i;
+    errno_t ret;
+    int hret;
+
+    table = stats->counters[type];
+    if (table == NULL) {
+        return EOK;
+    }
+
+    /* start counting again */
+    stats->counters[type] = NULL;
+
+    hret = hash_entries(table, &count, &entries);
+    if (hret != HASH_SUCCESS) {
+        ret = EIO;
+        goto done;
+    }
+
+    qsort(entries, count, sizeof(hash_entry_t), sss_access_stats_cmp);
+
+    num_names = MIN(count, stats->domain->refresh_hot_entries);
+    names = talloc_array(table, const char *, num_names);
+    if (names == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_names; i++) {
+        names[i] = entries[i].key.str;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Reporting %zu of %lu used %s in domain %s\n",
+          num_names, count, sss_access_type_name[type], stats->domain->name);
+
+    entry_type = sss_access_entry_type[type];
+    req = rdp_message_send(stats, stats->rctx, stats->domain, DP_PATH,
+                           IFACE_DP, IFACE_DP_REFRESHHINT,
+                           DBUS_TYPE_UINT32, &entry_type,
+                           DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+                           &names, num_names);
+    if (req == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(req, sss_access_stats_sent, NULL);
+
+    ret = EOK;
+
+done:
+    talloc_free(table);
+    return ret;
+}
+
+static errno_t sss_access_stats_schedule(struct sss_access_stats *stats);
+
+static void sss_access_stats_report(struct tevent_context *ev,
+                                    struct tevent_timer *te,
+                                    struct timeval tv,
+                                    void *pvt)
+{
+    struct sss_access_stats *stats;
+    enum sss_access_type type;
+    errno_t ret;
+
+    stats = talloc_get_type(pvt, struct sss_access_stats);
+    stats->te = NULL;
+
+    for (type = 0; type < SSS_ACCESS_SENTINEL; type++) {
+        ret = sss_access_stats_send(stats, type);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to report used entries "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+        }
+    }
+
+    ret = sss_access_stats_schedule(stats);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to schedule next report "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+}
+
+static errno_t sss_access_stats_schedule(struct sss_access_stats *stats)
+{
+    struct timeval tv;
+    uint32_t interval;
+
+    /* Report twice per refresh period so the hints are there when the
+     * next refresh starts. */
+    interval = MAX(stats->domain->refresh_expired_interval / 2, 1);
+    tv = tevent_timeval_current_ofs(interval, 0);
+
+    stats->te = tevent_add_timer(stats->rctx->ev, stats, tv,
+                                 sss_access_stats_report, stats);
+    if (stats->te == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static struct sss_access_stats *
+sss_access_stats_get(struct resp_ctx *rctx,
+                     struct sss_domain_info *domain)
+{
+    struct sss_access_stats *stats;
+    struct be_conn *be_conn;
+    errno_t ret;
+
+    ret = sss_dp_get_domain_conn(rctx, domain->conn_name, &be_conn);
+    if (ret != EOK) {
+        return NULL;
+    }
+
+    if (be_conn->access_stats != NULL) {
+        return be_conn->access_stats;
+    }
+
+    stats = talloc_zero(be_conn, struct sss_access_stats);
+    if (stats == NULL) {
+        return NULL;
+    }
+
+    stats->rctx = rctx;
+    stats->domain = domain;
+
+    ret = sss_access_stats_schedule(stats);
+    if (ret != EOK) {
+        talloc_free(stats);
+        return NULL;
+    }
+
+    be_conn->access_stats = stats;
+    return stats;
+}
+
+void sss_access_stats_record(struct resp_ctx *rctx,
+                             struct sss_domain_info *domain,
+                             enum sss_dp_acct_type dp_type,
+                             struct ldb_message *msg)
+{
+    struct sss_access_stats *stats;
+    struct sss_domain_info *dom;
+    enum sss_access_type type;
+    hash_key_t key;
+    hash_value_t value;
+    const char *name;
+    errno_t ret;
+    int hret;
+
+    /* The options are read for the domain the back end serves. */
+    dom = IS_SUBDOMAIN(domain) ? domain->parent : domain;
+    if (dom->refresh_hot_entries == 0 || dom->refresh_expired_interval == 0) {
+        return;
+    }
+
+    switch (dp_type) {
+    case SSS_DP_USER:
+    case SSS_DP_INITGROUPS:
+        type = SSS_ACCESS_USERS;
+        break;
+    case SSS_DP_GROUP:
+        type = SSS_ACCESS_GROUPS;
+        break;
+    case SSS_DP_NETGR:
+        type = SSS_ACCESS_NETGROUPS;
+        break;
+    default:
+        return;
+    }
+
+    name = ldb_msg_find_attr_as_string(msg, SYSDB_NAME, NULL);
+    if (name == NULL) {
+        return;
+    }
+
+    stats = sss_access_stats_get(rctx, dom);
+    if (stats == NULL) {
+        return;
+    }
+
+    if (stats->counters[type] == NULL) {
+        ret = sss_hash_create(stats, dom->refresh_hot_entries,
+                              &stats->counters[type]);
+        if (ret != EOK) {
+            return;
+        }
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+
+    hret = hash_lookup(stats->counters[type], &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        if (hash_count(stats->counters[type])
+                >= SSS_ACCESS_STATS_MAX_FACTOR * dom->refresh_hot_entries) {
+            return;
+        }
+
+        value.type = HASH_VALUE_ULONG;
+        value.ul = 0;
+    } else if (hret != HASH_SUCCESS) {
+        return;
+    }
+
+    value.ul++;
+
+    hret = hash_enter(stats->counters[type], &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to count access to [%s]: %s\n",
+              name, hash_error_string(hret));
+    }
+}
@@ -0,0 +1,1041 @@
+/*
+    SSSD
+
+    Search the cache in helper processes of the responder
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <string.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "util/atomic_io.h"
+#include "db/sysdb.h"
+#include "responder/common/responder.h"
+
+/* Readers are separate processes rather than threads because neither
+ * talloc nor the tdb handles that ldb shares within a process may be used
+ * from several threads. Each reader opens the cache on its own and runs
+ * one search at a time in a blocking loop.
+ *
+ * Both directions use the same framing: a uint32_t length followed by
+ * the body. A request body is
+ *
+ *   uint32_t op, uint32_t id, uint32_t has_views,
+ *   domain name, name, view name (all NUL terminated)
+ *
+ * and a reply body is
+ *
+ *   uint32_t error, uint32_t count, LDIF of count messages (NUL terminated)
+ *
+ * A reader that dies or does not reply in time is not started again. The
+ * responder has the cache open by then and a forked process would share
+ * its tdb handles. The searches are run by the responder itself once all
+ * readers are gone.
+ */
+
+/* A search result of a user with thousands of groups is large, but
+ * anything bigger than this is a broken reader. */
+#define SSS_CACHE_READER_MAX_PACKET (64 * 1024 * 1024)
+
+/* Seconds a search may wait for a reply, including the time spent in the
+ * queue. The caller searches the cache on its own afterwards. */
+#define SSS_CACHE_READER_TIMEOUT 5
+
+struct sss_cache_reader_state;
+
+struct sss_cache_reader {
+    struct sss_cache_reader_pool *pool;
+    pid_t pid;
+    int fd;
+    struct tevent_fd *fde;
+
+    /* the request being processed, NULL if the reader is idle or the
+     * caller is not interested in the reply anymore */
+    bool busy;
+    struct sss_cache_reader_state *state;
+
+    uint8_t len_buf[sizeof(uint32_t)];
+    uint32_t reply_len;
+    uint8_t *reply;
+    size_t received;
+};
+
+struct sss_cache_reader_pool {
+    struct tevent_context *ev;
+    struct resp_ctx *rctx;
+    struct sss_cache_reader **readers;
+    size_t num_readers;
+    size_t num_alive;
+    size_t num_lost;
+    int timeout;
+
+    /* requests waiting for an idle reader */
+    struct sss_cache_reader_state *queue;
+};
+
+/* ==Reader process========================================================= */
+
+static errno_t sss_cache_reader_read_request(TALLOC_CTX *mem_ctx,
+                                             int fd,
+                                             uint8_t **_body,
+                                             size_t *_len)
+{
+    uint8_t len_buf[sizeof(uint32_t)];
+    uint32_t len;
+    uint8_t *body;
+    ssize_t ret;
+
+    ret = sss_atomic_read_s(fd, len_buf, sizeof(len_buf));
+    if (ret == 0) {
+        /* the responder went away */
+        return ENOTCONN;
+    } else if (ret != sizeof(len_buf)) {
+        return EIO;
+    }
+
+    SAFEALIGN_COPY_UINT32(&len, len_buf, NULL);
+    if (len == 0 || len > SSS_CACHE_READER_MAX_PACKET) {
+        return EBADMSG;
+    }
+
+    body = talloc_size(mem_ctx, len);
+    if (body == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_atomic_read_s(fd, body, len);
+    if (ret != len) {
+        talloc_free(body);
+        return EIO;
+    }
+
+    *_body = body;
+    *_len = len;
+
+    return EOK;
+}
+
+static const char *sss_cache_reader_get_string(uint8_t *body,
+                                               size_t len,
+                                               size_t *_pos)
+{
+    const char *str;
+    size_t str_len;
+
+    if (*_pos >= len) {
+        return NULL;
+    }
+
+    str = (const char *)body + *_pos;
+    str_len = strnlen(str, len - *_pos);
+    if (str_len == len - *_pos) {
+        /* not terminated */
+        return NULL;
+    }
+
+    *_pos += str_len + 1;
+
+    return str;
+}
+
+static struct sss_domain_info *
+sss_cache_reader_get_domain(struct sss_domain_info *domains,
+                            const char *name)
+{
+    struct sss_domain_info *dom;
+    errno_t ret;
+
+    dom = find_domain_by_name(domains, name, false);
+    if (dom != NULL) {
+        return dom;
+    }
+
+    /* The responder learned about a new subdomain, read them again. */
+    for (dom = domains; dom != NULL; dom = get_next_domain(dom, 0)) {
+        ret = sysdb_update_subdomains(dom);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Unable to update subdomains of [%s] [%d]: %s\n",
+                  dom->name, ret, sss_strerror(ret));
+        }
+    }
+
+    return find_domain_by_name(domains, name, false);
+}
+
+static errno_t sss_cache_reader_search(TALLOC_CTX *mem_ctx,
+                                       struct sss_domain_info *domains,
+                                       uint8_t *body,
+                                       size_t len,
+                                       struct sss_domain_info **_domain,
+                                       struct ldb_result **_result)
+{
+    struct sss_domain_info *domain;
+    struct ldb_result *result = NULL;
+    const char *domain_name;
+    const char *name;
+    const char *view_name;
+    uint32_t op;
+    uint32_t id;
+    uint32_t has_views;
+    size_t pos = 0;
+    errno_t ret;
+
+    if (len < 3 * sizeof(uint32_t)) {
+        return EBADMSG;
+    }
+
+    SAFEALIGN_COPY_UINT32(&op, body + pos, &pos);
+    SAFEALIGN_COPY_UINT32(&id, body + pos, &pos);
+    SAFEALIGN_COPY_UINT32(&has_views, body + pos, &pos);
+
+    domain_name = sss_cache_reader_get_string(body, len, &pos);
+    name = sss_cache_reader_get_string(body, len, &pos);
+    view_name = sss_cache_reader_get_string(body, len, &pos);
+    if (domain_name == NULL || name == NULL || view_name == NULL) {
+        return EBADMSG;
+    }
+
+    domain = sss_cache_reader_get_domain(domains, domain_name);
+    if (domain == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unknown domain [%s]\n", domain_name);
+        return ERR_DOMAIN_NOT_FOUND;
+    }
+
+    /* Views are applied the same way as in the responder. */
+    domain->has_views = has_views ? true : false;
+    if (*view_name == '\0') {
+        talloc_zfree(domain->view_name);
+    } else if (domain->view_name == NULL
+                   || strcmp(domain->view_name, view_name) != 0) {
+        talloc_zfree(domain->view_name);
+        domain->view_name = talloc_strdup(domain, view_name);
+        if (domain->view_name == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    switch (op) {
+    case SSS_CACHE_READER_USER_BY_NAME:
+        ret = sysdb_getpwnam_with_views(mem_ctx, domain, name, &result);
+        break;
+    case SSS_CACHE_READER_USER_BY_ID:
+        ret = sysdb_getpwuid_with_views(mem_ctx, domain, id, &result);
+        break;
+    case SSS_CACHE_READER_GROUP_BY_NAME:
+        ret = sysdb_getgrnam_with_views(mem_ctx, domain, name, &result);
+        break;
+    case SSS_CACHE_READER_GROUP_BY_ID:
+        ret = sysdb_getgrgid_with_views(mem_ctx, domain, id, &result);
+        break;
+    case SSS_CACHE_READER_INITGROUPS:
+        ret = sysdb_initgroups_with_views(mem_ctx, domain, name, &result);
+        break;
+    default:
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unknown operation [%u]\n", op);
+        return EINVAL;
+    }
+
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_domain = domain;
+    *_result = result;
+
+    return EOK;
+}
+
+static errno_t sss_cache_reader_build_reply(TALLOC_CTX *mem_ctx,
+                                            errno_t error,
+                                            struct sss_domain_info *domain,
+                                            struct ldb_result *result,
+                                            uint8_t **_reply,
+                                            size_t *_len)
+{
+    struct ldb_context *ldb;
+    struct ldb_ldif ldif;
+    unsigned int count = 0;
+    unsigned int i;
+    char *text;
+    char *msg_text;
+    uint8_t *reply;
+    size_t text_len;
+    size_t len;
+    size_t pos = 0;
+
+    text = talloc_strdup(mem_ctx, "");
+    if (text == NULL) {
+        return ENOMEM;
+    }
+
+    if (error == EOK && result != NULL) {
+        ldb = sysdb_ctx_get_ldb(domain->sysdb);
+        count = result->count;
+
+        for (i = 0; i < count; i++) {
+            ldif.changetype = LDB_CHANGETYPE_NONE;
+            ldif.msg = result->msgs[i];
+
+            msg_text = ldb_ldif_write_string(ldb, text, &ldif);
+            if (msg_text == NULL) {
+                return ENOMEM;
+            }
+
+            text = talloc_strdup_append_buffer(text, msg_text);
+            if (text == NULL) {
+                return ENOMEM;
+            }
+        }
+    }
+
+    text_len = strlen(text) + 1;
+    len = 2 * sizeof(uint32_t) + text_len;
+    if (len > SSS_CACHE_READER_MAX_PACKET) {
+        return E2BIG;
+    }
+
+    reply = talloc_size(mem_ctx, sizeof(uint32_t) + len);
+    if (reply == NULL) {
+        return ENOMEM;
+    }
+
+    SAFEALIGN_SET_UINT32(reply + pos, len, &pos);
+    SAFEALIGN_SET_UINT32(reply + pos, error, &pos);
+    SAFEALIGN_SET_UINT32(reply + pos, count, &pos);
+    memcpy(reply + pos, text, text_len);
+
+    *_reply = reply;
+    *_len = sizeof(uint32_t) + len;
+
+    return EOK;
+}
+
+static void sss_cache_reader_main(struct sss_domain_info *domains, int fd)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_domain_info *domain = NULL;
+    struct ldb_result *result = NULL;
+    uint8_t *body;
+    uint8_t *reply;
+    size_t len;
+    ssize_t written;
+    errno_t error;
+    errno_t ret;
+
+    ret = sysdb_init(NULL, domains);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to open the cache [%d]: %s\n",
+              ret, sss_strerror(ret));
+        _exit(1);
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Cache reader is ready\n");
+
+    while (1) {
+        tmp_ctx = talloc_new(NULL);
+        if (tmp_ctx == NULL) {
+            _exit(1);
+        }
+
+        ret = sss_cache_reader_read_request(tmp_ctx, fd, &body, &len);
+        if (ret == ENOTCONN) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Responder has gone, exiting\n");
+            _exit(0);
+        } else if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to read request [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            _exit(1);
+        }
+
+        error = sss_cache_reader_search(tmp_ctx, domains, body, len,
+                                        &domain, &result);
+        if (error != EOK) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Search failed [%d]: %s\n",
+                  error, sss_strerror(error));
+        }
+
+        ret = sss_cache_reader_build_reply(tmp_ctx, error, domain, result,
+                                           &reply, &len);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to create reply [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            /* the responder will search on its own */
+            ret = sss_cache_reader_build_reply(tmp_ctx, ret, NULL, NULL,
+                                               &reply, &len);
+            if (ret != EOK) {
+                _exit(1);
+            }
+        }
+
+        written = sss_atomic_write_s(fd, reply, len);
+        if (written != len) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to send reply\n");
+            _exit(1);
+        }
+
+        talloc_free(tmp_ctx);
+        domain = NULL;
+        result = NULL;
+    }
+}
+
+/* ==Responder side========================================================= */
+
+struct sss_cache_reader_state {
+    struct sss_cache_reader_state *prev;
+    struct sss_cache_reader_state *next;
+
+    struct tevent_req *req;
+    struct sss_cache_reader_pool *pool;
+    struct sss_cache_reader *reader;
+    bool queued;
+    struct tevent_timer *timeout_te;
+
+    struct ldb_context *ldb;
+    uint8_t *packet;
+    size_t packet_len;
+
+    struct ldb_result *result;
+};
+
+static void sss_cache_reader_dispatch(struct sss_cache_reader_pool *pool);
+
+static void sss_cache_reader_stop(struct sss_cache_reader *reader,
+                                  errno_t error)
+{
+    struct sss_cache_reader_pool *pool = reader->pool;
+    struct sss_cache_reader_state *state;
+    pid_t pid;
+    int status;
+
+    if (reader->fd == -1) {
+        return;
+    }
+
+    talloc_zfree(reader->fde);
+    close(reader->fd);
+    reader->fd = -1;
+
+    pid = waitpid(reader->pid, &status, WNOHANG);
+    if (pid == reader->pid) {
+        if (WIFEXITED(status)) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cache reader [%d] exited with "
+                  "status [%d]\n", reader->pid, WEXITSTATUS(status));
+        } else if (WIFSIGNALED(status)) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cache reader [%d] was terminated by "
+                  "signal [%d]\n", reader->pid, WTERMSIG(status));
+        }
+    } else {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Stopping cache reader [%d]\n",
+              reader->pid);
+        kill(reader->pid, SIGKILL);
+        waitpid(reader->pid, NULL, 0);
+    }
+
+    talloc_zfree(reader->reply);
+    reader->received = 0;
+    reader->busy = false;
+    pool->num_alive--;
+    pool->num_lost++;
+
+    if (pool->num_alive == 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "All %zu cache readers are gone, the "
+              "cache will be searched by the responder only\n",
+              pool->num_lost);
+    } else {
+        DEBUG(SSSDBG_OP_FAILURE, "%zu of %zu cache readers are gone\n",
+              pool->num_lost, pool->num_readers);
+    }
+
+    state = reader->state;
+    reader->state = NULL;
+    if (state != NULL) {
+        state->reader = NULL;
+        tevent_req_error(state->req, error);
+    }
+}
+
+static errno_t sss_cache_reader_read_reply(struct sss_cache_reader *reader)
+{
+    uint8_t *dest;
+    size_t want;
+    ssize_t len;
+
+    if (reader->received < sizeof(uint32_t)) {
+        dest = reader->len_buf + reader->received;
+        want = sizeof(uint32_t) - reader->received;
+    } else {
+        dest = reader->reply + (reader->received - sizeof(uint32_t));
+        want = reader->reply_len - (reader->received - sizeof(uint32_t));
+    }
+
+    len = read(reader->fd, dest, want);
+    if (len == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return EAGAIN;
+        }
+        return errno;
+    } else if (len == 0) {
+        return EPIPE;
+    }
+
+    reader->received += len;
+    if (reader->received < sizeof(uint32_t)) {
+        return EAGAIN;
+    }
+
+    if (reader->received == sizeof(uint32_t)) {
+        SAFEALIGN_COPY_UINT32(&reader->reply_len, reader->len_buf, NULL);
+        if (reader->reply_len < 2 * sizeof(uint32_t)
+                || reader->reply_len > SSS_CACHE_READER_MAX_PACKET) {
+            return EBADMSG;
+        }
+
+        reader->reply = talloc_size(reader, reader->reply_len);
+        if (reader->reply == NULL) {
+            return ENOMEM;
+        }
+
+        return EAGAIN;
+    }
+
+    if (reader->received < sizeof(uint32_t) + reader->reply_len) {
+        return EAGAIN;
+    }
+
+    return EOK;
+}
+
+static errno_t sss_cache_reader_parse_reply(TALLOC_CTX *mem_ctx,
+                                            struct ldb_context *ldb,
+                                            uint8_t *reply,
+                                            size_t len,
+                                            struct ldb_result **_result)
+{
+    struct ldb_result *result;
+    struct ldb_ldif *ldif;
+    const char *text;
+    uint32_t error;
+    uint32_t count;
+    uint32_t i;
+    size_t pos = 0;
+    errno_t ret;
+
+    if (len < 2 * sizeof(uint32_t) + 1 || reply[len - 1] != '\0') {
+        return EBADMSG;
+    }
+
+    SAFEALIGN_COPY_UINT32(&error, reply + pos, &pos);
+    SAFEALIGN_COPY_UINT32(&count, reply + pos, &pos);
+    if (error != EOK) {
+        return error;
+    }
+
+    if (count > len) {
+        return EBADMSG;
+    }
+
+    result = talloc_zero(mem_ctx, struct ldb_result);
+    if (result == NULL) {
+        return ENOMEM;
+    }
+
+    result->msgs = talloc_zero_array(result, struct ldb_message *, count + 1);
+    if (result->msgs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    text = (const char *)reply + pos;
+    for (i = 0; i < count; i++) {
+        ldif = ldb_ldif_read_string(ldb, &text);
+        if (ldif == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Malformed reply from cache reader\n");
+            ret = EBADMSG;
+            goto done;
+        }
+
+        result->msgs[i] = talloc_steal(result->msgs, ldif->msg);
+        talloc_free(ldif);
+    }
+    result->count = count;
+
+    *_result = result;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(result);
+    }
+
+    return ret;
+}
+
+static void sss_cache_reader_done(struct sss_cache_reader *reader)
+{
+    struct sss_cache_reader_state *state;
+    uint8_t *reply;
+    errno_t ret;
+
+    state = reader->state;
+    reply = reader->reply;
+
+    reader->state = NULL;
+    reader->busy = false;
+    reader->reply = NULL;
+    reader->received = 0;
+
+    if (state == NULL) {
+        /* nobody waits for this reply anymore */
+        talloc_free(reply);
+        return;
+    }
+
+    state->reader = NULL;
+
+    ret = sss_cache_reader_parse_reply(state, state->ldb, reply,
+                                       reader->reply_len, &state->result);
+    talloc_free(reply);
+    if (ret != EOK) {
+        tevent_req_error(state->req, ret);
+        return;
+    }
+
+    tevent_req_done(state->req);
+}
+
+static void sss_cache_reader_handler(struct tevent_context *ev,
+                                     struct tevent_fd *fde,
+                                     uint16_t flags,
+                                     void *pvt)
+{
+    struct sss_cache_reader *reader;
+    struct sss_cache_reader_pool *pool;
+    errno_t ret;
+
+    reader = talloc_get_type(pvt, struct sss_cache_reader);
+    pool = reader->pool;
+
+    ret = sss_cache_reader_read_reply(reader);
+    if (ret == EAGAIN) {
+        return;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read from cache reader [%d]: %s\n",
+              ret, sss_strerror(ret));
+        sss_cache_reader_stop(reader, EIO);
+    } else {
+        sss_cache_reader_done(reader);
+    }
+
+    sss_cache_reader_dispatch(pool);
+}
+
+static void sss_cache_reader_dispatch(struct sss_cache_reader_pool *pool)
+{
+    struct sss_cache_reader_state *state;
+    struct sss_cache_reader *reader;
+    ssize_t len;
+    size_t i;
+
+    for (i = 0; i < pool->num_readers && pool->queue != NULL; i++) {
+        reader = pool->readers[i];
+        if (reader->fd == -1 || reader->busy) {
+            continue;
+        }
+
+        state = pool->queue;
+        DLIST_REMOVE(pool->queue, state);
+        state->queued = false;
+
+        /* The reader is idle and the request is small, this does not
+         * block in practice. */
+        len = sss_atomic_write_s(reader->fd, state->packet,
+                                 state->packet_len);
+        if (len != state->packet_len) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to send request to cache "
+                  "reader [%d]\n", reader->pid);
+            DLIST_ADD(pool->queue, state);
+            state->queued = true;
+            sss_cache_reader_stop(reader, EIO);
+            continue;
+        }
+
+        reader->busy = true;
+        reader->state = state;
+        state->reader = reader;
+    }
+
+    if (pool->num_alive > 0) {
+        return;
+    }
+
+    /* All readers are gone, the callers will search on their own. */
+    while ((state = pool->queue) != NULL) {
+        DLIST_REMOVE(pool->queue, state);
+        state->queued = false;
+        tevent_req_error(state->req, EIO);
+    }
+}
+
+static void sss_cache_reader_timeout(struct tevent_context *ev,
+                                     struct tevent_timer *te,
+                                     struct timeval tv,
+                                     void *pvt)
+{
+    struct sss_cache_reader_state *state;
+    struct sss_cache_reader_pool *pool;
+
+    state = talloc_get_type(pvt, struct sss_cache_reader_state);
+    pool = state->pool;
+    state->timeout_te = NULL;
+
+    if (!tevent_req_is_in_progress(state->req)) {
+        return;
+    }
+
+    if (state->queued) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "No cache reader became available\n");
+        DLIST_REMOVE(pool->queue, state);
+        state->queued = false;
+        tevent_req_error(state->req, ETIMEDOUT);
+        return;
+    }
+
+    if (state->reader != NULL) {
+        /* The reader is stuck, its reply could not be told apart from the
+         * reply to the next request anymore. */
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cache reader [%d] did not reply in "
+              "time\n", state->reader->pid);
+        sss_cache_reader_stop(state->reader, ETIMEDOUT);
+        sss_cache_reader_dispatch(pool);
+    }
+}
+
+static int sss_cache_reader_state_destructor(struct sss_cache_reader_state *state)
+{
+    if (state->queued) {
+        DLIST_REMOVE(state->pool->queue, state);
+    }
+
+    if (state->reader != NULL) {
+        /* The reply will be read and dropped. */
+        state->reader->state = NULL;
+    }
+
+    return 0;
+}
+
+static errno_t sss_cache_reader_build_request(TALLOC_CTX *mem_ctx,
+                                              struct sss_domain_info *domain,
+                                              enum sss_cache_reader_op op,
+                                              const char *name,
+                                              uint32_t id,
+                                              uint8_t **_packet,
+                                              size_t *_len)
+{
+    const char *view_name;
+    size_t domain_len;
+    size_t name_len;
+    size_t view_len;
+    uint8_t *packet;
+    size_t len;
+    size_t pos = 0;
+
+    name = name == NULL ? "" : name;
+    view_name = domain->view_name == NULL ? "" : domain->view_name;
+
+    domain_len = strlen(domain->name) + 1;
+    name_len = strlen(name) + 1;
+    view_len = strlen(view_name) + 1;
+
+    len = 3 * sizeof(uint32_t) + domain_len + name_len + view_len;
+    if (len > SSS_CACHE_READER_MAX_PACKET) {
+        return E2BIG;
+    }
+
+    packet = talloc_size(mem_ctx, sizeof(uint32_t) + len);
+    if (packet == NULL) {
+        return ENOMEM;
+    }
+
+    SAFEALIGN_SET_UINT32(packet + pos, len, &pos);
+    SAFEALIGN_SET_UINT32(packet + pos, op, &pos);
+    SAFEALIGN_SET_UINT32(packet + pos, id, &pos);
+    SAFEALIGN_SET_UINT32(packet + pos, domain->has_views ? 1 : 0, &pos);
+    memcpy(packet + pos, domain->name, domain_len);
+    pos += domain_len;
+    memcpy(packet + pos, name, name_len);
+    pos += name_len;
+    memcpy(packet + pos, view_name, view_len);
+
+    *_packet = packet;
+    *_len = sizeof(uint32_t) + len;
+
+    return EOK;
+}
+
+struct tevent_req *
+sss_cache_reader_search_send(TALLOC_CTX *mem_ctx,
+                             struct tevent_context *ev,
+                             struct sss_cache_reader_pool *pool,
+                             struct sss_domain_info *domain,
+                             enum sss_cache_reader_op op,
+                             const char *name,
+                             uint32_t id)
+{
+    struct sss_cache_reader_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sss_cache_reader_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    /* Requests are finished from the reader fd handler which may go on
+     * with the next request in the queue. */
+    tevent_req_defer_callback(req, ev);
+
+    state->req = req;
+    state->pool = pool;
+    state->ldb = sysdb_ctx_get_ldb(domain->sysdb);
+
+    if (pool->num_alive == 0) {
+        ret = EIO;
+        goto immediately;
+    }
+
+    ret = sss_cache_reader_build_request(state, domain, op, name, id,
+                                         &state->packet, &state->packet_len);
+    if (ret != EOK) {
+        goto immediately;
+    }
+
+    talloc_set_destructor(state, sss_cache_reader_state_destructor);
+
+    state->timeout_te = tevent_add_timer(ev, state,
+                                         tevent_timeval_current_ofs(
+                                                         pool->timeout, 0),
+                                         sss_cache_reader_timeout, state);
+    if (state->timeout_te == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    DLIST_ADD_END(pool->queue, state, struct sss_cache_reader_state *);
+    state->queued = true;
+
+    sss_cache_reader_dispatch(pool);
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+
+    return req;
+}
+
+errno_t sss_cache_reader_search_recv(TALLOC_CTX *mem_ctx,
+                                     struct tevent_req *req,
+                                     struct ldb_result **_result)
+{
+    struct sss_cache_reader_state *state;
+    state = tevent_req_data(req, struct sss_cache_reader_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_result = talloc_steal(mem_ctx, state->result);
+
+    return EOK;
+}
+
+static int sss_cache_reader_destructor(struct sss_cache_reader *reader)
+{
+    /* Closing the socket makes the reader exit. */
+    talloc_zfree(reader->fde);
+    if (reader->fd != -1) {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+
+    return 0;
+}
+
+static errno_t sss_cache_reader_attach(struct sss_cache_reader_pool *pool,
+                                       struct sss_cache_reader *reader,
+                                       pid_t pid,
+                                       int fd)
+{
+    errno_t ret;
+
+    reader->pool = pool;
+    reader->pid = pid;
+    reader->fd = fd;
+    talloc_set_destructor(reader, sss_cache_reader_destructor);
+
+    ret = sss_fd_nonblocking(reader->fd);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    reader->fde = tevent_add_fd(pool->ev, reader, reader->fd, TEVENT_FD_READ,
+                                sss_cache_reader_handler, reader);
+    if (reader->fde == NULL) {
+        return ENOMEM;
+    }
+
+    pool->num_alive++;
+
+    return EOK;
+}
+
+static errno_t sss_cache_reader_start(struct sss_cache_reader_pool *pool,
+                                      struct sss_domain_info *domains,
+                                      struct sss_cache_reader *reader)
+{
+    int sv[2];
+    pid_t pid;
+    size_t i;
+    errno_t ret;
+
+    ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv);
+    if (ret != 0) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "socketpair failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    sss_debug_prepare_fork();
+    pid = fork();
+    if (pid == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "fork failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        close(sv[0]);
+        close(sv[1]);
+        return ret;
+    }
+
+    if (pid == 0) {
+        /* reader */
+        close(sv[0]);
+        for (i = 0; i < pool->num_readers; i++) {
+            if (pool->readers[i] != NULL && pool->readers[i]->fd != -1) {
+                close(pool->readers[i]->fd);
+            }
+        }
+
+        /* the reader must not keep the responder sockets open, nor accept
+         * clients on them */
+        if (pool->rctx->lfd != -1) {
+            close(pool->rctx->lfd);
+        }
+        if (pool->rctx->priv_lfd != -1) {
+            close(pool->rctx->priv_lfd);
+        }
+
+        /* signal handlers of the responder are useless here */
+        CatchSignal(SIGTERM, SIG_DFL);
+        CatchSignal(SIGINT, SIG_DFL);
+        CatchSignal(SIGHUP, SIG_DFL);
+
+        debug_prg_name = talloc_asprintf(NULL, "%s[reader]", debug_prg_name);
+        if (debug_prg_name == NULL) {
+            _exit(1);
+        }
+
+        sss_cache_reader_main(domains, sv[1]);
+        _exit(0);
+    }
+
+    close(sv[1]);
+
+    ret = sss_cache_reader_attach(pool, reader, pid, sv[0]);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Started cache reader [%d]\n", pid);
+
+    return EOK;
+}
+
+errno_t sss_cache_reader_pool_init(TALLOC_CTX *mem_ctx,
+                                   struct resp_ctx *rctx,
+                                   int num_readers,
+                                   struct sss_cache_reader_pool **_pool)
+{
+    struct sss_cache_reader_pool *pool;
+    struct sss_cache_reader *reader;
+    int i;
+    errno_t ret;
+
+    if (num_readers <= 0) {
+        return EINVAL;
+    }
+
+    pool = talloc_zero(mem_ctx, struct sss_cache_reader_pool);
+    if (pool == NULL) {
+        return ENOMEM;
+    }
+
+    pool->ev = rctx->ev;
+    pool->rctx = rctx;
+    pool->timeout = SSS_CACHE_READER_TIMEOUT;
+    pool->readers = talloc_zero_array(pool, struct sss_cache_reader *,
+                                      num_readers);
+    if (pool->readers == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_readers; i++) {
+        reader = talloc_zero(pool->readers, struct sss_cache_reader);
+        if (reader == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        reader->fd = -1;
+        pool->readers[i] = reader;
+        pool->num_readers++;
+
+        ret = sss_cache_reader_start(pool, rctx->domains, reader);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to start cache reader\n");
+            goto done;
+        }
+    }
+
+    *_pool = pool;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(pool);
+    }
+
+    return ret;
+}
@@ -24,6 +24,7 @@
 #include <tevent.h>
 
 #include "util/util.h"
+#include "util/probes.h"
 #include "db/sysdb.h"
 #include "responder/common/responder_cache_req.h"
 #include "providers/data_provider.h"
@@ -248,6 +249,7 @@ struct cache_req {
 
     /* Debug information */
     uint32_t reqid;
+    uint64_t trace_id;
     const char *reqname;
     const char *debugobj;
 
@@ -354,6 +356,7 @@ cache_req_create(TALLOC_CTX *mem_ctx,
 
     /* It is perfectly fine to just overflow here. */
     cr->reqid = rctx->cache_req_num++;
+    cr->trace_id = sss_trace_id;
 
     cache_req_set_reqname(cr, data->type);
     cache_req_set_dp(cr, data->type);
@@ -361,6 +364,42 @@ cache_req_create(TALLOC_CTX *mem_ctx,
     return cr;
 }
 
+/* Create an independent copy of the request so it can be used to search
+ * a different domain at the same time. */
+static struct cache_req *
+cache_req_copy(TALLOC_CTX *mem_ctx,
+               struct cache_req *cr)
+{
+    struct cache_req *copy;
+
+    copy = talloc_zero(mem_ctx, struct cache_req);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    copy->data = cache_req_data_create(copy, cr->data->type, cr->data);
+    if (copy->data == NULL) {
+        talloc_free(copy);
+        return NULL;
+    }
+
+    if (cr->data->name.name != NULL) {
+        copy->data->name.name = talloc_strdup(copy->data, cr->data->name.name);
+        if (copy->data->name.name == NULL) {
+            talloc_free(copy);
+            return NULL;
+        }
+    }
+
+    copy->dp_type = cr->dp_type;
+    copy->reqid = cr->reqid;
+    copy->trace_id = cr->trace_id;
+    copy->reqname = cr->reqname;
+    copy->req_start = cr->req_start;
+
+    return copy;
+}
+
 static errno_t
 cache_req_set_name(struct cache_req *cr, const char *name)
 {
@@ -974,20 +1013,29 @@ struct cache_req_cache_state {
     struct sss_nc_ctx *ncache;
     int cache_refresh_percent;
     struct cache_req *cr;
+    bool cache_only;
 
     /* output data */
     struct ldb_result *result;
+    bool dp_needed;
+    bool midpoint;
 };
 
 static errno_t cache_req_cache_search(struct tevent_req *req);
+static errno_t cache_req_cache_search_result(struct tevent_req *req,
+                                             errno_t ret);
+static void cache_req_cache_search_done(struct tevent_req *subreq);
 static errno_t cache_req_cache_check(struct tevent_req *req);
 static void cache_req_cache_done(struct tevent_req *subreq);
 
+/* If cache_only is true, the data provider is never contacted. The caller
+ * learns from cache_req_cache_only_recv() whether it would have been. */
 static struct tevent_req *cache_req_cache_send(TALLOC_CTX *mem_ctx,
                                                struct tevent_context *ev,
                                                struct resp_ctx *rctx,
                                                struct sss_nc_ctx *ncache,
                                                int cache_refresh_percent,
+                                               bool cache_only,
                                                struct cache_req *cr)
 {
     struct cache_req_cache_state *state = NULL;
@@ -1004,8 +1052,12 @@ static struct tevent_req *cache_req_cache_send(TALLOC_CTX *mem_ctx,
     state->rctx = rctx;
     state->ncache = ncache;
     state->cache_refresh_percent = cache_refresh_percent;
+    state->cache_only = cache_only;
     state->cr = cr;
 
+    PROBE(CACHE_REQ_CACHE_SEND, cr->reqname, cr->reqid, cr->domain->name,
+          cr->trace_id);
+
     /* Check negative cache first. */
     ret = cache_req_check_ncache(state->cr, state->ncache);
     if (ret == EEXIST) {
@@ -1033,14 +1085,106 @@ immediately:
     return req;
 }
 
+static bool cache_req_reader_op(struct cache_req *cr,
+                                enum sss_cache_reader_op *_op)
+{
+    switch (cr->data->type) {
+    case CACHE_REQ_USER_BY_NAME:
+        *_op = SSS_CACHE_READER_USER_BY_NAME;
+        return true;
+    case CACHE_REQ_USER_BY_ID:
+        *_op = SSS_CACHE_READER_USER_BY_ID;
+        return true;
+    case CACHE_REQ_GROUP_BY_NAME:
+        *_op = SSS_CACHE_READER_GROUP_BY_NAME;
+        return true;
+    case CACHE_REQ_GROUP_BY_ID:
+        *_op = SSS_CACHE_READER_GROUP_BY_ID;
+        return true;
+    case CACHE_REQ_INITGROUPS:
+        *_op = SSS_CACHE_READER_INITGROUPS;
+        return true;
+    default:
+        return false;
+    }
+}
+
 static errno_t cache_req_cache_search(struct tevent_req *req)
 {
     struct cache_req_cache_state *state = NULL;
+    struct tevent_req *subreq = NULL;
+    enum sss_cache_reader_op op;
     errno_t ret;
 
     state = tevent_req_data(req, struct cache_req_cache_state);
 
+    /* Let a cache reader process run the search so that an expensive
+     * search does not block other clients. */
+    if (state->rctx->cache_readers != NULL
+            && cache_req_reader_op(state->cr, &op)) {
+        subreq = sss_cache_reader_search_send(state, state->ev,
+                                              state->rctx->cache_readers,
+                                              state->cr->domain, op,
+                                              state->cr->data->name.lookup,
+                                              state->cr->data->id);
+        if (subreq != NULL) {
+            tevent_req_set_callback(subreq, cache_req_cache_search_done, req);
+            return EAGAIN;
+        }
+    }
+
     ret = cache_req_get_object(state, state->cr, &state->result);
+
+    return cache_req_cache_search_result(req, ret);
+}
+
+static void cache_req_cache_search_done(struct tevent_req *subreq)
+{
+    struct cache_req_cache_state *state = NULL;
+    struct tevent_req *req = NULL;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct cache_req_cache_state);
+    sss_trace_id = state->cr->trace_id;
+
+    ret = sss_cache_reader_search_recv(state, subreq, &state->result);
+    talloc_zfree(subreq);
+    if (ret == EOK) {
+        if (state->result->count == 0) {
+            ret = ENOENT;
+        } else if (state->cr->data->type != CACHE_REQ_INITGROUPS
+                       && state->result->count > 1) {
+            CACHE_REQ_DEBUG(SSSDBG_CRIT_FAILURE, state->cr,
+                            "Multiple objects were found when "
+                            "sysdb search expected only one!\n");
+            ret = ERR_INTERNAL;
+        }
+    } else if (ret != ENOENT) {
+        CACHE_REQ_DEBUG(SSSDBG_MINOR_FAILURE, state->cr,
+                        "Cache reader failed [%d]: %s, searching the cache "
+                        "directly\n", ret, sss_strerror(ret));
+        ret = cache_req_get_object(state, state->cr, &state->result);
+    }
+
+    ret = cache_req_cache_search_result(req, ret);
+    if (ret == EAGAIN) {
+        return;
+    } else if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t cache_req_cache_search_result(struct tevent_req *req,
+                                             errno_t ret)
+{
+    struct cache_req_cache_state *state = NULL;
+
+    state = tevent_req_data(req, struct cache_req_cache_state);
+
     if (ret != EOK && ret != ENOENT) {
         CACHE_REQ_DEBUG(SSSDBG_CRIT_FAILURE, state->cr, "Failed to make "
                         "request to our cache [%d]: %s\n",
@@ -1050,7 +1194,12 @@ static errno_t cache_req_cache_search(struct tevent_req *req)
 
     /* Verify that the cache is up to date. */
     ret = cache_req_cache_check(req);
-    if (ret != EOK) {
+    if (ret != EOK && state->dp_needed) {
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
+                        "[%s] is not cached or expired\n",
+                        state->cr->debugobj);
+        return ret;
+    } else if (ret != EOK) {
         CACHE_REQ_DEBUG(SSSDBG_OP_FAILURE, state->cr,
                         "Cannot find info for [%s]\n", state->cr->debugobj);
         return ret;
@@ -1062,6 +1211,50 @@ static errno_t cache_req_cache_search(struct tevent_req *req)
     return EOK;
 }
 
+/* Called when a cached entry is returned to the client. A midpoint entry
+ * is refreshed out of band. */
+static void cache_req_cache_use(TALLOC_CTX *mem_ctx,
+                                struct resp_ctx *rctx,
+                                struct cache_req *cr,
+                                struct ldb_result *result,
+                                bool midpoint)
+{
+    struct tevent_req *subreq = NULL;
+    const char *extra_flag = NULL;
+    const char *search_str;
+    uint32_t search_id;
+
+    sss_access_stats_record(rctx, cr->domain, cr->dp_type, result->msgs[0]);
+
+    if (!midpoint) {
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
+                        "[%s] entry is valid\n", cr->debugobj);
+        return;
+    }
+
+    /* Out of band update. The calling function will return the cached
+     * entry immediately. No callback is required. */
+
+    CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
+                    "Performing midpoint cache update of [%s]\n",
+                    cr->debugobj);
+
+    cache_req_dpreq_params(mem_ctx, cr, result,
+                           &search_str, &search_id, &extra_flag);
+
+    PROBE(CACHE_REQ_DP_SEND, cr->reqname, cr->reqid,
+          cr->domain->name, 1, cr->trace_id);
+
+    subreq = sss_dp_get_account_send(mem_ctx, rctx, cr->domain, true,
+                                     cr->dp_type, search_str, search_id,
+                                     extra_flag);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory sending out-of-band "
+                                   "data provider request\n");
+        /* This is non-fatal, so we'll continue here */
+    }
+}
+
 static errno_t cache_req_cache_check(struct tevent_req *req)
 {
     struct cache_req_cache_state *state = NULL;
@@ -1073,35 +1266,23 @@ static errno_t cache_req_cache_check(struct tevent_req *req)
 
     state = tevent_req_data(req, struct cache_req_cache_state);
 
-    cache_req_dpreq_params(state, state->cr, state->result,
-                           &search_str, &search_id, &extra_flag);
-
     ret = cache_req_expiration_status(state->cr, state->result,
                                       state->cache_refresh_percent);
 
+    if (state->cache_only && (ret == EOK || ret == EAGAIN)) {
+        /* the caller decides whether the entry is used */
+        state->midpoint = (ret == EAGAIN);
+        return EOK;
+    } else if (state->cache_only && ret == ENOENT) {
+        state->dp_needed = true;
+        return ENOENT;
+    }
+
     switch (ret) {
     case EOK:
-        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
-                        "[%s] entry is valid\n", state->cr->debugobj);
-        return EOK;
     case EAGAIN:
-        /* Out of band update. The calling function will return the cached
-         * entry immediately. No callback is required. */
-
-        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
-                        "Performing midpoint cache update of [%s]\n",
-                        state->cr->debugobj);
-
-        subreq = sss_dp_get_account_send(state, state->rctx,
-                                         state->cr->domain, true,
-                                         state->cr->dp_type,
-                                         search_str, search_id, extra_flag);
-        if (subreq == NULL) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory sending out-of-band "
-                                       "data provider request\n");
-            /* This is non-fatal, so we'll continue here */
-        }
-
+        cache_req_cache_use(state, state->rctx, state->cr, state->result,
+                            ret == EAGAIN);
         return EOK;
     case ENOENT:
         /* Cache miss or the cache is expired. We need to get the updated
@@ -1111,6 +1292,12 @@ static errno_t cache_req_cache_check(struct tevent_req *req)
                         "Looking up [%s] in data provider\n",
                         state->cr->debugobj);
 
+        cache_req_dpreq_params(state, state->cr, state->result,
+                               &search_str, &search_id, &extra_flag);
+
+        PROBE(CACHE_REQ_DP_SEND, state->cr->reqname, state->cr->reqid,
+              state->cr->domain->name, 0, state->cr->trace_id);
+
         subreq = sss_dp_get_account_send(state, state->rctx,
                                          state->cr->domain, true,
                                          state->cr->dp_type,
@@ -1142,9 +1329,12 @@ static void cache_req_cache_done(struct tevent_req *subreq)
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct cache_req_cache_state);
+    sss_trace_id = state->cr->trace_id;
 
     ret = sss_dp_get_account_recv(state, subreq, &err_maj, &err_min, &err_msg);
     talloc_zfree(subreq);
+    PROBE(CACHE_REQ_DP_RECV, state->cr->reqname, state->cr->reqid,
+          state->cr->domain->name, ret, state->cr->trace_id);
     if (ret != EOK) {
         CACHE_REQ_DEBUG(SSSDBG_OP_FAILURE, state->cr,
                         "Could not get account info [%d]: %s\n",
@@ -1188,6 +1378,9 @@ static errno_t cache_req_cache_recv(TALLOC_CTX *mem_ctx,
     struct cache_req_cache_state *state = NULL;
     state = tevent_req_data(req, struct cache_req_cache_state);
 
+    PROBE(CACHE_REQ_CACHE_RECV, state->cr->reqname, state->cr->reqid,
+          state->cr->domain->name, state->cr->trace_id);
+
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
     *_result = talloc_steal(mem_ctx, state->result);
@@ -1195,6 +1388,39 @@ static errno_t cache_req_cache_recv(TALLOC_CTX *mem_ctx,
     return EOK;
 }
 
+static errno_t cache_req_cache_only_recv(TALLOC_CTX *mem_ctx,
+                                         struct tevent_req *req,
+                                         struct ldb_result **_result,
+                                         bool *_dp_needed,
+                                         bool *_midpoint)
+{
+    struct cache_req_cache_state *state = NULL;
+    state = tevent_req_data(req, struct cache_req_cache_state);
+
+    *_dp_needed = state->dp_needed;
+    *_midpoint = state->midpoint;
+
+    return cache_req_cache_recv(mem_ctx, req, _result);
+}
+
+
+struct cache_req_parallel_lookup {
+    struct tevent_req *req;
+    struct cache_req *cr;
+
+    /* the cache of the domain was searched */
+    bool searched;
+    /* the cache entry is missing or expired, the data provider must be
+     * asked before the result is known */
+    bool dp_needed;
+    /* the result comes from the cache search */
+    bool cached;
+    bool midpoint;
+
+    bool finished;
+    errno_t ret;
+    struct ldb_result *result;
+};
 
 struct cache_req_state {
     /* input data */
@@ -1209,6 +1435,10 @@ struct cache_req_state {
     struct sss_domain_info *domain;
     struct sss_domain_info *selected_domain;
     bool check_next;
+
+    /* lookups of a parallel multi-domain search in domain order */
+    struct cache_req_parallel_lookup **lookups;
+    size_t num_lookups;
 };
 
 static void cache_req_input_parsed(struct tevent_req *subreq);
@@ -1218,6 +1448,8 @@ static errno_t cache_req_select_domains(struct tevent_req *req,
 
 static errno_t cache_req_next_domain(struct tevent_req *req);
 
+static errno_t cache_req_parallel_domains(struct tevent_req *req);
+
 static void cache_req_done(struct tevent_req *subreq);
 
 struct tevent_req *cache_req_send(TALLOC_CTX *mem_ctx,
@@ -1252,6 +1484,9 @@ struct tevent_req *cache_req_send(TALLOC_CTX *mem_ctx,
 
     CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr, "New request\n");
 
+    PROBE(CACHE_REQ_SEND, cr->reqname, cr->reqid,
+          PROBE_SAFE_STR(cr->data->name.input), cr->trace_id);
+
     if (cr->data->name.input != NULL && domain == NULL) {
         /* Parse input name first, since it may contain domain name. */
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr, "Parsing input name [%s]\n",
@@ -1356,11 +1591,43 @@ static errno_t cache_req_select_domains(struct tevent_req *req,
 
         state->domain = state->rctx->domains;
         state->check_next = true;
+
+        if (state->rctx->parallel_domain_lookup) {
+            return cache_req_parallel_domains(req);
+        }
     }
 
     return cache_req_next_domain(req);
 }
 
+static struct sss_domain_info *
+cache_req_skip_domains(struct cache_req_state *state,
+                       struct sss_domain_info *domain)
+{
+    /* If it is a domainless search, skip domains that require fully
+     * qualified names instead. */
+    while (domain != NULL && state->check_next
+            && domain->fqnames
+            && state->cr->data->type != CACHE_REQ_USER_BY_CERT
+            && !cache_req_is_upn(state->cr)) {
+        domain = get_next_domain(domain, 0);
+    }
+
+    return domain;
+}
+
+static struct sss_domain_info *
+cache_req_following_domain(struct cache_req_state *state,
+                           struct sss_domain_info *domain)
+{
+    if (cache_req_is_upn(state->cr)
+            || state->cr->data->type == CACHE_REQ_USER_BY_CERT ) {
+        return get_next_domain(domain, SSS_GND_DESCEND);
+    }
+
+    return get_next_domain(domain, 0);
+}
+
 static errno_t cache_req_next_domain(struct tevent_req *req)
 {
     struct cache_req_state *state = NULL;
@@ -1370,15 +1637,7 @@ static errno_t cache_req_next_domain(struct tevent_req *req)
     state = tevent_req_data(req, struct cache_req_state);
 
     while (state->domain != NULL) {
-       /* If it is a domainless search, skip domains that require fully
-        * qualified names instead. */
-        while (state->domain != NULL && state->check_next
-                && state->domain->fqnames
-                && state->cr->data->type != CACHE_REQ_USER_BY_CERT
-                && !cache_req_is_upn(state->cr)) {
-            state->domain = get_next_domain(state->domain, 0);
-        }
-
+        state->domain = cache_req_skip_domains(state, state->domain);
         state->selected_domain = state->domain;
 
         if (state->domain == NULL) {
@@ -1393,7 +1652,7 @@ static errno_t cache_req_next_domain(struct tevent_req *req)
         subreq = cache_req_cache_send(state, state->ev, state->rctx,
                                       state->ncache,
                                       state->cache_refresh_percent,
-                                      state->cr);
+                                      false, state->cr);
         if (subreq == NULL) {
             return ENOMEM;
         }
@@ -1402,12 +1661,7 @@ static errno_t cache_req_next_domain(struct tevent_req *req)
 
         /* we will continue with the following domain the next time */
         if (state->check_next) {
-            if (cache_req_is_upn(state->cr)
-                    || state->cr->data->type == CACHE_REQ_USER_BY_CERT ) {
-                state->domain = get_next_domain(state->domain, SSS_GND_DESCEND);
-            } else {
-                state->domain = get_next_domain(state->domain, 0);
-            }
+            state->domain = cache_req_following_domain(state, state->domain);
         }
 
         return EAGAIN;
@@ -1422,6 +1676,257 @@ static errno_t cache_req_next_domain(struct tevent_req *req)
     return ENOENT;
 }
 
+static void cache_req_parallel_searched(struct tevent_req *subreq);
+static void cache_req_parallel_done(struct tevent_req *subreq);
+
+/* Search all candidate domains at once instead of one after another. Each
+ * domain gets its own copy of the request, the result is still picked in
+ * domain order.
+ *
+ * The caches of all domains are searched first. The data providers are
+ * then asked only in the domains that precede the first domain with a
+ * valid cache entry, so that an entry cached in the first domain does not
+ * cause a request to every back end. */
+static errno_t cache_req_parallel_domains(struct tevent_req *req)
+{
+    struct cache_req_state *state = NULL;
+    struct cache_req_parallel_lookup *lookup;
+    struct sss_domain_info *domain;
+    struct tevent_req *subreq;
+    size_t num_lookups;
+    size_t i;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct cache_req_state);
+
+    num_lookups = 0;
+    for (domain = cache_req_skip_domains(state, state->domain);
+         domain != NULL;
+         domain = cache_req_skip_domains(state,
+                        cache_req_following_domain(state, domain))) {
+        num_lookups++;
+    }
+
+    if (num_lookups < 2) {
+        /* nothing to parallelize */
+        return cache_req_next_domain(req);
+    }
+
+    CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
+                    "Searching %zu domains in parallel\n", num_lookups);
+
+    state->lookups = talloc_zero_array(state,
+                                       struct cache_req_parallel_lookup *,
+                                       num_lookups);
+    if (state->lookups == NULL) {
+        return ENOMEM;
+    }
+    state->num_lookups = num_lookups;
+
+    domain = cache_req_skip_domains(state, state->domain);
+    for (i = 0; i < num_lookups; i++) {
+        lookup = talloc_zero(state->lookups, struct cache_req_parallel_lookup);
+        if (lookup == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        state->lookups[i] = lookup;
+
+        lookup->req = req;
+        lookup->cr = cache_req_copy(lookup, state->cr);
+        if (lookup->cr == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = cache_req_set_domain(lookup->cr, domain, state->rctx);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        subreq = cache_req_cache_send(lookup, state->ev, state->rctx,
+                                      state->ncache,
+                                      state->cache_refresh_percent,
+                                      true, lookup->cr);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        tevent_req_set_callback(subreq, cache_req_parallel_searched, lookup);
+
+        domain = cache_req_skip_domains(state,
+                        cache_req_following_domain(state, domain));
+    }
+
+    state->domain = NULL;
+    ret = EAGAIN;
+
+done:
+    if (ret != EAGAIN) {
+        talloc_zfree(state->lookups);
+        state->num_lookups = 0;
+    }
+
+    return ret;
+}
+
+static void cache_req_parallel_dp(struct cache_req_state *state,
+                                  struct cache_req_parallel_lookup *lookup)
+{
+    struct tevent_req *subreq;
+
+    lookup->dp_needed = false;
+
+    subreq = cache_req_cache_send(lookup, state->ev, state->rctx,
+                                  state->ncache,
+                                  state->cache_refresh_percent,
+                                  false, lookup->cr);
+    if (subreq == NULL) {
+        lookup->ret = ENOMEM;
+        lookup->finished = true;
+        return;
+    }
+
+    tevent_req_set_callback(subreq, cache_req_parallel_done, lookup);
+}
+
+static void cache_req_parallel_finish(struct tevent_req *req)
+{
+    struct cache_req_state *state = NULL;
+    struct cache_req_parallel_lookup *lookup = NULL;
+    size_t i;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct cache_req_state);
+
+    /* Ask the data providers of the domains that precede the first domain
+     * that has the entry. Their negative answers end up in the negative
+     * cache. The following domains are never contacted. */
+    for (i = 0; i < state->num_lookups; i++) {
+        lookup = state->lookups[i];
+
+        if (!lookup->searched) {
+            /* the cache of this domain may still have the entry */
+            break;
+        }
+
+        if (lookup->finished && lookup->ret == EOK) {
+            break;
+        }
+
+        if (lookup->dp_needed) {
+            cache_req_parallel_dp(state, lookup);
+        }
+    }
+
+    lookup = NULL;
+    for (i = 0; i < state->num_lookups; i++) {
+        if (!state->lookups[i]->finished) {
+            /* a preceding domain takes precedence, wait for it */
+            return;
+        }
+
+        if (state->lookups[i]->ret == EOK) {
+            lookup = state->lookups[i];
+            break;
+        }
+    }
+
+    if (lookup == NULL) {
+        /* Not found in any domain. The per-domain negative cache entries
+         * were already added by each lookup. */
+        cache_req_add_to_ncache_global(state->lookups[i - 1]->cr,
+                                       state->ncache);
+        talloc_zfree(state->lookups);
+        state->num_lookups = 0;
+
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Not found\n");
+        tevent_req_error(req, ENOENT);
+        return;
+    }
+
+    ret = cache_req_set_domain(state->cr, lookup->cr->domain, state->rctx);
+    if (ret != EOK) {
+        talloc_zfree(state->lookups);
+        state->num_lookups = 0;
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    state->result = talloc_steal(state, lookup->result);
+    state->selected_domain = lookup->cr->domain;
+
+    if (lookup->cached) {
+        cache_req_cache_use(state, state->rctx, state->cr, state->result,
+                            lookup->midpoint);
+    }
+
+    /* Nobody is interested in the lookups in the following domains
+     * anymore. Data provider requests that were already sent still finish
+     * in the back end and update the cache. */
+    talloc_zfree(state->lookups);
+    state->num_lookups = 0;
+
+    CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Success\n");
+    tevent_req_done(req);
+}
+
+static void cache_req_parallel_done(struct tevent_req *subreq)
+{
+    struct cache_req_parallel_lookup *lookup = NULL;
+    struct cache_req_state *state = NULL;
+    struct tevent_req *req = NULL;
+
+    lookup = tevent_req_callback_data(subreq, struct cache_req_parallel_lookup);
+    req = lookup->req;
+    state = tevent_req_data(req, struct cache_req_state);
+    sss_trace_id = state->cr->trace_id;
+
+    lookup->ret = cache_req_cache_recv(lookup, subreq, &lookup->result);
+    lookup->finished = true;
+    talloc_zfree(subreq);
+
+    if (lookup->ret != EOK && lookup->ret != ENOENT) {
+        CACHE_REQ_DEBUG(SSSDBG_OP_FAILURE, lookup->cr,
+                        "Lookup of [%s] failed [%d]: %s\n",
+                        lookup->cr->debugobj, lookup->ret,
+                        sss_strerror(lookup->ret));
+    }
+
+    cache_req_parallel_finish(req);
+}
+
+static void cache_req_parallel_searched(struct tevent_req *subreq)
+{
+    struct cache_req_parallel_lookup *lookup = NULL;
+    struct cache_req_state *state = NULL;
+    struct tevent_req *req = NULL;
+
+    lookup = tevent_req_callback_data(subreq, struct cache_req_parallel_lookup);
+    req = lookup->req;
+    state = tevent_req_data(req, struct cache_req_state);
+    sss_trace_id = state->cr->trace_id;
+
+    lookup->ret = cache_req_cache_only_recv(lookup, subreq, &lookup->result,
+                                            &lookup->dp_needed,
+                                            &lookup->midpoint);
+    talloc_zfree(subreq);
+
+    lookup->searched = true;
+    lookup->cached = (lookup->ret == EOK);
+    lookup->finished = !lookup->dp_needed;
+
+    if (lookup->ret != EOK && lookup->ret != ENOENT) {
+        CACHE_REQ_DEBUG(SSSDBG_OP_FAILURE, lookup->cr,
+                        "Cache search of [%s] failed [%d]: %s\n",
+                        lookup->cr->debugobj, lookup->ret,
+                        sss_strerror(lookup->ret));
+    }
+
+    cache_req_parallel_finish(req);
+}
+
 static void cache_req_done(struct tevent_req *subreq)
 {
     struct cache_req_state *state = NULL;
@@ -1430,6 +1935,7 @@ static void cache_req_done(struct tevent_req *subreq)
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct cache_req_state);
+    sss_trace_id = state->cr->trace_id;
 
     ret = cache_req_cache_recv(state, subreq, &state->result);
     talloc_zfree(subreq);
@@ -1472,6 +1978,12 @@ errno_t cache_req_recv(TALLOC_CTX *mem_ctx,
 
     state = tevent_req_data(req, struct cache_req_state);
 
+    if (state->cr != NULL) {
+        PROBE(CACHE_REQ_RECV, state->cr->reqname, state->cr->reqid,
+              PROBE_SAFE_STR(state->cr->data->name.input),
+              state->cr->trace_id);
+    }
+
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
     if (_name != NULL) {
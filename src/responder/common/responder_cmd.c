@@ -21,6 +21,7 @@
 #include <errno.h>
 #include "db/sysdb.h"
 #include "util/util.h"
+#include "util/sss_metrics.h"
 #include "responder/common/responder.h"
 #include "responder/common/responder_packet.h"
 
@@ -295,13 +296,16 @@ sss_cmd_check_cache(struct ldb_message *msg,
              * We'll return the value from the cache, but we'll also
              * queue the cache entry for update out-of-band.
              */
+            sss_metrics_inc("cache", "hit_refresh");
             return EAGAIN;
         } else {
             /* Cache is still valid. */
+            sss_metrics_inc("cache", "hit");
             return EOK;
         }
     }
 
     /* Cache needs to be updated */
+    sss_metrics_inc("cache", "miss");
     return ENOENT;
 }
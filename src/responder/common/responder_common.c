@@ -43,6 +43,9 @@
 #include "monitor/monitor_interfaces.h"
 #include "sbus/sbus_client.h"
 #include "util/util_creds.h"
+#include "util/sss_cli_cmd.h"
+#include "util/sss_metrics.h"
+#include "util/probes.h"
 
 #ifdef HAVE_SYSTEMD
 #include <systemd/sd-daemon.h>
@@ -251,9 +254,13 @@ done:
 static void client_send(struct cli_ctx *cctx)
 {
     struct cli_protocol *pctx;
+    struct timeval now;
+    struct timeval diff;
+    const char *cmd;
     int ret;
 
     pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
+    sss_trace_id = pctx->creq->trace_id;
 
     ret = sss_packet_send(pctx->creq->out, cctx->cfd);
     if (ret == EAGAIN) {
@@ -267,6 +274,17 @@ static void client_send(struct cli_ctx *cctx)
     }
 
     /* ok all sent */
+    PROBE(RESPONDER_REQUEST_SEND, cctx->cfd,
+          sss_packet_get_cmd(pctx->creq->in), pctx->creq->trace_id);
+
+    cmd = sss_cmd2str(sss_packet_get_cmd(pctx->creq->in));
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(&pctx->creq->start, &now);
+    sss_metrics_add_usec("cmd", cmd, diff.tv_sec * 1000000ULL + diff.tv_usec);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Request [%s] finished in %ld.%06ld seconds\n",
+          cmd, (long)diff.tv_sec, (long)diff.tv_usec);
+
     TEVENT_FD_NOT_WRITEABLE(cctx->cfde);
     TEVENT_FD_READABLE(cctx->cfde);
     talloc_zfree(pctx->creq);
@@ -316,6 +334,11 @@ static void client_recv(struct cli_ctx *cctx)
     case EOK:
         /* do not read anymore */
         TEVENT_FD_NOT_READABLE(cctx->cfde);
+        pctx->creq->start = tevent_timeval_current();
+        pctx->creq->trace_id = sss_trace_id_new();
+        sss_trace_id = pctx->creq->trace_id;
+        PROBE(RESPONDER_REQUEST_RECV, cctx->cfd,
+              sss_packet_get_cmd(pctx->creq->in), pctx->creq->trace_id);
         /* execute command */
         ret = client_cmd_execute(cctx, cctx->rctx->sss_cmds);
         if (ret != EOK) {
@@ -435,13 +458,21 @@ static void accept_fd_handler(struct tevent_context *ev,
     len = sizeof(cctx->addr);
     cctx->cfd = accept(fd, (struct sockaddr *)&cctx->addr, &len);
     if (cctx->cfd == -1) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Accept failed [%s]\n", strerror(errno));
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            /* another process sharing the socket accepted the client */
+            DEBUG(SSSDBG_TRACE_ALL, "No client to accept\n");
+        } else {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Accept failed [%s]\n",
+                  strerror(errno));
+        }
         talloc_free(cctx);
         return;
     }
 
     cctx->priv = accept_ctx->is_private;
 
+    PROBE(RESPONDER_ACCEPT, cctx->cfd, cctx->priv);
+
     ret = get_client_cred(cctx);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "get_client_cred failed, "
@@ -557,6 +588,7 @@ static int sss_dp_init(struct resp_ctx *rctx,
                        struct sss_domain_info *domain)
 {
     struct be_conn *be_conn;
+    char *conf_path;
     int ret;
 
     be_conn = talloc_zero(rctx, struct be_conn);
@@ -566,6 +598,34 @@ static int sss_dp_init(struct resp_ctx *rctx,
     be_conn->domain = domain;
     be_conn->rctx = rctx;
 
+    conf_path = talloc_asprintf(be_conn, CONFDB_DOMAIN_PATH_TMPL,
+                                domain->name);
+    if (conf_path == NULL) {
+        talloc_free(be_conn);
+        return ENOMEM;
+    }
+
+    ret = confdb_get_bool(rctx->cdb, conf_path,
+                          CONFDB_DOMAIN_DP_BINARY_TRANSPORT, false,
+                          &be_conn->use_bin);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to read %s [%d]: %s\n",
+              CONFDB_DOMAIN_DP_BINARY_TRANSPORT, ret, sss_strerror(ret));
+        talloc_free(be_conn);
+        return ret;
+    }
+
+    ret = confdb_get_int(rctx->cdb, conf_path,
+                         CONFDB_DOMAIN_DP_BATCH_WINDOW, 0,
+                         &be_conn->bin_batch_window);
+    talloc_free(conf_path);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Unable to read %s [%d]: %s\n",
+              CONFDB_DOMAIN_DP_BATCH_WINDOW, ret, sss_strerror(ret));
+        talloc_free(be_conn);
+        return ret;
+    }
+
     /* Set up SBUS connection to the monitor */
     ret = dp_get_sbus_address(be_conn, &be_conn->sbus_address, domain->name);
     if (ret != EOK) {
@@ -936,6 +996,7 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
 {
     struct resp_ctx *rctx;
     struct sss_domain_info *dom;
+    int cache_readers;
     int ret;
     char *tmp = NULL;
 
@@ -987,6 +1048,25 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
         rctx->domains_timeout = GET_DOMAINS_DEFAULT_TIMEOUT;
     }
 
+    ret = confdb_get_bool(rctx->cdb, rctx->confdb_service_path,
+                          CONFDB_RESPONDER_PARALLEL_DOMAIN_LOOKUP, false,
+                          &rctx->parallel_domain_lookup);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the parallel domain lookup option [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
+    ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
+                         CONFDB_RESPONDER_CACHE_READERS, 0, &cache_readers);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the number of cache readers [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
     ret = confdb_get_domains(rctx->cdb, &rctx->domains);
     if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE, "fatal error setting up domain map\n");
@@ -1023,12 +1103,27 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
         rctx->override_space = tmp[0];
     }
 
-    ret = sss_monitor_init(rctx, rctx->ev, monitor_intf,
-                           svc_name, svc_version, rctx,
-                           &rctx->mon_conn);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_FATAL_FAILURE, "fatal error setting up message bus\n");
-        goto fail;
+    /* The readers must be started before any connection is set up and
+     * before the cache is opened. */
+    if (cache_readers > 0) {
+        ret = sss_cache_reader_pool_init(rctx, rctx, cache_readers,
+                                         &rctx->cache_readers);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to start cache readers, "
+                  "the cache will be searched by the responder only\n");
+        }
+    }
+
+    /* helper processes of a responder are not known to the monitor */
+    if (monitor_intf != NULL) {
+        ret = sss_monitor_init(rctx, rctx->ev, monitor_intf,
+                               svc_name, svc_version, rctx,
+                               &rctx->mon_conn);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "fatal error setting up message bus\n");
+            goto fail;
+        }
     }
 
     for (dom = rctx->domains; dom; dom = get_next_domain(dom, 0)) {
@@ -27,10 +27,17 @@
 #include "responder/common/responder.h"
 #include "providers/data_provider.h"
 #include "providers/data_provider/dp_responder_iface.h"
+#include "providers/data_provider/dp_bin.h"
+#include "responder/common/data_provider/rdp.h"
 #include "sbus/sbus_client.h"
 
 struct sss_dp_req;
 
+/* Fill the request for the binary transport. Return false if the request
+ * can not be sent this way, D-Bus is used then. */
+typedef bool (*sss_dp_bin_constructor)(TALLOC_CTX *mem_ctx, void *pvt,
+                                       struct dp_bin_account_req *areq);
+
 struct sss_dp_callback {
     struct sss_dp_callback *prev;
     struct sss_dp_callback *next;
@@ -43,6 +50,7 @@ struct sss_dp_req {
     struct resp_ctx *rctx;
     struct tevent_context *ev;
     DBusPendingCall *pending_reply;
+    struct tevent_req *bin_req;
 
     hash_key_t *key;
 
@@ -76,6 +84,9 @@ static int sss_dp_req_destructor(void *ptr)
         sdp_req->pending_reply = NULL;
     }
 
+    /* The data provider will finish the request but the reply is ignored */
+    talloc_zfree(sdp_req->bin_req);
+
     /* Do not call callbacks if the responder is shutting down, because
      * the top level responder context (pam_ctx, sudo_ctx, ...) may be
      * already semi-freed and we may end up accessing freed memory.
@@ -245,16 +256,19 @@ static struct tevent_req *
 sss_dp_internal_get_send(struct resp_ctx *rctx,
                          hash_key_t *key,
                          struct sss_domain_info *dom,
-                         DBusMessage *msg);
+                         dbus_msg_constructor msg_create,
+                         sss_dp_bin_constructor bin_create,
+                         void *pvt);
 
 static void
 sss_dp_req_done(struct tevent_req *sidereq);
 
-errno_t
-sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
-                     const char *strkey, struct sss_domain_info *dom,
-                     dbus_msg_constructor msg_create, void *pvt,
-                     struct tevent_req *nreq)
+static errno_t
+sss_dp_issue_request_ext(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
+                         const char *strkey, struct sss_domain_info *dom,
+                         dbus_msg_constructor msg_create,
+                         sss_dp_bin_constructor bin_create,
+                         void *pvt, struct tevent_req *nreq)
 {
     int hret;
     hash_value_t value;
@@ -264,7 +278,6 @@ sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
     struct sss_dp_callback *cb;
     struct tevent_timer *te;
     struct timeval tv;
-    DBusMessage *msg;
     TALLOC_CTX *tmp_ctx = NULL;
     errno_t ret;
 
@@ -301,18 +314,11 @@ sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
         /* No such request in progress
          * Create a new request
          */
-        msg = msg_create(pvt);
-        if (!msg) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create D-Bus message\n");
-            ret = EIO;
-            goto fail;
-        }
-
         value.type = HASH_VALUE_PTR;
-        sidereq = sss_dp_internal_get_send(rctx, key, dom, msg);
-        dbus_message_unref(msg);
+        sidereq = sss_dp_internal_get_send(rctx, key, dom, msg_create,
+                                           bin_create, pvt);
         if (!sidereq) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot send D-Bus message\n");
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot send DP request\n");
             ret = EIO;
             goto fail;
         }
@@ -379,6 +385,16 @@ fail:
     return ret;
 }
 
+errno_t
+sss_dp_issue_request(TALLOC_CTX *mem_ctx, struct resp_ctx *rctx,
+                     const char *strkey, struct sss_domain_info *dom,
+                     dbus_msg_constructor msg_create, void *pvt,
+                     struct tevent_req *nreq)
+{
+    return sss_dp_issue_request_ext(mem_ctx, rctx, strkey, dom, msg_create,
+                                    NULL, pvt, nreq);
+}
+
 static void
 sss_dp_req_done(struct tevent_req *sidereq)
 {
@@ -429,6 +445,8 @@ sss_dp_req_recv(TALLOC_CTX *mem_ctx,
  * the data provider action.
  */
 static DBusMessage *sss_dp_get_account_msg(void *pvt);
+static bool sss_dp_get_account_bin(TALLOC_CTX *mem_ctx, void *pvt,
+                                   struct dp_bin_account_req *areq);
 
 struct sss_dp_account_info {
     struct sss_domain_info *dom;
@@ -438,6 +456,7 @@ struct sss_dp_account_info {
     const char *opt_name;
     const char *extra;
     uint32_t opt_id;
+    uint64_t trace_id;
 };
 
 struct tevent_req *
@@ -479,6 +498,7 @@ sss_dp_get_account_send(TALLOC_CTX *mem_ctx,
     info->opt_id = opt_id;
     info->extra = extra;
     info->dom = dom;
+    info->trace_id = sss_trace_id;
 
     if (opt_name) {
         if (extra) {
@@ -503,8 +523,9 @@ sss_dp_get_account_send(TALLOC_CTX *mem_ctx,
         goto error;
     }
 
-    ret = sss_dp_issue_request(state, rctx, key, dom, sss_dp_get_account_msg,
-                               info, req);
+    ret = sss_dp_issue_request_ext(state, rctx, key, dom,
+                                   sss_dp_get_account_msg,
+                                   sss_dp_get_account_bin, info, req);
     talloc_free(key);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE,
@@ -521,19 +542,15 @@ error:
     return req;
 }
 
-static DBusMessage *
-sss_dp_get_account_msg(void *pvt)
+static char *
+sss_dp_get_account_args(TALLOC_CTX *mem_ctx,
+                        struct sss_dp_account_info *info,
+                        uint32_t *_dp_flags,
+                        uint32_t *_entry_type)
 {
-    DBusMessage *msg;
-    dbus_bool_t dbret;
-    struct sss_dp_account_info *info;
-    uint32_t dp_flags;
     uint32_t entry_type;
-    uint32_t attrs_type = BE_ATTR_CORE;
     char *filter;
 
-    info = talloc_get_type(pvt, struct sss_dp_account_info);
-
     switch (info->type) {
         case SSS_DP_USER:
         case SSS_DP_WILDCARD_USER:
@@ -563,32 +580,88 @@ sss_dp_get_account_msg(void *pvt)
             break;
     }
 
-    dp_flags = info->fast_reply ? DP_FAST_REPLY : 0;
+    *_dp_flags = info->fast_reply ? DP_FAST_REPLY : 0;
+    *_entry_type = entry_type;
 
     if (info->opt_name) {
         if (info->type == SSS_DP_SECID) {
-            filter = talloc_asprintf(info, "%s=%s", DP_SEC_ID,
+            filter = talloc_asprintf(mem_ctx, "%s=%s", DP_SEC_ID,
                                      info->opt_name);
         } else if (info->type == SSS_DP_CERT) {
-            filter = talloc_asprintf(info, "%s=%s", DP_CERT,
+            filter = talloc_asprintf(mem_ctx, "%s=%s", DP_CERT,
                                      info->opt_name);
         } else if (info->type == SSS_DP_WILDCARD_USER ||
                    info->type == SSS_DP_WILDCARD_GROUP) {
-            filter = talloc_asprintf(info, "%s=%s", DP_WILDCARD,
+            filter = talloc_asprintf(mem_ctx, "%s=%s", DP_WILDCARD,
                                      info->opt_name);
         } else {
-            filter = talloc_asprintf(info, "name=%s", info->opt_name);
+            filter = talloc_asprintf(mem_ctx, "name=%s", info->opt_name);
         }
     } else if (info->opt_id) {
-        filter = talloc_asprintf(info, "idnumber=%u", info->opt_id);
+        filter = talloc_asprintf(mem_ctx, "idnumber=%u", info->opt_id);
     } else {
-        filter = talloc_strdup(info, ENUM_INDICATOR);
+        filter = talloc_strdup(mem_ctx, ENUM_INDICATOR);
     }
     if (!filter) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory?!\n");
         return NULL;
     }
 
+    return filter;
+}
+
+static bool
+sss_dp_get_account_bin(TALLOC_CTX *mem_ctx, void *pvt,
+                       struct dp_bin_account_req *areq)
+{
+    struct sss_dp_account_info *info;
+
+    info = talloc_get_type(pvt, struct sss_dp_account_info);
+
+    /* The backend updates the memory cache after initgroups through
+     * D-Bus, keep using it. */
+    if (info->type == SSS_DP_INITGROUPS) {
+        return false;
+    }
+
+    areq->filter = sss_dp_get_account_args(mem_ctx, info, &areq->dp_flags,
+                                           &areq->entry_type);
+    if (areq->filter == NULL) {
+        return false;
+    }
+
+    areq->attr_type = BE_ATTR_CORE;
+    areq->domain = info->dom->name;
+    areq->extra = info->extra;
+    areq->trace_id = info->trace_id;
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Creating binary request for [%s][%#x][%s][%d][%s:%s]\n",
+          info->dom->name, areq->entry_type, be_req2str(areq->entry_type),
+          areq->attr_type, areq->filter,
+          info->extra == NULL ? "-" : info->extra);
+
+    return true;
+}
+
+static DBusMessage *
+sss_dp_get_account_msg(void *pvt)
+{
+    DBusMessage *msg;
+    dbus_bool_t dbret;
+    struct sss_dp_account_info *info;
+    uint32_t dp_flags;
+    uint32_t entry_type;
+    uint32_t attrs_type = BE_ATTR_CORE;
+    char *filter;
+
+    info = talloc_get_type(pvt, struct sss_dp_account_info);
+
+    filter = sss_dp_get_account_args(info, info, &dp_flags, &entry_type);
+    if (!filter) {
+        return NULL;
+    }
+
     msg = dbus_message_new_method_call(NULL,
                                        DP_PATH,
                                        IFACE_DP,
@@ -617,6 +690,7 @@ sss_dp_get_account_msg(void *pvt)
                                      DBUS_TYPE_STRING, &filter,
                                      DBUS_TYPE_STRING, &info->dom->name,
                                      DBUS_TYPE_STRING, &info->extra,
+                                     DBUS_TYPE_UINT64, &info->trace_id,
                                      DBUS_TYPE_INVALID);
     talloc_free(filter);
     if (!dbret) {
@@ -647,12 +721,92 @@ struct dp_internal_get_state {
 };
 
 static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr);
+static void sss_dp_internal_get_bin_done(struct tevent_req *subreq);
+
+static errno_t
+sss_dp_internal_get_bin(struct tevent_req *req,
+                        struct be_conn *be_conn,
+                        sss_dp_bin_constructor bin_create,
+                        void *pvt)
+{
+    struct dp_internal_get_state *state;
+    struct dp_bin_account_req areq;
+    TALLOC_CTX *tmp_ctx;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct dp_internal_get_state);
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    if (!bin_create(tmp_ctx, pvt, &areq)) {
+        ret = ENOTSUP;
+        goto done;
+    }
+
+    state->sdp_req->bin_req = rdp_bin_account_send(state->sdp_req, be_conn,
+                                                   &areq);
+    if (state->sdp_req->bin_req == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(state->sdp_req->bin_req,
+                            sss_dp_internal_get_bin_done, req);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t
+sss_dp_internal_get_dbus(struct tevent_req *req,
+                         struct be_conn *be_conn,
+                         dbus_msg_constructor msg_create,
+                         void *pvt)
+{
+    struct dp_internal_get_state *state;
+    DBusMessage *msg;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct dp_internal_get_state);
+
+    msg = msg_create(pvt);
+    if (!msg) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create D-Bus message\n");
+        return EIO;
+    }
+
+    ret = sbus_conn_send(be_conn->conn, msg,
+                         SSS_CLI_SOCKET_TIMEOUT / 2,
+                         sss_dp_internal_get_done,
+                         req,
+                         &state->sdp_req->pending_reply);
+    dbus_message_unref(msg);
+    if (ret != EOK) {
+        /*
+         * Critical Failure
+         * We can't communicate on this connection
+         */
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "D-BUS send failed.\n");
+        return EIO;
+    }
+
+    return EOK;
+}
 
 static struct tevent_req *
 sss_dp_internal_get_send(struct resp_ctx *rctx,
                          hash_key_t *key,
                          struct sss_domain_info *dom,
-                         DBusMessage *msg)
+                         dbus_msg_constructor msg_create,
+                         sss_dp_bin_constructor bin_create,
+                         void *pvt)
 {
     errno_t ret;
     int hret;
@@ -701,20 +855,16 @@ sss_dp_internal_get_send(struct resp_ctx *rctx,
         goto error;
     }
 
-    ret = sbus_conn_send(be_conn->conn, msg,
-                         SSS_CLI_SOCKET_TIMEOUT / 2,
-                         sss_dp_internal_get_done,
-                         req,
-                         &state->sdp_req->pending_reply);
+    ret = ENOTSUP;
+    if (bin_create != NULL && rdp_bin_available(be_conn)) {
+        ret = sss_dp_internal_get_bin(req, be_conn, bin_create, pvt);
+    }
+
     if (ret != EOK) {
-        /*
-         * Critical Failure
-         * We can't communicate on this connection
-         */
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "D-BUS send failed.\n");
-        ret = EIO;
-        goto error;
+        ret = sss_dp_internal_get_dbus(req, be_conn, msg_create, pvt);
+        if (ret != EOK) {
+            goto error;
+        }
     }
 
     /* Add this sdp_req to the hash table */
@@ -741,14 +891,14 @@ error:
     return req;
 }
 
+static void sss_dp_internal_get_finish(struct tevent_req *req, errno_t ret);
+
 static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr)
 {
     int ret;
     struct tevent_req *req;
     struct sss_dp_req *sdp_req;
-    struct sss_dp_callback *cb;
     struct dp_internal_get_state *state;
-    struct sss_dp_req_state *cb_state;
 
     req = talloc_get_type(ptr, struct tevent_req);
     state = tevent_req_data(req, struct dp_internal_get_state);
@@ -776,6 +926,49 @@ static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr)
         }
     }
 
+    sss_dp_internal_get_finish(req, ret);
+}
+
+static void sss_dp_internal_get_bin_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req;
+    struct sss_dp_req *sdp_req;
+    struct dp_internal_get_state *state;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct dp_internal_get_state);
+    sdp_req = state->sdp_req;
+
+    ret = rdp_bin_account_recv(sdp_req, subreq,
+                               &sdp_req->dp_err,
+                               &sdp_req->dp_ret,
+                               &sdp_req->err_msg);
+    talloc_zfree(subreq);
+    sdp_req->bin_req = NULL;
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Binary request failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        ret = EIO;
+        sdp_req->dp_err = DP_ERR_FATAL;
+        sdp_req->dp_ret = ret;
+        sdp_req->err_msg = talloc_strdup(sdp_req,
+                                  "Failed to get reply from Data Provider");
+    }
+
+    sss_dp_internal_get_finish(req, ret);
+}
+
+static void sss_dp_internal_get_finish(struct tevent_req *req, errno_t ret)
+{
+    struct sss_dp_req *sdp_req;
+    struct sss_dp_callback *cb;
+    struct dp_internal_get_state *state;
+    struct sss_dp_req_state *cb_state;
+
+    state = tevent_req_data(req, struct dp_internal_get_state);
+    sdp_req = state->sdp_req;
+
     /* Check whether we need to issue any callbacks */
     while ((cb = sdp_req->cb_list) != NULL) {
         cb_state = tevent_req_data(cb->req, struct sss_dp_req_state);
@@ -174,8 +174,40 @@ int sss_packet_set_size(struct sss_packet *packet, size_t size)
     return 0;
 }
 
+/* Requests carrying a list of objects may be larger than the default
+ * receive buffer, enlarge it once the header tells us about such a request */
+static int sss_packet_grow_bulk_recv(struct sss_packet *packet, size_t rb)
+{
+    uint32_t cmd;
+    uint32_t len;
+    uint8_t *newmem;
+
+    if (packet->iop + rb < SSS_PACKET_CMD_OFFSET + sizeof(uint32_t)) {
+        return EINVAL;
+    }
+
+    SAFEALIGN_COPY_UINT32(&cmd, packet->buffer + SSS_PACKET_CMD_OFFSET, NULL);
+    SAFEALIGN_COPY_UINT32(&len, packet->buffer + SSS_PACKET_LEN_OFFSET, NULL);
+
+    if (cmd != SSS_NSS_GETIDSBYSIDS
+            || len > SSS_NSS_HEADER_SIZE + SSS_CLI_BULK_MAX_REQ_SIZE) {
+        return EINVAL;
+    }
+
+    newmem = talloc_realloc_size(packet, packet->buffer, len);
+    if (newmem == NULL) {
+        return ENOMEM;
+    }
+
+    packet->buffer = newmem;
+    packet->memsize = len;
+
+    return EOK;
+}
+
 int sss_packet_recv(struct sss_packet *packet, int fd)
 {
+    int ret;
     size_t rb;
     size_t len;
     void *buf;
@@ -205,7 +237,10 @@ int sss_packet_recv(struct sss_packet *packet, int fd)
     }
 
     if (sss_packet_get_len(packet) > packet->memsize) {
-        return EINVAL;
+        ret = sss_packet_grow_bulk_recv(packet, rb);
+        if (ret != EOK) {
+            return ret;
+        }
     }
 
     packet->iop += rb;
@@ -29,6 +29,7 @@
 #include "util/util.h"
 #include "responder/common/responder.h"
 #include "responder/ifp/ifp_components.h"
+#include "monitor/monitor_interfaces.h"
 
 #ifdef HAVE_CONFIG_LIB
 #include "util/sss_config.h"
@@ -462,6 +463,108 @@ int ifp_find_backend_by_name(struct sbus_request *dbus_req,
     return iface_ifp_FindBackendByName_finish(dbus_req, result);
 }
 
+/* The monitor knows all running services, it collects their metrics. */
+struct ifp_get_stats_state {
+    struct sbus_request *dbus_req;
+    DBusPendingCall *pending;
+};
+
+static int ifp_get_stats_state_destructor(struct ifp_get_stats_state *state)
+{
+    if (state->pending != NULL) {
+        dbus_pending_call_cancel(state->pending);
+        dbus_pending_call_unref(state->pending);
+    }
+
+    return 0;
+}
+
+static void ifp_get_stats_done(DBusPendingCall *pending, void *ptr)
+{
+    struct ifp_get_stats_state *state;
+    DBusMessage *reply;
+    const char *stats;
+    DBusError *error;
+    errno_t ret;
+
+    state = talloc_get_type(ptr, struct ifp_get_stats_state);
+    state->pending = NULL;
+
+    reply = dbus_pending_call_steal_reply(pending);
+    dbus_pending_call_unref(pending);
+    if (reply == NULL) {
+        ret = EFAULT;
+        goto done;
+    }
+
+    ret = sbus_parse_reply(reply, DBUS_TYPE_STRING, &stats);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    iface_ifp_GetStats_finish(state->dbus_req, stats);
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to get metrics [%d]: %s\n",
+              ret, sss_strerror(ret));
+        error = sbus_error_new(state->dbus_req, DBUS_ERROR_FAILED,
+                               "%s", sss_strerror(ret));
+        sbus_request_fail_and_finish(state->dbus_req, error);
+    }
+
+    if (reply != NULL) {
+        dbus_message_unref(reply);
+    }
+}
+
+int ifp_get_stats(struct sbus_request *dbus_req, void *data)
+{
+    struct ifp_get_stats_state *state;
+    struct ifp_req *ireq;
+    struct ifp_ctx *ctx;
+    DBusMessage *msg;
+    DBusError *error;
+    errno_t ret;
+
+    ctx = talloc_get_type(data, struct ifp_ctx);
+    if (ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid ifp context!\n");
+        return ERR_INTERNAL;
+    }
+
+    /* The metrics are only available to users in the ACL */
+    ret = ifp_req_create(dbus_req, ctx, &ireq);
+    if (ret != EOK) {
+        return ifp_req_create_handle_failure(dbus_req, ret);
+    }
+
+    state = talloc_zero(ireq, struct ifp_get_stats_state);
+    if (state == NULL) {
+        return ENOMEM;
+    }
+    state->dbus_req = dbus_req;
+
+    msg = dbus_message_new_method_call(NULL, MON_SRV_PATH, MON_SRV_IFACE,
+                                       MON_SRV_IFACE_GETSTATS);
+    if (msg == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sbus_conn_send(ctx->rctx->mon_conn, msg, 30000,
+                         ifp_get_stats_done, state, &state->pending);
+    dbus_message_unref(msg);
+    if (ret != EOK) {
+        error = sbus_error_new(dbus_req, DBUS_ERROR_FAILED,
+                               "Unable to contact the monitor");
+        return sbus_request_fail_and_finish(dbus_req, error);
+    }
+
+    talloc_set_destructor(state, ifp_get_stats_state_destructor);
+
+    return EOK;
+}
+
 int ifp_component_enable(struct sbus_request *dbus_req, void *data)
 {
 #ifndef HAVE_CONFIG_LIB
@@ -42,6 +42,8 @@ int ifp_find_backend_by_name(struct sbus_request *dbus_req,
                              void *data,
                              const char *arg_name);
 
+int ifp_get_stats(struct sbus_request *dbus_req, void *data);
+
 /* org.freedesktop.sssd.infopipe.Components */
 
 int ifp_component_enable(struct sbus_request *dbus_req, void *data);
@@ -96,6 +96,10 @@ static int ifp_groups_list_copy(struct ifp_list_ctx *list_ctx,
         if (list_ctx->paths[list_ctx->path_count + i] == NULL) {
             return ENOMEM;
         }
+
+        ifp_object_memo_add(list_ctx->ctx,
+                            list_ctx->paths[list_ctx->path_count + i],
+                            list_ctx->dom, result->msgs[i]);
     }
 
     list_ctx->path_count += copy_count;
@@ -160,6 +164,9 @@ ifp_groups_find_by_name_done(struct tevent_req *req)
         goto done;
     }
 
+    ifp_object_memo_add(sbus_req->intf->handler_data, object_path, domain,
+                        result->msgs[0]);
+
     ret = EOK;
 
 done:
@@ -230,6 +237,9 @@ ifp_groups_find_by_id_done(struct tevent_req *req)
         goto done;
     }
 
+    ifp_object_memo_add(sbus_req->intf->handler_data, object_path, domain,
+                        result->msgs[0]);
+
 done:
     if (ret != EOK) {
         sbus_request_fail_and_finish(sbus_req, error);
@@ -439,6 +449,10 @@ ifp_groups_group_get(struct sbus_request *sbus_req,
     }
 
     if (_group != NULL) {
+        ret = ifp_object_memo_get(ctx, sbus_req->path, &domain, _group);
+    }
+
+    if (_group != NULL && ret != EOK) {
         ret = sysdb_getgrgid_with_views(sbus_req, domain, gid, &res);
         if (ret == EOK && res->count == 0) {
             *_group = NULL;
@@ -450,6 +464,7 @@ ifp_groups_group_get(struct sbus_request *sbus_req,
                   gid, domain->name, ret, sss_strerror(ret));
         } else {
             *_group = res->msgs[0];
+            ifp_object_memo_add(ctx, sbus_req->path, domain, *_group);
         }
     }
 
@@ -558,6 +573,9 @@ static void resolv_ghosts_group_done(struct tevent_req *subreq)
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct resolv_ghosts_state);
 
+    /* the group was just refreshed, do not use the remembered copy */
+    ifp_object_memo_remove(state->ctx, state->sbus_req->path);
+
     ret = ifp_groups_group_get(state->sbus_req, state->data, NULL,
                                &state->domain, &group);
     if (ret != EOK) {
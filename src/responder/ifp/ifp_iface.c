@@ -43,6 +43,7 @@ struct iface_ifp iface_ifp = {
     .GetUserGroups = ifp_user_get_groups,
     .ListDomains = ifp_list_domains,
     .FindDomainByName = ifp_find_domain_by_name,
+    .GetStats = ifp_get_stats,
 };
 
 struct iface_ifp_components iface_ifp_components = {
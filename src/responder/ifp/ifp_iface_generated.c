@@ -172,6 +172,19 @@ int iface_ifp_ListDomains_finish(struct sbus_request *req, const char *arg_domai
                                          DBUS_TYPE_INVALID);
 }
 
+/* arguments for org.freedesktop.sssd.infopipe.GetStats */
+const struct sbus_arg_meta iface_ifp_GetStats__out[] = {
+    { "stats", "s" },
+    { NULL, }
+};
+
+int iface_ifp_GetStats_finish(struct sbus_request *req, const char *arg_stats)
+{
+   return sbus_request_return_and_finish(req,
+                                         DBUS_TYPE_STRING, &arg_stats,
+                                         DBUS_TYPE_INVALID);
+}
+
 /* methods for org.freedesktop.sssd.infopipe */
 const struct sbus_method_meta iface_ifp__methods[] = {
     {
@@ -251,6 +264,13 @@ const struct sbus_method_meta iface_ifp__methods[] = {
         offsetof(struct iface_ifp, ListDomains),
         NULL, /* no invoker */
     },
+    {
+        "GetStats", /* name */
+        NULL, /* no in_args */
+        iface_ifp_GetStats__out,
+        offsetof(struct iface_ifp, GetStats),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
@@ -24,6 +24,7 @@
 #define IFACE_IFP_GETUSERGROUPS "GetUserGroups"
 #define IFACE_IFP_FINDDOMAINBYNAME "FindDomainByName"
 #define IFACE_IFP_LISTDOMAINS "ListDomains"
+#define IFACE_IFP_GETSTATS "GetStats"
 
 /* constants for org.freedesktop.sssd.infopipe.Components */
 #define IFACE_IFP_COMPONENTS "org.freedesktop.sssd.infopipe.Components"
@@ -138,6 +139,7 @@ struct iface_ifp {
     int (*GetUserGroups)(struct sbus_request *req, void *data, const char *arg_user);
     int (*FindDomainByName)(struct sbus_request *req, void *data, const char *arg_name);
     int (*ListDomains)(struct sbus_request *req, void *data);
+    int (*GetStats)(struct sbus_request *req, void *data);
 };
 
 /* finish function for ListComponents */
@@ -167,6 +169,9 @@ int iface_ifp_FindDomainByName_finish(struct sbus_request *req, const char *arg_
 /* finish function for ListDomains */
 int iface_ifp_ListDomains_finish(struct sbus_request *req, const char *arg_domain[], int len_domain);
 
+/* finish function for GetStats */
+int iface_ifp_GetStats_finish(struct sbus_request *req, const char *arg_stats);
+
 /* vtable for org.freedesktop.sssd.infopipe.Components */
 struct iface_ifp_components {
     struct sbus_vtable vtable; /* derive from sbus_vtable */
@@ -41,6 +41,9 @@ struct ifp_ctx {
     struct sysbus_ctx *sysbus;
     const char **user_whitelist;
     uint32_t wildcard_limit;
+
+    /* users and groups recently read from sysdb, keyed by object path */
+    hash_table_t *object_memo;
 };
 
 errno_t ifp_register_sbus_interface(struct sbus_connection *conn,
@@ -110,4 +113,20 @@ errno_t ifp_ldb_el_output_name(struct resp_ctx *rctx,
 char *ifp_format_name_attr(TALLOC_CTX *mem_ctx, struct ifp_ctx *ifp_ctx,
                            const char *in_name, struct sss_domain_info *dom);
 
+/* Objects are remembered for a short while after they are read, so that
+ * GetAll or a property read right after ListByName does not search sysdb
+ * once for every property. The returned message belongs to the memo and is
+ * only valid until the memo is called again. */
+errno_t ifp_object_memo_get(struct ifp_ctx *ifp_ctx,
+                            const char *path,
+                            struct sss_domain_info **_domain,
+                            struct ldb_message **_msg);
+
+void ifp_object_memo_add(struct ifp_ctx *ifp_ctx,
+                         const char *path,
+                         struct sss_domain_info *domain,
+                         struct ldb_message *msg);
+
+void ifp_object_memo_remove(struct ifp_ctx *ifp_ctx, const char *path);
+
 #endif /* _IFPSRV_PRIVATE_H_ */
@@ -141,6 +141,9 @@ ifp_users_find_by_name_done(struct tevent_req *req)
         goto done;
     }
 
+    ifp_object_memo_add(sbus_req->intf->handler_data, object_path, domain,
+                        result->msgs[0]);
+
     ret = EOK;
 
 done:
@@ -211,6 +214,9 @@ ifp_users_find_by_id_done(struct tevent_req *req)
         goto done;
     }
 
+    ifp_object_memo_add(sbus_req->intf->handler_data, object_path, domain,
+                        result->msgs[0]);
+
 done:
     if (ret != EOK) {
         sbus_request_fail_and_finish(sbus_req, error);
@@ -296,6 +302,9 @@ static void ifp_users_find_by_cert_done(struct tevent_req *req)
         goto done;
     }
 
+    ifp_object_memo_add(sbus_req->intf->handler_data, object_path, domain,
+                        result->msgs[0]);
+
 done:
     if (ret != EOK) {
         sbus_request_fail_and_finish(sbus_req, error);
@@ -321,6 +330,10 @@ static int ifp_users_list_copy(struct ifp_list_ctx *list_ctx,
         if (list_ctx->paths[list_ctx->path_count + i] == NULL) {
             return ENOMEM;
         }
+
+        ifp_object_memo_add(list_ctx->ctx,
+                            list_ctx->paths[list_ctx->path_count + i],
+                            list_ctx->dom, result->msgs[i]);
     }
 
     list_ctx->path_count += copy_count;
@@ -491,6 +504,9 @@ static void ifp_users_list_by_domain_and_name_done(struct tevent_req *req)
                                    "Failed to compose object path");
             goto done;
         }
+
+        ifp_object_memo_add(list_ctx->ctx, list_ctx->paths[i],
+                            list_ctx->dom, result->msgs[i]);
     }
 
     list_ctx->path_count += copy_count;
@@ -528,6 +544,10 @@ ifp_users_user_get(struct sbus_request *sbus_req,
     }
 
     if (_user != NULL) {
+        ret = ifp_object_memo_get(ifp_ctx, sbus_req->path, &domain, _user);
+    }
+
+    if (_user != NULL && ret != EOK) {
         ret = sysdb_getpwuid_with_views(sbus_req, domain, uid, &res);
         if (ret == EOK && res->count == 0) {
             *_user = NULL;
@@ -539,6 +559,7 @@ ifp_users_user_get(struct sbus_request *sbus_req,
                   uid, domain->name, ret, sss_strerror(ret));
         } else {
             *_user = res->msgs[0];
+            ifp_object_memo_add(ifp_ctx, sbus_req->path, domain, *_user);
         }
     }
 
@@ -712,6 +733,10 @@ static void ifp_users_user_update_groups_list_done(struct tevent_req *req)
 
     ret = cache_req_initgr_by_name_recv(sbus_req, req, NULL, NULL, NULL);
     talloc_zfree(req);
+
+    /* the user was refreshed, read it from sysdb next time */
+    ifp_object_memo_remove(sbus_req->intf->handler_data, sbus_req->path);
+
     if (ret == ENOENT) {
         error = sbus_error_new(sbus_req, SBUS_ERROR_NOT_FOUND,
                                "User not found");
@@ -56,6 +56,7 @@ struct mon_cli_iface monitor_ifp_methods = {
     .resetOffline = NULL,
     .rotateLogs = responder_logrotate,
     .sysbusReconnect = ifp_sysbus_reconnect,
+    .getStats = monitor_common_get_stats,
 };
 
 struct sss_cmd_table *get_ifp_cmds(void)
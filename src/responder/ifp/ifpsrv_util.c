@@ -22,6 +22,7 @@
 */
 
 #include <sys/param.h>
+#include <time.h>
 
 #include "db/sysdb.h"
 #include "responder/ifp/ifp_private.h"
@@ -32,6 +33,11 @@
                                 "groups", \
                                 NULL}
 
+/* How long, in seconds, a memoized object is served without reading sysdb */
+#define IFP_OBJECT_MEMO_TTL 1
+/* The memo is emptied when it holds this many objects */
+#define IFP_OBJECT_MEMO_MAX 1024
+
 errno_t ifp_req_create(struct sbus_request *dbus_req,
                        struct ifp_ctx *ifp_ctx,
                        struct ifp_req **_ifp_req)
@@ -419,3 +425,128 @@ done:
     talloc_free(tmp_ctx);
     return ret_name;
 }
+
+struct ifp_object_memo_entry {
+    struct sss_domain_info *domain;
+    struct ldb_message *msg;
+    time_t expire;
+};
+
+errno_t ifp_object_memo_get(struct ifp_ctx *ifp_ctx,
+                            const char *path,
+                            struct sss_domain_info **_domain,
+                            struct ldb_message **_msg)
+{
+    struct ifp_object_memo_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    if (ifp_ctx->object_memo == NULL) {
+        return ENOENT;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(path);
+
+    hret = hash_lookup(ifp_ctx->object_memo, &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        return ENOENT;
+    } else if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to look up [%s] in object "
+              "memo: %s\n", path, hash_error_string(hret));
+        return EIO;
+    }
+
+    entry = talloc_get_type(value.ptr, struct ifp_object_memo_entry);
+    if (entry->expire < time(NULL)) {
+        ifp_object_memo_remove(ifp_ctx, path);
+        return ENOENT;
+    }
+
+    *_domain = entry->domain;
+    *_msg = entry->msg;
+
+    return EOK;
+}
+
+void ifp_object_memo_add(struct ifp_ctx *ifp_ctx,
+                         const char *path,
+                         struct sss_domain_info *domain,
+                         struct ldb_message *msg)
+{
+    struct ifp_object_memo_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (path == NULL || msg == NULL) {
+        return;
+    }
+
+    if (ifp_ctx->object_memo != NULL
+            && hash_count(ifp_ctx->object_memo) >= IFP_OBJECT_MEMO_MAX) {
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Object memo is full, emptying it\n");
+        talloc_zfree(ifp_ctx->object_memo);
+    }
+
+    if (ifp_ctx->object_memo == NULL) {
+        ret = sss_hash_create(ifp_ctx, IFP_OBJECT_MEMO_MAX / 4,
+                              &ifp_ctx->object_memo);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to create object memo "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+            return;
+        }
+    }
+
+    ifp_object_memo_remove(ifp_ctx, path);
+
+    entry = talloc_zero(ifp_ctx->object_memo, struct ifp_object_memo_entry);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->domain = domain;
+    entry->expire = time(NULL) + IFP_OBJECT_MEMO_TTL;
+    entry->msg = ldb_msg_copy(entry, msg);
+    if (entry->msg == NULL) {
+        talloc_free(entry);
+        return;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(path);
+    value.type = HASH_VALUE_PTR;
+    value.ptr = entry;
+
+    hret = hash_enter(ifp_ctx->object_memo, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to remember [%s]: %s\n",
+              path, hash_error_string(hret));
+        talloc_free(entry);
+    }
+}
+
+void ifp_object_memo_remove(struct ifp_ctx *ifp_ctx, const char *path)
+{
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    if (ifp_ctx->object_memo == NULL) {
+        return;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(path);
+
+    hret = hash_lookup(ifp_ctx->object_memo, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        return;
+    }
+
+    hash_delete(ifp_ctx->object_memo, &key);
+    talloc_free(value.ptr);
+}
@@ -49,6 +49,7 @@
 #include "monitor/monitor_interfaces.h"
 #include "sbus/sbus_client.h"
 #include "util/util_sss_idmap.h"
+#include "util/child_common.h"
 
 #define DEFAULT_PWFIELD "*"
 #define DEFAULT_NSS_FD_LIMIT 8192
@@ -56,8 +57,16 @@
 #define SHELL_REALLOC_INCREMENT 5
 #define SHELL_REALLOC_MAX       50
 
+/* negative cache shared by the main and the worker processes */
+#define NSS_SHARED_NEGCACHE DB_PATH"/negcache_nss.tdb"
+
+/* seconds to wait before a worker process that exited is started again */
+#define NSS_WORKER_RESTART_DELAY 1
+
 static int nss_clear_memcache(struct sbus_request *dbus_req, void *data);
 static int nss_clear_netgroup_hash_table(struct sbus_request *dbus_req, void *data);
+static int nss_rotate_logs(struct sbus_request *dbus_req, void *data);
+static void nss_workers_signal(struct nss_ctx *nctx, int signum);
 
 struct mon_cli_iface monitor_nss_methods = {
     { &mon_cli_iface_meta, 0 },
@@ -66,22 +75,104 @@ struct mon_cli_iface monitor_nss_methods = {
     .shutDown = NULL,
     .goOffline = NULL,
     .resetOffline = NULL,
-    .rotateLogs = responder_logrotate,
+    .rotateLogs = nss_rotate_logs,
     .clearMemcache = nss_clear_memcache,
     .clearEnumCache = nss_clear_netgroup_hash_table,
     .sysbusReconnect = NULL,
+    .getStats = monitor_common_get_stats,
 };
 
+/* Drops the entries listed in the CLEAR_MC_FLAG file from the memory
+ * caches. Returns ENOENT if the file lists no entries. */
+static errno_t nss_clear_memcache_entries(struct nss_ctx *nctx,
+                                          FILE *flag,
+                                          bool *_reinit_initgr)
+{
+    struct sss_domain_info *dom;
+    char line[1024];
+    char *domain;
+    char *name;
+    char *nl;
+    size_t count = 0;
+    errno_t ret;
+
+    while (fgets(line, sizeof(line), flag) != NULL) {
+        nl = strchr(line, '\n');
+        if (nl != NULL) {
+            *nl = '\0';
+        }
+
+        domain = strchr(line, '\t');
+        name = domain == NULL ? NULL : strchr(domain + 1, '\t');
+        if (name == NULL) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Malformed line [%s]\n", line);
+            return EINVAL;
+        }
+        *domain++ = '\0';
+        *name++ = '\0';
+
+        dom = responder_get_domain(nctx->rctx, domain);
+        if (dom == NULL) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unknown domain [%s]\n", domain);
+            continue;
+        }
+
+        if (strcmp(line, SSS_MC_ENTRY_PASSWD) == 0) {
+            ret = delete_entry_from_memcache(dom, name, nctx->rctx,
+                                             nctx->pwd_mc_ctx, SSS_MC_PASSWD);
+            if (ret == EOK) {
+                ret = delete_entry_from_memcache(dom, name, nctx->rctx,
+                                                 nctx->initgr_mc_ctx,
+                                                 SSS_MC_INITGROUPS);
+            }
+        } else if (strcmp(line, SSS_MC_ENTRY_GROUP) == 0) {
+            ret = delete_entry_from_memcache(dom, name, nctx->rctx,
+                                             nctx->grp_mc_ctx, SSS_MC_GROUP);
+            /* the members' group lists are not known here */
+            *_reinit_initgr = true;
+        } else {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unknown type [%s]\n", line);
+            return EINVAL;
+        }
+
+        if (ret != EOK) {
+            return ret;
+        }
+        count++;
+    }
+
+    if (ferror(flag)) {
+        return EIO;
+    }
+
+    if (count == 0) {
+        return ENOENT;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Removed %zu entries from memory caches.\n",
+          count);
+    return EOK;
+}
+
 static int nss_clear_memcache(struct sbus_request *dbus_req, void *data)
 {
     errno_t ret;
     int memcache_timeout;
     struct resp_ctx *rctx = talloc_get_type(data, struct resp_ctx);
     struct nss_ctx *nctx = (struct nss_ctx*) rctx->pvt_ctx;
+    FILE *flag;
+    bool reinit_initgr = false;
+
+    /* The file is read after it is removed so that a new request is not
+     * lost. */
+    flag = fopen(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG, "r");
 
     ret = unlink(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG);
     if (ret != 0) {
         ret = errno;
+        if (flag != NULL) {
+            fclose(flag);
+        }
         if (ret == ENOENT) {
             DEBUG(SSSDBG_TRACE_FUNC,
                   "CLEAR_MC_FLAG not found. Nothing to do.\n");
@@ -102,9 +193,26 @@ static int nss_clear_memcache(struct sbus_request *dbus_req, void *data)
     if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE,
               "Unable to get memory cache entry timeout.\n");
+        if (flag != NULL) {
+            fclose(flag);
+        }
         return ret;
     }
 
+    if (flag != NULL) {
+        ret = nss_clear_memcache_entries(nctx, flag, &reinit_initgr);
+        fclose(flag);
+        if (ret == EOK) {
+            if (reinit_initgr) {
+                goto initgroups;
+            }
+            goto done;
+        } else if (ret != ENOENT) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to remove listed entries "
+                  "[%d]: %s, clearing everything.\n", ret, sss_strerror(ret));
+        }
+    }
+
     /* TODO: read cache sizes from configuration */
     DEBUG(SSSDBG_TRACE_FUNC, "Clearing memory caches.\n");
     ret = sss_mmap_cache_reinit(nctx, SSS_MC_CACHE_ELEMENTS,
@@ -125,6 +233,7 @@ static int nss_clear_memcache(struct sbus_request *dbus_req, void *data)
         return ret;
     }
 
+initgroups:
     ret = sss_mmap_cache_reinit(nctx, SSS_MC_CACHE_ELEMENTS,
                                 (time_t)memcache_timeout,
                                 &nctx->initgr_mc_ctx);
@@ -144,6 +253,9 @@ static int nss_clear_netgroup_hash_table(struct sbus_request *dbus_req, void *da
     struct resp_ctx *rctx = talloc_get_type(data, struct resp_ctx);
     struct nss_ctx *nctx = (struct nss_ctx*) rctx->pvt_ctx;
 
+    /* the netgroups are cached by each process */
+    nss_workers_signal(nctx, SIGUSR2);
+
     ret = nss_orphan_netgroups(nctx);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -154,6 +266,17 @@ static int nss_clear_netgroup_hash_table(struct sbus_request *dbus_req, void *da
     return sbus_request_return_and_finish(dbus_req, DBUS_TYPE_INVALID);
 }
 
+static int nss_rotate_logs(struct sbus_request *dbus_req, void *data)
+{
+    struct resp_ctx *rctx = talloc_get_type(data, struct resp_ctx);
+    struct nss_ctx *nctx = (struct nss_ctx*) rctx->pvt_ctx;
+
+    /* SIGHUP makes the workers reopen their log files */
+    nss_workers_signal(nctx, SIGHUP);
+
+    return responder_logrotate(dbus_req, data);
+}
+
 static errno_t nss_get_etc_shells(TALLOC_CTX *mem_ctx, char ***_shells)
 {
     int i = 0;
@@ -373,15 +496,261 @@ static void nss_dp_reconnect_init(struct sbus_connection *conn,
     /* nss_shutdown(rctx); */
 }
 
+/* The main process, started by the monitor, starts worker processes that
+ * accept the clients on the same listening socket. They share the memory
+ * caches and the negative cache with the main process but they are not
+ * known to the monitor, the main process restarts them and passes on the
+ * monitor's requests. */
+struct nss_worker {
+    struct nss_workers *workers;
+    int id;
+    pid_t pid;
+    struct sss_child_ctx_old *child_ctx;
+};
+
+struct nss_workers {
+    struct nss_ctx *nctx;
+    const char **argv;
+    int argc;
+    struct nss_worker **list;
+    int num;
+};
+
+static errno_t nss_worker_start(struct nss_worker *worker);
+
+static void nss_worker_restart(struct tevent_context *ev,
+                               struct tevent_timer *te,
+                               struct timeval tv,
+                               void *pvt)
+{
+    struct nss_worker *worker = talloc_get_type(pvt, struct nss_worker);
+    errno_t ret;
+
+    ret = nss_worker_start(worker);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to restart worker %d [%d]: %s\n",
+              worker->id, ret, sss_strerror(ret));
+    }
+}
+
+static void nss_worker_exited(int child_status,
+                              struct tevent_signal *sige,
+                              void *pvt)
+{
+    struct nss_worker *worker = talloc_get_type(pvt, struct nss_worker);
+    struct tevent_context *ev = worker->workers->nctx->rctx->ev;
+    struct tevent_timer *te;
+    struct timeval tv;
+
+    DEBUG(SSSDBG_OP_FAILURE, "Worker %d [%d] exited, restarting it\n",
+          worker->id, worker->pid);
+
+    worker->pid = -1;
+    worker->child_ctx = NULL;
+
+    tv = tevent_timeval_current_ofs(NSS_WORKER_RESTART_DELAY, 0);
+    te = tevent_add_timer(ev, worker, tv, nss_worker_restart, worker);
+    if (te == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to schedule restart of worker %d\n", worker->id);
+    }
+}
+
+static errno_t nss_worker_start(struct nss_worker *worker)
+{
+    struct nss_workers *workers = worker->workers;
+    struct resp_ctx *rctx = workers->nctx->rctx;
+    const char **argv;
+    pid_t pid;
+    errno_t ret;
+    int i;
+
+    /* the arguments the main process got, the worker number and the
+     * listening socket */
+    argv = talloc_zero_array(worker, const char *, workers->argc + 3);
+    if (argv == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < workers->argc; i++) {
+        argv[i] = workers->argv[i];
+    }
+
+    argv[i++] = talloc_asprintf(argv, "--worker=%d", worker->id);
+    argv[i++] = talloc_asprintf(argv, "--listen-fd=%d", rctx->lfd);
+    if (argv[i - 2] == NULL || argv[i - 1] == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    sss_debug_prepare_fork();
+    pid = fork();
+    if (pid == 0) {
+        /* the socket is created with FD_CLOEXEC */
+        ret = fcntl(rctx->lfd, F_SETFD, 0);
+        if (ret == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Unable to pass the listening socket [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            _exit(1);
+        }
+
+        execv(SSSD_LIBEXEC_PATH"/sssd_nss", discard_const(argv));
+
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "execv failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        _exit(1);
+    } else if (pid == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "fork failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    worker->pid = pid;
+
+    ret = child_handler_setup(rctx->ev, pid, nss_worker_exited, worker,
+                              &worker->child_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to watch worker %d [%d]: %s\n",
+              worker->id, ret, sss_strerror(ret));
+        /* the worker still serves the clients, it is just not restarted */
+        ret = EOK;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Started worker %d [%d]\n", worker->id, pid);
+    ret = EOK;
+
+done:
+    talloc_free(argv);
+    return ret;
+}
+
+static int nss_workers_destructor(struct nss_workers *workers)
+{
+    int i;
+
+    for (i = 0; i < workers->num; i++) {
+        if (workers->list[i] != NULL && workers->list[i]->child_ctx != NULL) {
+            /* kills the worker */
+            child_handler_destroy(workers->list[i]->child_ctx);
+            workers->list[i]->child_ctx = NULL;
+        }
+    }
+
+    return 0;
+}
+
+static errno_t nss_workers_init(struct nss_ctx *nctx,
+                                int num,
+                                int argc,
+                                const char **argv)
+{
+    struct nss_workers *workers;
+    errno_t ret;
+    int i;
+
+    workers = talloc_zero(nctx, struct nss_workers);
+    if (workers == NULL) {
+        return ENOMEM;
+    }
+
+    workers->nctx = nctx;
+    workers->argc = argc;
+    workers->argv = argv;
+    workers->num = num;
+
+    workers->list = talloc_zero_array(workers, struct nss_worker *, num);
+    if (workers->list == NULL) {
+        talloc_free(workers);
+        return ENOMEM;
+    }
+    talloc_set_destructor(workers, nss_workers_destructor);
+
+    nctx->workers = workers;
+
+    for (i = 0; i < num; i++) {
+        workers->list[i] = talloc_zero(workers->list, struct nss_worker);
+        if (workers->list[i] == NULL) {
+            return ENOMEM;
+        }
+
+        workers->list[i]->workers = workers;
+        workers->list[i]->id = i + 1;
+        workers->list[i]->pid = -1;
+
+        ret = nss_worker_start(workers->list[i]);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to start worker %d [%d]: %s\n",
+                  i + 1, ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+static void nss_workers_signal(struct nss_ctx *nctx, int signum)
+{
+    struct nss_workers *workers = nctx->workers;
+    int ret;
+    int i;
+
+    if (workers == NULL) {
+        return;
+    }
+
+    for (i = 0; i < workers->num; i++) {
+        if (workers->list[i] == NULL || workers->list[i]->pid == -1) {
+            continue;
+        }
+
+        ret = kill(workers->list[i]->pid, signum);
+        if (ret == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Unable to signal worker %d [%d]: %s\n",
+                  workers->list[i]->id, ret, sss_strerror(ret));
+        }
+    }
+}
+
+static void nss_worker_clear_netgroups(struct tevent_context *ev,
+                                       struct tevent_signal *se,
+                                       int signum,
+                                       int count,
+                                       void *siginfo,
+                                       void *private_data)
+{
+    struct nss_ctx *nctx = talloc_get_type(private_data, struct nss_ctx);
+    errno_t ret;
+
+    ret = nss_orphan_netgroups(nctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not invalidate netgroups\n");
+    }
+}
+
 int nss_process_init(TALLOC_CTX *mem_ctx,
                      struct tevent_context *ev,
-                     struct confdb_ctx *cdb)
+                     struct confdb_ctx *cdb,
+                     int argc,
+                     const char **argv,
+                     int worker_id,
+                     int listen_fd)
 {
     struct resp_ctx *rctx;
     struct sss_cmd_table *nss_cmds;
     struct be_conn *iter;
     struct nss_ctx *nctx;
+    struct tevent_signal *tes;
     int memcache_timeout;
+    int worker_processes;
+    bool shared;
     int ret, max_retries;
     enum idmap_error_code err;
     int hret;
@@ -389,13 +758,14 @@ int nss_process_init(TALLOC_CTX *mem_ctx,
 
     nss_cmds = get_nss_cmds();
 
+    /* only the main process is known to the monitor */
     ret = sss_process_init(mem_ctx, ev, cdb,
                            nss_cmds,
-                           SSS_NSS_SOCKET_NAME, -1, NULL, -1,
+                           SSS_NSS_SOCKET_NAME, listen_fd, NULL, -1,
                            CONFDB_NSS_CONF_ENTRY,
                            NSS_SBUS_SERVICE_NAME,
                            NSS_SBUS_SERVICE_VERSION,
-                           &monitor_nss_methods,
+                           worker_id == 0 ? &monitor_nss_methods : NULL,
                            "NSS",
                            nss_get_sbus_interface(),
                            nss_connection_setup,
@@ -414,6 +784,25 @@ int nss_process_init(TALLOC_CTX *mem_ctx,
 
     nctx->rctx = rctx;
     nctx->rctx->pvt_ctx = nctx;
+    nctx->worker_id = worker_id;
+
+    ret = confdb_get_int(cdb, CONFDB_NSS_CONF_ENTRY,
+                         CONFDB_NSS_WORKER_PROCESSES, 1, &worker_processes);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to get 'worker_processes' option from confdb.\n");
+        goto fail;
+    }
+    shared = worker_processes > 1 || worker_id > 0;
+
+    /* before the negative cache is prepopulated */
+    if (shared) {
+        ret = sss_ncache_share(rctx->ncache, NSS_SHARED_NEGCACHE);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "The negative cache is not shared "
+                  "with the other processes\n");
+        }
+    }
 
     ret = nss_get_config(nctx, cdb);
     if (ret != EOK) {
@@ -455,6 +844,42 @@ int nss_process_init(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    ret = confdb_get_int(nctx->rctx->cdb,
+                         CONFDB_NSS_CONF_ENTRY,
+                         CONFDB_MEMCACHE_TIMEOUT,
+                         300, &memcache_timeout);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Failed to get 'memcache_timeout' option from confdb.\n");
+        goto fail;
+    }
+
+    if (worker_id > 0) {
+        /* the main process created the mmap caches */
+        ret = sss_mmap_cache_attach(nctx, "passwd", SSS_MC_PASSWD,
+                                    (time_t)memcache_timeout,
+                                    &nctx->pwd_mc_ctx);
+        if (ret) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "passwd mmap cache is DISABLED\n");
+        }
+
+        ret = sss_mmap_cache_attach(nctx, "group", SSS_MC_GROUP,
+                                    (time_t)memcache_timeout,
+                                    &nctx->grp_mc_ctx);
+        if (ret) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "group mmap cache is DISABLED\n");
+        }
+
+        ret = sss_mmap_cache_attach(nctx, "initgroups", SSS_MC_INITGROUPS,
+                                    (time_t)memcache_timeout,
+                                    &nctx->initgr_mc_ctx);
+        if (ret) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "inigroups mmap cache is DISABLED\n");
+        }
+
+        goto mmap_done;
+    }
+
     /* create mmap caches */
     /* Remove the CLEAR_MC_FLAG file if exists. */
     ret = unlink(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG);
@@ -466,38 +891,29 @@ int nss_process_init(TALLOC_CTX *mem_ctx,
                SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG, ret, strerror(ret));
     }
 
-    ret = confdb_get_int(nctx->rctx->cdb,
-                         CONFDB_NSS_CONF_ENTRY,
-                         CONFDB_MEMCACHE_TIMEOUT,
-                         300, &memcache_timeout);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_FATAL_FAILURE,
-              "Failed to get 'memcache_timeout' option from confdb.\n");
-        goto fail;
-    }
-
     /* TODO: read cache sizes from configuration */
     ret = sss_mmap_cache_init(nctx, "passwd", SSS_MC_PASSWD,
                               SSS_MC_CACHE_ELEMENTS, (time_t)memcache_timeout,
-                              &nctx->pwd_mc_ctx);
+                              shared, &nctx->pwd_mc_ctx);
     if (ret) {
         DEBUG(SSSDBG_CRIT_FAILURE, "passwd mmap cache is DISABLED\n");
     }
 
     ret = sss_mmap_cache_init(nctx, "group", SSS_MC_GROUP,
                               SSS_MC_CACHE_ELEMENTS, (time_t)memcache_timeout,
-                              &nctx->grp_mc_ctx);
+                              shared, &nctx->grp_mc_ctx);
     if (ret) {
         DEBUG(SSSDBG_CRIT_FAILURE, "group mmap cache is DISABLED\n");
     }
 
     ret = sss_mmap_cache_init(nctx, "initgroups", SSS_MC_INITGROUPS,
                               SSS_MC_CACHE_ELEMENTS, (time_t)memcache_timeout,
-                              &nctx->initgr_mc_ctx);
+                              shared, &nctx->initgr_mc_ctx);
     if (ret) {
         DEBUG(SSSDBG_CRIT_FAILURE, "inigroups mmap cache is DISABLED\n");
     }
 
+mmap_done:
     /* Set up file descriptor limits */
     ret = confdb_get_int(nctx->rctx->cdb,
                          CONFDB_NSS_CONF_ENTRY,
@@ -523,6 +939,25 @@ int nss_process_init(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    if (worker_id > 0) {
+        /* The main process passes on the requests to clear the netgroups
+         * as SIGUSR2, log rotation is requested with SIGHUP as usual. */
+        BlockSignals(false, SIGUSR2);
+        tes = tevent_add_signal(ev, nctx, SIGUSR2, 0,
+                                nss_worker_clear_netgroups, nctx);
+        if (tes == NULL) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Unable to setup SIGUSR2 handler\n");
+            ret = EIO;
+            goto fail;
+        }
+    } else if (worker_processes > 1) {
+        ret = nss_workers_init(nctx, worker_processes - 1, argc, argv);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Not all worker processes were "
+                  "started, the clients are served by fewer processes\n");
+        }
+    }
+
     DEBUG(SSSDBG_TRACE_FUNC, "NSS Initialization complete\n");
 
     return EOK;
@@ -537,6 +972,9 @@ int main(int argc, const char *argv[])
     int opt;
     poptContext pc;
     struct main_context *main_ctx;
+    const char *prg_name = "sssd[nss]";
+    int worker_id = 0;
+    int listen_fd = -1;
     int ret;
     uid_t uid;
     gid_t gid;
@@ -545,6 +983,10 @@ int main(int argc, const char *argv[])
         POPT_AUTOHELP
         SSSD_MAIN_OPTS
         SSSD_SERVER_OPTS(uid, gid)
+        {"worker", 0, POPT_ARG_INT, &worker_id, 0,
+         _("Number of the worker process (internal)"), NULL },
+        {"listen-fd", 0, POPT_ARG_INT, &listen_fd, 0,
+         _("Listening socket passed by the main process (internal)"), NULL },
         POPT_TABLEEND
     };
 
@@ -571,7 +1013,21 @@ int main(int argc, const char *argv[])
     /* set up things like debug, signals, daemonization, etc... */
     debug_log_file = "sssd_nss";
 
-    ret = server_setup("sssd[nss]", 0, uid, gid, CONFDB_NSS_CONF_ENTRY,
+    if (worker_id > 0) {
+        if (listen_fd == -1) {
+            fprintf(stderr, "\n--listen-fd is required with --worker\n\n");
+            return 1;
+        }
+
+        /* each worker writes its own log file */
+        debug_log_file = talloc_asprintf(NULL, "sssd_nss_%d", worker_id);
+        prg_name = talloc_asprintf(NULL, "sssd[nss:%d]", worker_id);
+        if (debug_log_file == NULL || prg_name == NULL) {
+            return 2;
+        }
+    }
+
+    ret = server_setup(prg_name, 0, uid, gid, CONFDB_NSS_CONF_ENTRY,
                        &main_ctx);
     if (ret != EOK) return 2;
 
@@ -584,7 +1040,9 @@ int main(int argc, const char *argv[])
 
     ret = nss_process_init(main_ctx,
                            main_ctx->event_ctx,
-                           main_ctx->confdb_ctx);
+                           main_ctx->confdb_ctx,
+                           argc, argv,
+                           worker_id, listen_fd);
     if (ret != EOK) return 3;
 
     /* loop on main */
@@ -40,6 +40,7 @@
 
 struct getent_ctx;
 struct sss_mc_ctx;
+struct nss_workers;
 
 struct nss_ctx {
     struct resp_ctx *rctx;
@@ -75,6 +76,11 @@ struct nss_ctx {
     struct sss_names_ctx *global_names;
 
     const char **extra_attributes;
+
+    /* 0 in the main process, the worker processes it starts to serve
+     * the clients as well are numbered from 1 */
+    int worker_id;
+    struct nss_workers *workers;
 };
 
 struct nss_packet;
@@ -748,6 +748,11 @@ errno_t check_cache(struct nss_dom_ctx *dctx,
         ret = sss_cmd_check_cache(res->msgs[0],
                                   nctx->cache_refresh_percent,
                                   cacheExpire);
+        if (ret == EOK || ret == EAGAIN) {
+            sss_access_stats_record(cctx->rctx, dctx->domain, req_type,
+                                    res->msgs[0]);
+        }
+
         if (ret == EOK || (ret == EAGAIN && refreshed_on_bg))  {
             DEBUG(SSSDBG_TRACE_FUNC, "Cached entry is valid, returning..\n");
             return EOK;
@@ -856,11 +861,11 @@ static void nsssrv_dp_send_acct_req_done(struct tevent_req *req)
     cb_ctx->callback(err_maj, err_min, err_msg, cb_ctx->ptr);
 }
 
-static int delete_entry_from_memcache(struct sss_domain_info *dom,
-                                      char *name,
-                                      struct resp_ctx *rctx,
-                                      struct sss_mc_ctx *mc_ctx,
-                                      enum sss_mc_type type)
+int delete_entry_from_memcache(struct sss_domain_info *dom,
+                               char *name,
+                               struct resp_ctx *rctx,
+                               struct sss_mc_ctx *mc_ctx,
+                               enum sss_mc_type type)
 {
     TALLOC_CTX *tmp_ctx = NULL;
     struct sized_string *delete_name;
@@ -5022,16 +5027,11 @@ done:
     return ret;
 }
 
-static errno_t fill_id(struct sss_packet *packet,
-                       enum sss_id_type id_type,
-                       struct ldb_message *msg)
+static errno_t get_posix_id(enum sss_id_type id_type,
+                            struct ldb_message *msg,
+                            uint32_t *_id)
 {
-    int ret;
-    uint8_t *body;
-    size_t blen;
-    size_t pctr = 0;
     uint64_t tmp_id;
-    uint32_t id;
 
     if (id_type == SSS_ID_TYPE_GID) {
         tmp_id = ldb_msg_find_attr_as_uint64(msg, SYSDB_GIDNUM, 0);
@@ -5043,7 +5043,25 @@ static errno_t fill_id(struct sss_packet *packet,
         DEBUG(SSSDBG_CRIT_FAILURE, "Invalid POSIX ID.\n");
         return EINVAL;
     }
-    id = (uint32_t) tmp_id;
+
+    *_id = (uint32_t) tmp_id;
+    return EOK;
+}
+
+static errno_t fill_id(struct sss_packet *packet,
+                       enum sss_id_type id_type,
+                       struct ldb_message *msg)
+{
+    int ret;
+    uint8_t *body;
+    size_t blen;
+    size_t pctr = 0;
+    uint32_t id;
+
+    ret = get_posix_id(id_type, msg, &id);
+    if (ret != EOK) {
+        return ret;
+    }
 
     ret = sss_packet_grow(packet, 4 * sizeof(uint32_t));
     if (ret != EOK) {
@@ -5299,6 +5317,349 @@ done:
     return nss_cmd_done(cmdctx, ret);
 }
 
+/* Maximal number of SIDs of a SSS_NSS_GETIDSBYSIDS request which are looked
+ * up concurrently, to avoid flooding the backends with requests */
+#define NSS_GETIDSBYSIDS_MAX_ACTIVE 32
+
+struct nss_getidsbysids_ctx {
+    struct cli_ctx *cctx;
+    struct nss_ctx *nctx;
+
+    uint32_t num_sids;
+    const char **sids;
+
+    /* per SID results, sent back in the order of the request */
+    uint32_t *errs;
+    uint32_t *types;
+    uint32_t *ids;
+
+    uint32_t next;
+    uint32_t num_active;
+    uint32_t num_done;
+};
+
+static void nss_getidsbysids_domains_done(struct tevent_req *req);
+static void nss_getidsbysids_step(struct nss_getidsbysids_ctx *bctx);
+static void nss_getidsbysids_sid_done(struct tevent_req *req);
+
+struct nss_getidsbysids_sid_ctx {
+    struct nss_getidsbysids_ctx *bctx;
+    uint32_t idx;
+};
+
+static errno_t nss_getidsbysids_parse(struct nss_getidsbysids_ctx *bctx,
+                                      uint8_t *body, size_t blen)
+{
+    enum idmap_error_code err;
+    uint8_t *bin_sid = NULL;
+    size_t bin_sid_length;
+    size_t pctr = 0;
+    uint8_t *end;
+    uint32_t c;
+
+    if (blen < sizeof(uint32_t) + 2) {
+        return EINVAL;
+    }
+
+    SAFEALIGN_COPY_UINT32(&bctx->num_sids, body, &pctr);
+
+    /* every SID needs at least a single character and the terminator */
+    if (bctx->num_sids == 0 || bctx->num_sids > (blen - pctr) / 2) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid number of SIDs [%"PRIu32"].\n",
+              bctx->num_sids);
+        return EINVAL;
+    }
+
+    bctx->sids = talloc_zero_array(bctx, const char *, bctx->num_sids);
+    bctx->errs = talloc_zero_array(bctx, uint32_t, bctx->num_sids);
+    bctx->types = talloc_zero_array(bctx, uint32_t, bctx->num_sids);
+    bctx->ids = talloc_zero_array(bctx, uint32_t, bctx->num_sids);
+    if (bctx->sids == NULL || bctx->errs == NULL
+            || bctx->types == NULL || bctx->ids == NULL) {
+        return ENOMEM;
+    }
+
+    for (c = 0; c < bctx->num_sids; c++) {
+        end = memchr(body + pctr, '\0', blen - pctr);
+        if (end == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "SID list is not terminated.\n");
+            return EINVAL;
+        }
+
+        bctx->sids[c] = (const char *) body + pctr;
+        pctr = end - body + 1;
+
+        /* A single invalid SID does not spoil the whole request */
+        err = sss_idmap_sid_to_bin_sid(bctx->nctx->idmap_ctx, bctx->sids[c],
+                                       &bin_sid, &bin_sid_length);
+        sss_idmap_free_bin_sid(bctx->nctx->idmap_ctx, bin_sid);
+        bin_sid = NULL;
+        if (err != IDMAP_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "sss_idmap_sid_to_bin_sid failed for [%s].\n",
+                  bctx->sids[c]);
+            bctx->errs[c] = EINVAL;
+        }
+    }
+
+    if (pctr != blen) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Trailing data after SID list.\n");
+        return EINVAL;
+    }
+
+    return EOK;
+}
+
+static int nss_cmd_getidsbysids(struct cli_ctx *cctx)
+{
+    struct nss_getidsbysids_ctx *bctx;
+    struct sss_domain_info *dom;
+    struct cli_protocol *pctx;
+    struct tevent_req *req;
+    bool refresh_domains = false;
+    uint8_t *body;
+    size_t blen;
+    uint32_t c;
+    errno_t ret;
+
+    pctx = talloc_get_type(cctx->protocol_ctx, struct cli_protocol);
+
+    bctx = talloc_zero(cctx, struct nss_getidsbysids_ctx);
+    if (bctx == NULL) {
+        return ENOMEM;
+    }
+    bctx->cctx = cctx;
+    bctx->nctx = talloc_get_type(cctx->rctx->pvt_ctx, struct nss_ctx);
+
+    sss_packet_get_body(pctx->creq->in, &body, &blen);
+
+    ret = nss_getidsbysids_parse(bctx, body, blen);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Running command [%d][%s] with [%"PRIu32"] "
+          "SIDs.\n", SSS_NSS_GETIDSBYSIDS, sss_cmd2str(SSS_NSS_GETIDSBYSIDS),
+          bctx->num_sids);
+
+    /* Refresh the list of (sub)domains at most once for the whole list
+     * instead of once per unknown SID */
+    for (c = 0; c < bctx->num_sids; c++) {
+        if (bctx->errs[c] != EOK) {
+            continue;
+        }
+
+        ret = responder_get_domain_by_id(cctx->rctx, bctx->sids[c], &dom);
+        if (ret == EAGAIN || ret == ENOENT) {
+            refresh_domains = true;
+            break;
+        }
+    }
+
+    if (refresh_domains) {
+        req = sss_dp_get_domains_send(bctx, cctx->rctx, true, NULL);
+        if (req == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        tevent_req_set_callback(req, nss_getidsbysids_domains_done, bctx);
+        return EOK;
+    }
+
+    nss_getidsbysids_step(bctx);
+    return EOK;
+
+done:
+    talloc_free(bctx);
+    ret = sss_cmd_send_error(cctx, ret);
+    if (ret != EOK) {
+        return EFAULT;
+    }
+    sss_cmd_done(cctx, NULL);
+    return EOK;
+}
+
+static void nss_getidsbysids_domains_done(struct tevent_req *req)
+{
+    struct nss_getidsbysids_ctx *bctx;
+    errno_t ret;
+
+    bctx = tevent_req_callback_data(req, struct nss_getidsbysids_ctx);
+
+    ret = sss_dp_get_domains_recv(req);
+    talloc_free(req);
+    if (ret != EOK) {
+        /* Continue with the domains we already know about */
+        DEBUG(SSSDBG_MINOR_FAILURE, "Cannot refresh subdomains [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+
+    nss_getidsbysids_step(bctx);
+}
+
+static errno_t nss_getidsbysids_send_reply(struct nss_getidsbysids_ctx *bctx)
+{
+    struct cli_protocol *pctx;
+    uint8_t *body;
+    size_t blen;
+    size_t pctr = 0;
+    uint32_t c;
+    errno_t ret;
+
+    pctx = talloc_get_type(bctx->cctx->protocol_ctx, struct cli_protocol);
+
+    ret = sss_packet_new(pctx->creq,
+                         (2 + 3 * bctx->num_sids) * sizeof(uint32_t),
+                         sss_packet_get_cmd(pctx->creq->in),
+                         &pctx->creq->out);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sss_packet_get_body(pctx->creq->out, &body, &blen);
+    SAFEALIGN_COPY_UINT32(body, &bctx->num_sids, &pctr); /* Num results */
+    SAFEALIGN_SETMEM_UINT32(body + pctr, 0, &pctr); /* reserved */
+    for (c = 0; c < bctx->num_sids; c++) {
+        SAFEALIGN_COPY_UINT32(body + pctr, &bctx->errs[c], &pctr);
+        SAFEALIGN_COPY_UINT32(body + pctr, &bctx->types[c], &pctr);
+        SAFEALIGN_COPY_UINT32(body + pctr, &bctx->ids[c], &pctr);
+    }
+
+    sss_packet_set_error(pctx->creq->out, EOK);
+    return EOK;
+}
+
+static errno_t nss_getidsbysids_lookup(struct nss_getidsbysids_ctx *bctx,
+                                       uint32_t idx)
+{
+    struct nss_getidsbysids_sid_ctx *sctx;
+    struct sss_domain_info *dom;
+    const char *wk_dom_name;
+    const char *wk_name;
+    struct tevent_req *req;
+    errno_t ret;
+
+    /* Well-Known SIDs can only be translated to names */
+    ret = well_known_sid_to_name(bctx->sids[idx], &wk_dom_name, &wk_name);
+    if (ret == EOK) {
+        return EINVAL;
+    }
+
+    ret = responder_get_domain_by_id(bctx->cctx->rctx, bctx->sids[idx], &dom);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC, "No domain found for SID [%s].\n",
+              bctx->sids[idx]);
+        return ENOENT;
+    }
+
+    sctx = talloc_zero(bctx, struct nss_getidsbysids_sid_ctx);
+    if (sctx == NULL) {
+        return ENOMEM;
+    }
+    sctx->bctx = bctx;
+    sctx->idx = idx;
+
+    req = cache_req_object_by_sid_send(sctx, bctx->cctx->ev,
+                                       bctx->cctx->rctx,
+                                       bctx->nctx->rctx->ncache,
+                                       0, dom->name, bctx->sids[idx], NULL);
+    if (req == NULL) {
+        talloc_free(sctx);
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(req, nss_getidsbysids_sid_done, sctx);
+    bctx->num_active++;
+
+    return EAGAIN;
+}
+
+static void nss_getidsbysids_step(struct nss_getidsbysids_ctx *bctx)
+{
+    struct cli_ctx *cctx = bctx->cctx;
+    uint32_t idx;
+    errno_t ret;
+
+    while (bctx->next < bctx->num_sids
+            && bctx->num_active < NSS_GETIDSBYSIDS_MAX_ACTIVE) {
+        idx = bctx->next++;
+
+        if (bctx->errs[idx] != EOK) {
+            bctx->num_done++;
+            continue;
+        }
+
+        ret = nss_getidsbysids_lookup(bctx, idx);
+        if (ret != EAGAIN) {
+            bctx->errs[idx] = ret;
+            bctx->num_done++;
+        }
+    }
+
+    if (bctx->num_done < bctx->num_sids) {
+        /* wait for outstanding lookups */
+        return;
+    }
+
+    ret = nss_getidsbysids_send_reply(bctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot create reply [%d]: %s\n",
+              ret, sss_strerror(ret));
+        sss_cmd_send_error(cctx, ret);
+    }
+
+    sss_cmd_done(cctx, bctx);
+}
+
+static void nss_getidsbysids_sid_done(struct tevent_req *req)
+{
+    struct nss_getidsbysids_sid_ctx *sctx;
+    struct nss_getidsbysids_ctx *bctx;
+    struct sss_domain_info *dom;
+    struct ldb_result *res = NULL;
+    enum sss_id_type id_type;
+    uint32_t idx;
+    errno_t ret;
+
+    sctx = tevent_req_callback_data(req, struct nss_getidsbysids_sid_ctx);
+    bctx = sctx->bctx;
+    idx = sctx->idx;
+
+    ret = cache_req_object_by_sid_recv(sctx, req, &res, &dom);
+    talloc_zfree(req);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (res->count != 1) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Expected only 1 result for SID lookup, got [%u].\n",
+              res->count);
+        ret = EINVAL;
+        goto done;
+    }
+
+    ret = find_sss_id_type(res->msgs[0], dom->mpg, &id_type);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = get_posix_id(id_type, res->msgs[0], &bctx->ids[idx]);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    bctx->types[idx] = id_type;
+
+done:
+    bctx->errs[idx] = ret;
+    bctx->num_active--;
+    bctx->num_done++;
+    talloc_free(sctx);
+
+    nss_getidsbysids_step(bctx);
+}
+
 static void users_find_by_cert_done(struct tevent_req *req);
 
 static int nss_cmd_getbycert(enum sss_cli_command cmd, struct cli_ctx *cctx)
@@ -5479,6 +5840,7 @@ static struct sss_cmd_table nss_cmds[] = {
     {SSS_NSS_GETIDBYSID, nss_cmd_getidbysid},
     {SSS_NSS_GETORIGBYNAME, nss_cmd_getorigbyname},
     {SSS_NSS_GETNAMEBYCERT, nss_cmd_getnamebycert},
+    {SSS_NSS_GETIDSBYSIDS, nss_cmd_getidsbysids},
     {SSS_CLI_NULL, NULL}
 };
 
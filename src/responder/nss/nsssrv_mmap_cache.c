@@ -20,8 +20,11 @@
 */
 
 #include "util/util.h"
+#include "util/sss_metrics.h"
+#include "util/probes.h"
 #include "confdb/confdb.h"
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include "util/mmap_cache.h"
 #include "responder/nss/nsssrv.h"
@@ -36,6 +39,11 @@
 
 #define MC_NEXT_BARRIER(val) ((((val) + 1) & 0x00ffffff) | 0xf0000000)
 
+/* When several responder processes write to the same file, the writes
+ * are serialized with a lock on this byte. The first byte is held by the
+ * process that created the file for its whole lifetime. */
+#define SSS_MC_WRITE_LOCK_OFFSET 1
+
 #define MC_RAISE_BARRIER(m) do { \
     m->b2 = MC_NEXT_BARRIER(m->b1); \
     __sync_synchronize(); \
@@ -72,6 +80,8 @@ struct sss_mc_ctx {
 
     uint8_t *data_table;    /* data table address (in mmap) */
     uint32_t dt_size;       /* size of data table */
+
+    bool shared;            /* the file is written by other processes too */
 };
 
 #define MC_FIND_BIT(base, num) \
@@ -455,6 +465,8 @@ static errno_t sss_mc_find_free_slots(struct sss_mc_ctx *mcc,
             /* next loop skip the whole record */
             i += MC_SIZE_TO_SLOTS(rec->len) - 1;
 
+            PROBE(MMAP_CACHE_EVICT, mcc->name, rec->len);
+
             /* finally invalidate record completely */
             sss_mc_invalidate_rec(mcc, rec);
         }
@@ -587,6 +599,8 @@ static errno_t sss_mc_get_record(struct sss_mc_ctx **_mcc,
     errno_t ret;
     int i;
 
+    PROBE(MMAP_CACHE_STORE_BEGIN, mcc->name, key->str, sss_trace_id);
+
     num_slots = MC_SIZE_TO_SLOTS(rec_len);
 
     old_rec = sss_mc_find_record(mcc, key);
@@ -652,6 +666,170 @@ static inline void sss_mmap_chain_in_rec(struct sss_mc_ctx *mcc,
     sss_mc_add_rec_to_chain(mcc, rec, rec->hash1);
     /* then uid/gid */
     sss_mc_add_rec_to_chain(mcc, rec, rec->hash2);
+
+    sss_metrics_inc("mmap_store", mcc->name);
+    PROBE(MMAP_CACHE_STORE_END, mcc->name, rec->len, sss_trace_id);
+}
+
+/***************************************************************************
+ * shared access
+ ***************************************************************************/
+
+/* Maps the current cache file, created by this or by another responder
+ * process, in place of the one mcc uses now. */
+static errno_t sss_mc_attach_file(struct sss_mc_ctx *mcc)
+{
+    struct sss_mc_header h;
+    struct stat st;
+    size_t mmap_size;
+    void *mmap_base;
+    ssize_t len;
+    int fd;
+    errno_t ret;
+
+    fd = open(mcc->file, O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_TRACE_FUNC, "Unable to open mmap file %s: %d(%s)\n",
+                                  mcc->file, ret, strerror(ret));
+        return ret;
+    }
+
+    errno = 0;
+    len = sss_atomic_read_s(fd, (uint8_t *)&h, sizeof(h));
+    if (len != sizeof(h)
+            || h.b1 != h.b2 || !MC_VALID_BARRIER(h.b1)
+            || h.status != SSS_MC_HEADER_ALIVE) {
+        /* the file is still being initialized */
+        DEBUG(SSSDBG_TRACE_FUNC, "mmap file %s is not ready\n", mcc->file);
+        ret = EAGAIN;
+        goto done;
+    }
+
+    if (h.major_vno != SSS_MC_MAJOR_VNO || h.minor_vno != SSS_MC_MINOR_VNO) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "mmap file %s has unknown version\n",
+                                    mcc->file);
+        ret = EINVAL;
+        goto done;
+    }
+
+    mmap_size = MC_HEADER_SIZE +
+                MC_ALIGN64(h.dt_size) +
+                MC_ALIGN64(h.ft_size) +
+                MC_ALIGN64(h.ht_size);
+
+    ret = fstat(fd, &st);
+    if (ret == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    if (st.st_size < (off_t)mmap_size) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "mmap file %s is truncated\n", mcc->file);
+        ret = EINVAL;
+        goto done;
+    }
+
+    mmap_base = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    if (mmap_base == MAP_FAILED) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to mmap file %s(%zu): %d(%s)\n",
+                                    mcc->file, mmap_size, ret, strerror(ret));
+        goto done;
+    }
+
+    if (mcc->mmap_base != NULL) {
+        munmap(mcc->mmap_base, mcc->mmap_size);
+    }
+    if (mcc->fd != -1) {
+        close(mcc->fd);
+    }
+
+    mcc->fd = fd;
+    fd = -1;
+    mcc->mmap_base = mmap_base;
+    mcc->mmap_size = mmap_size;
+    mcc->seed = h.seed;
+    mcc->data_table = MC_PTR_ADD(mmap_base, h.data_table);
+    mcc->dt_size = h.dt_size;
+    mcc->free_table = MC_PTR_ADD(mmap_base, h.free_table);
+    mcc->ft_size = h.ft_size;
+    mcc->hash_table = MC_PTR_ADD(mmap_base, h.hash_table);
+    mcc->ht_size = h.ht_size;
+    mcc->next_slot = 0;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Attached to mmap file %s\n", mcc->file);
+    ret = EOK;
+
+done:
+    if (fd != -1) {
+        close(fd);
+    }
+    return ret;
+}
+
+static errno_t sss_mc_write_lock(struct sss_mc_ctx *mcc)
+{
+    struct sss_mc_header *h;
+    struct flock lock;
+    errno_t ret;
+
+    if (!mcc->shared) {
+        return EOK;
+    }
+
+    /* Another process replaced the file, the clients already use the new
+     * one. A write that raced with the replacement ends up in the old file
+     * which is harmless, the entry is just not cached. */
+    h = (struct sss_mc_header *)mcc->mmap_base;
+    if (h == NULL || h->status == SSS_MC_HEADER_RECYCLED) {
+        ret = sss_mc_attach_file(mcc);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = SSS_MC_WRITE_LOCK_OFFSET;
+    lock.l_len = 1;
+    lock.l_pid = 0;
+
+    do {
+        ret = fcntl(mcc->fd, F_SETLKW, &lock);
+    } while (ret == -1 && errno == EINTR);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to lock mmap file %s: %d(%s)\n",
+                                    mcc->file, ret, strerror(ret));
+        return ret;
+    }
+
+    return EOK;
+}
+
+static void sss_mc_write_unlock(struct sss_mc_ctx *mcc)
+{
+    struct flock lock;
+    int ret;
+
+    if (mcc == NULL || !mcc->shared || mcc->fd == -1) {
+        return;
+    }
+
+    lock.l_type = F_UNLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = SSS_MC_WRITE_LOCK_OFFSET;
+    lock.l_len = 1;
+    lock.l_pid = 0;
+
+    ret = fcntl(mcc->fd, F_SETLK, &lock);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to unlock mmap file %s: %d(%s)\n",
+                                    mcc->file, ret, strerror(ret));
+    }
 }
 
 /***************************************************************************
@@ -662,21 +840,33 @@ static errno_t sss_mmap_cache_invalidate(struct sss_mc_ctx *mcc,
                                          struct sized_string *key)
 {
     struct sss_mc_rec *rec;
+    errno_t ret;
 
     if (mcc == NULL) {
         /* cache not initialized ? */
         return EINVAL;
     }
 
+    ret = sss_mc_write_lock(mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
     rec = sss_mc_find_record(mcc, key);
     if (rec == NULL) {
         /* nothing to invalidate */
-        return ENOENT;
+        ret = ENOENT;
+        goto done;
     }
 
+    PROBE(MMAP_CACHE_INVALIDATE, mcc->name, key->str);
     sss_mc_invalidate_rec(mcc, rec);
 
-    return EOK;
+    ret = EOK;
+
+done:
+    sss_mc_write_unlock(mcc);
+    return ret;
 }
 
 /***************************************************************************
@@ -716,13 +906,21 @@ errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
     rec_len = sizeof(struct sss_mc_rec) +
               sizeof(struct sss_mc_pwd_data) +
               data_len;
+    ret = sss_mc_write_lock(mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
     if (rec_len > mcc->dt_size) {
-        return ENOMEM;
+        ret = ENOMEM;
+        goto done;
     }
 
     ret = sss_mc_get_record(_mcc, rec_len, name, &rec);
     if (ret != EOK) {
-        return ret;
+        /* the cache might have been recreated */
+        mcc = *_mcc;
+        goto done;
     }
 
     data = (struct sss_mc_pwd_data *)rec->data;
@@ -755,7 +953,11 @@ errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
     /* finally chain the rec in the hash table */
     sss_mmap_chain_in_rec(mcc, rec);
 
-    return EOK;
+    ret = EOK;
+
+done:
+    sss_mc_write_unlock(mcc);
+    return ret;
 }
 
 errno_t sss_mmap_cache_pw_invalidate(struct sss_mc_ctx *mcc,
@@ -778,9 +980,15 @@ errno_t sss_mmap_cache_pw_invalidate_uid(struct sss_mc_ctx *mcc, uid_t uid)
         return EINVAL;
     }
 
+    ret = sss_mc_write_lock(mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
     uidstr = talloc_asprintf(NULL, "%ld", (long)uid);
     if (!uidstr) {
-        return ENOMEM;
+        ret = ENOMEM;
+        goto done;
     }
 
     hash = sss_mc_hash(mcc, uidstr, strlen(uidstr) + 1);
@@ -820,6 +1028,7 @@ errno_t sss_mmap_cache_pw_invalidate_uid(struct sss_mc_ctx *mcc, uid_t uid)
     ret = EOK;
 
 done:
+    sss_mc_write_unlock(mcc);
     talloc_zfree(uidstr);
     return ret;
 }
@@ -859,13 +1068,21 @@ int sss_mmap_cache_gr_store(struct sss_mc_ctx **_mcc,
     rec_len = sizeof(struct sss_mc_rec) +
               sizeof(struct sss_mc_grp_data) +
               data_len;
+    ret = sss_mc_write_lock(mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
     if (rec_len > mcc->dt_size) {
-        return ENOMEM;
+        ret = ENOMEM;
+        goto done;
     }
 
     ret = sss_mc_get_record(_mcc, rec_len, name, &rec);
     if (ret != EOK) {
-        return ret;
+        /* the cache might have been recreated */
+        mcc = *_mcc;
+        goto done;
     }
 
     data = (struct sss_mc_grp_data *)rec->data;
@@ -894,7 +1111,11 @@ int sss_mmap_cache_gr_store(struct sss_mc_ctx **_mcc,
     /* finally chain the rec in the hash table */
     sss_mmap_chain_in_rec(mcc, rec);
 
-    return EOK;
+    ret = EOK;
+
+done:
+    sss_mc_write_unlock(mcc);
+    return ret;
 }
 
 errno_t sss_mmap_cache_gr_invalidate(struct sss_mc_ctx *mcc,
@@ -917,9 +1138,15 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx *mcc, gid_t gid)
         return EINVAL;
     }
 
+    ret = sss_mc_write_lock(mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
     gidstr = talloc_asprintf(NULL, "%ld", (long)gid);
     if (!gidstr) {
-        return ENOMEM;
+        ret = ENOMEM;
+        goto done;
     }
 
     hash = sss_mc_hash(mcc, gidstr, strlen(gidstr) + 1);
@@ -959,6 +1186,7 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx *mcc, gid_t gid)
     ret = EOK;
 
 done:
+    sss_mc_write_unlock(mcc);
     talloc_zfree(gidstr);
     return ret;
 }
@@ -986,14 +1214,22 @@ errno_t sss_mmap_cache_initgr_store(struct sss_mc_ctx **_mcc,
     data_len = num_groups * sizeof(uint32_t) + name->len + unique_name->len;
     rec_len = sizeof(struct sss_mc_rec) + sizeof(struct sss_mc_initgr_data)
               + data_len;
+    ret = sss_mc_write_lock(mcc);
+    if (ret != EOK) {
+        return ret;
+    }
+
     if (rec_len > mcc->dt_size) {
-        return ENOMEM;
+        ret = ENOMEM;
+        goto done;
     }
 
     /* use unique name for searching potential old records */
     ret = sss_mc_get_record(_mcc, rec_len, unique_name, &rec);
     if (ret != EOK) {
-        return ret;
+        /* the cache might have been recreated */
+        mcc = *_mcc;
+        goto done;
     }
 
     data = (struct sss_mc_initgr_data *)rec->data;
@@ -1027,7 +1263,11 @@ errno_t sss_mmap_cache_initgr_store(struct sss_mc_ctx **_mcc,
     /* finally chain the rec in the hash table */
     sss_mmap_chain_in_rec(mcc, rec);
 
-    return EOK;
+    ret = EOK;
+
+done:
+    sss_mc_write_unlock(mcc);
+    return ret;
 }
 
 errno_t sss_mmap_cache_initgr_invalidate(struct sss_mc_ctx *mcc,
@@ -1086,7 +1326,7 @@ static errno_t sss_mc_create_file(struct sss_mc_ctx *mc_ctx)
     useconds_t t = 50000;
     int retries = 3;
 
-    ofd = open(mc_ctx->file, O_RDWR);
+    ofd = open(mc_ctx->file, O_RDWR | O_CLOEXEC);
     if (ofd != -1) {
         ret = sss_br_lock_file(ofd, 0, 1, retries, t);
         if (ret != EOK) {
@@ -1121,7 +1361,8 @@ static errno_t sss_mc_create_file(struct sss_mc_ctx *mc_ctx)
     old_mask = umask(0022);
 
     errno = 0;
-    mc_ctx->fd = open(mc_ctx->file, O_CREAT | O_EXCL | O_RDWR, 0644);
+    mc_ctx->fd = open(mc_ctx->file, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC,
+                      0644);
     umask(old_mask);
     if (mc_ctx->fd == -1) {
         ret = errno;
@@ -1209,9 +1450,46 @@ static int mc_ctx_destructor(struct sss_mc_ctx *mc_ctx)
     return 0;
 }
 
+static errno_t sss_mc_ctx_new(TALLOC_CTX *mem_ctx, const char *name,
+                              enum sss_mc_type type, time_t timeout,
+                              bool shared, struct sss_mc_ctx **_mc_ctx)
+{
+    struct sss_mc_ctx *mc_ctx;
+
+    mc_ctx = talloc_zero(mem_ctx, struct sss_mc_ctx);
+    if (!mc_ctx) {
+        return ENOMEM;
+    }
+    mc_ctx->fd = -1;
+    talloc_set_destructor(mc_ctx, mc_ctx_destructor);
+
+    mc_ctx->name = talloc_strdup(mc_ctx, name);
+    if (!mc_ctx->name) {
+        talloc_free(mc_ctx);
+        return ENOMEM;
+    }
+
+    mc_ctx->type = type;
+
+    mc_ctx->valid_time_slot = timeout;
+
+    mc_ctx->shared = shared;
+
+    mc_ctx->file = talloc_asprintf(mc_ctx, "%s/%s",
+                                   SSS_NSS_MCACHE_DIR, name);
+    if (!mc_ctx->file) {
+        talloc_free(mc_ctx);
+        return ENOMEM;
+    }
+
+    *_mc_ctx = mc_ctx;
+    return EOK;
+}
+
 errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
                             enum sss_mc_type type, size_t n_elem,
-                            time_t timeout, struct sss_mc_ctx **mcc)
+                            time_t timeout, bool shared,
+                            struct sss_mc_ctx **mcc)
 {
     struct sss_mc_ctx *mc_ctx = NULL;
     unsigned int rseed;
@@ -1232,28 +1510,9 @@ errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
         return EINVAL;
     }
 
-    mc_ctx = talloc_zero(mem_ctx, struct sss_mc_ctx);
-    if (!mc_ctx) {
-        return ENOMEM;
-    }
-    mc_ctx->fd = -1;
-    talloc_set_destructor(mc_ctx, mc_ctx_destructor);
-
-    mc_ctx->name = talloc_strdup(mc_ctx, name);
-    if (!mc_ctx->name) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    mc_ctx->type = type;
-
-    mc_ctx->valid_time_slot = timeout;
-
-    mc_ctx->file = talloc_asprintf(mc_ctx, "%s/%s",
-                                   SSS_NSS_MCACHE_DIR, name);
-    if (!mc_ctx->file) {
-        ret = ENOMEM;
-        goto done;
+    ret = sss_mc_ctx_new(mem_ctx, name, type, timeout, shared, &mc_ctx);
+    if (ret != EOK) {
+        return ret;
     }
 
     /* elements must always be multiple of 8 to make things easier to handle,
@@ -1338,6 +1597,29 @@ done:
     return ret;
 }
 
+errno_t sss_mmap_cache_attach(TALLOC_CTX *mem_ctx, const char *name,
+                              enum sss_mc_type type, time_t timeout,
+                              struct sss_mc_ctx **mcc)
+{
+    struct sss_mc_ctx *mc_ctx = NULL;
+    errno_t ret;
+
+    ret = sss_mc_ctx_new(mem_ctx, name, type, timeout, true, &mc_ctx);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* If the file is not ready yet, it is mapped on the first write. */
+    ret = sss_mc_attach_file(mc_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "mmap file %s will be attached later\n", mc_ctx->file);
+    }
+
+    *mcc = mc_ctx;
+    return EOK;
+}
+
 errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx, size_t n_elem,
                               time_t timeout, struct sss_mc_ctx **mc_ctx)
 {
@@ -1345,6 +1627,7 @@ errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx, size_t n_elem,
     TALLOC_CTX* tmp_ctx = NULL;
     char *name;
     enum sss_mc_type type;
+    bool shared;
 
     if (mc_ctx == NULL || (*mc_ctx) == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -1366,6 +1649,9 @@ errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx, size_t n_elem,
     }
 
     type = (*mc_ctx)->type;
+    shared = (*mc_ctx)->shared;
+
+    PROBE(MMAP_CACHE_REINIT, name);
 
     if (n_elem == (size_t)-1) {
         n_elem = (*mc_ctx)->ft_size * 8;
@@ -1380,7 +1666,12 @@ errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx, size_t n_elem,
     /* make sure we do not leave a potentially freed pointer around */
     *mc_ctx = NULL;
 
-    ret = sss_mmap_cache_init(mem_ctx, name, type, n_elem, timeout, mc_ctx);
+    ret = sss_mmap_cache_init(mem_ctx, name, type, n_elem, timeout, shared,
+                              mc_ctx);
+    if (ret == EEXIST && shared) {
+        /* another responder process recreated the file at the same time */
+        ret = sss_mmap_cache_attach(mem_ctx, name, type, timeout, mc_ctx);
+    }
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to re-initialize mmap cache.\n");
         goto done;
@@ -1401,6 +1692,8 @@ void sss_mmap_cache_reset(struct sss_mc_ctx *mc_ctx)
         return;
     }
 
+    PROBE(MMAP_CACHE_RESET, mc_ctx->name);
+
     sss_mc_header_update(mc_ctx, SSS_MC_HEADER_UNINIT);
 
     /* Reset the mmaped area */
@@ -35,7 +35,14 @@ enum sss_mc_type {
 
 errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
                             enum sss_mc_type type, size_t n_elem,
-                            time_t valid_time, struct sss_mc_ctx **mcc);
+                            time_t valid_time, bool shared,
+                            struct sss_mc_ctx **mcc);
+
+/* Use the cache file created by another responder process. The writes
+ * of all processes that share the file are serialized. */
+errno_t sss_mmap_cache_attach(TALLOC_CTX *mem_ctx, const char *name,
+                              enum sss_mc_type type, time_t valid_time,
+                              struct sss_mc_ctx **mcc);
 
 errno_t sss_mmap_cache_pw_store(struct sss_mc_ctx **_mcc,
                                 struct sized_string *name,
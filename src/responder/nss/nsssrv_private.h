@@ -27,6 +27,8 @@
 
 #include <dhash.h>
 
+#include "responder/nss/nsssrv_mmap_cache.h"
+
 struct nss_state_ent {
     int dom_idx;
     int cur;
@@ -147,6 +149,12 @@ void nss_update_initgr_memcache(struct nss_ctx *nctx,
                                 const char *fq_name, const char *domain,
                                 int gnum, uint32_t *groups);
 
+int delete_entry_from_memcache(struct sss_domain_info *dom,
+                               char *name,
+                               struct resp_ctx *rctx,
+                               struct sss_mc_ctx *mc_ctx,
+                               enum sss_mc_type type);
+
 int nss_connection_setup(struct cli_ctx *cctx);
 
 #endif /* NSSSRV_PRIVATE_H_ */
@@ -64,6 +64,7 @@ struct mon_cli_iface monitor_pam_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .getStats = monitor_common_get_stats,
 };
 
 static void pam_dp_reconnect_init(struct sbus_connection *conn, int status, void *pvt)
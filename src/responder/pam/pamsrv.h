@@ -70,6 +70,8 @@ struct pam_auth_req {
 
     struct ldb_message *cert_user_obj;
     char *token_name;
+
+    uint64_t trace_id;
 };
 
 struct sss_cmd_table *get_pam_cmds(void);
@@ -23,6 +23,7 @@
 #include <time.h>
 #include "util/util.h"
 #include "util/auth_utils.h"
+#include "util/probes.h"
 #include "db/sysdb.h"
 #include "confdb/confdb.h"
 #include "responder/common/responder_packet.h"
@@ -840,6 +841,7 @@ static void pam_reply(struct pam_auth_req *preq)
     }
 
 done:
+    PROBE(PAM_REPLY, pd->cmd, pd->pam_status, preq->trace_id);
     sss_cmd_done(cctx, preq);
 }
 
@@ -1158,6 +1160,9 @@ static int pam_forwarder(struct cli_ctx *cctx, int pam_cmd)
     pd->cmd = pam_cmd;
     pd->priv = cctx->priv;
 
+    preq->trace_id = sss_trace_id;
+    PROBE(PAM_REQUEST_START, pd->cmd, preq->trace_id);
+
     ret = pam_forwarder_parse_data(cctx, pd);
     if (ret == EAGAIN) {
         req = sss_dp_get_domains_send(cctx->rctx, cctx->rctx, true, pd->domain);
@@ -26,6 +26,7 @@
 #include <security/pam_modules.h>
 
 #include "util/util.h"
+#include "util/probes.h"
 #include "responder/common/responder_packet.h"
 #include "providers/data_provider.h"
 #include "sbus/sbus_client.h"
@@ -56,6 +57,8 @@ static void pam_dp_process_reply(DBusPendingCall *pending, void *ptr)
         return;
     }
 
+    sss_trace_id = preq->trace_id;
+
     /* Sanity-check of message validity */
     if (msg == NULL) {
         DEBUG(SSSDBG_FATAL_FAILURE,
@@ -90,6 +93,7 @@ static void pam_dp_process_reply(DBusPendingCall *pending, void *ptr)
 
 
 done:
+    PROBE(PAM_DP_RECV, preq->pd->cmd, preq->pd->pam_status, preq->trace_id);
     dbus_pending_call_unref(pending);
     dbus_message_unref(msg);
     preq->callback(preq);
@@ -155,6 +159,9 @@ int pam_dp_send_req(struct pam_auth_req *preq, int timeout)
     preq->dpreq_spy = pdp_req;
     talloc_set_destructor(pdp_req, pdp_req_destructor);
 
+    PROBE(PAM_DP_SEND, pd->cmd, PROBE_SAFE_STR(pd->user),
+          PROBE_SAFE_STR(pd->domain), preq->trace_id);
+
     res = sbus_conn_send(be_conn->conn, msg,
                          timeout, pam_dp_process_reply,
                          pdp_req, NULL);
@@ -325,6 +325,7 @@ struct tevent_req *pam_check_cert_send(TALLOC_CTX *mem_ctx,
         child_debug_fd = STDERR_FILENO;
     }
 
+    sss_debug_prepare_fork();
     child_pid = fork();
     if (child_pid == 0) { /* child */
         exec_child_ex(state, pipefd_to_child, pipefd_from_child,
@@ -23,14 +23,230 @@
 #include "util/crypto/sss_crypto.h"
 #include <time.h>
 #include <ldb.h>
+#include <dhash.h>
 
 #define MKEY_SIZE (256 / 8)
 
+/* Clients tend to poll the same secrets over and over, so decrypted
+ * values and container listings are kept in memory for a short time.
+ * Only this process writes to the database, entries are dropped on every
+ * change that affects them. */
+#define LOCAL_CACHE_TIMEOUT 30
+#define LOCAL_CACHE_MAX_ENTRIES 256
+
+struct local_cache_entry {
+    time_t expire;
+
+    /* decrypted secret, wiped when the entry is freed */
+    char *secret;
+
+    /* paths of all simple secrets below a container */
+    char **keys;
+    int num_keys;
+};
+
 struct local_context {
     struct ldb_context *ldb;
     struct sec_data master_key;
+
+    /* both keyed by the casefolded DN, created on demand */
+    hash_table_t *secrets_cache;
+    hash_table_t *keys_cache;
+
+    /* makes sure decrypted secrets do not linger in memory */
+    struct tevent_context *ev;
+    struct tevent_timer *purge_te;
 };
 
+static int local_cache_entry_destructor(struct local_cache_entry *entry)
+{
+    if (entry->secret) {
+        safezero(entry->secret, strlen(entry->secret));
+    }
+    return 0;
+}
+
+static void local_cache_del(hash_table_t *table, struct ldb_dn *dn)
+{
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    if (!table) return;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(dn));
+    if (!key.str) return;
+
+    hret = hash_lookup(table, &key, &value);
+    if (hret != HASH_SUCCESS) return;
+
+    hret = hash_delete(table, &key);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Failed to remove cache entry [%s]\n",
+              hash_error_string(hret));
+    }
+    talloc_free(value.ptr);
+}
+
+static struct local_cache_entry *local_cache_get(hash_table_t *table,
+                                                 struct ldb_dn *dn)
+{
+    struct local_cache_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    if (!table) return NULL;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(dn));
+    if (!key.str) return NULL;
+
+    hret = hash_lookup(table, &key, &value);
+    if (hret != HASH_SUCCESS) return NULL;
+
+    entry = talloc_get_type(value.ptr, struct local_cache_entry);
+    if (entry->expire <= time(NULL)) {
+        local_cache_del(table, dn);
+        return NULL;
+    }
+
+    return entry;
+}
+
+/* Takes ownership of the entry, even on failure */
+static int local_cache_put(struct local_context *lctx,
+                           hash_table_t **table,
+                           struct ldb_dn *dn,
+                           struct local_cache_entry *entry)
+{
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+    int ret;
+
+    if (*table && hash_count(*table) >= LOCAL_CACHE_MAX_ENTRIES) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Secrets cache is full, flushing\n");
+        talloc_zfree(*table);
+    }
+
+    if (!*table) {
+        ret = sss_hash_create(lctx, 0, table);
+        if (ret) {
+            talloc_free(entry);
+            return ret;
+        }
+    }
+
+    local_cache_del(*table, dn);
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_casefold(dn));
+    if (!key.str) {
+        talloc_free(entry);
+        return ENOMEM;
+    }
+
+    entry->expire = time(NULL) + LOCAL_CACHE_TIMEOUT;
+    value.type = HASH_VALUE_PTR;
+    value.ptr = talloc_steal(*table, entry);
+
+    hret = hash_enter(*table, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        talloc_free(entry);
+        return EIO;
+    }
+
+    return EOK;
+}
+
+static void local_cache_purge(hash_table_t *table)
+{
+    struct local_cache_entry *entry;
+    hash_entry_t *entries;
+    unsigned long count;
+    time_t now;
+    int hret;
+
+    if (!table) return;
+
+    hret = hash_entries(table, &count, &entries);
+    if (hret != HASH_SUCCESS) return;
+
+    now = time(NULL);
+    for (unsigned long i = 0; i < count; i++) {
+        entry = talloc_get_type(entries[i].value.ptr,
+                                struct local_cache_entry);
+        if (entry->expire > now) continue;
+
+        hret = hash_delete(table, &entries[i].key);
+        if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Failed to remove cache entry [%s]\n",
+                  hash_error_string(hret));
+        }
+        talloc_free(entry);
+    }
+
+    talloc_free(entries);
+}
+
+static void local_cache_schedule_purge(struct local_context *lctx);
+
+static void local_cache_purge_handler(struct tevent_context *ev,
+                                      struct tevent_timer *te,
+                                      struct timeval tv, void *pvt)
+{
+    struct local_context *lctx = talloc_get_type(pvt, struct local_context);
+
+    lctx->purge_te = NULL;
+
+    local_cache_purge(lctx->secrets_cache);
+    local_cache_purge(lctx->keys_cache);
+
+    if (lctx->secrets_cache && hash_count(lctx->secrets_cache) > 0) {
+        local_cache_schedule_purge(lctx);
+    }
+}
+
+static void local_cache_schedule_purge(struct local_context *lctx)
+{
+    struct timeval tv;
+
+    if (lctx->purge_te || !lctx->ev) return;
+
+    tv = tevent_timeval_current_ofs(LOCAL_CACHE_TIMEOUT + 1, 0);
+    lctx->purge_te = tevent_add_timer(lctx->ev, lctx, tv,
+                                      local_cache_purge_handler, lctx);
+    if (!lctx->purge_te) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Failed to schedule cache purge\n");
+    }
+}
+
+/* Drops the cached value of the entry and the listings of all containers
+ * it is visible in. */
+static void local_cache_invalidate(struct local_context *lctx,
+                                   struct ldb_dn *dn)
+{
+    struct ldb_dn *parent;
+
+    local_cache_del(lctx->secrets_cache, dn);
+
+    parent = ldb_dn_copy(NULL, dn);
+    if (!parent) {
+        /* better safe than sorry */
+        talloc_zfree(lctx->keys_cache);
+        return;
+    }
+
+    do {
+        local_cache_del(lctx->keys_cache, parent);
+    } while (ldb_dn_remove_child_components(parent, 1)
+                && ldb_dn_get_comp_num(parent) > 0);
+
+    talloc_free(parent);
+}
+
 int local_decrypt(struct local_context *lctx, TALLOC_CTX *mem_ctx,
                   const char *secret, const char *enctype,
                   char **plain_secret)
@@ -176,6 +392,7 @@ int local_db_get_simple(TALLOC_CTX *mem_ctx,
 {
     TALLOC_CTX *tmp_ctx;
     static const char *attrs[] = { "secret", "enctype", NULL };
+    struct local_cache_entry *entry;
     struct ldb_result *res;
     struct ldb_dn *dn;
     const char *attr_secret;
@@ -188,6 +405,13 @@ int local_db_get_simple(TALLOC_CTX *mem_ctx,
     ret = local_db_dn(tmp_ctx, lctx->ldb, req_path, &dn);
     if (ret != EOK) goto done;
 
+    entry = local_cache_get(lctx->secrets_cache, dn);
+    if (entry) {
+        *secret = talloc_strdup(mem_ctx, entry->secret);
+        ret = *secret ? EOK : ENOMEM;
+        goto done;
+    }
+
     ret = ldb_search(lctx->ldb, tmp_ctx, &res, dn, LDB_SCOPE_BASE,
                      attrs, "%s", LOCAL_SIMPLE_FILTER);
     if (ret != EOK) {
@@ -219,6 +443,23 @@ int local_db_get_simple(TALLOC_CTX *mem_ctx,
         if (ret) goto done;
     } else {
         *secret = talloc_strdup(mem_ctx, attr_secret);
+        if (!*secret) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    entry = talloc_zero(lctx, struct local_cache_entry);
+    if (entry) {
+        talloc_set_destructor(entry, local_cache_entry_destructor);
+        entry->secret = talloc_strdup(entry, *secret);
+        if (entry->secret) {
+            /* not fatal, the secret is just not cached */
+            ret = local_cache_put(lctx, &lctx->secrets_cache, dn, entry);
+            if (ret == EOK) local_cache_schedule_purge(lctx);
+        } else {
+            talloc_free(entry);
+        }
     }
     ret = EOK;
 
@@ -235,8 +476,10 @@ int local_db_list_keys(TALLOC_CTX *mem_ctx,
 {
     TALLOC_CTX *tmp_ctx;
     static const char *attrs[] = { "secret", NULL };
+    struct local_cache_entry *entry;
     struct ldb_result *res;
     struct ldb_dn *dn;
+    bool fresh = false;
     char **keys;
     int ret;
 
@@ -246,37 +489,70 @@ int local_db_list_keys(TALLOC_CTX *mem_ctx,
     ret = local_db_dn(tmp_ctx, lctx->ldb, req_path, &dn);
     if (ret != EOK) goto done;
 
-    ret = ldb_search(lctx->ldb, tmp_ctx, &res, dn, LDB_SCOPE_SUBTREE,
-                     attrs, "%s", LOCAL_SIMPLE_FILTER);
-    if (ret != EOK) {
-        ret = ENOENT;
-        goto done;
+    entry = local_cache_get(lctx->keys_cache, dn);
+    if (!entry) {
+        ret = ldb_search(lctx->ldb, tmp_ctx, &res, dn, LDB_SCOPE_SUBTREE,
+                         attrs, "%s", LOCAL_SIMPLE_FILTER);
+        if (ret != EOK) {
+            ret = ENOENT;
+            goto done;
+        }
+
+        entry = talloc_zero(tmp_ctx, struct local_cache_entry);
+        if (!entry) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        entry->keys = talloc_array(entry, char *, res->count);
+        if (!entry->keys) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        for (unsigned i = 0; i < res->count; i++) {
+            entry->keys[i] = local_dn_to_path(entry->keys, dn,
+                                              res->msgs[i]->dn);
+            if (!entry->keys[i]) {
+                ret = ENOMEM;
+                goto done;
+            }
+        }
+        entry->num_keys = res->count;
+        fresh = true;
     }
 
-    if (res->count == 0) {
+    if (entry->num_keys == 0) {
         ret = ENOENT;
         goto done;
     }
 
-    keys = talloc_array(mem_ctx, char *, res->count);
+    keys = talloc_array(mem_ctx, char *, entry->num_keys);
     if (!keys) {
         ret = ENOMEM;
         goto done;
     }
 
-    for (unsigned i = 0; i < res->count; i++) {
-        keys[i] = local_dn_to_path(keys, dn, res->msgs[i]->dn);
+    for (int i = 0; i < entry->num_keys; i++) {
+        keys[i] = talloc_strdup(keys, entry->keys[i]);
         if (!keys[i]) {
+            talloc_free(keys);
             ret = ENOMEM;
             goto done;
         }
     }
 
     *_keys = keys;
-    *num_keys = res->count;
+    *num_keys = entry->num_keys;
     ret = EOK;
 
 done:
+    if (fresh && (ret == EOK || ret == ENOENT)) {
+        /* empty listings are cached as well */
+        if (local_cache_put(lctx, &lctx->keys_cache, dn, entry)) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Failed to cache secrets list\n");
+        }
+    }
     talloc_free(tmp_ctx);
     return ret;
 }
@@ -360,6 +636,7 @@ int local_db_put_simple(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    local_cache_invalidate(lctx, msg->dn);
     ret = EOK;
 
 done:
@@ -378,6 +655,10 @@ int local_db_delete(TALLOC_CTX *mem_ctx,
     if (ret != EOK) return ret;
 
     ret = ldb_delete(lctx->ldb, dn);
+    if (ret == LDB_SUCCESS) {
+        local_cache_invalidate(lctx, dn);
+    }
+
     return sysdb_error_to_errno(ret);
 }
 
@@ -653,6 +934,8 @@ int local_secrets_provider_handle(struct sec_ctx *sctx,
     lctx = talloc_zero(handle, struct local_context);
     if (!lctx) return ENOMEM;
 
+    lctx->ev = sctx->rctx->ev;
+
     lctx->ldb = ldb_init(lctx, NULL);
     if (!lctx->ldb) return ENOMEM;
 
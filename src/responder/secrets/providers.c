@@ -19,6 +19,8 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <sys/param.h>
+
 #include "responder/secrets/secsrv_private.h"
 #include "responder/secrets/secsrv_local.h"
 #include "responder/secrets/secsrv_proxy.h"
@@ -161,7 +163,7 @@ static struct sec_http_status_format_table {
       "The server encountered an internal error." },
 };
 
-int sec_http_status_reply(TALLOC_CTX *mem_ctx, struct sec_data *reply,
+int sec_http_status_reply(TALLOC_CTX *mem_ctx, struct sec_msg *reply,
                           enum sec_http_status_codes code)
 {
     char *body = talloc_asprintf(mem_ctx,
@@ -177,31 +179,46 @@ int sec_http_status_reply(TALLOC_CTX *mem_ctx, struct sec_data *reply,
                         sec_http_status_format_table[code].description);
     if (!body) return ENOMEM;
 
-    reply->data = talloc_asprintf(mem_ctx,
+    reply->head.data = talloc_asprintf(mem_ctx,
                         "HTTP/1.1 %d %s\r\n"
                         "Content-Length: %u\r\n"
                         "Content-Type: text/html\r\n"
-                        "\r\n"
-                        "%s",
+                        "\r\n",
                         sec_http_status_format_table[code].status,
                         sec_http_status_format_table[code].text,
-                        (unsigned)strlen(body), body);
-    talloc_free(body);
-    if (!reply->data) return ENOMEM;
+                        (unsigned)strlen(body));
+    if (!reply->head.data) {
+        talloc_free(body);
+        return ENOMEM;
+    }
 
-    reply->length = strlen(reply->data);
+    reply->head.length = strlen(reply->head.data);
+    reply->body.data = body;
+    reply->body.length = strlen(body);
 
     return EOK;
 }
 
-int sec_http_reply_with_body(TALLOC_CTX *mem_ctx, struct sec_data *reply,
+/* The body is not copied, body->data must be a talloc chunk and it is
+ * moved under mem_ctx so that it lives as long as the reply. */
+static void sec_msg_set_body(TALLOC_CTX *mem_ctx, struct sec_msg *reply,
+                             struct sec_data *body)
+{
+    if (body && body->length) {
+        reply->body.data = talloc_steal(mem_ctx, body->data);
+        reply->body.length = body->length;
+    } else {
+        reply->body.data = NULL;
+        reply->body.length = 0;
+    }
+}
+
+int sec_http_reply_with_body(TALLOC_CTX *mem_ctx, struct sec_msg *reply,
                              enum sec_http_status_codes code,
                              const char *content_type,
                              struct sec_data *body)
 {
-    int head_size;
-
-    reply->data = talloc_asprintf(mem_ctx,
+    reply->head.data = talloc_asprintf(mem_ctx,
                         "HTTP/1.1 %d %s\r\n"
                         "Content-Type: %s\r\n"
                         "Content-Length: %zu\r\n"
@@ -209,16 +226,10 @@ int sec_http_reply_with_body(TALLOC_CTX *mem_ctx, struct sec_data *reply,
                         sec_http_status_format_table[code].status,
                         sec_http_status_format_table[code].text,
                         content_type, body->length);
-    if (!reply->data) return ENOMEM;
-
-    head_size = strlen(reply->data);
-
-    reply->data = talloc_realloc(mem_ctx, reply->data, char,
-                                 head_size + body->length);
-    if (!reply->data) return ENOMEM;
+    if (!reply->head.data) return ENOMEM;
 
-    memcpy(&reply->data[head_size], body->data, body->length);
-    reply->length = head_size + body->length;
+    reply->head.length = strlen(reply->head.data);
+    sec_msg_set_body(mem_ctx, reply, body);
 
     return EOK;
 }
@@ -237,7 +248,61 @@ int sec_http_append_header(TALLOC_CTX *mem_ctx, char **dest,
     return EOK;
 }
 
-int sec_http_reply_with_headers(TALLOC_CTX *mem_ctx, struct sec_data *reply,
+int sec_data_append(TALLOC_CTX *mem_ctx, struct sec_data *buf,
+                    const char *src, size_t len)
+{
+    size_t size;
+    char *data;
+
+    /* keep room for a terminating NUL so that text payloads can be
+     * handled as strings, the data itself may contain any byte */
+    size = buf->data ? talloc_get_size(buf->data) : 0;
+    if (buf->length + len + 1 > size) {
+        size = MAX(size * 2, buf->length + len + 1);
+        data = talloc_realloc_size(mem_ctx, buf->data, size);
+        if (!data) return ENOMEM;
+        buf->data = data;
+    }
+
+    memcpy(&buf->data[buf->length], src, len);
+    buf->length += len;
+    buf->data[buf->length] = '\0';
+
+    return EOK;
+}
+
+int sec_data_prealloc(TALLOC_CTX *mem_ctx, struct sec_data *buf,
+                      uint64_t content_length, size_t max_length)
+{
+    /* no Content-Length, the body is chunked or runs until EOF */
+    if (content_length == 0 || content_length == ULLONG_MAX) return EOK;
+
+    if (content_length > max_length) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Announced body size %"PRIu64" exceeds the limit of %zu\n",
+              content_length, max_length);
+        return E2BIG;
+    }
+
+    if (buf->data) return EOK;
+
+    buf->data = talloc_size(mem_ctx, content_length + 1);
+    if (!buf->data) return ENOMEM;
+    buf->data[0] = '\0';
+
+    return EOK;
+}
+
+/* Connection management headers describe the upstream connection and
+ * must not be relayed, the body is forwarded already decoded. */
+static bool sec_http_is_hop_by_hop(const char *name)
+{
+    return strcasecmp(name, "Transfer-Encoding") == 0
+        || strcasecmp(name, "Connection") == 0
+        || strcasecmp(name, "Keep-Alive") == 0;
+}
+
+int sec_http_reply_with_headers(TALLOC_CTX *mem_ctx, struct sec_msg *reply,
                                 int status_code, const char *reason,
                                 struct sec_kvp *headers, int num_headers,
                                 struct sec_data *body)
@@ -248,18 +313,20 @@ int sec_http_reply_with_headers(TALLOC_CTX *mem_ctx, struct sec_data *reply,
     int ret;
 
     /* Status-Line */
-    reply->data = talloc_asprintf(mem_ctx, "HTTP/1.1 %d %s\r\n",
-                                  status_code, reason_phrase);
-    if (!reply->data) return ENOMEM;
+    reply->head.data = talloc_asprintf(mem_ctx, "HTTP/1.1 %d %s\r\n",
+                                       status_code, reason_phrase);
+    if (!reply->head.data) return ENOMEM;
 
     /* Headers */
     for (int i = 0; i < num_headers; i++) {
-        if (strcasecmp(headers[i].name, "Content-Length") == 0) {
+        if (sec_http_is_hop_by_hop(headers[i].name)) {
+            continue;
+        } else if (strcasecmp(headers[i].name, "Content-Length") == 0) {
             add_content_length = false;
         } else if (strcasecmp(headers[i].name, "Content-Type") == 0) {
             has_content_type = true;
         }
-        ret = sec_http_append_header(mem_ctx, &reply->data,
+        ret = sec_http_append_header(mem_ctx, &reply->head.data,
                                      headers[i].name, headers[i].value);
         if (ret) return ret;
     }
@@ -267,25 +334,20 @@ int sec_http_reply_with_headers(TALLOC_CTX *mem_ctx, struct sec_data *reply,
     if (!has_content_type) return EINVAL;
 
     if (add_content_length) {
-        reply->data = talloc_asprintf_append_buffer(reply->data,
-                            "Content-Length: %u\r\n", (unsigned)body->length);
-        if (!reply->data) return ENOMEM;
+        reply->head.data = talloc_asprintf_append_buffer(reply->head.data,
+                            "Content-Length: %zu\r\n",
+                            body ? body->length : 0);
+        if (!reply->head.data) return ENOMEM;
     }
 
     /* CRLF separator before body */
-    reply->data = talloc_strdup_append_buffer(reply->data, "\r\n");
+    reply->head.data = talloc_strdup_append_buffer(reply->head.data, "\r\n");
+    if (!reply->head.data) return ENOMEM;
 
-    reply->length = strlen(reply->data);
+    reply->head.length = strlen(reply->head.data);
 
     /* Message-Body */
-    if (body && body->length) {
-        reply->data = talloc_realloc(mem_ctx, reply->data, char,
-                                     reply->length + body->length);
-        if (!reply->data) return ENOMEM;
-
-        memcpy(&reply->data[reply->length], body->data, body->length);
-        reply->length += body->length;
-    }
+    sec_msg_set_body(mem_ctx, reply, body);
 
     return EOK;
 }
@@ -23,10 +23,20 @@
 #include "util/crypto/sss_crypto.h"
 #include "resolv/async_resolv.h"
 #include "util/sss_sockets.h"
+#include "util/dlinklist.h"
+
+struct proxy_pool;
 
 struct proxy_context {
     struct resolv_ctx *resctx;
     struct confdb_ctx *cdb;
+
+    /* upstream connection pools */
+    int max_conns;
+    int idle_timeout;
+    struct proxy_pool *pools;
+
+    size_t max_payload_size;
 };
 
 enum proxy_auth_type {
@@ -203,10 +213,17 @@ int proxy_sec_map_url(TALLOC_CTX *mem_ctx, struct sec_req_ctx *secreq,
 int proxy_sec_map_headers(TALLOC_CTX *mem_ctx, struct sec_req_ctx *secreq,
                           struct proxy_cfg *pcfg, char **req_headers)
 {
+    bool has_content_length = false;
     int ret;
 
     for (int i = 0; i < secreq->num_headers; i++) {
         bool forward = false;
+
+        /* the body was decoded already, it is sent as a whole */
+        if (strcasecmp(secreq->headers[i].name, "Transfer-Encoding") == 0) {
+            continue;
+        }
+
         for (int j = 0; pcfg->fwd_headers[j]; j++) {
             if (strcasecmp(secreq->headers[i].name,
                            pcfg->fwd_headers[j]) == 0) {
@@ -215,6 +232,9 @@ int proxy_sec_map_headers(TALLOC_CTX *mem_ctx, struct sec_req_ctx *secreq,
             }
         }
         if (forward) {
+            if (strcasecmp(secreq->headers[i].name, "Content-Length") == 0) {
+                has_content_length = true;
+            }
             ret = sec_http_append_header(mem_ctx, req_headers,
                                          secreq->headers[i].name,
                                          secreq->headers[i].value);
@@ -222,6 +242,12 @@ int proxy_sec_map_headers(TALLOC_CTX *mem_ctx, struct sec_req_ctx *secreq,
         }
     }
 
+    if (!has_content_length && secreq->body.length > 0) {
+        *req_headers = talloc_asprintf_append_buffer(*req_headers,
+                            "Content-Length: %zu\r\n", secreq->body.length);
+        if (!*req_headers) return ENOMEM;
+    }
+
     if (pcfg->auth_type == PAT_HEADER) {
         ret = sec_http_append_header(mem_ctx, req_headers,
                                      pcfg->auth.header.name,
@@ -236,44 +262,39 @@ static int proxy_http_create_request(TALLOC_CTX *mem_ctx,
                                      struct sec_req_ctx *secreq,
                                      struct proxy_cfg *pcfg,
                                      const char *http_uri,
-                                     struct sec_data **http_req)
+                                     struct sec_msg **http_req)
 {
-    struct sec_data *req;
+    struct sec_msg *req;
     int ret;
 
-    req = talloc_zero(mem_ctx, struct sec_data);
+    req = talloc_zero(mem_ctx, struct sec_msg);
     if (!req) return ENOMEM;
 
     /* Request-Line */
-    req->data = talloc_asprintf(req, "%s %s HTTP/1.1\r\n",
-                                http_method_str(secreq->method), http_uri);
-    if (!req->data) {
+    req->head.data = talloc_asprintf(req, "%s %s HTTP/1.1\r\n",
+                                     http_method_str(secreq->method),
+                                     http_uri);
+    if (!req->head.data) {
         ret = ENOMEM;
         goto done;
     }
 
     /* Headers */
-    ret = proxy_sec_map_headers(req, secreq, pcfg, &req->data);
+    ret = proxy_sec_map_headers(req, secreq, pcfg, &req->head.data);
     if (ret) goto done;
 
     /* CRLF separator before body */
-    req->data = talloc_strdup_append_buffer(req->data, "\r\n");
-
-    req->length = strlen(req->data);
+    req->head.data = talloc_strdup_append_buffer(req->head.data, "\r\n");
+    if (!req->head.data) {
+        ret = ENOMEM;
+        goto done;
+    }
 
-    /* Message-Body */
-    if (secreq->body.length > 0) {
-        req->data = talloc_realloc_size(req, req->data,
-                                        req->length + secreq->body.length);
-        if (!req->data) {
-            ret = ENOMEM;
-            goto done;
-        }
+    req->head.length = strlen(req->head.data);
 
-        memcpy(&req->data[req->length],
-               secreq->body.data, secreq->body.length);
-        req->length += secreq->body.length;
-    }
+    /* Message-Body, sent straight from the client request which outlives
+     * the proxied one */
+    req->body = secreq->body;
 
     *http_req = req;
     ret = EOK;
@@ -284,13 +305,16 @@ done:
 }
 
 struct proxy_http_request {
-    struct sec_data *data;
-    size_t written;
+    enum http_method method;
+    struct sec_msg *msg;
+    /* what is left to be written on the current attempt */
+    struct sec_msg pending;
 };
 
 struct proxy_http_reply {
     http_parser parser;
     bool complete;
+    bool keep_alive;
 
     int status_code;
     char *reason_phrase;
@@ -299,10 +323,53 @@ struct proxy_http_reply {
     struct sec_data body;
 
     size_t received;
+    size_t max_body;
+};
+
+/* Connections to the upstream servers are kept open when a request is
+ * finished and are reused by the following requests to the same host and
+ * port. The number of connections to each upstream is limited, requests
+ * that find all of them busy wait in a queue until one is released. */
+struct proxy_conn {
+    struct proxy_conn *prev;
+    struct proxy_conn *next;
+
+    struct proxy_pool *pool;
+    int sd;
+    struct tevent_fd *fde;
+
+    /* request that owns the connection */
+    struct tevent_req *req;
+
+    /* set while the connection sits in the idle list */
+    bool idle;
+    struct tevent_timer *idle_te;
+};
+
+struct proxy_pool {
+    struct proxy_pool *next;
+    struct proxy_pool *prev;
+
+    struct proxy_context *pctx;
+    char *name;
+    int port;
+
+    /* includes connections that are still being established */
+    int num_conns;
+    bool freeing;
+    struct proxy_conn *idle;
+
+    /* requests waiting for a free connection */
+    struct proxy_http_req_state *waiting;
 };
 
 struct proxy_http_req_state {
+    struct proxy_http_req_state *prev;
+    struct proxy_http_req_state *next;
+
     struct tevent_context *ev;
+    struct tevent_req *req;
+    struct proxy_context *pctx;
 
     char *proxyname;
     int port;
@@ -310,38 +377,374 @@ struct proxy_http_req_state {
     struct resolv_hostent *hostent;
     int hostidx;
 
-    int sd;
-    struct tevent_fd *fde;
+    struct proxy_pool *pool;
+    struct proxy_conn *conn;
+    bool waiting;
+    bool reused;
+    bool retried;
+    bool got_data;
 
     struct proxy_http_request request;
     struct proxy_http_reply *reply;
 };
 
 static int proxy_http_req_state_destroy(void *data);
+static errno_t proxy_http_req_acquire(struct tevent_req *req);
 static void proxy_http_req_gethostname_done(struct tevent_req *subreq);
 static void proxy_http_req_connect_step(struct tevent_req *req);
 static void proxy_http_req_connect_done(struct tevent_req *subreq);
 static void proxy_fd_handler(struct tevent_context *ev, struct tevent_fd *fde,
                              uint16_t flags, void *ptr);
 
+static int proxy_conn_destructor(struct proxy_conn *conn)
+{
+    struct proxy_http_req_state *state;
+
+    if (conn->req != NULL) {
+        state = tevent_req_data(conn->req, struct proxy_http_req_state);
+        state->conn = NULL;
+        if (conn->pool->freeing) {
+            state->pool = NULL;
+        }
+    }
+
+    if (conn->idle) {
+        DLIST_REMOVE(conn->pool->idle, conn);
+    }
+
+    conn->pool->num_conns--;
+
+    talloc_zfree(conn->fde);
+    if (conn->sd != -1) {
+        DEBUG(SSSDBG_TRACE_FUNC, "closing socket [%d]\n", conn->sd);
+        close(conn->sd);
+        conn->sd = -1;
+    }
+
+    return 0;
+}
+
+static int proxy_pool_destructor(struct proxy_pool *pool)
+{
+    struct proxy_http_req_state *state;
+    struct proxy_conn *conn;
+
+    /* The responder is shutting down, detach whoever still refers to
+     * the pool. */
+    pool->freeing = true;
+
+    while ((state = pool->waiting) != NULL) {
+        DLIST_REMOVE(pool->waiting, state);
+        state->waiting = false;
+        state->pool = NULL;
+    }
+
+    while ((conn = pool->idle) != NULL) {
+        talloc_free(conn);
+    }
+
+    return 0;
+}
+
+static struct proxy_pool *proxy_pool_get(struct proxy_context *pctx,
+                                         const char *name, int port)
+{
+    struct proxy_pool *pool;
+
+    DLIST_FOR_EACH(pool, pctx->pools) {
+        if (pool->port == port && strcasecmp(pool->name, name) == 0) {
+            return pool;
+        }
+    }
+
+    pool = talloc_zero(pctx, struct proxy_pool);
+    if (!pool) return NULL;
+
+    pool->pctx = pctx;
+    pool->port = port;
+    pool->name = talloc_strdup(pool, name);
+    if (!pool->name) {
+        talloc_free(pool);
+        return NULL;
+    }
+
+    talloc_set_destructor(pool, proxy_pool_destructor);
+    DLIST_ADD(pctx->pools, pool);
+
+    return pool;
+}
+
+static struct proxy_conn *proxy_conn_new(struct proxy_pool *pool,
+                                         struct tevent_req *req)
+{
+    struct proxy_conn *conn;
+
+    conn = talloc_zero(pool, struct proxy_conn);
+    if (!conn) return NULL;
+
+    conn->pool = pool;
+    conn->sd = -1;
+    conn->req = req;
+    pool->num_conns++;
+    talloc_set_destructor(conn, proxy_conn_destructor);
+
+    return conn;
+}
+
+static void proxy_pool_dispatch(struct proxy_pool *pool);
+
+/* Closes the connection and lets a waiting request take its place */
+static void proxy_conn_close(struct proxy_conn *conn)
+{
+    struct proxy_pool *pool = conn->pool;
+
+    talloc_free(conn);
+    proxy_pool_dispatch(pool);
+}
+
+static void proxy_http_req_fail(struct tevent_req *req, int err)
+{
+    struct proxy_http_req_state *state =
+                tevent_req_data(req, struct proxy_http_req_state);
+
+    if (state->conn) {
+        /* the connection is in an unknown state, never reuse it */
+        proxy_conn_close(state->conn);
+    }
+
+    tevent_req_error(req, err);
+}
+
+static void proxy_pool_dispatch(struct proxy_pool *pool)
+{
+    struct proxy_http_req_state *state;
+    int ret;
+
+    while (pool->waiting &&
+           (pool->idle || pool->num_conns < pool->pctx->max_conns)) {
+        state = pool->waiting;
+        DLIST_REMOVE(pool->waiting, state);
+        state->waiting = false;
+
+        ret = proxy_http_req_acquire(state->req);
+        if (ret != EOK) {
+            proxy_http_req_fail(state->req, ret);
+        }
+    }
+}
+
+static void proxy_conn_idle_timeout(struct tevent_context *ev,
+                                    struct tevent_timer *te,
+                                    struct timeval tv, void *pvt)
+{
+    struct proxy_conn *conn = talloc_get_type(pvt, struct proxy_conn);
+
+    /* the timer is freed by tevent */
+    conn->idle_te = NULL;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Closing idle connection to %s:%d\n",
+          conn->pool->name, conn->pool->port);
+    proxy_conn_close(conn);
+}
+
+/* Returns the connection of a finished request to the pool */
+static void proxy_http_req_release(struct tevent_req *req, bool reusable)
+{
+    struct proxy_http_req_state *state =
+                tevent_req_data(req, struct proxy_http_req_state);
+    struct proxy_conn *conn = state->conn;
+    struct timeval tv;
+
+    state->conn = NULL;
+    conn->req = NULL;
+
+    if (!reusable || conn->pool->pctx->idle_timeout <= 0) {
+        proxy_conn_close(conn);
+        return;
+    }
+
+    tv = tevent_timeval_current_ofs(conn->pool->pctx->idle_timeout, 0);
+    conn->idle_te = tevent_add_timer(state->ev, conn, tv,
+                                     proxy_conn_idle_timeout, conn);
+    if (!conn->idle_te) {
+        proxy_conn_close(conn);
+        return;
+    }
+
+    /* only watch for the server closing the connection */
+    TEVENT_FD_NOT_WRITEABLE(conn->fde);
+    TEVENT_FD_READABLE(conn->fde);
+
+    DLIST_ADD(conn->pool->idle, conn);
+    conn->idle = true;
+
+    proxy_pool_dispatch(conn->pool);
+}
+
+static errno_t proxy_http_req_start_io(struct tevent_req *req)
+{
+    struct proxy_http_req_state *state =
+                tevent_req_data(req, struct proxy_http_req_state);
+    struct proxy_conn *conn = state->conn;
+
+    state->request.pending = *state->request.msg;
+    state->got_data = false;
+    talloc_zfree(state->reply);
+
+    if (!conn->fde) {
+        conn->fde = tevent_add_fd(state->ev, conn, conn->sd,
+                                  TEVENT_FD_WRITE, proxy_fd_handler, conn);
+        if (!conn->fde) return EIO;
+    } else {
+        TEVENT_FD_NOT_READABLE(conn->fde);
+        TEVENT_FD_WRITEABLE(conn->fde);
+    }
+
+    return EOK;
+}
+
+/* Gives the request an idle connection, opens a new one if the limit
+ * allows it or queues the request until a connection is released. */
+static errno_t proxy_http_req_acquire(struct tevent_req *req)
+{
+    struct proxy_http_req_state *state =
+                tevent_req_data(req, struct proxy_http_req_state);
+    struct proxy_pool *pool = state->pool;
+    struct proxy_conn *conn;
+    struct tevent_req *subreq;
+
+    if (!pool) return EIO;
+
+    if (pool->idle) {
+        conn = pool->idle;
+        DLIST_REMOVE(pool->idle, conn);
+        conn->idle = false;
+        talloc_zfree(conn->idle_te);
+
+        conn->req = req;
+        state->conn = conn;
+        state->reused = true;
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Reusing connection [%d] to %s:%d\n",
+              conn->sd, pool->name, pool->port);
+
+        return proxy_http_req_start_io(req);
+    }
+
+    if (pool->num_conns >= pool->pctx->max_conns) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "All %d connections to %s:%d are busy, queuing request\n",
+              pool->num_conns, pool->name, pool->port);
+        DLIST_ADD_END(pool->waiting, state, struct proxy_http_req_state *);
+        state->waiting = true;
+        return EOK;
+    }
+
+    state->conn = proxy_conn_new(pool, req);
+    if (!state->conn) return ENOMEM;
+    state->reused = false;
+
+    if (state->hostent) {
+        /* already resolved, this is a retry */
+        state->hostidx = 0;
+        proxy_http_req_connect_step(req);
+        return EOK;
+    }
+
+    /* STEP2: resolve hostname first */
+    subreq = resolv_gethostbyname_send(state, state->ev, state->pctx->resctx,
+                                       state->proxyname, IPV4_FIRST,
+                                       default_host_dbs);
+    if (subreq == NULL) return ENOMEM;
+
+    tevent_req_set_callback(subreq, proxy_http_req_gethostname_done, req);
+
+    return EOK;
+}
+
+static bool proxy_http_method_is_idempotent(enum http_method method)
+{
+    switch (method) {
+    case HTTP_GET:
+    case HTTP_HEAD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* A reused connection may have been closed by the server just before we
+ * sent the request. Such a request can be sent again on a fresh
+ * connection if the server did not see any of it. Once the request was
+ * written the server may have executed it before closing the connection,
+ * so only requests without side effects are repeated then. */
+static bool proxy_http_req_may_retry(struct proxy_http_req_state *state)
+{
+    struct proxy_http_request *request = &state->request;
+    bool written;
+
+    if (!state->reused || state->retried || state->got_data) {
+        return false;
+    }
+
+    written = request->pending.head.length != request->msg->head.length
+                || request->pending.body.length != request->msg->body.length;
+    if (!written) {
+        return true;
+    }
+
+    return proxy_http_method_is_idempotent(request->method);
+}
+
+static bool proxy_http_req_retry(struct tevent_req *req)
+{
+    struct proxy_http_req_state *state =
+                tevent_req_data(req, struct proxy_http_req_state);
+    struct proxy_pool *pool;
+    int ret;
+
+    if (!proxy_http_req_may_retry(state)) {
+        return false;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Reused connection to %s:%d failed, retrying\n",
+          state->pool->name, state->pool->port);
+
+    state->retried = true;
+    pool = state->pool;
+    talloc_free(state->conn);
+
+    /* the freed slot belongs to this request, not to the waiting ones */
+    ret = proxy_http_req_acquire(req);
+    if (ret != EOK) {
+        proxy_http_req_fail(req, ret);
+    }
+
+    proxy_pool_dispatch(pool);
+    return true;
+}
+
 struct tevent_req *proxy_http_req_send(struct proxy_context *pctx,
                                        TALLOC_CTX *mem_ctx,
                                        struct tevent_context *ev,
                                        struct sec_req_ctx *secreq,
                                        const char *http_uri,
-                                       struct sec_data *http_req)
+                                       struct sec_msg *http_req)
 {
     struct proxy_http_req_state *state;
     struct http_parser_url parsed;
-    struct tevent_req *req, *subreq;
+    struct tevent_req *req;
     int ret;
 
     req = tevent_req_create(mem_ctx, &state, struct proxy_http_req_state);
     if (!req) return NULL;
 
     state->ev = ev;
-    state->request.data = http_req;
-    state->sd = -1;
+    state->req = req;
+    state->pctx = pctx;
+    state->request.method = secreq->method;
+    state->request.msg = http_req;
     talloc_set_destructor((TALLOC_CTX *)state,
                           proxy_http_req_state_destroy);
 
@@ -377,16 +780,16 @@ struct tevent_req *proxy_http_req_send(struct proxy_context *pctx,
         }
     }
 
-    /* STEP2: resolve hostname first */
-    subreq = resolv_gethostbyname_send(state, ev, pctx->resctx,
-                                       state->proxyname, IPV4_FIRST,
-                                       default_host_dbs);
-    if (subreq == NULL) {
+    state->pool = proxy_pool_get(pctx, state->proxyname, state->port);
+    if (!state->pool) {
         ret = ENOMEM;
         goto done;
     }
 
-    tevent_req_set_callback(subreq, proxy_http_req_gethostname_done, req);
+    /* STEP2: get a connection, resolving the hostname if a new one is
+     * needed */
+    ret = proxy_http_req_acquire(req);
+    if (ret) goto done;
 
     return req;
 
@@ -394,6 +797,7 @@ done:
     if (ret == EOK) {
         tevent_req_done(req);
     } else {
+        if (state->conn) proxy_conn_close(state->conn);
         tevent_req_error(req, ret);
     }
     tevent_req_post(req, ev);
@@ -438,7 +842,7 @@ done:
     if (ret == EOK) {
         tevent_req_done(req);
     } else {
-        tevent_req_error(req, ret);
+        proxy_http_req_fail(req, ret);
     }
 }
 
@@ -452,6 +856,12 @@ static void proxy_http_req_connect_step(struct tevent_req *req)
 
     state = tevent_req_data(req, struct proxy_http_req_state);
 
+    if (!state->conn) {
+        /* the pool went away */
+        ret = EIO;
+        goto done;
+    }
+
     if (!state->hostent->addr_list[state->hostidx]) {
         DEBUG(SSSDBG_CRIT_FAILURE, "No more addresses to try.\n");
         ret = ENXIO;
@@ -494,7 +904,7 @@ done:
     if (ret == EOK) {
         tevent_req_done(req);
     } else {
-        tevent_req_error(req, ret);
+        proxy_http_req_fail(req, ret);
     }
 }
 
@@ -502,12 +912,13 @@ static void proxy_http_req_connect_done(struct tevent_req *subreq)
 {
     struct tevent_req *req;
     struct proxy_http_req_state *state;
+    int sd;
     int ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct proxy_http_req_state);
 
-    ret = sssd_async_socket_init_recv(subreq, &state->sd);
+    ret = sssd_async_socket_init_recv(subreq, &sd);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -519,16 +930,18 @@ static void proxy_http_req_connect_done(struct tevent_req *subreq)
         return;
     }
 
-    /* EOK */
-    DEBUG(SSSDBG_TRACE_FUNC, "Connected to %s\n", state->hostent->name);
-
-    state->fde = tevent_add_fd(state->ev, state, state->sd,
-                               TEVENT_FD_WRITE, proxy_fd_handler,
-                               req);
-    if (!state->fde) {
+    if (!state->conn) {
+        close(sd);
         ret = EIO;
         goto done;
     }
+    state->conn->sd = sd;
+
+    /* EOK */
+    DEBUG(SSSDBG_TRACE_FUNC, "Connected to %s\n", state->hostent->name);
+
+    ret = proxy_http_req_start_io(req);
+    if (ret != EOK) goto done;
 
     return;
 
@@ -536,7 +949,7 @@ done:
     if (ret == EOK) {
         tevent_req_done(req);
     } else {
-        tevent_req_error(req, ret);
+        proxy_http_req_fail(req, ret);
     }
 }
 
@@ -561,10 +974,14 @@ static int proxy_http_req_state_destroy(void *data)
 
     if (!state) return 0;
 
-    if (state->sd != -1) {
-        DEBUG(SSSDBG_TRACE_FUNC, "closing socket [%d]\n", state->sd);
-        close(state->sd);
-        state->sd = -1;
+    if (state->waiting) {
+        DLIST_REMOVE(state->pool->waiting, state);
+        state->waiting = false;
+    }
+
+    if (state->conn) {
+        /* the request was interrupted in the middle of an exchange */
+        proxy_conn_close(state->conn);
     }
 
     return 0;
@@ -572,42 +989,32 @@ static int proxy_http_req_state_destroy(void *data)
 
 static int proxy_wire_send(int fd, struct proxy_http_request *req)
 {
-    struct sec_data data;
-    size_t ret;
-
-    data.data = req->data->data + req->written;
-    data.length = req->data->length - req->written;
-
-    ret = sec_send_data(fd, &data);
-    if (ret != EOK && ret != EAGAIN) return ret;
-
-    req->written = req->data->length - data.length;
-    return ret;
+    return sec_send_msg(fd, &req->pending);
 }
 
-static void proxy_fd_send(void *data)
+static void proxy_fd_send(struct tevent_req *req)
 {
     struct proxy_http_req_state *state;
-    struct tevent_req * req;
     int ret;
 
-    req = talloc_get_type(data, struct tevent_req);
     state = tevent_req_data(req, struct proxy_http_req_state);
 
-    ret = proxy_wire_send(state->sd, &state->request);
+    ret = proxy_wire_send(state->conn->sd, &state->request);
     if (ret == EAGAIN) {
         /* not all data was sent, loop again */
         return;
     }
     if (ret != EOK) {
+        if (proxy_http_req_retry(req)) return;
+
         DEBUG(SSSDBG_FATAL_FAILURE, "Failed to send data, aborting!\n");
-        tevent_req_error(req, ret);
+        proxy_http_req_fail(req, ret);
         return;
     }
 
     /* ok all sent, wait for reply now */
-    TEVENT_FD_NOT_WRITEABLE(state->fde);
-    TEVENT_FD_READABLE(state->fde);
+    TEVENT_FD_NOT_WRITEABLE(state->conn->fde);
+    TEVENT_FD_READABLE(state->conn->fde);
     return;
 }
 
@@ -633,6 +1040,12 @@ static void ph_append_string(TALLOC_CTX *memctx, char **dest,
 
 static int ph_on_message_begin(http_parser *parser)
 {
+    struct proxy_http_reply *reply =
+        talloc_get_type(parser->data, struct proxy_http_reply);
+
+    /* We never pipeline requests, anything after the reply is garbage */
+    if (reply->complete) return -1;
+
     DEBUG(SSSDBG_TRACE_INTERNAL, "HTTP Message parsing begins\n");
     return 0;
 }
@@ -727,7 +1140,19 @@ static int ph_on_header_value(http_parser *parser,
 
 static int ph_on_headers_complete(http_parser *parser)
 {
+    struct proxy_http_reply *reply =
+        talloc_get_type(parser->data, struct proxy_http_reply);
+    int ret;
+
     /* TODO: if message has no body we should return 1 */
+
+    ret = sec_data_prealloc(reply, &reply->body, parser->content_length,
+                            reply->max_body);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Cannot accept body, aborting!\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -735,17 +1160,19 @@ static int ph_on_body(http_parser *parser, const char *at, size_t length)
 {
     struct proxy_http_reply *reply =
         talloc_get_type(parser->data, struct proxy_http_reply);
+    int ret;
 
-    if (ph_received_data(reply, length)) return -1;
+    if (reply->body.length + length > reply->max_body) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Reply body too big, aborting!\n");
+        return -1;
+    }
 
-    /* FIXME: body may be binary */
-    ph_append_string(reply, &reply->body.data, at, length);
-    if (!reply->body.data) {
+    ret = sec_data_append(reply, &reply->body, at, length);
+    if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE,
               "Failed to store body, aborting!\n");
         return -1;
     }
-    reply->body.length += length;
 
     return 0;
 }
@@ -756,6 +1183,7 @@ static int ph_on_message_complete(http_parser *parser)
         talloc_get_type(parser->data, struct proxy_http_reply);
 
     reply->status_code = parser->status_code;
+    reply->keep_alive = http_should_keep_alive(parser);
     reply->complete = true;
 
     return 0;
@@ -773,17 +1201,16 @@ static http_parser_settings ph_callbacks = {
     .on_message_complete = ph_on_message_complete
 };
 
-static void proxy_fd_recv(void *data)
+static void proxy_fd_recv(struct tevent_req *req)
 {
     char buffer[SEC_PACKET_MAX_RECV_SIZE];
     struct sec_data packet = { buffer,
                                SEC_PACKET_MAX_RECV_SIZE };
     struct proxy_http_req_state *state;
-    struct tevent_req *req;
     bool must_complete = false;
+    bool reusable;
     int ret;
 
-    req = talloc_get_type(data, struct tevent_req);
     state = tevent_req_data(req, struct proxy_http_req_state);
 
     if (!state->reply) {
@@ -791,16 +1218,19 @@ static void proxy_fd_recv(void *data)
         state->reply = talloc_zero(state, struct proxy_http_reply);
         if (!state->reply) {
             DEBUG(SSSDBG_FATAL_FAILURE, "Failed to allocate reply, aborting!\n");
-            tevent_req_error(req, ENOMEM);
+            proxy_http_req_fail(req, ENOMEM);
             return;
         }
         http_parser_init(&state->reply->parser, HTTP_RESPONSE);
         state->reply->parser.data = state->reply;
+        state->reply->max_body = state->pctx->max_payload_size;
     }
 
-    ret = sec_recv_data(state->sd, &packet);
+    ret = sec_recv_data(state->conn->sd, &packet);
     switch (ret) {
     case ENODATA:
+        if (proxy_http_req_retry(req)) return;
+
         DEBUG(SSSDBG_TRACE_ALL, "Server closed connection.\n");
         /* if we got no content length and the request is not complete,
          * then 0 length will indicate EOF to the parser, otherwise we
@@ -813,43 +1243,64 @@ static void proxy_fd_recv(void *data)
         return;
     case EOK:
         /* all fine */
+        state->got_data = true;
         break;
     default:
+        if (proxy_http_req_retry(req)) return;
+
         DEBUG(SSSDBG_FATAL_FAILURE,
               "Failed to receive data (%d, %s), aborting\n",
               ret, sss_strerror(ret));
-        tevent_req_error(req, EIO);
+        proxy_http_req_fail(req, EIO);
         return;
     }
 
     ret = http_parser_execute(&state->reply->parser, &ph_callbacks,
                               packet.data, packet.length);
-    if (ret != packet.length) {
+    if (ret != packet.length && !state->reply->complete) {
         DEBUG(SSSDBG_FATAL_FAILURE,
               "Failed to parse request, aborting!\n");
-        tevent_req_error(req, EIO);
+        proxy_http_req_fail(req, EIO);
         return;
     }
 
     if (!state->reply->complete) {
         if (must_complete) {
-            tevent_req_error(req, EIO);
+            proxy_http_req_fail(req, EIO);
         }
         return;
     }
 
+    /* The connection can serve another request only if the server
+     * agreed to keep it open and sent nothing beyond the reply. */
+    reusable = state->reply->keep_alive
+                && !must_complete
+                && ret == packet.length;
+
     /* do not read anymore, server is done sending */
-    TEVENT_FD_NOT_READABLE(state->fde);
+    TEVENT_FD_NOT_READABLE(state->conn->fde);
+    proxy_http_req_release(req, reusable);
     tevent_req_done(req);
 }
 
 static void proxy_fd_handler(struct tevent_context *ev, struct tevent_fd *fde,
                              uint16_t flags, void *data)
 {
+    struct proxy_conn *conn = talloc_get_type(data, struct proxy_conn);
+
+    if (!conn->req) {
+        /* an idle connection became readable, the server either closed
+         * it or sent something we did not ask for */
+        DEBUG(SSSDBG_TRACE_FUNC, "Idle connection to %s:%d was closed\n",
+              conn->pool->name, conn->pool->port);
+        proxy_conn_close(conn);
+        return;
+    }
+
     if (flags & TEVENT_FD_READ) {
-        proxy_fd_recv(data);
+        proxy_fd_recv(conn->req);
     } else if (flags & TEVENT_FD_WRITE) {
-        proxy_fd_send(data);
+        proxy_fd_send(conn->req);
     }
 }
 
@@ -868,7 +1319,7 @@ struct tevent_req *proxy_secret_req(TALLOC_CTX *mem_ctx,
     struct tevent_req *req, *subreq;
     struct proxy_secret_state *state;
     struct proxy_context *pctx;
-    struct sec_data *http_req;
+    struct sec_msg *http_req;
     char *http_uri;
     int ret;
 
@@ -964,11 +1415,14 @@ int proxy_secrets_provider_handle(struct sec_ctx *sctx,
     handle->name = "PROXY";
     handle->fn = proxy_secret_req;
 
-    pctx = talloc(handle, struct proxy_context);
+    pctx = talloc_zero(handle, struct proxy_context);
     if (!pctx) return ENOMEM;
 
     pctx->resctx = sctx->resctx;
     pctx->cdb = sctx->rctx->cdb;
+    pctx->max_conns = sctx->proxy_max_conns;
+    pctx->idle_timeout = sctx->proxy_idle_timeout;
+    pctx->max_payload_size = sctx->max_payload_size;
 
     handle->context = pctx;
 
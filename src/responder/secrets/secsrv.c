@@ -32,6 +32,7 @@
 
 static int sec_get_config(struct sec_ctx *sctx)
 {
+    int max_payload;
     int ret;
 
     ret = confdb_get_int(sctx->rctx->cdb,
@@ -61,6 +62,50 @@ static int sec_get_config(struct sec_ctx *sctx)
         sctx->rctx->client_idle_timeout = 10;
     }
 
+    ret = confdb_get_int(sctx->rctx->cdb, sctx->rctx->confdb_service_path,
+                         CONFDB_SEC_PROXY_MAX_CONNS,
+                         SEC_PROXY_DEFAULT_MAX_CONNS,
+                         &sctx->proxy_max_conns);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the proxy connection limit [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
+    if (sctx->proxy_max_conns < 1) {
+        sctx->proxy_max_conns = 1;
+    }
+
+    /* 0 disables keeping idle connections open */
+    ret = confdb_get_int(sctx->rctx->cdb, sctx->rctx->confdb_service_path,
+                         CONFDB_SEC_PROXY_IDLE_TIMEOUT,
+                         SEC_PROXY_DEFAULT_IDLE_TIMEOUT,
+                         &sctx->proxy_idle_timeout);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the proxy idle timeout [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
+    ret = confdb_get_int(sctx->rctx->cdb, sctx->rctx->confdb_service_path,
+                         CONFDB_SEC_MAX_PAYLOAD_SIZE,
+                         SEC_DEFAULT_MAX_PAYLOAD_SIZE,
+                         &max_payload);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the maximum payload size [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
+    /* the option is in KiB */
+    if (max_payload < 1) {
+        max_payload = 1;
+    }
+    sctx->max_payload_size = (size_t)max_payload * 1024;
+
     ret = EOK;
 
 fail:
@@ -31,6 +31,9 @@
 #include <ldb.h>
 
 #define SEC_NET_TIMEOUT 5
+#define SEC_PROXY_DEFAULT_MAX_CONNS 8
+#define SEC_PROXY_DEFAULT_IDLE_TIMEOUT 30
+#define SEC_DEFAULT_MAX_PAYLOAD_SIZE 64 /* KiB */
 
 struct resctx;
 
@@ -38,6 +41,11 @@ struct sec_ctx {
     struct resolv_ctx *resctx;
     struct resp_ctx *rctx;
     int fd_limit;
+    size_t max_payload_size;
+
+    /* connections to each proxy upstream */
+    int proxy_max_conns;
+    int proxy_idle_timeout;
 
     struct provider_handle **providers;
 };
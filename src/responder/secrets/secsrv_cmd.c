@@ -20,6 +20,8 @@
 */
 
 #include "config.h"
+#include <sys/param.h>
+#include <sys/uio.h>
 #include "util/util.h"
 #include "responder/common/responder.h"
 #include "responder/secrets/secsrv.h"
@@ -263,9 +265,32 @@ static int sec_on_header_value(http_parser *parser,
     return 0;
 }
 
+static size_t sec_max_payload_size(struct sec_req_ctx *req)
+{
+    struct sec_ctx *sctx;
+
+    sctx = talloc_get_type(req->cctx->rctx->pvt_ctx, struct sec_ctx);
+    return sctx->max_payload_size;
+}
+
 static int sec_on_headers_complete(http_parser *parser)
 {
+    struct sec_req_ctx *req =
+        talloc_get_type(parser->data, struct sec_req_ctx);
+    int ret;
+
     /* TODO: if message has no body we should return 1 */
+
+    /* Refuse oversized payloads before reading them and size the buffer
+     * once when the length is known, chunked bodies grow as they come */
+    ret = sec_data_prealloc(req, &req->body, parser->content_length,
+                            sec_max_payload_size(req));
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Cannot accept body, aborting client!\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -274,16 +299,20 @@ static int sec_on_body(http_parser *parser,
 {
     struct sec_req_ctx *req =
         talloc_get_type(parser->data, struct sec_req_ctx);
+    int ret;
 
-    if (sec_too_much_data(req, length)) return -1;
+    if (req->body.length + length > sec_max_payload_size(req)) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Request body too big, aborting client!\n");
+        return -1;
+    }
 
-    sec_append_string(req, &req->body.data, at, length);
-    if (!req->body.data) {
+    ret = sec_data_append(req, &req->body, at, length);
+    if (ret != EOK) {
         DEBUG(SSSDBG_FATAL_FAILURE,
               "Failed to store body, aborting client!\n");
         return -1;
     }
-    req->body.length += length;
 
     return 0;
 }
@@ -373,12 +402,31 @@ static int sec_on_message_complete(http_parser *parser)
 
 /* ##### Communications ##### */
 
-int sec_send_data(int fd, struct sec_data *data)
+/* Writes as much of the message as the socket accepts, head and body
+ * are gathered in a single call. Returns EAGAIN until all is sent. */
+int sec_send_msg(int fd, struct sec_msg *msg)
 {
+    struct iovec iov[2];
+    int iovcnt = 0;
+    size_t head_len;
     ssize_t len;
 
+    if (msg->head.length) {
+        iov[iovcnt].iov_base = msg->head.data;
+        iov[iovcnt].iov_len = msg->head.length;
+        iovcnt++;
+    }
+    if (msg->body.length) {
+        iov[iovcnt].iov_base = msg->body.data;
+        iov[iovcnt].iov_len = msg->body.length;
+        iovcnt++;
+    }
+    if (iovcnt == 0) {
+        return EOK;
+    }
+
     errno = 0;
-    len = send(fd, data->data, data->length, 0);
+    len = writev(fd, iov, iovcnt);
     if (len == -1) {
         if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
             return EAGAIN;
@@ -391,8 +439,18 @@ int sec_send_data(int fd, struct sec_data *data)
         return EIO;
     }
 
-    data->length -= len;
-    data->data += len;
+    head_len = MIN((size_t)len, msg->head.length);
+    msg->head.data += head_len;
+    msg->head.length -= head_len;
+    len -= head_len;
+
+    msg->body.data += len;
+    msg->body.length -= len;
+
+    if (msg->head.length || msg->body.length) {
+        return EAGAIN;
+    }
+
     return EOK;
 }
 
@@ -403,7 +461,7 @@ static void sec_send(struct cli_ctx *cctx)
 
     req = talloc_get_type(cctx->state_ctx, struct sec_req_ctx);
 
-    ret = sec_send_data(cctx->cfd, &req->reply);
+    ret = sec_send_msg(cctx->cfd, &req->reply);
     if (ret == EAGAIN) {
         /* not all data was sent, loop again */
         return;
@@ -37,6 +37,14 @@ struct sec_data {
     size_t length;
 };
 
+/* An outgoing HTTP message. The body is kept apart from the status line
+ * and the headers so that it can be written to the socket straight from
+ * the buffer it was produced in. */
+struct sec_msg {
+    struct sec_data head;
+    struct sec_data body;
+};
+
 enum sec_http_status_codes {
     STATUS_200 = 0,
     STATUS_400,
@@ -81,7 +89,7 @@ struct sec_req_ctx {
     int num_headers;
     struct sec_data body;
 
-    struct sec_data reply;
+    struct sec_msg reply;
 };
 
 typedef struct tevent_req *(*sec_provider_req_t)(TALLOC_CTX *mem_ctx,
@@ -107,14 +115,18 @@ int sec_provider_recv(struct tevent_req *subreq);
 
 int sec_http_append_header(TALLOC_CTX *mem_ctx, char **dest,
                            char *field, char *value);
+int sec_data_append(TALLOC_CTX *mem_ctx, struct sec_data *buf,
+                    const char *src, size_t len);
+int sec_data_prealloc(TALLOC_CTX *mem_ctx, struct sec_data *buf,
+                      uint64_t content_length, size_t max_length);
 
-int sec_http_status_reply(TALLOC_CTX *mem_ctx, struct sec_data *reply,
+int sec_http_status_reply(TALLOC_CTX *mem_ctx, struct sec_msg *reply,
                           enum sec_http_status_codes code);
-int sec_http_reply_with_body(TALLOC_CTX *mem_ctx, struct sec_data *reply,
+int sec_http_reply_with_body(TALLOC_CTX *mem_ctx, struct sec_msg *reply,
                              enum sec_http_status_codes code,
                              const char *content_type,
                              struct sec_data *body);
-int sec_http_reply_with_headers(TALLOC_CTX *mem_ctx, struct sec_data *reply,
+int sec_http_reply_with_headers(TALLOC_CTX *mem_ctx, struct sec_msg *reply,
                                 int status_code, const char *reason,
                                 struct sec_kvp *headers, int num_headers,
                                 struct sec_data *body);
@@ -135,10 +147,11 @@ bool sec_req_has_header(struct sec_req_ctx *req,
                         const char *name, const char *value);
 
 /* secsrv_cmd.c */
+/* limit for everything but the body, see max_payload_size for that */
 #define SEC_REQUEST_MAX_SIZE 65536
 #define SEC_PACKET_MAX_RECV_SIZE 8192
 
-int sec_send_data(int fd, struct sec_data *data);
+int sec_send_msg(int fd, struct sec_msg *msg);
 int sec_recv_data(int fd, struct sec_data *data);
 
 #endif /* __SECSRV_PRIVATE_H__ */
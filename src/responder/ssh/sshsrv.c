@@ -39,6 +39,7 @@ struct mon_cli_iface monitor_ssh_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .getStats = monitor_common_get_stats,
 };
 
 static void ssh_dp_reconnect_init(struct sbus_connection *conn,
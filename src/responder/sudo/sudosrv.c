@@ -40,6 +40,7 @@ struct mon_cli_iface monitor_sudo_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .getStats = monitor_common_get_stats,
 };
 
 static void sudo_dp_reconnect_init(struct sbus_connection *conn,
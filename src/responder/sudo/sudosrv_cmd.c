@@ -135,6 +135,25 @@ errno_t sudosrv_cmd_reply(struct sudo_cmd_ctx *cmd_ctx, int ret)
             return EFAULT;
         }
 
+        /* Time restrictions depend on the current time, such responses
+         * can not be reused. */
+        if (!cmd_ctx->sudo_ctx->timed && cmd_ctx->domain != NULL) {
+            ret = sudosrv_rules_index_set_response(cmd_ctx->sudo_ctx,
+                                                   cmd_ctx->domain,
+                                                   cmd_ctx->type,
+                                                   cmd_ctx->uid,
+                                                   cmd_ctx->rawname,
+                                                   cmd_ctx->user,
+                                                   response_body,
+                                                   response_len,
+                                                   cmd_ctx->expire);
+            if (ret != EOK) {
+                DEBUG(SSSDBG_MINOR_FAILURE, "Unable to store packed "
+                      "response [%d]: %s\n", ret, sss_strerror(ret));
+                /* not fatal */
+            }
+        }
+
         ret = sudosrv_cmd_send_reply(cmd_ctx, response_body, response_len);
         break;
 
@@ -175,6 +194,8 @@ static int sudosrv_cmd(enum sss_sudo_type type, struct cli_ctx *cli_ctx)
     struct sudo_cmd_ctx *cmd_ctx = NULL;
     uint8_t *query_body = NULL;
     size_t query_len = 0;
+    uint8_t *response_body = NULL;
+    size_t response_len = 0;
     struct cli_protocol *pctx;
     uint32_t protocol;
     errno_t ret;
@@ -234,6 +255,20 @@ static int sudosrv_cmd(enum sss_sudo_type type, struct cli_ctx *cli_ctx)
         goto done;
     }
 
+    if (!cmd_ctx->sudo_ctx->timed) {
+        ret = sudosrv_rules_index_get_response(cmd_ctx->sudo_ctx,
+                                               cmd_ctx->type, cmd_ctx->uid,
+                                               cmd_ctx->rawname,
+                                               &response_body, &response_len);
+        if (ret == EOK) {
+            return sudosrv_cmd_send_reply(cmd_ctx, response_body,
+                                          response_len);
+        } else if (ret != ENOENT) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to look up packed response "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+        }
+    }
+
     req = sudosrv_get_rules_send(cmd_ctx, cli_ctx->ev, cmd_ctx->sudo_ctx,
                                  cmd_ctx->type, cmd_ctx->uid,
                                  cmd_ctx->rawname);
@@ -258,7 +293,8 @@ static void sudosrv_cmd_done(struct tevent_req *req)
     cmd_ctx = tevent_req_callback_data(req, struct sudo_cmd_ctx);
 
     ret = sudosrv_get_rules_recv(cmd_ctx, req, &cmd_ctx->rules,
-                                 &cmd_ctx->num_rules);
+                                 &cmd_ctx->num_rules, &cmd_ctx->domain,
+                                 &cmd_ctx->expire, &cmd_ctx->user);
     talloc_zfree(req);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to obtain cached rules [%d]: %s\n",
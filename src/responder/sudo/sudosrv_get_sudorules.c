@@ -32,87 +32,6 @@
 #include "responder/sudo/sudosrv_private.h"
 #include "providers/data_provider.h"
 
-static int
-sudo_order_cmp(const void *a, const void *b, bool lower_wins)
-{
-    struct sysdb_attrs *r1, *r2;
-    uint32_t o1, o2;
-    int ret;
-
-    r1 = * (struct sysdb_attrs * const *) a;
-    r2 = * (struct sysdb_attrs * const *) b;
-    if (!r1 || !r2) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "BUG: Wrong data?\n");
-        return 0;
-    }
-
-    ret = sysdb_attrs_get_uint32_t(r1, SYSDB_SUDO_CACHE_AT_ORDER, &o1);
-    if (ret == ENOENT) {
-        /* man sudoers-ldap: If the sudoOrder attribute is not present,
-         * a value of 0 is assumed */
-        o1 = 0;
-    } else if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "Cannot get sudoOrder value\n");
-        return 0;
-    }
-
-    ret = sysdb_attrs_get_uint32_t(r2, SYSDB_SUDO_CACHE_AT_ORDER, &o2);
-    if (ret == ENOENT) {
-        /* man sudoers-ldap: If the sudoOrder attribute is not present,
-         * a value of 0 is assumed */
-        o2 = 0;
-    } else if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "Cannot get sudoOrder value\n");
-        return 0;
-    }
-
-    if (lower_wins) {
-        /* The lowest value takes priority. Original wrong SSSD behaviour. */
-        if (o1 > o2) {
-            return 1;
-        } else if (o1 < o2) {
-            return -1;
-        }
-    } else {
-        /* The higher value takes priority. Standard LDAP behaviour. */
-        if (o1 < o2) {
-            return 1;
-        } else if (o1 > o2) {
-            return -1;
-        }
-    }
-
-    return 0;
-}
-
-static int
-sudo_order_low_cmp_fn(const void *a, const void *b)
-{
-    return sudo_order_cmp(a, b, true);
-}
-
-static int
-sudo_order_high_cmp_fn(const void *a, const void *b)
-{
-    return sudo_order_cmp(a, b, false);
-}
-
-static errno_t
-sort_sudo_rules(struct sysdb_attrs **rules, size_t count, bool lower_wins)
-{
-    if (lower_wins) {
-        DEBUG(SSSDBG_TRACE_FUNC, "Sorting rules with lower-wins logic\n");
-        qsort(rules, count, sizeof(struct sysdb_attrs *),
-              sudo_order_low_cmp_fn);
-    } else {
-        DEBUG(SSSDBG_TRACE_FUNC, "Sorting rules with higher-wins logic\n");
-        qsort(rules, count, sizeof(struct sysdb_attrs *),
-              sudo_order_high_cmp_fn);
-    }
-
-    return EOK;
-}
-
 static errno_t sudosrv_query_cache(TALLOC_CTX *mem_ctx,
                                    struct sss_domain_info *domain,
                                    const char **attrs,
@@ -168,6 +87,7 @@ done:
 }
 
 static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
+                                     struct sudo_ctx *sudo_ctx,
                                      struct sss_domain_info *domain,
                                      uid_t uid,
                                      const char *username,
@@ -175,210 +95,49 @@ static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
                                      struct sysdb_attrs ***_rules,
                                      uint32_t *_num_rules)
 {
-    const char *attrs[] = { SYSDB_NAME, NULL };
-    char *filter;
+    struct sudosrv_rules_index *idx;
     errno_t ret;
 
-    filter = sysdb_sudo_filter_expired(NULL, username, groups, uid);
-    if (filter == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sudosrv_query_cache(mem_ctx, domain, attrs, filter,
-                              _rules, _num_rules);
-    talloc_free(filter);
-
-    return ret;
-}
-
-static errno_t sudosrv_cached_rules_by_user(TALLOC_CTX *mem_ctx,
-                                            struct sss_domain_info *domain,
-                                            uid_t uid,
-                                            const char *username,
-                                            char **groupnames,
-                                            struct sysdb_attrs ***_rules,
-                                            uint32_t *_num_rules)
-{
-    TALLOC_CTX *tmp_ctx;
-    struct sysdb_attrs **rules;
-    uint32_t num_rules;
-    uint32_t i;
-    const char *filter;
-    const char *val;
-    errno_t ret;
-    const char *attrs[] = { SYSDB_OBJECTCLASS,
-                            SYSDB_SUDO_CACHE_AT_CN,
-                            SYSDB_SUDO_CACHE_AT_HOST,
-                            SYSDB_SUDO_CACHE_AT_COMMAND,
-                            SYSDB_SUDO_CACHE_AT_OPTION,
-                            SYSDB_SUDO_CACHE_AT_RUNAS,
-                            SYSDB_SUDO_CACHE_AT_RUNASUSER,
-                            SYSDB_SUDO_CACHE_AT_RUNASGROUP,
-                            SYSDB_SUDO_CACHE_AT_NOTBEFORE,
-                            SYSDB_SUDO_CACHE_AT_NOTAFTER,
-                            SYSDB_SUDO_CACHE_AT_ORDER,
-                            NULL };
-
-    tmp_ctx = talloc_new(NULL);
-    if (tmp_ctx == NULL) {
-        return ENOMEM;
-    }
-
-    filter = sysdb_sudo_filter_user(tmp_ctx, username, groupnames, uid);
-    if (filter == NULL) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    ret = sudosrv_query_cache(tmp_ctx, domain, attrs, filter,
-                              &rules, &num_rules);
+    ret = sudosrv_rules_index_get(sudo_ctx, domain, &idx);
     if (ret != EOK) {
-        goto done;
-    }
-
-    val = talloc_asprintf(tmp_ctx, "#%"SPRIuid, uid);
-    if (val == NULL) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    /* Add sudoUser: #uid to prevent conflicts with fqnames. */
-    DEBUG(SSSDBG_TRACE_FUNC, "Replacing sudoUser attribute with "
-          "sudoUser: %s\n", val);
-    for (i = 0; i < num_rules; i++) {
-        ret = sysdb_attrs_add_string(rules[i], SYSDB_SUDO_CACHE_AT_USER, val);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to alter sudoUser attribute "
-                  "[%d]: %s\n", ret, sss_strerror(ret));
-        }
-    }
-
-    *_rules = talloc_steal(mem_ctx, rules);
-    *_num_rules = num_rules;
-
-    ret = EOK;
-
-done:
-    talloc_free(tmp_ctx);
-    return ret;
-}
-
-static errno_t sudosrv_cached_rules_by_ng(TALLOC_CTX *mem_ctx,
-                                          struct sss_domain_info *domain,
-                                          uid_t uid,
-                                          const char *username,
-                                          char **groupnames,
-                                          struct sysdb_attrs ***_rules,
-                                          uint32_t *_num_rules)
-{
-    char *filter;
-    errno_t ret;
-    const char *attrs[] = { SYSDB_OBJECTCLASS,
-                            SYSDB_SUDO_CACHE_AT_CN,
-                            SYSDB_SUDO_CACHE_AT_USER,
-                            SYSDB_SUDO_CACHE_AT_HOST,
-                            SYSDB_SUDO_CACHE_AT_COMMAND,
-                            SYSDB_SUDO_CACHE_AT_OPTION,
-                            SYSDB_SUDO_CACHE_AT_RUNAS,
-                            SYSDB_SUDO_CACHE_AT_RUNASUSER,
-                            SYSDB_SUDO_CACHE_AT_RUNASGROUP,
-                            SYSDB_SUDO_CACHE_AT_NOTBEFORE,
-                            SYSDB_SUDO_CACHE_AT_NOTAFTER,
-                            SYSDB_SUDO_CACHE_AT_ORDER,
-                            NULL };
-
-    filter = sysdb_sudo_filter_netgroups(NULL, username, groupnames, uid);
-    if (filter == NULL) {
-        return ENOMEM;
+        return ret;
     }
 
-    ret = sudosrv_query_cache(mem_ctx, domain, attrs, filter,
-                              _rules, _num_rules);
-    talloc_free(filter);
-
-    return ret;
+    return sudosrv_rules_index_expired(mem_ctx, idx, uid, username, groups,
+                                       _rules, _num_rules);
 }
 
 static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
+                                    struct sudo_ctx *sudo_ctx,
                                     struct sss_domain_info *domain,
                                     uid_t uid,
                                     const char *username,
                                     char **groups,
-                                    bool inverse_order,
                                     struct sysdb_attrs ***_rules,
-                                    uint32_t *_num_rules)
+                                    uint32_t *_num_rules,
+                                    time_t *_expire)
 {
-    TALLOC_CTX *tmp_ctx;
-    struct sysdb_attrs **user_rules;
-    struct sysdb_attrs **ng_rules;
-    struct sysdb_attrs **rules;
-    uint32_t num_user_rules;
-    uint32_t num_ng_rules;
-    uint32_t num_rules;
-    uint32_t rule_iter, i;
+    struct sudosrv_rules_index *idx;
     errno_t ret;
 
-    tmp_ctx = talloc_new(NULL);
-    if (tmp_ctx == NULL) {
-        return ENOMEM;
-    }
-
-    ret = sudosrv_cached_rules_by_user(tmp_ctx, domain, uid, username, groups,
-                                       &user_rules, &num_user_rules);
-    if (ret != EOK) {
-        goto done;
-    }
-
-    ret = sudosrv_cached_rules_by_ng(tmp_ctx, domain, uid, username, groups,
-                                     &ng_rules, &num_ng_rules);
-    if (ret != EOK) {
-        goto done;
-    }
-
-    num_rules = num_user_rules + num_ng_rules;
-    if (num_rules == 0) {
-        *_rules = NULL;
-        *_num_rules = 0;
-        ret = EOK;
-        goto done;
-    }
-
-    rules = talloc_array(tmp_ctx, struct sysdb_attrs *, num_rules);
-    if (rules == NULL) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    rule_iter = 0;
-    for (i = 0; i < num_user_rules; rule_iter++, i++) {
-        rules[rule_iter] = talloc_steal(rules, user_rules[i]);
-    }
-
-    for (i = 0; i < num_ng_rules; rule_iter++, i++) {
-        rules[rule_iter] = talloc_steal(rules, ng_rules[i]);
-    }
-
-    ret = sort_sudo_rules(rules, num_rules, inverse_order);
+    ret = sudosrv_rules_index_get(sudo_ctx, domain, &idx);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "Could not sort rules by sudoOrder\n");
-        goto done;
+        return ret;
     }
 
-    *_rules = talloc_steal(mem_ctx, rules);
-    *_num_rules = num_rules;
-
-    ret = EOK;
-
-done:
-    talloc_free(tmp_ctx);
-    return ret;
+    /* The rules are returned already sorted by sudoOrder. */
+    return sudosrv_rules_index_lookup(mem_ctx, idx, uid, username, groups,
+                                      _rules, _num_rules, _expire);
 }
 
 static errno_t sudosrv_cached_defaults(TALLOC_CTX *mem_ctx,
+                                       struct sudo_ctx *sudo_ctx,
                                        struct sss_domain_info *domain,
                                        struct sysdb_attrs ***_rules,
-                                       uint32_t *_num_rules)
+                                       uint32_t *_num_rules,
+                                       time_t *_expire)
 {
+    struct sudosrv_rules_index *idx;
     char *filter;
     errno_t ret;
     const char *attrs[] = { SYSDB_OBJECTCLASS,
@@ -403,19 +162,30 @@ static errno_t sudosrv_cached_defaults(TALLOC_CTX *mem_ctx,
     ret = sudosrv_query_cache(mem_ctx, domain, attrs, filter,
                               _rules, _num_rules);
     talloc_free(filter);
+    if (ret != EOK) {
+        return ret;
+    }
 
-    return ret;
+    ret = sudosrv_rules_index_get(sudo_ctx, domain, &idx);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    sudosrv_rules_index_defaults_expire(idx, _expire);
+
+    return EOK;
 }
 
 static errno_t sudosrv_fetch_rules(TALLOC_CTX *mem_ctx,
+                                   struct sudo_ctx *sudo_ctx,
                                    enum sss_sudo_type type,
                                    struct sss_domain_info *domain,
                                    uid_t uid,
                                    const char *username,
                                    char **groups,
-                                   bool inverse_order,
                                    struct sysdb_attrs ***_rules,
-                                   uint32_t *_num_rules)
+                                   uint32_t *_num_rules,
+                                   time_t *_expire)
 {
     struct sysdb_attrs **rules;
     const char *debug_name = "unknown";
@@ -428,8 +198,8 @@ static errno_t sudosrv_fetch_rules(TALLOC_CTX *mem_ctx,
               username, domain->name);
         debug_name = "rules";
 
-        ret = sudosrv_cached_rules(mem_ctx, domain, uid, username, groups,
-                                   inverse_order, &rules, &num_rules);
+        ret = sudosrv_cached_rules(mem_ctx, sudo_ctx, domain, uid, username,
+                                   groups, &rules, &num_rules, _expire);
 
         break;
     case SSS_SUDO_DEFAULTS:
@@ -437,7 +207,8 @@ static errno_t sudosrv_fetch_rules(TALLOC_CTX *mem_ctx,
         DEBUG(SSSDBG_TRACE_FUNC, "Retrieving default options for [%s@%s]\n",
               username, domain->name);
 
-        ret = sudosrv_cached_defaults(mem_ctx, domain, &rules, &num_rules);
+        ret = sudosrv_cached_defaults(mem_ctx, sudo_ctx, domain,
+                                      &rules, &num_rules, _expire);
 
         break;
     default:
@@ -468,8 +239,11 @@ sudosrv_dp_oob_req_done(struct tevent_req *req)
 
 struct sudosrv_refresh_rules_state {
     struct resp_ctx *rctx;
+    struct sudo_ctx *sudo_ctx;
     struct sss_domain_info *domain;
     const char *username;
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
 };
 
 static void sudosrv_refresh_rules_done(struct tevent_req *subreq);
@@ -477,7 +251,7 @@ static void sudosrv_refresh_rules_done(struct tevent_req *subreq);
 static struct tevent_req *
 sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
                            struct tevent_context *ev,
-                           struct resp_ctx *rctx,
+                           struct sudo_ctx *sudo_ctx,
                            struct sss_domain_info *domain,
                            uid_t uid,
                            const char *username,
@@ -486,8 +260,6 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
     struct sudosrv_refresh_rules_state *state;
     struct tevent_req *req;
     struct tevent_req *subreq;
-    struct sysdb_attrs **rules;
-    uint32_t num_rules;
     errno_t ret;
 
     req = tevent_req_create(mem_ctx, &state,
@@ -497,12 +269,13 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    state->rctx = rctx;
+    state->rctx = sudo_ctx->rctx;
+    state->sudo_ctx = sudo_ctx;
     state->domain = domain;
     state->username = username;
 
-    ret = sudosrv_expired_rules(state, domain, uid, username, groups,
-                                &rules, &num_rules);
+    ret = sudosrv_expired_rules(state, sudo_ctx, domain, uid, username, groups,
+                                &state->rules, &state->num_rules);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Unable to retrieve expired sudo rules [%d]: %s\n",
@@ -510,7 +283,7 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
         goto immediately;
     }
 
-    if (num_rules == 0) {
+    if (state->num_rules == 0) {
         DEBUG(SSSDBG_TRACE_FUNC, "No expired rules were found for [%s@%s].\n",
               username, domain->name);
         ret = EOK;
@@ -518,11 +291,11 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
     }
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Refreshing %d expired rules of [%s@%s]\n",
-          num_rules, username, domain->name);
+          state->num_rules, username, domain->name);
 
-    subreq = sss_dp_get_sudoers_send(state, rctx, domain, false,
+    subreq = sss_dp_get_sudoers_send(state, state->rctx, domain, false,
                                      SSS_DP_SUDO_REFRESH_RULES,
-                                     username, num_rules, rules);
+                                     username, state->num_rules, state->rules);
     if (subreq == NULL) {
         ret = ENOMEM;
         goto immediately;
@@ -565,6 +338,15 @@ static void sudosrv_refresh_rules_done(struct tevent_req *subreq)
         goto done;
     }
 
+    /* The refreshed rules were replaced in the cache, reload them. */
+    ret = sudosrv_rules_index_update(state->sudo_ctx, state->domain,
+                                     state->rules, state->num_rules);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to update sudo rules index "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        /* not fatal, the index is rebuilt when needed */
+    }
+
     if (err_min == ENOENT) {
         DEBUG(SSSDBG_TRACE_INTERNAL,
               "Some expired rules were removed from the server, scheduling "
@@ -602,16 +384,19 @@ static errno_t sudosrv_refresh_rules_recv(struct tevent_req *req)
 
 struct sudosrv_get_rules_state {
     struct tevent_context *ev;
-    struct resp_ctx *rctx;
+    struct sudo_ctx *sudo_ctx;
     enum sss_sudo_type type;
     uid_t uid;
     char *username;
     struct sss_domain_info *domain;
     char **groups;
-    bool inverse_order;
 
     struct sysdb_attrs **rules;
     uint32_t num_rules;
+
+    /* time until which the result may be served from the packed cache */
+    time_t expire;
+    struct sudosrv_user_stamp *user;
 };
 
 static void sudosrv_get_rules_initgr_done(struct tevent_req *subreq);
@@ -636,10 +421,9 @@ struct tevent_req *sudosrv_get_rules_send(TALLOC_CTX *mem_ctx,
     }
 
     state->ev = ev;
-    state->rctx = sudo_ctx->rctx;
+    state->sudo_ctx = sudo_ctx;
     state->type = type;
     state->uid = uid;
-    state->inverse_order = sudo_ctx->inverse_order;
 
     DEBUG(SSSDBG_TRACE_FUNC, "Running initgroups for [%s]\n", username);
 
@@ -669,19 +453,36 @@ immediately:
 static void sudosrv_get_rules_initgr_done(struct tevent_req *subreq)
 {
     struct sudosrv_get_rules_state *state;
+    struct ldb_result *result;
     struct tevent_req *req;
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct sudosrv_get_rules_state);
 
-    ret = cache_req_initgr_by_name_recv(state, subreq, NULL,
+    ret = cache_req_initgr_by_name_recv(state, subreq, &result,
                                         &state->domain, &state->username);
     talloc_zfree(subreq);
     if (ret != EOK) {
         goto done;
     }
 
+    /* Group membership is not looked up again while a packed response
+     * is served, so it must not outlive the initgroups data. */
+    state->expire = ldb_msg_find_attr_as_uint64(result->msgs[0],
+                                                SYSDB_INITGR_EXPIRE, 0);
+    talloc_zfree(result);
+
+    ret = sudosrv_user_stamp_get(state, state->domain, state->username,
+                                 &state->user);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to read user entry, the "
+              "response will not be cached [%d]: %s\n",
+              ret, sss_strerror(ret));
+        /* not fatal */
+        state->user = NULL;
+    }
+
     ret = sysdb_get_sudo_user_info(state, state->domain, state->username,
                                    NULL, &state->groups);
     if (ret != EOK) {
@@ -690,7 +491,7 @@ static void sudosrv_get_rules_initgr_done(struct tevent_req *subreq)
         goto done;
     }
 
-    subreq = sudosrv_refresh_rules_send(state, state->ev, state->rctx,
+    subreq = sudosrv_refresh_rules_send(state, state->ev, state->sudo_ctx,
                                         state->domain, state->uid,
                                         state->username, state->groups);
     if (subreq == NULL) {
@@ -728,10 +529,11 @@ static void sudosrv_get_rules_done(struct tevent_req *subreq)
               "in cache.\n");
     }
 
-    ret = sudosrv_fetch_rules(state, state->type, state->domain, state->uid,
+    ret = sudosrv_fetch_rules(state, state->sudo_ctx, state->type,
+                              state->domain, state->uid,
                               state->username, state->groups,
-                              state->inverse_order,
-                              &state->rules, &state->num_rules);
+                              &state->rules, &state->num_rules,
+                              &state->expire);
 
     if (ret != EOK) {
         tevent_req_error(req, ret);
@@ -744,7 +546,10 @@ static void sudosrv_get_rules_done(struct tevent_req *subreq)
 errno_t sudosrv_get_rules_recv(TALLOC_CTX *mem_ctx,
                                struct tevent_req *req,
                                struct sysdb_attrs ***_rules,
-                               uint32_t *_num_rules)
+                               uint32_t *_num_rules,
+                               struct sss_domain_info **_domain,
+                               time_t *_expire,
+                               struct sudosrv_user_stamp **_user)
 {
     struct sudosrv_get_rules_state *state = NULL;
     state = tevent_req_data(req, struct sudosrv_get_rules_state);
@@ -754,5 +559,17 @@ errno_t sudosrv_get_rules_recv(TALLOC_CTX *mem_ctx,
     *_rules = talloc_steal(mem_ctx, state->rules);
     *_num_rules = state->num_rules;
 
+    if (_domain != NULL) {
+        *_domain = state->domain;
+    }
+
+    if (_expire != NULL) {
+        *_expire = state->expire;
+    }
+
+    if (_user != NULL) {
+        *_user = talloc_steal(mem_ctx, state->user);
+    }
+
     return EOK;
 }
@@ -40,6 +40,9 @@ enum sss_sudo_type {
     SSS_SUDO_USER
 };
 
+struct sudosrv_rules_index;
+struct sudosrv_user_stamp;
+
 struct sudo_ctx {
     struct resp_ctx *rctx;
 
@@ -48,6 +51,9 @@ struct sudo_ctx {
      */
     bool timed;
     bool inverse_order;
+
+    /* per-domain indexes of cached rules */
+    struct sudosrv_rules_index *rules_index;
 };
 
 struct sudo_cmd_ctx {
@@ -62,6 +68,9 @@ struct sudo_cmd_ctx {
     /* output data */
     struct sysdb_attrs **rules;
     uint32_t num_rules;
+    struct sss_domain_info *domain;
+    time_t expire;
+    struct sudosrv_user_stamp *user;
 };
 
 struct sss_cmd_table *get_sudo_cmds(void);
@@ -76,7 +85,10 @@ struct tevent_req *sudosrv_get_rules_send(TALLOC_CTX *mem_ctx,
 errno_t sudosrv_get_rules_recv(TALLOC_CTX *mem_ctx,
                                struct tevent_req *req,
                                struct sysdb_attrs ***_rules,
-                               uint32_t *_num_rules);
+                               uint32_t *_num_rules,
+                               struct sss_domain_info **_domain,
+                               time_t *_expire,
+                               struct sudosrv_user_stamp **_user);
 
 errno_t sudosrv_parse_query(TALLOC_CTX *mem_ctx,
                             uint8_t *query_body,
@@ -91,6 +103,57 @@ errno_t sudosrv_build_response(TALLOC_CTX *mem_ctx,
                                uint8_t **_response_body,
                                size_t *_response_len);
 
+errno_t sudosrv_rules_index_get(struct sudo_ctx *sudo_ctx,
+                                struct sss_domain_info *domain,
+                                struct sudosrv_rules_index **_index);
+
+errno_t sudosrv_rules_index_update(struct sudo_ctx *sudo_ctx,
+                                   struct sss_domain_info *domain,
+                                   struct sysdb_attrs **refreshed,
+                                   uint32_t num_refreshed);
+
+errno_t sudosrv_rules_index_lookup(TALLOC_CTX *mem_ctx,
+                                   struct sudosrv_rules_index *idx,
+                                   uid_t uid,
+                                   const char *username,
+                                   char **groupnames,
+                                   struct sysdb_attrs ***_rules,
+                                   uint32_t *_num_rules,
+                                   time_t *_expire);
+
+errno_t sudosrv_rules_index_expired(TALLOC_CTX *mem_ctx,
+                                    struct sudosrv_rules_index *idx,
+                                    uid_t uid,
+                                    const char *username,
+                                    char **groupnames,
+                                    struct sysdb_attrs ***_rules,
+                                    uint32_t *_num_rules);
+
+void sudosrv_rules_index_defaults_expire(struct sudosrv_rules_index *idx,
+                                         time_t *_expire);
+
+errno_t sudosrv_user_stamp_get(TALLOC_CTX *mem_ctx,
+                               struct sss_domain_info *domain,
+                               const char *username,
+                               struct sudosrv_user_stamp **_stamp);
+
+errno_t sudosrv_rules_index_get_response(struct sudo_ctx *sudo_ctx,
+                                         enum sss_sudo_type type,
+                                         uid_t uid,
+                                         const char *rawname,
+                                         uint8_t **_body,
+                                         size_t *_len);
+
+errno_t sudosrv_rules_index_set_response(struct sudo_ctx *sudo_ctx,
+                                         struct sss_domain_info *domain,
+                                         enum sss_sudo_type type,
+                                         uid_t uid,
+                                         const char *rawname,
+                                         struct sudosrv_user_stamp *user,
+                                         uint8_t *body,
+                                         size_t len,
+                                         time_t expire);
+
 struct tevent_req *
 sss_dp_get_sudoers_send(TALLOC_CTX *mem_ctx,
                         struct resp_ctx *rctx,
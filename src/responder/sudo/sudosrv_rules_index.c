@@ -0,0 +1,1340 @@
+/*
+    SSSD
+
+    In-memory index of cached sudo rules
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Looking up the rules of a user used to mean an ldb search with an OR
+ * filter over the user name, uid and the names of all groups the user is
+ * member of, followed by sorting the result by sudoOrder. With many rules
+ * and users that are members of many groups this gets slow.
+ *
+ * Instead, the responder loads all rules of a domain once, sorts them and
+ * builds an inverted index from every sudoUser value to the positions of
+ * the rules that contain it. Since the positions follow the sort order,
+ * merging the lists of all values that apply to the user yields an already
+ * sorted result.
+ *
+ * The index is rebuilt whenever the backend reports a new rules generation
+ * after a full or a smart refresh. Rules that are refreshed on behalf of
+ * the responder because they expired are reloaded individually.
+ *
+ * Every index also keeps the packed responses that were built from it, so
+ * that repeated queries of the same user can be answered without touching
+ * the rules at all. Since any change of the rule set replaces the index,
+ * the packed responses never outlive the rules they were built from.
+ * Group membership of the user is not looked up on this path, therefore
+ * every response also remembers the state of the user entry it was built
+ * for and is dropped as soon as the entry is refreshed, invalidated or
+ * its memberOf values change.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <talloc.h>
+#include <dhash.h>
+
+#include "util/util.h"
+#include "util/dlinklist.h"
+#include "db/sysdb_sudo.h"
+#include "responder/sudo/sudosrv_private.h"
+
+#define SUDOSRV_INDEX_WORD_BITS 32
+#define SUDOSRV_INDEX_MAX_RESPONSES 1024
+
+struct sudosrv_index_rule {
+    const char *name;
+    time_t expire;
+    uint32_t order;
+    size_t position;
+
+    /* attributes that are returned to the client */
+    struct sysdb_attrs *attrs;
+};
+
+struct sudosrv_index_list {
+    uint32_t *ids;
+    uint32_t count;
+    uint32_t alloc;
+};
+
+struct sudosrv_user_stamp {
+    const char *domain_name;
+    const char *username;
+    uint64_t initgr_expire;
+    struct ldb_message_element *memberof;
+};
+
+struct sudosrv_packed_response {
+    uint8_t *body;
+    size_t len;
+    time_t expire;
+    struct sudosrv_user_stamp *user;
+};
+
+struct sudosrv_rules_index {
+    struct sudosrv_rules_index *prev;
+    struct sudosrv_rules_index *next;
+
+    const char *domain_name;
+    uint64_t generation;
+
+    /* sorted by sudoOrder */
+    struct sudosrv_index_rule **rules;
+    uint32_t num_rules;
+
+    /* sudoUser value -> struct sudosrv_index_list */
+    hash_table_t *by_user;
+
+    /* rules that contain a +netgroup sudoUser value */
+    struct sudosrv_index_list netgroups;
+
+    /* query key -> struct sudosrv_packed_response, created on demand */
+    hash_table_t *responses;
+};
+
+static const char *sudosrv_index_attrs[] = { SYSDB_OBJECTCLASS,
+                                             SYSDB_NAME,
+                                             SYSDB_CACHE_EXPIRE,
+                                             SYSDB_SUDO_CACHE_AT_CN,
+                                             SYSDB_SUDO_CACHE_AT_USER,
+                                             SYSDB_SUDO_CACHE_AT_HOST,
+                                             SYSDB_SUDO_CACHE_AT_COMMAND,
+                                             SYSDB_SUDO_CACHE_AT_OPTION,
+                                             SYSDB_SUDO_CACHE_AT_RUNAS,
+                                             SYSDB_SUDO_CACHE_AT_RUNASUSER,
+                                             SYSDB_SUDO_CACHE_AT_RUNASGROUP,
+                                             SYSDB_SUDO_CACHE_AT_NOTBEFORE,
+                                             SYSDB_SUDO_CACHE_AT_NOTAFTER,
+                                             SYSDB_SUDO_CACHE_AT_ORDER,
+                                             NULL };
+
+static struct sss_domain_info *
+sudosrv_index_domain(struct sss_domain_info *domain)
+{
+    /* rules are stored inside parent domain tree */
+    if (IS_SUBDOMAIN(domain)) {
+        return domain->parent;
+    }
+
+    return domain;
+}
+
+static struct sudosrv_index_rule *
+sudosrv_index_rule_new(TALLOC_CTX *mem_ctx,
+                       struct sysdb_attrs *attrs)
+{
+    struct sudosrv_index_rule *rule;
+    struct ldb_message_element *el;
+    const char *name;
+    errno_t ret;
+    int i, j;
+
+    ret = sysdb_attrs_get_string(attrs, SYSDB_NAME, &name);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Sudo rule without a name, skipping\n");
+        return NULL;
+    }
+
+    rule = talloc_zero(mem_ctx, struct sudosrv_index_rule);
+    if (rule == NULL) {
+        return NULL;
+    }
+
+    rule->name = talloc_strdup(rule, name);
+    if (rule->name == NULL) {
+        talloc_free(rule);
+        return NULL;
+    }
+
+    ret = sysdb_attrs_get_uint32_t(attrs, SYSDB_SUDO_CACHE_AT_ORDER,
+                                   &rule->order);
+    if (ret != EOK) {
+        /* man sudoers-ldap: If the sudoOrder attribute is not present,
+         * a value of 0 is assumed */
+        rule->order = 0;
+    }
+
+    ret = sysdb_attrs_get_el_ext(attrs, SYSDB_CACHE_EXPIRE, false, &el);
+    if (ret == EOK && el->num_values > 0) {
+        rule->expire = strtoll((const char *) el->values[0].data, NULL, 10);
+    }
+
+    /* Only keep the attributes that were returned to the client before */
+    for (i = 0, j = 0; i < attrs->num; i++) {
+        if (strcasecmp(attrs->a[i].name, SYSDB_NAME) == 0
+                || strcasecmp(attrs->a[i].name, SYSDB_CACHE_EXPIRE) == 0) {
+            continue;
+        }
+
+        attrs->a[j] = attrs->a[i];
+        j++;
+    }
+    attrs->num = j;
+
+    rule->attrs = talloc_steal(rule, attrs);
+
+    return rule;
+}
+
+static errno_t
+sudosrv_index_load_rules(TALLOC_CTX *mem_ctx,
+                         struct sss_domain_info *domain,
+                         const char *filter,
+                         struct sudosrv_index_rule ***_rules,
+                         uint32_t *_num_rules)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index_rule **rules;
+    struct sysdb_attrs **attrs;
+    struct ldb_message **msgs;
+    uint32_t num_rules;
+    size_t count;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_search_custom(tmp_ctx, domain, filter, SUDORULE_SUBDIR,
+                              sudosrv_index_attrs, &count, &msgs);
+    if (ret == ENOENT) {
+        count = 0;
+        msgs = NULL;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Error looking up SUDO rules\n");
+        goto done;
+    }
+
+    ret = sysdb_msg2attrs(tmp_ctx, count, msgs, &attrs);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Could not convert ldb message to sysdb_attrs\n");
+        goto done;
+    }
+
+    rules = talloc_zero_array(tmp_ctx, struct sudosrv_index_rule *,
+                              count + 1);
+    if (rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    num_rules = 0;
+    for (i = 0; i < count; i++) {
+        rules[num_rules] = sudosrv_index_rule_new(rules, attrs[i]);
+        if (rules[num_rules] == NULL) {
+            continue;
+        }
+        num_rules++;
+    }
+
+    *_rules = talloc_steal(mem_ctx, rules);
+    *_num_rules = num_rules;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static int
+sudosrv_index_rule_cmp(const struct sudosrv_index_rule *r1,
+                       const struct sudosrv_index_rule *r2,
+                       bool lower_wins)
+{
+    if (r1->order != r2->order) {
+        if (lower_wins) {
+            /* The lowest value takes priority. Original wrong SSSD
+             * behaviour. */
+            return r1->order > r2->order ? 1 : -1;
+        } else {
+            /* The higher value takes priority. Standard LDAP behaviour. */
+            return r1->order < r2->order ? 1 : -1;
+        }
+    }
+
+    /* keep the order stable */
+    if (r1->position != r2->position) {
+        return r1->position > r2->position ? 1 : -1;
+    }
+
+    return 0;
+}
+
+static int
+sudosrv_index_low_cmp_fn(const void *a, const void *b)
+{
+    return sudosrv_index_rule_cmp(*(struct sudosrv_index_rule * const *) a,
+                                  *(struct sudosrv_index_rule * const *) b,
+                                  true);
+}
+
+static int
+sudosrv_index_high_cmp_fn(const void *a, const void *b)
+{
+    return sudosrv_index_rule_cmp(*(struct sudosrv_index_rule * const *) a,
+                                  *(struct sudosrv_index_rule * const *) b,
+                                  false);
+}
+
+static errno_t
+sudosrv_index_list_add(TALLOC_CTX *mem_ctx,
+                       struct sudosrv_index_list *list,
+                       uint32_t id)
+{
+    uint32_t *ids;
+
+    /* A rule may contain the same value more than once. Ids are added in
+     * ascending order, so it is sufficient to check the last one. */
+    if (list->count > 0 && list->ids[list->count - 1] == id) {
+        return EOK;
+    }
+
+    if (list->count == list->alloc) {
+        list->alloc = list->alloc == 0 ? 4 : list->alloc * 2;
+        ids = talloc_realloc(mem_ctx, list->ids, uint32_t, list->alloc);
+        if (ids == NULL) {
+            return ENOMEM;
+        }
+        list->ids = ids;
+    }
+
+    list->ids[list->count] = id;
+    list->count++;
+
+    return EOK;
+}
+
+static errno_t
+sudosrv_index_add_value(struct sudosrv_rules_index *idx,
+                        const char *value,
+                        uint32_t id)
+{
+    struct sudosrv_index_list *list;
+    hash_key_t key;
+    hash_value_t hval;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(value);
+
+    hret = hash_lookup(idx->by_user, &key, &hval);
+    if (hret == HASH_SUCCESS) {
+        list = talloc_get_type(hval.ptr, struct sudosrv_index_list);
+    } else if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        list = talloc_zero(idx->by_user, struct sudosrv_index_list);
+        if (list == NULL) {
+            return ENOMEM;
+        }
+
+        hval.type = HASH_VALUE_PTR;
+        hval.ptr = list;
+
+        hret = hash_enter(idx->by_user, &key, &hval);
+        if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to add [%s] to the index: %s\n",
+                  value, hash_error_string(hret));
+            talloc_free(list);
+            return EIO;
+        }
+    } else {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to look up [%s] in the index: %s\n",
+              value, hash_error_string(hret));
+        return EIO;
+    }
+
+    return sudosrv_index_list_add(list, list, id);
+}
+
+/* Takes ownership of rules, even on failure. */
+static errno_t
+sudosrv_index_build(TALLOC_CTX *mem_ctx,
+                    const char *domain_name,
+                    uint64_t generation,
+                    bool inverse_order,
+                    struct sudosrv_index_rule **rules,
+                    uint32_t num_rules,
+                    struct sudosrv_rules_index **_index)
+{
+    struct sudosrv_rules_index *idx;
+    struct ldb_message_element *el;
+    const char *value;
+    uint32_t i;
+    unsigned int j;
+    errno_t ret;
+
+    idx = talloc_zero(mem_ctx, struct sudosrv_rules_index);
+    if (idx == NULL) {
+        talloc_free(rules);
+        return ENOMEM;
+    }
+
+    idx->generation = generation;
+    idx->rules = talloc_steal(idx, rules);
+    idx->num_rules = num_rules;
+
+    idx->domain_name = talloc_strdup(idx, domain_name);
+    if (idx->domain_name == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_rules; i++) {
+        rules[i]->position = i;
+    }
+
+    if (inverse_order) {
+        qsort(rules, num_rules, sizeof(struct sudosrv_index_rule *),
+              sudosrv_index_low_cmp_fn);
+    } else {
+        qsort(rules, num_rules, sizeof(struct sudosrv_index_rule *),
+              sudosrv_index_high_cmp_fn);
+    }
+
+    ret = sss_hash_create(idx, num_rules, &idx->by_user);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (i = 0; i < num_rules; i++) {
+        rules[i]->position = i;
+
+        ret = sysdb_attrs_get_el_ext(rules[i]->attrs,
+                                     SYSDB_SUDO_CACHE_AT_USER, false, &el);
+        if (ret == ENOENT) {
+            continue;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        for (j = 0; j < el->num_values; j++) {
+            value = (const char *) el->values[j].data;
+            if (value[0] == '+') {
+                ret = sudosrv_index_list_add(idx, &idx->netgroups, i);
+            } else {
+                ret = sudosrv_index_add_value(idx, value, i);
+            }
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Indexed %u sudo rules of domain %s\n",
+          num_rules, domain_name);
+
+    *_index = idx;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(idx);
+    }
+
+    return ret;
+}
+
+static struct sudosrv_rules_index *
+sudosrv_index_find(struct sudo_ctx *sudo_ctx,
+                   const char *domain_name)
+{
+    struct sudosrv_rules_index *idx;
+
+    DLIST_FOR_EACH(idx, sudo_ctx->rules_index) {
+        if (strcmp(idx->domain_name, domain_name) == 0) {
+            return idx;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+sudosrv_index_replace(struct sudo_ctx *sudo_ctx,
+                      struct sudosrv_rules_index *old_index,
+                      struct sudosrv_rules_index *new_index)
+{
+    if (old_index != NULL) {
+        DLIST_REMOVE(sudo_ctx->rules_index, old_index);
+        talloc_free(old_index);
+    }
+
+    DLIST_ADD(sudo_ctx->rules_index, new_index);
+}
+
+errno_t sudosrv_rules_index_get(struct sudo_ctx *sudo_ctx,
+                                struct sss_domain_info *domain,
+                                struct sudosrv_rules_index **_index)
+{
+    struct sudosrv_rules_index *idx;
+    struct sudosrv_rules_index *new_index;
+    struct sudosrv_index_rule **rules;
+    uint32_t num_rules;
+    uint64_t generation;
+    char *filter;
+    errno_t ret;
+
+    domain = sudosrv_index_domain(domain);
+
+    /* The generation must be read before the rules are loaded so that
+     * a refresh that finishes in the meantime is noticed next time. */
+    ret = sysdb_sudo_get_rules_generation(domain, &generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read sudo rules generation "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    idx = sudosrv_index_find(sudo_ctx, domain->name);
+    if (idx != NULL && idx->generation == generation) {
+        *_index = idx;
+        return EOK;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Building sudo rules index of domain %s\n",
+          domain->name);
+
+    filter = talloc_asprintf(NULL, "(%s=%s)",
+                             SYSDB_OBJECTCLASS, SYSDB_SUDO_CACHE_OC);
+    if (filter == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sudosrv_index_load_rules(NULL, domain, filter, &rules, &num_rules);
+    talloc_free(filter);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sudosrv_index_build(sudo_ctx, domain->name, generation,
+                              sudo_ctx->inverse_order, rules, num_rules,
+                              &new_index);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to build sudo rules index "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    sudosrv_index_replace(sudo_ctx, idx, new_index);
+
+    *_index = new_index;
+    return EOK;
+}
+
+errno_t sudosrv_rules_index_update(struct sudo_ctx *sudo_ctx,
+                                   struct sss_domain_info *domain,
+                                   struct sysdb_attrs **refreshed,
+                                   uint32_t num_refreshed)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_rules_index *idx;
+    struct sudosrv_rules_index *new_index;
+    struct sudosrv_index_rule **loaded;
+    struct sudosrv_index_rule **rules;
+    hash_table_t *names;
+    hash_key_t key;
+    hash_value_t hval;
+    uint32_t num_loaded;
+    uint32_t num_rules;
+    const char *name;
+    char *sanitized;
+    char *filter;
+    uint32_t i;
+    errno_t ret;
+    int hret;
+
+    domain = sudosrv_index_domain(domain);
+
+    idx = sudosrv_index_find(sudo_ctx, domain->name);
+    if (idx == NULL || num_refreshed == 0) {
+        /* nothing to update, the index will be built from scratch */
+        return EOK;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_hash_create(tmp_ctx, num_refreshed, &names);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    filter = talloc_asprintf(tmp_ctx, "(&(%s=%s)(|",
+                             SYSDB_OBJECTCLASS, SYSDB_SUDO_CACHE_OC);
+    if (filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    key.type = HASH_KEY_STRING;
+    hval.type = HASH_VALUE_UNDEF;
+    for (i = 0; i < num_refreshed; i++) {
+        ret = sysdb_attrs_get_string(refreshed[i], SYSDB_NAME, &name);
+        if (ret != EOK) {
+            continue;
+        }
+
+        ret = sss_filter_sanitize(tmp_ctx, name, &sanitized);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        filter = talloc_asprintf_append(filter, "(%s=%s)",
+                                        SYSDB_NAME, sanitized);
+        if (filter == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        key.str = discard_const(name);
+        hret = hash_enter(names, &key, &hval);
+        if (hret != HASH_SUCCESS) {
+            ret = EIO;
+            goto done;
+        }
+    }
+
+    filter = talloc_asprintf_append(filter, "))");
+    if (filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Rules that were removed from the server are also removed from the
+     * cache, so they are simply not loaded again. */
+    ret = sudosrv_index_load_rules(tmp_ctx, domain, filter,
+                                   &loaded, &num_loaded);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    rules = talloc_array(tmp_ctx, struct sudosrv_index_rule *,
+                         idx->num_rules + num_loaded);
+    if (rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    num_rules = 0;
+    for (i = 0; i < idx->num_rules; i++) {
+        key.str = discard_const(idx->rules[i]->name);
+        if (hash_has_key(names, &key)) {
+            continue;
+        }
+
+        rules[num_rules] = talloc_steal(rules, idx->rules[i]);
+        num_rules++;
+    }
+
+    for (i = 0; i < num_loaded; i++) {
+        rules[num_rules] = talloc_steal(rules, loaded[i]);
+        num_rules++;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Updating %u refreshed sudo rules in the "
+          "index of domain %s\n", num_refreshed, domain->name);
+
+    ret = sudosrv_index_build(sudo_ctx, domain->name, idx->generation,
+                              sudo_ctx->inverse_order, rules, num_rules,
+                              &new_index);
+    if (ret != EOK) {
+        /* The old index lost some of its rules, drop it completely so that
+         * it is rebuilt next time. */
+        DLIST_REMOVE(sudo_ctx->rules_index, idx);
+        talloc_free(idx);
+        goto done;
+    }
+
+    sudosrv_index_replace(sudo_ctx, idx, new_index);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static void
+sudosrv_index_mark(uint32_t *bitmap,
+                   struct sudosrv_index_list *list)
+{
+    uint32_t i;
+
+    for (i = 0; i < list->count; i++) {
+        bitmap[list->ids[i] / SUDOSRV_INDEX_WORD_BITS] |=
+            1U << (list->ids[i] % SUDOSRV_INDEX_WORD_BITS);
+    }
+}
+
+static errno_t
+sudosrv_index_mark_value(struct sudosrv_rules_index *idx,
+                         uint32_t *bitmap,
+                         const char *value)
+{
+    struct sudosrv_index_list *list;
+    hash_key_t key;
+    hash_value_t hval;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(value);
+
+    hret = hash_lookup(idx->by_user, &key, &hval);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        return EOK;
+    } else if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to look up [%s] in the index: %s\n",
+              value, hash_error_string(hret));
+        return EIO;
+    }
+
+    list = talloc_get_type(hval.ptr, struct sudosrv_index_list);
+    sudosrv_index_mark(bitmap, list);
+
+    return EOK;
+}
+
+/* Marks rules that apply to the user directly in _user and rules that
+ * contain a netgroup in _netgroup. */
+static errno_t
+sudosrv_index_match(TALLOC_CTX *mem_ctx,
+                    struct sudosrv_rules_index *idx,
+                    uid_t uid,
+                    const char *username,
+                    char **groupnames,
+                    uint32_t **_user,
+                    uint32_t **_netgroup)
+{
+    TALLOC_CTX *tmp_ctx;
+    uint32_t *user;
+    uint32_t *netgroup;
+    uint32_t words;
+    char *value;
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    words = idx->num_rules / SUDOSRV_INDEX_WORD_BITS + 1;
+
+    user = talloc_zero_array(tmp_ctx, uint32_t, words);
+    netgroup = talloc_zero_array(tmp_ctx, uint32_t, words);
+    if (user == NULL || netgroup == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sudosrv_index_mark_value(idx, user, "ALL");
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sudosrv_index_mark_value(idx, user, username);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (uid != 0) {
+        value = talloc_asprintf(tmp_ctx, "#%"SPRIuid, uid);
+        if (value == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sudosrv_index_mark_value(idx, user, value);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    for (i = 0; groupnames != NULL && groupnames[i] != NULL; i++) {
+        value = talloc_asprintf(tmp_ctx, "%%%s", groupnames[i]);
+        if (value == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sudosrv_index_mark_value(idx, user, value);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    sudosrv_index_mark(netgroup, &idx->netgroups);
+
+    *_user = talloc_steal(mem_ctx, user);
+    *_netgroup = talloc_steal(mem_ctx, netgroup);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static bool
+sudosrv_index_is_marked(uint32_t *bitmap, uint32_t id)
+{
+    return bitmap[id / SUDOSRV_INDEX_WORD_BITS]
+               & (1U << (id % SUDOSRV_INDEX_WORD_BITS));
+}
+
+/* Returns a shallow copy of the rule where sudoUser is replaced with
+ * #uid to prevent conflicts with fqnames. */
+static struct sysdb_attrs *
+sudosrv_index_user_view(TALLOC_CTX *mem_ctx,
+                        struct sudosrv_index_rule *rule,
+                        const char *uid_value)
+{
+    struct sysdb_attrs *view;
+    int i;
+    errno_t ret;
+
+    view = sysdb_new_attrs(mem_ctx);
+    if (view == NULL) {
+        return NULL;
+    }
+
+    view->a = talloc_array(view, struct ldb_message_element,
+                           rule->attrs->num);
+    if (view->a == NULL) {
+        talloc_free(view);
+        return NULL;
+    }
+
+    for (i = 0; i < rule->attrs->num; i++) {
+        if (strcasecmp(rule->attrs->a[i].name,
+                       SYSDB_SUDO_CACHE_AT_USER) == 0) {
+            continue;
+        }
+
+        view->a[view->num] = rule->attrs->a[i];
+        view->num++;
+    }
+
+    ret = sysdb_attrs_add_string(view, SYSDB_SUDO_CACHE_AT_USER, uid_value);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to alter sudoUser attribute "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        talloc_free(view);
+        return NULL;
+    }
+
+    return view;
+}
+
+errno_t sudosrv_rules_index_lookup(TALLOC_CTX *mem_ctx,
+                                   struct sudosrv_rules_index *idx,
+                                   uid_t uid,
+                                   const char *username,
+                                   char **groupnames,
+                                   struct sysdb_attrs ***_rules,
+                                   uint32_t *_num_rules,
+                                   time_t *_expire)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
+    uint32_t *user;
+    uint32_t *netgroup;
+    char *uid_value;
+    uint32_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sudosrv_index_match(tmp_ctx, idx, uid, username, groupnames,
+                              &user, &netgroup);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    uid_value = talloc_asprintf(tmp_ctx, "#%"SPRIuid, uid);
+    if (uid_value == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Replacing sudoUser attribute with "
+          "sudoUser: %s\n", uid_value);
+
+    rules = talloc_array(tmp_ctx, struct sysdb_attrs *, idx->num_rules);
+    if (rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Rules are already sorted, the result is therefore sorted as well.
+     * Attribute values are shared with the idx, the result must be
+     * consumed before the index is updated. */
+    num_rules = 0;
+    for (i = 0; i < idx->num_rules; i++) {
+        if (sudosrv_index_is_marked(user, i)) {
+            rules[num_rules] = sudosrv_index_user_view(rules, idx->rules[i],
+                                                       uid_value);
+            if (rules[num_rules] == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+            num_rules++;
+        } else if (sudosrv_index_is_marked(netgroup, i)) {
+            rules[num_rules] = idx->rules[i]->attrs;
+            num_rules++;
+        } else {
+            continue;
+        }
+
+        /* 0 means that the rule never expires */
+        if (_expire != NULL && idx->rules[i]->expire != 0
+                && idx->rules[i]->expire < *_expire) {
+            *_expire = idx->rules[i]->expire;
+        }
+    }
+
+    *_rules = talloc_steal(mem_ctx, rules);
+    *_num_rules = num_rules;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t sudosrv_rules_index_expired(TALLOC_CTX *mem_ctx,
+                                    struct sudosrv_rules_index *idx,
+                                    uid_t uid,
+                                    const char *username,
+                                    char **groupnames,
+                                    struct sysdb_attrs ***_rules,
+                                    uint32_t *_num_rules)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
+    uint32_t *user;
+    uint32_t *netgroup;
+    time_t now;
+    uint32_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sudosrv_index_match(tmp_ctx, idx, uid, username, groupnames,
+                              &user, &netgroup);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    rules = talloc_array(tmp_ctx, struct sysdb_attrs *, idx->num_rules);
+    if (rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    now = time(NULL);
+    num_rules = 0;
+    for (i = 0; i < idx->num_rules; i++) {
+        /* 0 means that the rule never expires */
+        if (idx->rules[i]->expire == 0 || idx->rules[i]->expire > now) {
+            continue;
+        }
+
+        if (!sudosrv_index_is_marked(user, i)
+                && !sudosrv_index_is_marked(netgroup, i)
+                && strcmp(idx->rules[i]->name, "defaults") != 0) {
+            continue;
+        }
+
+        rules[num_rules] = sysdb_new_attrs(rules);
+        if (rules[num_rules] == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sysdb_attrs_add_string(rules[num_rules], SYSDB_NAME,
+                                     idx->rules[i]->name);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        num_rules++;
+    }
+
+    *_rules = talloc_steal(mem_ctx, rules);
+    *_num_rules = num_rules;
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+void sudosrv_rules_index_defaults_expire(struct sudosrv_rules_index *idx,
+                                         time_t *_expire)
+{
+    uint32_t i;
+
+    for (i = 0; i < idx->num_rules; i++) {
+        if (strcmp(idx->rules[i]->name, "defaults") == 0) {
+            if (idx->rules[i]->expire != 0
+                    && idx->rules[i]->expire < *_expire) {
+                *_expire = idx->rules[i]->expire;
+            }
+            return;
+        }
+    }
+}
+
+static char *
+sudosrv_response_key(TALLOC_CTX *mem_ctx,
+                     enum sss_sudo_type type,
+                     uid_t uid,
+                     const char *rawname)
+{
+    /* rawname goes last, it may contain any character */
+    return talloc_asprintf(mem_ctx, "%d:%"SPRIuid":%s", type, uid, rawname);
+}
+
+static void
+sudosrv_response_remove(struct sudosrv_rules_index *idx,
+                        hash_key_t *key,
+                        struct sudosrv_packed_response *response)
+{
+    int hret;
+
+    hret = hash_delete(idx->responses, key);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to remove packed response [%s]\n",
+              hash_error_string(hret));
+    }
+
+    talloc_free(response);
+}
+
+errno_t sudosrv_user_stamp_get(TALLOC_CTX *mem_ctx,
+                               struct sss_domain_info *domain,
+                               const char *username,
+                               struct sudosrv_user_stamp **_stamp)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_user_stamp *stamp;
+    struct ldb_message *msg;
+    const char *attrs[] = { SYSDB_INITGR_EXPIRE, SYSDB_MEMBEROF, NULL };
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_search_user_by_name(tmp_ctx, domain, username, attrs, &msg);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    stamp = talloc_zero(tmp_ctx, struct sudosrv_user_stamp);
+    if (stamp == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    stamp->domain_name = talloc_strdup(stamp, domain->name);
+    stamp->username = talloc_strdup(stamp, username);
+    if (stamp->domain_name == NULL || stamp->username == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    stamp->initgr_expire = ldb_msg_find_attr_as_uint64(msg,
+                                                       SYSDB_INITGR_EXPIRE, 0);
+    stamp->memberof = ldb_msg_find_element(msg, SYSDB_MEMBEROF);
+    if (stamp->memberof != NULL) {
+        talloc_steal(stamp, msg);
+    }
+
+    *_stamp = talloc_steal(mem_ctx, stamp);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static bool
+sudosrv_user_stamp_memberof_equal(struct ldb_message_element *a,
+                                  struct ldb_message_element *b)
+{
+    unsigned int num_a = a == NULL ? 0 : a->num_values;
+    unsigned int num_b = b == NULL ? 0 : b->num_values;
+    unsigned int i;
+
+    if (num_a != num_b) {
+        return false;
+    }
+
+    /* memberOf values are unique so equal counts and inclusion is enough */
+    for (i = 0; i < num_a; i++) {
+        if (ldb_msg_find_val(b, &a->values[i]) == NULL) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+sudosrv_user_stamp_is_current(struct sudo_ctx *sudo_ctx,
+                              struct sudosrv_user_stamp *stamp)
+{
+    struct sudosrv_user_stamp *current;
+    struct sss_domain_info *domain;
+    bool is_current;
+    errno_t ret;
+
+    domain = find_domain_by_name(sudo_ctx->rctx->domains,
+                                 stamp->domain_name, true);
+    if (domain == NULL) {
+        return false;
+    }
+
+    ret = sudosrv_user_stamp_get(NULL, domain, stamp->username, &current);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Unable to read user entry of [%s@%s] "
+              "[%d]: %s\n", stamp->username, stamp->domain_name,
+              ret, sss_strerror(ret));
+        return false;
+    }
+
+    /* Any initgroups refresh and sss_cache -u/-E change the timestamp. */
+    is_current = current->initgr_expire == stamp->initgr_expire
+                 && current->initgr_expire > time(NULL)
+                 && sudosrv_user_stamp_memberof_equal(stamp->memberof,
+                                                      current->memberof);
+    talloc_free(current);
+
+    return is_current;
+}
+
+static bool
+sudosrv_response_is_current(struct sudo_ctx *sudo_ctx,
+                            struct sudosrv_rules_index *idx)
+{
+    struct sss_domain_info *domain;
+    uint64_t generation;
+    errno_t ret;
+
+    domain = find_domain_by_name(sudo_ctx->rctx->domains,
+                                 idx->domain_name, true);
+    if (domain == NULL) {
+        return false;
+    }
+
+    ret = sysdb_sudo_get_rules_generation(domain, &generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read sudo rules generation "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return false;
+    }
+
+    return generation == idx->generation;
+}
+
+errno_t sudosrv_rules_index_get_response(struct sudo_ctx *sudo_ctx,
+                                         enum sss_sudo_type type,
+                                         uid_t uid,
+                                         const char *rawname,
+                                         uint8_t **_body,
+                                         size_t *_len)
+{
+    struct sudosrv_packed_response *response;
+    struct sudosrv_rules_index *idx;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = sudosrv_response_key(NULL, type, uid, rawname);
+    if (key.str == NULL) {
+        return ENOMEM;
+    }
+
+    /* The domain of the user is not known until the name is resolved,
+     * but there is only a handful of indexes and a response is stored
+     * only in the index of the domain the user was found in. */
+    DLIST_FOR_EACH(idx, sudo_ctx->rules_index) {
+        if (idx->responses == NULL) {
+            continue;
+        }
+
+        hret = hash_lookup(idx->responses, &key, &value);
+        if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+            continue;
+        } else if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to look up packed response "
+                  "[%s]\n", hash_error_string(hret));
+            ret = EIO;
+            goto done;
+        }
+
+        response = talloc_get_type(value.ptr, struct sudosrv_packed_response);
+        if (response->expire <= time(NULL)) {
+            DEBUG(SSSDBG_TRACE_INTERNAL, "Packed response for [%s] "
+                  "expired\n", rawname);
+            sudosrv_response_remove(idx, &key, response);
+            ret = ENOENT;
+            goto done;
+        }
+
+        /* The backend may have replaced the rules in the meantime. */
+        if (!sudosrv_response_is_current(sudo_ctx, idx)) {
+            ret = ENOENT;
+            goto done;
+        }
+
+        if (!sudosrv_user_stamp_is_current(sudo_ctx, response->user)) {
+            DEBUG(SSSDBG_TRACE_INTERNAL, "User entry of [%s] changed since "
+                  "the packed response was built\n", rawname);
+            sudosrv_response_remove(idx, &key, response);
+            ret = ENOENT;
+            goto done;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Returning packed response for [%s@%s]\n",
+              rawname, idx->domain_name);
+
+        /* The body is owned by the index, it must be consumed before
+         * the index is updated. */
+        *_body = response->body;
+        *_len = response->len;
+        ret = EOK;
+        goto done;
+    }
+
+    ret = ENOENT;
+
+done:
+    talloc_free(key.str);
+    return ret;
+}
+
+errno_t sudosrv_rules_index_set_response(struct sudo_ctx *sudo_ctx,
+                                         struct sss_domain_info *domain,
+                                         enum sss_sudo_type type,
+                                         uid_t uid,
+                                         const char *rawname,
+                                         struct sudosrv_user_stamp *user,
+                                         uint8_t *body,
+                                         size_t len,
+                                         time_t expire)
+{
+    struct sudosrv_packed_response *response;
+    struct sudosrv_rules_index *idx;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (expire <= time(NULL) || user == NULL) {
+        /* e.g. we are offline and returned expired rules */
+        return EOK;
+    }
+
+    idx = sudosrv_index_find(sudo_ctx, sudosrv_index_domain(domain)->name);
+    if (idx == NULL) {
+        return EOK;
+    }
+
+    if (idx->responses != NULL
+            && hash_count(idx->responses) >= SUDOSRV_INDEX_MAX_RESPONSES) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Too many packed responses in the index "
+              "of domain %s, flushing\n", idx->domain_name);
+        talloc_zfree(idx->responses);
+    }
+
+    if (idx->responses == NULL) {
+        ret = sss_hash_create(idx, 0, &idx->responses);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    response = talloc_zero(idx->responses, struct sudosrv_packed_response);
+    if (response == NULL) {
+        return ENOMEM;
+    }
+
+    response->body = talloc_memdup(response, body, len);
+    if (response->body == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    response->len = len;
+    response->expire = expire;
+    response->user = talloc_steal(response, user);
+
+    key.type = HASH_KEY_STRING;
+    key.str = sudosrv_response_key(response, type, uid, rawname);
+    if (key.str == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Free the response that is about to be replaced */
+    hret = hash_lookup(idx->responses, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        sudosrv_response_remove(idx, &key, value.ptr);
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = response;
+
+    hret = hash_enter(idx->responses, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to store packed response [%s]\n",
+              hash_error_string(hret));
+        ret = EIO;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(response);
+    }
+    return ret;
+}
@@ -392,3 +392,130 @@ int sss_nss_getnamebycert(const char *cert, char **fq_name,
 
     return ret;
 }
+
+static int sss_nss_getidsbysids_chunk(const char **sids, size_t count,
+                                      size_t req_len, uint32_t *ids,
+                                      enum sss_id_type *id_types, int *errs)
+{
+    int ret;
+    struct sss_cli_req_data rd;
+    uint8_t *reqbuf = NULL;
+    uint8_t *repbuf = NULL;
+    size_t replen;
+    int errnop;
+    enum nss_status nret;
+    uint32_t num_results;
+    uint32_t num_sids;
+    uint32_t tmp;
+    size_t pctr = 0;
+    size_t len;
+    size_t c;
+
+    reqbuf = malloc(req_len);
+    if (reqbuf == NULL) {
+        return ENOMEM;
+    }
+
+    num_sids = count;
+    SAFEALIGN_COPY_UINT32(reqbuf, &num_sids, &pctr);
+    for (c = 0; c < count; c++) {
+        len = strlen(sids[c]) + 1;
+        memcpy(reqbuf + pctr, sids[c], len);
+        pctr += len;
+    }
+
+    rd.len = req_len;
+    rd.data = reqbuf;
+
+    sss_nss_lock();
+
+    nret = sss_nss_make_request(SSS_NSS_GETIDSBYSIDS, &rd, &repbuf, &replen,
+                                &errnop);
+    if (nret != NSS_STATUS_SUCCESS) {
+        ret = nss_status_to_errno(nret);
+        goto done;
+    }
+
+    if (replen < 2 * sizeof(uint32_t)) {
+        ret = EBADMSG;
+        goto done;
+    }
+
+    SAFEALIGN_COPY_UINT32(&num_results, repbuf, NULL);
+    if (num_results != count
+            || replen != 2 * sizeof(uint32_t) + count * 3 * sizeof(uint32_t)) {
+        ret = EBADMSG;
+        goto done;
+    }
+
+    /* Skip number of results and reserved padding */
+    pctr = 2 * sizeof(uint32_t);
+    for (c = 0; c < count; c++) {
+        SAFEALIGN_COPY_UINT32(&tmp, repbuf + pctr, &pctr);
+        errs[c] = tmp;
+        SAFEALIGN_COPY_UINT32(&tmp, repbuf + pctr, &pctr);
+        id_types[c] = tmp;
+        SAFEALIGN_COPY_UINT32(&ids[c], repbuf + pctr, &pctr);
+    }
+
+    ret = EOK;
+
+done:
+    sss_nss_unlock();
+    free(repbuf);
+    free(reqbuf);
+
+    return ret;
+}
+
+int sss_nss_getidsbysids(const char **sids, size_t count, uint32_t *ids,
+                         enum sss_id_type *id_types, int *errs)
+{
+    int ret;
+    size_t start;
+    size_t end;
+    size_t req_len;
+    size_t len;
+    size_t c;
+
+    if (count == 0) {
+        return EOK;
+    }
+
+    if (sids == NULL || ids == NULL || id_types == NULL || errs == NULL) {
+        return EINVAL;
+    }
+
+    for (c = 0; c < count; c++) {
+        if (sids[c] == NULL || *sids[c] == '\0') {
+            return EINVAL;
+        }
+
+        ret = sss_strnlen(sids[c], 2048, &len);
+        if (ret != EOK) {
+            return EINVAL;
+        }
+    }
+
+    /* Send as many SIDs as fit into a single request, usually this means
+     * the whole list is resolved with a single round-trip. */
+    for (start = 0; start < count; start = end) {
+        req_len = sizeof(uint32_t);
+        for (end = start; end < count; end++) {
+            len = strlen(sids[end]) + 1;
+            if (end > start && req_len + len > SSS_CLI_BULK_MAX_REQ_SIZE) {
+                break;
+            }
+            req_len += len;
+        }
+
+        ret = sss_nss_getidsbysids_chunk(sids + start, end - start, req_len,
+                                         ids + start, id_types + start,
+                                         errs + start);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
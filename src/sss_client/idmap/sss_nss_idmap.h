@@ -26,6 +26,7 @@
 #define SSS_NSS_IDMAP_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 /**
  * Object types
@@ -102,6 +103,34 @@ int sss_nss_getnamebysid(const char *sid, char **fq_name,
 int sss_nss_getidbysid(const char *sid, uint32_t *id,
                        enum sss_id_type *id_type);
 
+/**
+ * @brief Return the POSIX IDs for a list of SIDs
+ *
+ * This is the vectorized version of sss_nss_getidbysid(). All SIDs are
+ * resolved with as few requests to SSSD as possible, typically a single one,
+ * which makes it suitable for translating e.g. all SIDs of a security
+ * descriptor.
+ *
+ * @param[in] sids      Array of string representations of SIDs
+ * @param[in] count     Number of elements in sids
+ * @param[out] ids      Array with at least count elements for the POSIX IDs
+ *                      related to the SIDs
+ * @param[out] id_types Array with at least count elements for the types of
+ *                      the objects related to the SIDs
+ * @param[out] errs     Array with at least count elements for the status of
+ *                      the individual lookups, 0 (EOK) if ids[i] and
+ *                      id_types[i] are valid, an error code as returned by
+ *                      #sss_nss_getidbysid otherwise
+ *
+ * @return
+ *  - 0 (EOK): success, check errs for the results of the individual SIDs
+ *  - EINVAL: input cannot be parsed
+ *  - EBADMSG: invalid reply
+ *  - other: see #sss_nss_getsidbyname
+ */
+int sss_nss_getidsbysids(const char **sids, size_t count, uint32_t *ids,
+                         enum sss_id_type *id_types, int *errs);
+
 /**
  * @brief Find original data by fully qualified name
  *
@@ -51,6 +51,10 @@ typedef int errno_t;
 #define SSS_SSH_PROTOCOL_VERSION 0
 #define SSS_PAC_PROTOCOL_VERSION 1
 
+/* Maximal size of the body of a request which carries a list of objects,
+ * e.g. SSS_NSS_GETIDSBYSIDS. Clients have to split larger lists. */
+#define SSS_CLI_BULK_MAX_REQ_SIZE (64 * 1024)
+
 #ifdef LOGIN_NAME_MAX
 #define SSS_NAME_MAX LOGIN_NAME_MAX
 #else
@@ -260,6 +264,14 @@ SSS_NSS_GETNAMEBYCERT = 0x0116, /**< Takes the zero terminated string
                                      of a X509 certificate and returns the zero
                                      terminated fully qualified name of the
                                      related object. */
+SSS_NSS_GETIDSBYSIDS = 0x0117, /**< Takes an unsigned 32bit integer with the
+                                    number of SIDs followed by the zero
+                                    terminated string representations of the
+                                    SIDs. Returns for each SID, in the order
+                                    of the request, three unsigned 32bit
+                                    integer values: the status of the lookup
+                                    (0 or an errno value), the type of the
+                                    object and the POSIX ID. */
 };
 
 /**
@@ -0,0 +1,276 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <errno.h>
+#include <string.h>
+#include <popt.h>
+
+#include "providers/data_provider/dp_bin.h"
+#include "tests/cmocka/common_mock.h"
+
+static int test_setup(void **state)
+{
+    TALLOC_CTX *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_new(global_talloc_context);
+    assert_non_null(test_ctx);
+
+    check_leaks_push(test_ctx);
+
+    *state = test_ctx;
+
+    return 0;
+}
+
+static int test_teardown(void **state)
+{
+    assert_true(check_leaks_pop(*state));
+    talloc_zfree(*state);
+
+    return 0;
+}
+
+static void test_account_req(void **state)
+{
+    struct dp_bin_account_req in = { 1, 2, 3, "name=user", "dom", NULL,
+                                     0x123456789ULL };
+    struct dp_bin_account_req out;
+    struct dp_bin_header hdr;
+    uint8_t *frame;
+    size_t len;
+    errno_t ret;
+
+    frame = dp_bin_pack_account_req(*state, 42, &in, &len);
+    assert_non_null(frame);
+
+    ret = dp_bin_parse_header(frame, len, &hdr);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hdr.length, len);
+    assert_int_equal(hdr.id, 42);
+    assert_int_equal(hdr.code, DP_BIN_GET_ACCOUNT_INFO);
+
+    dp_bin_set_id(frame, 43);
+    ret = dp_bin_parse_header(frame, len, &hdr);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hdr.id, 43);
+
+    ret = dp_bin_unpack_account_req(frame, len, &out);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(out.dp_flags, 1);
+    assert_int_equal(out.entry_type, 2);
+    assert_int_equal(out.attr_type, 3);
+    assert_string_equal(out.filter, "name=user");
+    assert_string_equal(out.domain, "dom");
+    assert_null(out.extra);
+    assert_true(out.trace_id == 0x123456789ULL);
+
+    /* truncated frame */
+    ret = dp_bin_unpack_account_req(frame, len - 1, &out);
+    assert_int_not_equal(ret, EOK);
+
+    talloc_free(frame);
+}
+
+static void test_reply(void **state)
+{
+    struct dp_bin_reply in = { 1, ENOENT, "Success" };
+    struct dp_bin_reply out;
+    struct dp_bin_header hdr;
+    uint8_t *frame;
+    size_t len;
+    errno_t ret;
+
+    frame = dp_bin_pack_reply(*state, 7, EOK, &in, &len);
+    assert_non_null(frame);
+
+    ret = dp_bin_parse_header(frame, len, &hdr);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hdr.code, EOK);
+
+    ret = dp_bin_unpack_reply(frame, len, &out);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(out.dp_error, 1);
+    assert_int_equal(out.error, ENOENT);
+    assert_string_equal(out.message, "Success");
+    talloc_free(frame);
+
+    /* error status has no payload */
+    frame = dp_bin_pack_reply(*state, 7, ENOTSUP, NULL, &len);
+    assert_non_null(frame);
+    assert_int_equal(len, DP_BIN_HEADER_SIZE);
+
+    ret = dp_bin_parse_header(frame, len, &hdr);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hdr.code, ENOTSUP);
+    talloc_free(frame);
+}
+
+static void test_register(void **state)
+{
+    const char *name;
+    uint8_t *frame;
+    size_t len;
+    errno_t ret;
+
+    frame = dp_bin_pack_register(*state, 0, "NSS", &len);
+    assert_non_null(frame);
+
+    ret = dp_bin_unpack_register(frame, len, &name);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(name, "NSS");
+
+    talloc_free(frame);
+}
+
+static void test_header(void **state)
+{
+    struct dp_bin_header hdr;
+    uint8_t *frame;
+    size_t len;
+    errno_t ret;
+
+    frame = dp_bin_pack_register(*state, 0, "NSS", &len);
+    assert_non_null(frame);
+
+    /* incomplete header */
+    ret = dp_bin_parse_header(frame, DP_BIN_HEADER_SIZE - 1, &hdr);
+    assert_int_equal(ret, EAGAIN);
+
+    /* invalid length */
+    memset(frame, 0, sizeof(uint32_t));
+    ret = dp_bin_parse_header(frame, len, &hdr);
+    assert_int_equal(ret, EBADMSG);
+
+    talloc_free(frame);
+}
+
+static void test_batch(void **state)
+{
+    struct dp_bin_account_req in1 = { 0, 1, 3, "name=user1", "dom", NULL };
+    struct dp_bin_account_req in2 = { 0, 2, 3, "idnumber=42", "dom", NULL };
+    struct dp_bin_account_req out;
+    struct dp_bin_header hdr;
+    uint8_t *frames[2];
+    size_t lens[2];
+    const uint8_t *sub;
+    uint8_t *nested;
+    uint8_t *batch;
+    size_t offset = 0;
+    size_t nested_len;
+    size_t len;
+    errno_t ret;
+
+    frames[0] = dp_bin_pack_account_req(*state, 1, &in1, &lens[0]);
+    assert_non_null(frames[0]);
+    frames[1] = dp_bin_pack_account_req(*state, 2, &in2, &lens[1]);
+    assert_non_null(frames[1]);
+
+    batch = dp_bin_pack_batch(*state, frames, lens, 2, &len);
+    assert_non_null(batch);
+    assert_int_equal(len, DP_BIN_HEADER_SIZE + lens[0] + lens[1]);
+
+    ret = dp_bin_parse_header(batch, len, &hdr);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hdr.code, DP_BIN_BATCH);
+
+    ret = dp_bin_batch_next(batch, len, &offset, &hdr, &sub);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hdr.id, 1);
+    ret = dp_bin_unpack_account_req(sub, hdr.length, &out);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(out.filter, "name=user1");
+
+    ret = dp_bin_batch_next(batch, len, &offset, &hdr, &sub);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(hdr.id, 2);
+    ret = dp_bin_unpack_account_req(sub, hdr.length, &out);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(out.filter, "idnumber=42");
+
+    ret = dp_bin_batch_next(batch, len, &offset, &hdr, &sub);
+    assert_int_equal(ret, ENOENT);
+
+    /* truncated sub-frame */
+    offset = 0;
+    ret = dp_bin_batch_next(batch, len - 1, &offset, &hdr, &sub);
+    assert_int_equal(ret, EOK);
+    ret = dp_bin_batch_next(batch, len - 1, &offset, &hdr, &sub);
+    assert_int_equal(ret, EBADMSG);
+
+    /* nested batch */
+    nested = dp_bin_pack_batch(*state, &batch, &len, 1, &nested_len);
+    assert_non_null(nested);
+    offset = 0;
+    ret = dp_bin_batch_next(nested, nested_len, &offset, &hdr, &sub);
+    assert_int_equal(ret, EBADMSG);
+
+    talloc_free(nested);
+    talloc_free(batch);
+    talloc_free(frames[0]);
+    talloc_free(frames[1]);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_account_req,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_reply,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_register,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_header,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_batch,
+                                        test_setup,
+                                        test_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -50,6 +50,10 @@ uint8_t buf3[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x
 uint8_t buf4[] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 't', 'e', 's', 't', 'x'};
 
 uint8_t buf_orig1[] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 'k', 'e', 'y', 0x00, 'v', 'a', 'l', 'u', 'e', 0x00};
+
+uint8_t buf_ids1[] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                      0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xe8, 0x03, 0x00, 0x00,
+                      0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 #elif (__BYTE_ORDER == __BIG_ENDIAN)
 uint8_t buf1[] = {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 't', 'e', 's', 't', 0x00};
 uint8_t buf2[] = {0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 't', 'e', 's', 't', 0x00};
@@ -57,6 +61,10 @@ uint8_t buf3[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x
 uint8_t buf4[] = {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 't', 'e', 's', 't', 'x'};
 
 uint8_t buf_orig1[] = {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 'k', 'e', 'y', 0x00, 'v', 'a', 'l', 'u', 'e', 0x00};
+
+uint8_t buf_ids1[] = {0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+                      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x03, 0xe8,
+                      0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 #else
  #error "unknow endianess"
 #endif
@@ -146,12 +154,47 @@ void test_getorigbyname(void **state)
     sss_nss_free_kv(kv_list);
 }
 
+void test_getidsbysids(void **state)
+{
+    int ret;
+    const char *sids[] = { "S-1-5-21-1-2-3-1000", "S-1-5-21-1-2-3-1001" };
+    uint32_t ids[2];
+    enum sss_id_type types[2];
+    int errs[2];
+    struct sss_nss_make_request_test_data d = {buf_ids1, sizeof(buf_ids1), 0, NSS_STATUS_SUCCESS};
+    struct sss_nss_make_request_test_data d_short = {buf_ids1, sizeof(buf_ids1) - 1, 0, NSS_STATUS_SUCCESS};
+
+    ret = sss_nss_getidsbysids(NULL, 2, ids, types, errs);
+    assert_int_equal(ret, EINVAL);
+
+    ret = sss_nss_getidsbysids(sids, 2, NULL, types, errs);
+    assert_int_equal(ret, EINVAL);
+
+    will_return(sss_nss_make_request, &d);
+    ret = sss_nss_getidsbysids(sids, 2, ids, types, errs);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(errs[0], EOK);
+    assert_int_equal(types[0], SSS_ID_TYPE_UID);
+    assert_int_equal(ids[0], 1000);
+    assert_int_equal(errs[1], ENOENT);
+
+    will_return(sss_nss_make_request, &d_short);
+    ret = sss_nss_getidsbysids(sids, 2, ids, types, errs);
+    assert_int_equal(ret, EBADMSG);
+
+    /* number of results does not match the number of SIDs */
+    will_return(sss_nss_make_request, &d);
+    ret = sss_nss_getidsbysids(sids, 1, ids, types, errs);
+    assert_int_equal(ret, EBADMSG);
+}
+
 int main(int argc, const char *argv[])
 {
 
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_getsidbyname),
         cmocka_unit_test(test_getorigbyname),
+        cmocka_unit_test(test_getidsbysids),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,275 @@
+/*
+    SSSD
+
+    Unit tests for the access decision cache
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <errno.h>
+#include <popt.h>
+#include <unistd.h>
+
+#include "providers/be_access_cache.h"
+#include "tests/cmocka/common_mock.h"
+
+#define TIMEOUT 60
+#define USER "user"
+#define SERVICE "sshd"
+#define HOST "host.example.com"
+#define MEMBERSHIP 0x1234
+
+#define new_test(test) \
+    cmocka_unit_test_setup_teardown(test_ ## test, test_setup, test_teardown)
+
+struct test_ctx {
+    struct be_access_cache *cache;
+};
+
+static int test_setup(void **state)
+{
+    struct test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct test_ctx);
+    assert_non_null(test_ctx);
+
+    ret = be_access_cache_init(test_ctx, TIMEOUT, &test_ctx->cache);
+    assert_int_equal(ret, EOK);
+    assert_non_null(test_ctx->cache);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_teardown(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    talloc_zfree(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_be_access_cache_hit(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    errno_t result;
+    errno_t ret;
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+
+    ret = be_access_cache_store(test_ctx->cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, ERR_ACCESS_DENIED);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(result, ERR_ACCESS_DENIED);
+
+    /* overwrite the decision */
+    ret = be_access_cache_store(test_ctx->cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, EOK);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(result, EOK);
+
+    /* the decision is bound to the whole tuple */
+    ret = be_access_cache_lookup(test_ctx->cache, USER, "login", HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, NULL,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+
+    ret = be_access_cache_lookup(test_ctx->cache, "other", SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+}
+
+static void test_be_access_cache_invalidate(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    errno_t result;
+    errno_t ret;
+
+    ret = be_access_cache_store(test_ctx->cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, EOK);
+    assert_int_equal(ret, EOK);
+
+    be_access_cache_invalidate(test_ctx->cache);
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+
+    /* decisions made after the invalidation are cached again */
+    ret = be_access_cache_store(test_ctx->cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, EOK);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(result, EOK);
+}
+
+static void test_be_access_cache_membership(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    errno_t result;
+    errno_t ret;
+
+    ret = be_access_cache_store(test_ctx->cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, EOK);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP + 1, &result);
+    assert_int_equal(ret, ENOENT);
+
+    /* the stale entry was dropped */
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+}
+
+static void test_be_access_cache_expire(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    struct be_access_cache *cache;
+    errno_t result;
+    errno_t ret;
+
+    ret = be_access_cache_init(test_ctx, 1, &cache);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_store(cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, EOK);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, EOK);
+
+    sleep(2);
+
+    ret = be_access_cache_lookup(cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+
+    talloc_free(cache);
+}
+
+static void test_be_access_cache_errors(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    errno_t result;
+    errno_t ret;
+
+    ret = be_access_cache_store(test_ctx->cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, EIO);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(test_ctx->cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+}
+
+static void test_be_access_cache_disabled(void **state)
+{
+    struct be_access_cache *cache = (struct be_access_cache *) 0x1;
+    errno_t result;
+    errno_t ret;
+
+    ret = be_access_cache_init(NULL, 0, &cache);
+    assert_int_equal(ret, EOK);
+    assert_null(cache);
+
+    ret = be_access_cache_store(cache, USER, SERVICE, HOST,
+                                MEMBERSHIP, EOK);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(cache, USER, SERVICE, HOST,
+                                 MEMBERSHIP, &result);
+    assert_int_equal(ret, ENOENT);
+
+    be_access_cache_invalidate(cache);
+}
+
+static void test_be_access_cache_fingerprint(void **state)
+{
+    const char *a[] = { "S-1-5-21-1", "S-1-5-21-2", "S-1-5-21-3" };
+    const char *b[] = { "S-1-5-21-3", "S-1-5-21-1", "S-1-5-21-2" };
+    const char *c[] = { "S-1-5-21-1", "S-1-5-21-2", "S-1-5-21-4" };
+
+    assert_true(be_access_cache_fingerprint(a, 3)
+                    == be_access_cache_fingerprint(b, 3));
+    assert_true(be_access_cache_fingerprint(a, 3)
+                    != be_access_cache_fingerprint(c, 3));
+    assert_true(be_access_cache_fingerprint(a, 3)
+                    != be_access_cache_fingerprint(a, 2));
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        new_test(be_access_cache_hit),
+        new_test(be_access_cache_invalidate),
+        new_test(be_access_cache_membership),
+        new_test(be_access_cache_expire),
+        new_test(be_access_cache_errors),
+        new_test(be_access_cache_disabled),
+        new_test(be_access_cache_fingerprint)
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,263 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests: Periodic latency probes of fail over servers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "tests/cmocka/common_mock.h"
+
+/* Include source file directly to be able to test static functions */
+#include "providers/data_provider_fo.c"
+
+#define TEST_RESOLV_TIMEOUT 5
+#define TEST_SERVICE_NAME "LDAP"
+/* probe as fast as possible */
+#define TEST_PROBE_INTERVAL 0
+
+struct fo_latency_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct be_ctx *be_ctx;
+    struct be_svc_data *svc;
+    int listen_fd;
+
+    int num_probes;
+    int wait_probes;
+};
+
+/* Mock the only function of the back end we need, so we don't have to
+ * bring the whole data provider into this test. */
+bool be_is_offline(struct be_ctx *ctx)
+{
+    return ctx->offstat.offline;
+}
+
+struct tevent_req *
+__real_fo_probe_service_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                             struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+                             struct fo_service *service);
+
+struct tevent_req *
+__wrap_fo_probe_service_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                             struct resolv_ctx *resolv, struct fo_ctx *fo_ctx,
+                             struct fo_service *service)
+{
+    struct fo_latency_test_ctx *test_ctx;
+    bool fail;
+
+    test_ctx = sss_mock_ptr_type(struct fo_latency_test_ctx *);
+    fail = sss_mock_type(bool);
+
+    test_ctx->num_probes++;
+    if (test_ctx->num_probes == test_ctx->wait_probes) {
+        test_ev_done(test_ctx->tctx, EOK);
+    }
+
+    if (fail) {
+        return NULL;
+    }
+
+    return __real_fo_probe_service_send(mem_ctx, ev, resolv, fo_ctx, service);
+}
+
+static void mock_probe(struct fo_latency_test_ctx *test_ctx, bool fail)
+{
+    will_return(__wrap_fo_probe_service_send, test_ctx);
+    will_return(__wrap_fo_probe_service_send, fail);
+}
+
+static int listen_local(int *_port)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen;
+    int fd;
+    int ret;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert_true(fd >= 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    ret = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+    assert_int_equal(ret, 0);
+
+    ret = listen(fd, 10);
+    assert_int_equal(ret, 0);
+
+    ret = fcntl(fd, F_SETFL, O_NONBLOCK);
+    assert_int_equal(ret, 0);
+
+    addrlen = sizeof(addr);
+    ret = getsockname(fd, (struct sockaddr *) &addr, &addrlen);
+    assert_int_equal(ret, 0);
+
+    *_port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static int test_fo_latency_setup(void **state)
+{
+    struct fo_latency_test_ctx *test_ctx;
+    struct be_failover_ctx *be_fo;
+    struct fo_options fopts;
+    int port;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct fo_latency_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_ev_test_ctx(test_ctx);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->be_ctx = talloc_zero(test_ctx, struct be_ctx);
+    assert_non_null(test_ctx->be_ctx);
+    test_ctx->be_ctx->ev = test_ctx->tctx->ev;
+
+    test_ctx->be_ctx->be_res = talloc_zero(test_ctx->be_ctx,
+                                           struct be_resolv_ctx);
+    assert_non_null(test_ctx->be_ctx->be_res);
+
+    ret = resolv_init(test_ctx->be_ctx->be_res, test_ctx->tctx->ev,
+                      TEST_RESOLV_TIMEOUT,
+                      &test_ctx->be_ctx->be_res->resolv);
+    assert_int_equal(ret, EOK);
+
+    be_fo = talloc_zero(test_ctx->be_ctx, struct be_failover_ctx);
+    assert_non_null(be_fo);
+    be_fo->be_res = test_ctx->be_ctx->be_res;
+    test_ctx->be_ctx->be_fo = be_fo;
+
+    memset(&fopts, 0, sizeof(fopts));
+    fopts.retry_timeout = 30;
+    fopts.family_order = IPV4_FIRST;
+    fopts.latency_probe_interval = TEST_PROBE_INTERVAL;
+
+    be_fo->fo_ctx = fo_context_init(be_fo, &fopts);
+    assert_non_null(be_fo->fo_ctx);
+
+    test_ctx->svc = talloc_zero(be_fo, struct be_svc_data);
+    assert_non_null(test_ctx->svc);
+    test_ctx->svc->name = talloc_strdup(test_ctx->svc, TEST_SERVICE_NAME);
+    assert_non_null(test_ctx->svc->name);
+
+    ret = fo_new_service(be_fo->fo_ctx, TEST_SERVICE_NAME, NULL,
+                         &test_ctx->svc->fo_service);
+    assert_int_equal(ret, EOK);
+
+    /* A configured server, as from ldap_uri, that accepts connections */
+    test_ctx->listen_fd = listen_local(&port);
+    ret = fo_add_server(test_ctx->svc->fo_service, "127.0.0.1", port,
+                        NULL, true);
+    assert_int_equal(ret, EOK);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_fo_latency_teardown(void **state)
+{
+    struct fo_latency_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct fo_latency_test_ctx);
+
+    close(test_ctx->listen_fd);
+    talloc_free(test_ctx);
+
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_fo_latency_probe_reschedule(void **state)
+{
+    struct fo_latency_test_ctx *test_ctx;
+    int fd;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct fo_latency_test_ctx);
+
+    /* The first probe cannot be started, the second one is really sent
+     * and the third one is there only if the second one re-armed the
+     * timer when it finished. */
+    mock_probe(test_ctx, true);
+    mock_probe(test_ctx, false);
+    mock_probe(test_ctx, true);
+    test_ctx->wait_probes = 3;
+
+    ret = be_fo_latency_probe_init(test_ctx->be_ctx, test_ctx->svc,
+                                   TEST_PROBE_INTERVAL);
+    assert_int_equal(ret, EOK);
+
+    ret = test_ev_loop(test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(test_ctx->num_probes, 3);
+
+    /* The second probe connected to the configured server. */
+    fd = accept(test_ctx->listen_fd, NULL, NULL);
+    assert_true(fd >= 0);
+    close(fd);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_fo_latency_probe_reschedule,
+                                        test_fo_latency_setup,
+                                        test_fo_latency_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
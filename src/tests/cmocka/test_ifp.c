@@ -354,6 +354,54 @@ void test_attr_allowed(void **state)
     assert_false(ifp_attr_allowed(NULL, "name"));
 }
 
+void test_object_memo(void **state)
+{
+    struct ifp_ctx *ifp_ctx;
+    struct sss_domain_info *dom;
+    struct sss_domain_info *out_dom;
+    struct ldb_message *msg;
+    struct ldb_message *out_msg;
+    const char *path = "/org/freedesktop/sssd/infopipe/Users/test/1000";
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    ifp_ctx = mock_ifp_ctx(global_talloc_context);
+    assert_non_null(ifp_ctx);
+
+    dom = talloc_zero(ifp_ctx, struct sss_domain_info);
+    assert_non_null(dom);
+
+    msg = ldb_msg_new(ifp_ctx);
+    assert_non_null(msg);
+    ret = ldb_msg_add_string(msg, SYSDB_NAME, "user1");
+    assert_int_equal(ret, LDB_SUCCESS);
+
+    ret = ifp_object_memo_get(ifp_ctx, path, &out_dom, &out_msg);
+    assert_int_equal(ret, ENOENT);
+
+    ifp_object_memo_add(ifp_ctx, path, dom, msg);
+
+    /* the memo keeps its own copy */
+    talloc_free(msg);
+
+    ret = ifp_object_memo_get(ifp_ctx, path, &out_dom, &out_msg);
+    assert_int_equal(ret, EOK);
+    assert_ptr_equal(out_dom, dom);
+    assert_string_equal(ldb_msg_find_attr_as_string(out_msg, SYSDB_NAME,
+                                                    NULL), "user1");
+
+    ret = ifp_object_memo_get(ifp_ctx, "/other/path", &out_dom, &out_msg);
+    assert_int_equal(ret, ENOENT);
+
+    ifp_object_memo_remove(ifp_ctx, path);
+    ret = ifp_object_memo_get(ifp_ctx, path, &out_dom, &out_msg);
+    assert_int_equal(ret, ENOENT);
+
+    talloc_free(ifp_ctx);
+    assert_true(leak_check_teardown());
+}
+
 struct ifp_test_req_ctx {
     struct ifp_req *ireq;
     struct sbus_request *sr;
@@ -417,6 +465,7 @@ int main(int argc, const char *argv[])
         cmocka_unit_test(test_attr_acl),
         cmocka_unit_test(test_attr_acl_ex),
         cmocka_unit_test(test_attr_allowed),
+        cmocka_unit_test(test_object_memo),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
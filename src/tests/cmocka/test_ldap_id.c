@@ -0,0 +1,149 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests: LDAP group lookups
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <popt.h>
+#include <talloc.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ldap/ldap_common.h"
+#include "providers/ldap/ldap_opts.h"
+
+struct ldap_id_test_ctx {
+    struct sdap_options *opts;
+};
+
+static int test_ldap_id_setup(void **state)
+{
+    struct ldap_id_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct ldap_id_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->opts = talloc_zero(test_ctx, struct sdap_options);
+    assert_non_null(test_ctx->opts);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_ldap_id_teardown(void **state)
+{
+    struct ldap_id_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct ldap_id_test_ctx);
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_groups_get_by_sids_filter(void **state)
+{
+    struct ldap_id_test_ctx *test_ctx;
+    const char *sids[] = { "S-1-5-21-1-2-3-1000",
+                           "S-1-5-21-1-2-3-1001",
+                           NULL };
+    char *filter = NULL;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct ldap_id_test_ctx);
+
+    /* rfc2307 has no objectSID mapping */
+    ret = sdap_copy_map(test_ctx->opts, rfc2307_group_map,
+                        SDAP_OPTS_GROUP, &test_ctx->opts->group_map);
+    assert_int_equal(ret, ERR_OK);
+
+    ret = groups_get_by_sids_filter(test_ctx, test_ctx->opts, sids, 2,
+                                    &filter);
+    assert_int_equal(ret, EINVAL);
+    assert_null(filter);
+
+    talloc_zfree(test_ctx->opts->group_map);
+    ret = sdap_copy_map(test_ctx->opts, gen_ad2008r2_group_map,
+                        SDAP_OPTS_GROUP, &test_ctx->opts->group_map);
+    assert_int_equal(ret, ERR_OK);
+
+    check_leaks_push(test_ctx);
+
+    ret = groups_get_by_sids_filter(test_ctx, test_ctx->opts, sids, 0,
+                                    &filter);
+    assert_int_equal(ret, EINVAL);
+    assert_null(filter);
+
+    ret = groups_get_by_sids_filter(test_ctx, test_ctx->opts, sids, 1,
+                                    &filter);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(filter,
+                        "(&(|(objectSID=S-1-5-21-1-2-3-1000))"
+                        "(objectClass=group)(name=*))");
+    talloc_zfree(filter);
+
+    ret = groups_get_by_sids_filter(test_ctx, test_ctx->opts, sids, 2,
+                                    &filter);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(filter,
+                        "(&(|(objectSID=S-1-5-21-1-2-3-1000)"
+                        "(objectSID=S-1-5-21-1-2-3-1001))"
+                        "(objectClass=group)(name=*))");
+    talloc_zfree(filter);
+
+    assert_true(check_leaks_pop(test_ctx));
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_groups_get_by_sids_filter,
+                                        test_ldap_id_setup,
+                                        test_ldap_id_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
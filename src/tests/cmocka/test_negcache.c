@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <inttypes.h>
 #include <cmocka.h>
 
@@ -52,6 +53,7 @@
 #define TESTS_PATH "tp_" BASE_FILE_STEM
 #define TEST_CONF_DB "test_nss_conf.ldb"
 #define TEST_DOM_NAME "nss_test"
+#define TEST_SHARED_NCACHE TESTS_PATH "/shared_negcache.tdb"
 #define TEST_ID_PROVIDER "ldap"
 
 /* register_cli_protocol_version is required in test since it links with
@@ -786,6 +788,53 @@ static void test_sss_ncache_reset_prepopulate(void **state)
     ret = check_group_in_ncache(ncache, dom2, "testgroup2");
     assert_int_equal(ret, EEXIST);
 }
+/* @test_sss_ncache_share : entries added by one process are seen by
+ * another one using the same file
+ */
+static void test_sss_ncache_share(void **state)
+{
+    struct test_state *ts;
+    struct sss_nc_ctx *child_ctx;
+    pid_t pid;
+    int status;
+    int ret;
+
+    ts = talloc_get_type_abort(*state, struct test_state);
+
+    ret = sss_ncache_share(ts->ctx, TEST_SHARED_NCACHE);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_ncache_check_uid(ts->ctx, NULL, 12345);
+    assert_int_equal(ret, ENOENT);
+
+    pid = fork();
+    assert_int_not_equal(pid, -1);
+    if (pid == 0) {
+        /* the tdb of the parent must not be used in the child */
+        talloc_zfree(ts->ctx);
+
+        ret = sss_ncache_init(ts, SHORTSPAN, 0, &child_ctx);
+        if (ret == EOK) {
+            ret = sss_ncache_share(child_ctx, TEST_SHARED_NCACHE);
+        }
+        if (ret == EOK) {
+            ret = sss_ncache_set_uid(child_ctx, true, NULL, 12345);
+        }
+        _exit(ret == EOK ? 0 : 1);
+    }
+
+    ret = waitpid(pid, &status, 0);
+    assert_int_equal(ret, pid);
+    assert_true(WIFEXITED(status));
+    assert_int_equal(WEXITSTATUS(status), 0);
+
+    ret = sss_ncache_check_uid(ts->ctx, NULL, 12345);
+    assert_int_equal(ret, EEXIST);
+
+    talloc_zfree(ts->ctx);
+    unlink(TEST_SHARED_NCACHE);
+}
+
 int main(void)
 {
     int rv;
@@ -810,6 +859,8 @@ int main(void)
                                         setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_reset_prepopulate,
                                         setup, teardown),
+        cmocka_unit_test_setup_teardown(test_sss_ncache_share,
+                                        setup, teardown),
     };
 
     tests_set_cwd();
@@ -0,0 +1,374 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests: Memory cache shared by several NSS responder processes
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <errno.h>
+#include <popt.h>
+#include <sys/wait.h>
+
+#include "tests/cmocka/common_mock.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+
+/* Include source file directly to be able to test static functions and
+ * to keep the cache files in the test directory */
+#undef SSS_NSS_MCACHE_DIR
+#define SSS_NSS_MCACHE_DIR TESTS_PATH
+#include "responder/nss/nsssrv_mmap_cache.c"
+
+#define TEST_MC_NAME "passwd"
+#define TEST_MC_FILE TESTS_PATH "/" TEST_MC_NAME
+#define TEST_MC_ELEMENTS 1024
+#define TEST_MC_TIMEOUT 300
+
+/* entries stored by each writer process */
+#define TEST_NUM_ENTRIES 200
+
+struct mmap_cache_test_ctx {
+    struct sss_mc_ctx *mcc;
+};
+
+static errno_t store_user(struct sss_mc_ctx **mcc, const char *name, uid_t uid)
+{
+    struct sized_string sname;
+    struct sized_string empty;
+
+    to_sized_string(&sname, name);
+    to_sized_string(&empty, "");
+
+    return sss_mmap_cache_pw_store(mcc, &sname, &empty, uid, uid,
+                                   &empty, &empty, &empty);
+}
+
+static bool has_user(struct sss_mc_ctx *mcc, const char *name)
+{
+    struct sized_string sname;
+
+    to_sized_string(&sname, name);
+
+    return sss_mc_find_record(mcc, &sname) != NULL;
+}
+
+static uint32_t header_status(struct sss_mc_ctx *mcc)
+{
+    return ((struct sss_mc_header *)mcc->mmap_base)->status;
+}
+
+/* Runs fn in a child process that attaches to the cache like an NSS
+ * worker does. The return value of fn is the exit status of the child. */
+static pid_t start_worker(int (*fn)(struct sss_mc_ctx **mcc, void *pvt),
+                          void *pvt)
+{
+    struct sss_mc_ctx *mcc;
+    pid_t pid;
+    errno_t ret;
+
+    pid = fork();
+    assert_int_not_equal(pid, -1);
+
+    if (pid == 0) {
+        ret = sss_mmap_cache_attach(NULL, TEST_MC_NAME, SSS_MC_PASSWD,
+                                    TEST_MC_TIMEOUT, &mcc);
+        if (ret != EOK) {
+            _exit(1);
+        }
+
+        _exit(fn(&mcc, pvt));
+    }
+
+    return pid;
+}
+
+static void assert_worker_ok(pid_t pid)
+{
+    int status;
+
+    assert_int_equal(waitpid(pid, &status, 0), pid);
+    assert_true(WIFEXITED(status));
+    assert_int_equal(WEXITSTATUS(status), 0);
+}
+
+static int test_mmap_cache_setup(void **state)
+{
+    struct mmap_cache_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    ret = mkdir(TESTS_PATH, 0775);
+    assert_true(ret == 0 || errno == EEXIST);
+
+    test_ctx = talloc_zero(global_talloc_context, struct mmap_cache_test_ctx);
+    assert_non_null(test_ctx);
+
+    /* what the main NSS process does */
+    ret = sss_mmap_cache_init(test_ctx, TEST_MC_NAME, SSS_MC_PASSWD,
+                              TEST_MC_ELEMENTS, TEST_MC_TIMEOUT, true,
+                              &test_ctx->mcc);
+    assert_int_equal(ret, EOK);
+
+    check_leaks_push(test_ctx);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_mmap_cache_teardown(void **state)
+{
+    struct mmap_cache_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct mmap_cache_test_ctx);
+
+    assert_true(check_leaks_pop(test_ctx));
+    talloc_free(test_ctx);
+
+    unlink(TEST_MC_FILE);
+    rmdir(TESTS_PATH);
+
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+void test_mc_attach_file(void **state)
+{
+    struct mmap_cache_test_ctx *test_ctx;
+    struct sss_mc_ctx *mcc;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct mmap_cache_test_ctx);
+
+    ret = store_user(&test_ctx->mcc, "user1", 1001);
+    assert_int_equal(ret, EOK);
+
+    ret = sss_mmap_cache_attach(test_ctx, TEST_MC_NAME, SSS_MC_PASSWD,
+                                TEST_MC_TIMEOUT, &mcc);
+    assert_int_equal(ret, EOK);
+    assert_non_null(mcc->mmap_base);
+    assert_int_equal(mcc->seed, test_ctx->mcc->seed);
+    assert_int_equal(mcc->dt_size, test_ctx->mcc->dt_size);
+    assert_true(has_user(mcc, "user1"));
+
+    /* a file that is being initialized is not attached */
+    sss_mc_header_update(test_ctx->mcc, SSS_MC_HEADER_UNINIT);
+    assert_int_equal(sss_mc_attach_file(mcc), EAGAIN);
+    sss_mc_header_update(test_ctx->mcc, SSS_MC_HEADER_ALIVE);
+    assert_int_equal(sss_mc_attach_file(mcc), EOK);
+
+    talloc_free(mcc);
+
+    /* the file is attached on the first write if it did not exist yet */
+    unlink(TEST_MC_FILE);
+    ret = sss_mmap_cache_attach(test_ctx, TEST_MC_NAME, SSS_MC_PASSWD,
+                                TEST_MC_TIMEOUT, &mcc);
+    assert_int_equal(ret, EOK);
+    assert_null(mcc->mmap_base);
+    assert_int_equal(store_user(&mcc, "user2", 1002), ENOENT);
+    talloc_free(mcc);
+}
+
+static int hold_write_lock(struct sss_mc_ctx **mcc, void *pvt)
+{
+    int *fds = pvt;
+    char c = 0;
+
+    if (sss_mc_write_lock(*mcc) != EOK) {
+        return 1;
+    }
+
+    /* tell the parent that the lock is held, then wait for it */
+    if (sss_atomic_write_s(fds[0], (uint8_t *)&c, 1) != 1
+            || sss_atomic_read_s(fds[1], (uint8_t *)&c, 1) != 1) {
+        return 1;
+    }
+
+    sss_mc_write_unlock(*mcc);
+    return 0;
+}
+
+void test_mc_write_lock(void **state)
+{
+    struct mmap_cache_test_ctx *test_ctx;
+    struct flock lock;
+    int locked[2];
+    int release[2];
+    int fds[2];
+    pid_t pid;
+    char c = 0;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct mmap_cache_test_ctx);
+
+    assert_int_equal(pipe(locked), 0);
+    assert_int_equal(pipe(release), 0);
+    fds[0] = locked[1];
+    fds[1] = release[0];
+
+    pid = start_worker(hold_write_lock, fds);
+    assert_int_equal(sss_atomic_read_s(locked[0], (uint8_t *)&c, 1), 1);
+
+    /* the worker holds the write lock while the creator still holds the
+     * first byte */
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = SSS_MC_WRITE_LOCK_OFFSET;
+    lock.l_len = 1;
+    lock.l_pid = 0;
+    assert_int_equal(fcntl(test_ctx->mcc->fd, F_GETLK, &lock), 0);
+    assert_int_equal(lock.l_type, F_WRLCK);
+    assert_int_equal(lock.l_pid, pid);
+
+    assert_int_equal(sss_atomic_write_s(release[1], (uint8_t *)&c, 1), 1);
+    assert_worker_ok(pid);
+
+    ret = sss_mc_write_lock(test_ctx->mcc);
+    assert_int_equal(ret, EOK);
+    sss_mc_write_unlock(test_ctx->mcc);
+
+    close(locked[0]);
+    close(locked[1]);
+    close(release[0]);
+    close(release[1]);
+}
+
+static int store_users(struct sss_mc_ctx **mcc, void *pvt)
+{
+    const char *prefix = pvt;
+    char name[64];
+    int i;
+
+    for (i = 0; i < TEST_NUM_ENTRIES; i++) {
+        snprintf(name, sizeof(name), "%s%d", prefix, i);
+        if (store_user(mcc, name, 10000 + i) != EOK) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void test_mc_two_writers(void **state)
+{
+    struct mmap_cache_test_ctx *test_ctx;
+    char name[64];
+    pid_t pid1;
+    pid_t pid2;
+    int i;
+
+    test_ctx = talloc_get_type_abort(*state, struct mmap_cache_test_ctx);
+
+    pid1 = start_worker(store_users, discard_const("first"));
+    pid2 = start_worker(store_users, discard_const("second"));
+    assert_worker_ok(pid1);
+    assert_worker_ok(pid2);
+
+    /* no write was lost or overwritten by the other process */
+    for (i = 0; i < TEST_NUM_ENTRIES; i++) {
+        snprintf(name, sizeof(name), "first%d", i);
+        assert_true(has_user(test_ctx->mcc, name));
+        snprintf(name, sizeof(name), "second%d", i);
+        assert_true(has_user(test_ctx->mcc, name));
+    }
+}
+
+static int recycle_and_store(struct sss_mc_ctx **mcc, void *pvt)
+{
+    /* what a worker does when it finds the cache corrupted */
+    if (sss_mmap_cache_reinit(NULL, -1, -1, mcc) != EOK) {
+        return 1;
+    }
+
+    return store_user(mcc, "recycler", 1003) == EOK ? 0 : 1;
+}
+
+void test_mc_recycled(void **state)
+{
+    struct mmap_cache_test_ctx *test_ctx;
+    pid_t pid;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct mmap_cache_test_ctx);
+
+    ret = store_user(&test_ctx->mcc, "before", 1001);
+    assert_int_equal(ret, EOK);
+
+    pid = start_worker(recycle_and_store, NULL);
+    assert_worker_ok(pid);
+
+    /* still mapped, but abandoned */
+    assert_int_equal(header_status(test_ctx->mcc), SSS_MC_HEADER_RECYCLED);
+
+    /* the next write moves to the file the worker created */
+    ret = store_user(&test_ctx->mcc, "after", 1002);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(header_status(test_ctx->mcc), SSS_MC_HEADER_ALIVE);
+    assert_true(has_user(test_ctx->mcc, "recycler"));
+    assert_true(has_user(test_ctx->mcc, "after"));
+    assert_false(has_user(test_ctx->mcc, "before"));
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_mc_attach_file,
+                                        test_mmap_cache_setup,
+                                        test_mmap_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_mc_write_lock,
+                                        test_mmap_cache_setup,
+                                        test_mmap_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_mc_two_writers,
+                                        test_mmap_cache_setup,
+                                        test_mmap_cache_teardown),
+        cmocka_unit_test_setup_teardown(test_mc_recycled,
+                                        test_mmap_cache_setup,
+                                        test_mmap_cache_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+
+    return rv;
+}
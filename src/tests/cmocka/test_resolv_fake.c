@@ -29,6 +29,7 @@
 #include <sys/types.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <resolv.h>
 
@@ -194,8 +195,15 @@ struct fake_ares_query {
     int timeouts;
     unsigned char *abuf;
     int alen;
+
+    ares_callback callback;
+    void *arg;
 };
 
+/* When set, answers are delivered from this event loop like a real server
+ * would do instead of from within ares_query() */
+static struct tevent_context *fake_ares_defer_ev = NULL;
+
 void mock_ares_query(int status, int timeouts, unsigned char *abuf, int alen)
 {
     will_return(__wrap_ares_query, status);
@@ -204,23 +212,57 @@ void mock_ares_query(int status, int timeouts, unsigned char *abuf, int alen)
     will_return(__wrap_ares_query, alen);
 }
 
+static void fake_ares_query_answer(struct tevent_context *ev,
+                                   struct tevent_timer *te,
+                                   struct timeval tv,
+                                   void *pvt)
+{
+    struct fake_ares_query *query =
+        talloc_get_type(pvt, struct fake_ares_query);
+
+    query->callback(query->arg, query->status, query->timeouts,
+                    query->abuf, query->alen);
+    talloc_free(query);
+}
+
 void __wrap_ares_query(ares_channel channel, const char *name, int dnsclass,
                        int type, ares_callback callback, void *arg)
 {
-    struct fake_ares_query query;
-
-    query.status = sss_mock_type(int);
-    query.timeouts = sss_mock_type(int);
-    query.abuf = sss_mock_ptr_type(unsigned char *);
-    query.alen = sss_mock_type(int);
+    struct fake_ares_query *query;
+    struct tevent_timer *te;
+
+    query = talloc_zero(global_mock_context, struct fake_ares_query);
+    assert_non_null(query);
+
+    query->status = sss_mock_type(int);
+    query->timeouts = sss_mock_type(int);
+    query->abuf = sss_mock_ptr_type(unsigned char *);
+    query->alen = sss_mock_type(int);
+    query->callback = callback;
+    query->arg = arg;
+
+    if (fake_ares_defer_ev == NULL) {
+        fake_ares_query_answer(NULL, NULL, tevent_timeval_zero(), query);
+        return;
+    }
 
-    callback(arg, query.status, query.timeouts, query.abuf, query.alen);
+    te = tevent_add_timer(fake_ares_defer_ev, query,
+                          tevent_timeval_current(),
+                          fake_ares_query_answer, query);
+    assert_non_null(te);
 }
 
 /* The unit test */
 struct resolv_fake_ctx {
     struct resolv_ctx *resolv;
     struct sss_test_ctx *ctx;
+
+    /* results of resolv_fake_getsrv() */
+    int num_expected;
+    int num_done;
+    errno_t ret;
+    int status;
+    uint32_t ttl;
 };
 
 static int test_resolv_fake_setup(void **state)
@@ -252,6 +294,7 @@ static int test_resolv_fake_teardown(void **state)
     struct resolv_fake_ctx *test_ctx =
         talloc_get_type(*state, struct resolv_fake_ctx);
 
+    fake_ares_defer_ev = NULL;
     talloc_free(test_ctx);
     talloc_free(global_mock_context);
     assert_true(leak_check_teardown());
@@ -334,6 +377,147 @@ void test_resolv_fake_srv(void **state)
     assert_int_equal(ret, ERR_OK);
 }
 
+static void mock_srv_answer(uint32_t ttl)
+{
+    unsigned char *buf;
+    size_t buflen;
+    struct srv_rrdata rr;
+
+    rr.prio = 1;
+    rr.port = 389;
+    rr.weight = 100;
+    rr.ttl = ttl;
+    rr.hostname = "ldap.sssd.com";
+
+    buf = create_srv_buffer(global_mock_context, TEST_SRV_QUERY,
+                            &rr, 1, &buflen);
+    assert_non_null(buf);
+    mock_ares_query(ARES_SUCCESS, 0, buf, buflen);
+}
+
+static void resolv_fake_getsrv_done(struct tevent_req *req)
+{
+    struct ares_srv_reply *srv_replies = NULL;
+    struct resolv_fake_ctx *test_ctx =
+        tevent_req_callback_data(req, struct resolv_fake_ctx);
+
+    test_ctx->ret = resolv_getsrv_recv(test_ctx, req, &test_ctx->status,
+                                       NULL, &srv_replies, &test_ctx->ttl);
+    talloc_free(req);
+
+    if (test_ctx->ret == EOK) {
+        assert_non_null(srv_replies);
+        assert_int_equal(srv_replies->port, 389);
+        assert_string_equal(srv_replies->host, "ldap.sssd.com");
+        assert_null(srv_replies->next);
+    }
+    talloc_free(srv_replies);
+
+    test_ctx->num_done++;
+    if (test_ctx->num_done == test_ctx->num_expected) {
+        test_ev_done(test_ctx->ctx, EOK);
+    }
+}
+
+/* Sends num_requests identical SRV queries at once and waits for all */
+static void resolv_fake_getsrv(struct resolv_fake_ctx *test_ctx,
+                               int num_requests)
+{
+    struct tevent_req *req;
+    int ret;
+    int i;
+
+    test_ctx->ctx->done = false;
+    test_ctx->num_expected = num_requests;
+    test_ctx->num_done = 0;
+
+    for (i = 0; i < num_requests; i++) {
+        req = resolv_getsrv_send(test_ctx, test_ctx->ctx->ev,
+                                 test_ctx->resolv, TEST_SRV_QUERY);
+        assert_non_null(req);
+        tevent_req_set_callback(req, resolv_fake_getsrv_done, test_ctx);
+    }
+
+    ret = test_ev_loop(test_ctx->ctx);
+    assert_int_equal(ret, ERR_OK);
+    assert_int_equal(test_ctx->num_done, num_requests);
+}
+
+void test_resolv_fake_srv_cache_expire(void **state)
+{
+    struct resolv_fake_ctx *test_ctx =
+        talloc_get_type(*state, struct resolv_fake_ctx);
+
+    mock_srv_answer(2);
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_equal(test_ctx->ret, EOK);
+    assert_int_equal(test_ctx->ttl, 2);
+
+    /* Answered from the cache, ares_query() must not be called */
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_equal(test_ctx->ret, EOK);
+    assert_true(test_ctx->ttl > 0 && test_ctx->ttl <= 2);
+
+    sleep(3);
+
+    /* The answer expired, the server is asked again */
+    mock_srv_answer(600);
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_equal(test_ctx->ret, EOK);
+    assert_int_equal(test_ctx->ttl, 600);
+
+    /* The cached answer reports the remaining time only */
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_equal(test_ctx->ret, EOK);
+    assert_true(test_ctx->ttl > 590 && test_ctx->ttl <= 600);
+}
+
+void test_resolv_fake_srv_cache_negative(void **state)
+{
+    struct resolv_fake_ctx *test_ctx =
+        talloc_get_type(*state, struct resolv_fake_ctx);
+
+    mock_ares_query(ARES_ENOTFOUND, 0, NULL, 0);
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_not_equal(test_ctx->ret, EOK);
+    assert_int_equal(test_ctx->status, ARES_ENOTFOUND);
+
+    /* The missing name is remembered as well */
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_not_equal(test_ctx->ret, EOK);
+    assert_int_equal(test_ctx->status, ARES_ENOTFOUND);
+}
+
+void test_resolv_fake_srv_cache_errors(void **state)
+{
+    struct resolv_fake_ctx *test_ctx =
+        talloc_get_type(*state, struct resolv_fake_ctx);
+
+    mock_ares_query(ARES_ESERVFAIL, 0, NULL, 0);
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_not_equal(test_ctx->ret, EOK);
+    assert_int_equal(test_ctx->status, ARES_ESERVFAIL);
+
+    /* Server failures are not cached */
+    mock_srv_answer(600);
+    resolv_fake_getsrv(test_ctx, 1);
+    assert_int_equal(test_ctx->ret, EOK);
+}
+
+void test_resolv_fake_srv_coalesce(void **state)
+{
+    struct resolv_fake_ctx *test_ctx =
+        talloc_get_type(*state, struct resolv_fake_ctx);
+
+    fake_ares_defer_ev = test_ctx->ctx->ev;
+
+    /* All three requests are waiting for a single query */
+    mock_srv_answer(600);
+    resolv_fake_getsrv(test_ctx, 3);
+    assert_int_equal(test_ctx->ret, EOK);
+    assert_int_equal(test_ctx->ttl, 600);
+}
+
 void test_resolv_is_address(void **state)
 {
     bool ret;
@@ -372,6 +556,18 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_resolv_fake_srv,
                                         test_resolv_fake_setup,
                                         test_resolv_fake_teardown),
+        cmocka_unit_test_setup_teardown(test_resolv_fake_srv_cache_expire,
+                                        test_resolv_fake_setup,
+                                        test_resolv_fake_teardown),
+        cmocka_unit_test_setup_teardown(test_resolv_fake_srv_cache_negative,
+                                        test_resolv_fake_setup,
+                                        test_resolv_fake_teardown),
+        cmocka_unit_test_setup_teardown(test_resolv_fake_srv_cache_errors,
+                                        test_resolv_fake_setup,
+                                        test_resolv_fake_teardown),
+        cmocka_unit_test_setup_teardown(test_resolv_fake_srv_coalesce,
+                                        test_resolv_fake_setup,
+                                        test_resolv_fake_teardown),
         cmocka_unit_test(test_resolv_is_address),
     };
 
@@ -0,0 +1,351 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests: Counting of used cache entries in the responders
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+
+/* Include source file directly to be able to look at the counters */
+#include "responder/common/responder_access_stats.c"
+
+#define TEST_DOM_NAME "access_stats_test"
+#define TEST_REFRESH_INTERVAL 60
+
+struct access_stats_test_ctx {
+    struct tevent_context *ev;
+    struct resp_ctx *rctx;
+    struct sss_domain_info *domain;
+    struct be_conn *be_conn;
+
+    /* refresh hints sent to the data provider */
+    uint32_t sent_types[SSS_ACCESS_SENTINEL];
+    const char **sent_names[SSS_ACCESS_SENTINEL];
+    int num_sent;
+};
+
+static struct access_stats_test_ctx *global_test_ctx;
+
+int sss_dp_get_domain_conn(struct resp_ctx *rctx, const char *domain,
+                           struct be_conn **_conn)
+{
+    *_conn = global_test_ctx->be_conn;
+    return EOK;
+}
+
+struct test_rdp_state {
+    int dummy;
+};
+
+struct tevent_req *_rdp_message_send(TALLOC_CTX *mem_ctx,
+                                     struct resp_ctx *rctx,
+                                     struct sss_domain_info *domain,
+                                     const char *path,
+                                     const char *iface,
+                                     const char *method,
+                                     int first_arg_type,
+                                     ...)
+{
+    struct access_stats_test_ctx *test_ctx = global_test_ctx;
+    struct test_rdp_state *state;
+    struct tevent_req *req;
+    const char **names;
+    uint32_t *entry_type;
+    int num_names;
+    va_list ap;
+    int i;
+
+    assert_string_equal(method, IFACE_DP_REFRESHHINT);
+    assert_int_equal(first_arg_type, DBUS_TYPE_UINT32);
+
+    va_start(ap, first_arg_type);
+    entry_type = va_arg(ap, uint32_t *);
+    assert_int_equal(va_arg(ap, int), DBUS_TYPE_ARRAY);
+    assert_int_equal(va_arg(ap, int), DBUS_TYPE_STRING);
+    names = *va_arg(ap, const char ***);
+    num_names = va_arg(ap, int);
+    assert_int_equal(va_arg(ap, int), DBUS_TYPE_INVALID);
+    va_end(ap);
+
+    assert_true(test_ctx->num_sent < SSS_ACCESS_SENTINEL);
+    test_ctx->sent_types[test_ctx->num_sent] = *entry_type;
+    test_ctx->sent_names[test_ctx->num_sent] = talloc_zero_array(test_ctx,
+                                                                 const char *,
+                                                                 num_names + 1);
+    assert_non_null(test_ctx->sent_names[test_ctx->num_sent]);
+    for (i = 0; i < num_names; i++) {
+        test_ctx->sent_names[test_ctx->num_sent][i] =
+                talloc_strdup(test_ctx->sent_names[test_ctx->num_sent],
+                              names[i]);
+    }
+    test_ctx->num_sent++;
+
+    /* never finishes, it is freed together with the counters */
+    req = tevent_req_create(mem_ctx, &state, struct test_rdp_state);
+    assert_non_null(req);
+    return req;
+}
+
+errno_t _rdp_message_recv(struct tevent_req *req,
+                          int first_arg_type,
+                          ...)
+{
+    return EOK;
+}
+
+static int test_access_stats_setup(void **state)
+{
+    struct access_stats_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct access_stats_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    test_ctx->rctx = talloc_zero(test_ctx, struct resp_ctx);
+    assert_non_null(test_ctx->rctx);
+    test_ctx->rctx->ev = test_ctx->ev;
+
+    test_ctx->domain = talloc_zero(test_ctx, struct sss_domain_info);
+    assert_non_null(test_ctx->domain);
+    test_ctx->domain->name = talloc_strdup(test_ctx->domain, TEST_DOM_NAME);
+    assert_non_null(test_ctx->domain->name);
+    test_ctx->domain->conn_name = test_ctx->domain->name;
+    test_ctx->domain->refresh_expired_interval = TEST_REFRESH_INTERVAL;
+
+    test_ctx->be_conn = talloc_zero(test_ctx, struct be_conn);
+    assert_non_null(test_ctx->be_conn);
+    test_ctx->be_conn->rctx = test_ctx->rctx;
+    test_ctx->be_conn->domain = test_ctx->domain;
+
+    global_test_ctx = test_ctx;
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_access_stats_teardown(void **state)
+{
+    struct access_stats_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_stats_test_ctx);
+
+    global_test_ctx = NULL;
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void record(struct access_stats_test_ctx *test_ctx,
+                   enum sss_dp_acct_type dp_type,
+                   const char *name,
+                   int times)
+{
+    struct ldb_message *msg;
+    int ret;
+    int i;
+
+    msg = ldb_msg_new(test_ctx);
+    assert_non_null(msg);
+
+    ret = ldb_msg_add_string(msg, SYSDB_NAME, name);
+    assert_int_equal(ret, LDB_SUCCESS);
+
+    for (i = 0; i < times; i++) {
+        sss_access_stats_record(test_ctx->rctx, test_ctx->domain,
+                                dp_type, msg);
+    }
+
+    talloc_free(msg);
+}
+
+static unsigned long counted(struct access_stats_test_ctx *test_ctx,
+                             enum sss_access_type type,
+                             const char *name)
+{
+    struct sss_access_stats *stats;
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    stats = test_ctx->be_conn->access_stats;
+    assert_non_null(stats);
+    assert_non_null(stats->counters[type]);
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+
+    hret = hash_lookup(stats->counters[type], &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        return 0;
+    }
+    assert_int_equal(hret, HASH_SUCCESS);
+
+    return value.ul;
+}
+
+static void test_access_stats_disabled(void **state)
+{
+    struct access_stats_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_stats_test_ctx);
+
+    test_ctx->domain->refresh_hot_entries = 0;
+    record(test_ctx, SSS_DP_USER, "user", 1);
+    assert_null(test_ctx->be_conn->access_stats);
+
+    /* needs the background refresh as well */
+    test_ctx->domain->refresh_hot_entries = 10;
+    test_ctx->domain->refresh_expired_interval = 0;
+    record(test_ctx, SSS_DP_USER, "user", 1);
+    assert_null(test_ctx->be_conn->access_stats);
+}
+
+static void test_access_stats_count(void **state)
+{
+    struct access_stats_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_stats_test_ctx);
+
+    test_ctx->domain->refresh_hot_entries = 10;
+
+    record(test_ctx, SSS_DP_USER, "user1", 3);
+    record(test_ctx, SSS_DP_INITGROUPS, "user1", 1);
+    record(test_ctx, SSS_DP_USER, "user2", 1);
+    record(test_ctx, SSS_DP_GROUP, "group1", 2);
+
+    assert_int_equal(counted(test_ctx, SSS_ACCESS_USERS, "user1"), 4);
+    assert_int_equal(counted(test_ctx, SSS_ACCESS_USERS, "user2"), 1);
+    assert_int_equal(counted(test_ctx, SSS_ACCESS_USERS, "group1"), 0);
+    assert_int_equal(counted(test_ctx, SSS_ACCESS_GROUPS, "group1"), 2);
+    assert_null(test_ctx->be_conn->access_stats->counters[SSS_ACCESS_NETGROUPS]);
+}
+
+static void test_access_stats_bounded(void **state)
+{
+    struct access_stats_test_ctx *test_ctx;
+    char name[16];
+    int i;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_stats_test_ctx);
+
+    test_ctx->domain->refresh_hot_entries = 1;
+
+    for (i = 0; i < SSS_ACCESS_STATS_MAX_FACTOR + 1; i++) {
+        snprintf(name, sizeof(name), "user%d", i);
+        record(test_ctx, SSS_DP_USER, name, 1);
+    }
+
+    assert_int_equal(
+        hash_count(test_ctx->be_conn->access_stats->counters[SSS_ACCESS_USERS]),
+        SSS_ACCESS_STATS_MAX_FACTOR);
+
+    /* names already in the table are still counted */
+    record(test_ctx, SSS_DP_USER, "user0", 1);
+    assert_int_equal(counted(test_ctx, SSS_ACCESS_USERS, "user0"), 2);
+}
+
+static void test_access_stats_report(void **state)
+{
+    struct access_stats_test_ctx *test_ctx;
+    struct sss_access_stats *stats;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_stats_test_ctx);
+
+    test_ctx->domain->refresh_hot_entries = 2;
+
+    record(test_ctx, SSS_DP_USER, "rare", 1);
+    record(test_ctx, SSS_DP_USER, "hot", 5);
+    record(test_ctx, SSS_DP_USER, "warm", 3);
+    record(test_ctx, SSS_DP_NETGR, "netgroup", 1);
+
+    stats = test_ctx->be_conn->access_stats;
+    assert_non_null(stats);
+
+    /* run the report now instead of waiting for the timer */
+    talloc_zfree(stats->te);
+    sss_access_stats_report(test_ctx->ev, NULL, tevent_timeval_zero(), stats);
+    assert_non_null(stats->te);
+
+    /* only the most used names, types without hits are not sent */
+    assert_int_equal(test_ctx->num_sent, 2);
+
+    assert_int_equal(test_ctx->sent_types[0], BE_REQ_USER);
+    assert_string_equal(test_ctx->sent_names[0][0], "hot");
+    assert_string_equal(test_ctx->sent_names[0][1], "warm");
+    assert_null(test_ctx->sent_names[0][2]);
+
+    assert_int_equal(test_ctx->sent_types[1], BE_REQ_NETGROUP);
+    assert_string_equal(test_ctx->sent_names[1][0], "netgroup");
+    assert_null(test_ctx->sent_names[1][1]);
+
+    /* counting starts again for the next report */
+    assert_null(stats->counters[SSS_ACCESS_USERS]);
+    assert_null(stats->counters[SSS_ACCESS_NETGROUPS]);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_access_stats_disabled,
+                                        test_access_stats_setup,
+                                        test_access_stats_teardown),
+        cmocka_unit_test_setup_teardown(test_access_stats_count,
+                                        test_access_stats_setup,
+                                        test_access_stats_teardown),
+        cmocka_unit_test_setup_teardown(test_access_stats_bounded,
+                                        test_access_stats_setup,
+                                        test_access_stats_teardown),
+        cmocka_unit_test_setup_teardown(test_access_stats_report,
+                                        test_access_stats_setup,
+                                        test_access_stats_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
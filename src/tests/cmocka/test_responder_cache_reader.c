@@ -0,0 +1,425 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests: Cache reader processes of the responder
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+
+/* Include source file directly to be able to attach fake readers */
+#include "responder/common/responder_cache_reader.c"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_responder_cache_reader_conf.ldb"
+#define TEST_DOM_NAME "responder_cache_reader_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define TEST_USER_NAME "test_reader_user"
+#define TEST_USER_UID 1000
+#define TEST_NUM_READERS 2
+
+enum test_reader_action {
+    TEST_READER_REPLY,
+    TEST_READER_DIE,
+    TEST_READER_HANG
+};
+
+struct cache_reader_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sss_cache_reader_pool *pool;
+    char *username;
+
+    /* reply of a well behaving reader */
+    uint8_t *reply;
+    size_t reply_len;
+
+    int pending;
+    errno_t error;
+    struct ldb_result *result;
+};
+
+static int test_cache_reader_setup(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+    struct ldb_result *res;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct cache_reader_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER, NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->username = sss_create_internal_fqname(test_ctx, TEST_USER_NAME,
+                                                    test_ctx->tctx->dom->name);
+    assert_non_null(test_ctx->username);
+
+    ret = sysdb_add_user(test_ctx->tctx->dom, test_ctx->username,
+                         TEST_USER_UID, 0, NULL, NULL, "/bin/sh", NULL,
+                         NULL, 300, time(NULL));
+    assert_int_equal(ret, EOK);
+
+    /* what a reader sends back for the user */
+    ret = sysdb_getpwnam_with_views(test_ctx, test_ctx->tctx->dom,
+                                    test_ctx->username, &res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(res->count, 1);
+
+    ret = sss_cache_reader_build_reply(test_ctx, EOK, test_ctx->tctx->dom,
+                                       res, &test_ctx->reply,
+                                       &test_ctx->reply_len);
+    assert_int_equal(ret, EOK);
+    talloc_free(res);
+
+    check_leaks_push(test_ctx);
+
+    /* the readers are attached by the tests */
+    test_ctx->pool = talloc_zero(test_ctx, struct sss_cache_reader_pool);
+    assert_non_null(test_ctx->pool);
+    test_ctx->pool->ev = test_ctx->tctx->ev;
+    test_ctx->pool->timeout = 1;
+    test_ctx->pool->readers = talloc_zero_array(test_ctx->pool,
+                                                struct sss_cache_reader *,
+                                                TEST_NUM_READERS);
+    assert_non_null(test_ctx->pool->readers);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_cache_reader_teardown(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+    size_t i;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_reader_test_ctx);
+
+    for (i = 0; i < test_ctx->pool->num_readers; i++) {
+        sss_cache_reader_stop(test_ctx->pool->readers[i], EIO);
+    }
+
+    talloc_zfree(test_ctx->pool);
+    talloc_zfree(test_ctx->result);
+    assert_true(check_leaks_pop(test_ctx));
+
+    talloc_zfree(test_ctx);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_reader_main(int fd,
+                             enum test_reader_action action,
+                             uint8_t *reply,
+                             size_t reply_len)
+{
+    uint8_t *body;
+    size_t len;
+    errno_t ret;
+
+    while (1) {
+        ret = sss_cache_reader_read_request(NULL, fd, &body, &len);
+        if (ret != EOK) {
+            _exit(0);
+        }
+        talloc_free(body);
+
+        switch (action) {
+        case TEST_READER_REPLY:
+            if (sss_atomic_write_s(fd, reply, reply_len) != reply_len) {
+                _exit(1);
+            }
+            break;
+        case TEST_READER_DIE:
+            _exit(1);
+        case TEST_READER_HANG:
+            while (1) {
+                pause();
+            }
+        }
+    }
+}
+
+static void test_reader_start(struct cache_reader_test_ctx *test_ctx,
+                              enum test_reader_action action,
+                              uint8_t *reply,
+                              size_t reply_len)
+{
+    struct sss_cache_reader_pool *pool = test_ctx->pool;
+    struct sss_cache_reader *reader;
+    int sv[2];
+    pid_t pid;
+    errno_t ret;
+
+    assert_true(pool->num_readers < TEST_NUM_READERS);
+
+    ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    assert_int_equal(ret, 0);
+
+    pid = fork();
+    assert_int_not_equal(pid, -1);
+
+    if (pid == 0) {
+        close(sv[0]);
+        test_reader_main(sv[1], action, reply, reply_len);
+        _exit(0);
+    }
+
+    close(sv[1]);
+
+    reader = talloc_zero(pool->readers, struct sss_cache_reader);
+    assert_non_null(reader);
+    reader->fd = -1;
+    pool->readers[pool->num_readers] = reader;
+    pool->num_readers++;
+
+    ret = sss_cache_reader_attach(pool, reader, pid, sv[0]);
+    assert_int_equal(ret, EOK);
+}
+
+static void test_search_done(struct tevent_req *req)
+{
+    struct cache_reader_test_ctx *test_ctx;
+
+    test_ctx = tevent_req_callback_data(req, struct cache_reader_test_ctx);
+
+    talloc_zfree(test_ctx->result);
+    test_ctx->error = sss_cache_reader_search_recv(test_ctx, req,
+                                                   &test_ctx->result);
+    talloc_free(req);
+
+    test_ctx->pending--;
+}
+
+static void test_search_send(struct cache_reader_test_ctx *test_ctx)
+{
+    struct tevent_req *req;
+
+    req = sss_cache_reader_search_send(test_ctx, test_ctx->tctx->ev,
+                                       test_ctx->pool, test_ctx->tctx->dom,
+                                       SSS_CACHE_READER_USER_BY_NAME,
+                                       test_ctx->username, 0);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_search_done, test_ctx);
+
+    test_ctx->pending++;
+}
+
+static errno_t test_search(struct cache_reader_test_ctx *test_ctx)
+{
+    test_search_send(test_ctx);
+
+    while (test_ctx->pending > 0) {
+        tevent_loop_once(test_ctx->tctx->ev);
+    }
+
+    return test_ctx->error;
+}
+
+static void assert_test_user(struct cache_reader_test_ctx *test_ctx)
+{
+    const char *name;
+
+    assert_non_null(test_ctx->result);
+    assert_int_equal(test_ctx->result->count, 1);
+
+    name = ldb_msg_find_attr_as_string(test_ctx->result->msgs[0],
+                                       SYSDB_NAME, NULL);
+    assert_non_null(name);
+    assert_string_equal(name, test_ctx->username);
+}
+
+void test_reader_reply(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_reader_test_ctx);
+
+    test_reader_start(test_ctx, TEST_READER_REPLY,
+                      test_ctx->reply, test_ctx->reply_len);
+
+    assert_int_equal(test_search(test_ctx), EOK);
+    assert_test_user(test_ctx);
+
+    /* the reader goes on with the next request */
+    assert_int_equal(test_search(test_ctx), EOK);
+    assert_test_user(test_ctx);
+    assert_int_equal(test_ctx->pool->num_alive, 1);
+}
+
+void test_reader_died(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_reader_test_ctx);
+
+    test_reader_start(test_ctx, TEST_READER_DIE, NULL, 0);
+
+    assert_int_equal(test_search(test_ctx), EIO);
+    assert_int_equal(test_ctx->pool->num_alive, 0);
+    assert_int_equal(test_ctx->pool->num_lost, 1);
+
+    /* without readers the caller has to search on its own */
+    assert_int_equal(test_search(test_ctx), EIO);
+}
+
+void test_reader_died_other_serves(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_reader_test_ctx);
+
+    test_reader_start(test_ctx, TEST_READER_DIE, NULL, 0);
+    test_reader_start(test_ctx, TEST_READER_REPLY,
+                      test_ctx->reply, test_ctx->reply_len);
+
+    /* the first request is sent to the dying reader */
+    test_search_send(test_ctx);
+    test_search_send(test_ctx);
+    while (test_ctx->pending > 0) {
+        tevent_loop_once(test_ctx->tctx->ev);
+    }
+
+    assert_int_equal(test_ctx->pool->num_alive, 1);
+    assert_int_equal(test_ctx->pool->num_lost, 1);
+
+    assert_int_equal(test_search(test_ctx), EOK);
+    assert_test_user(test_ctx);
+}
+
+void test_reader_timeout(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_reader_test_ctx);
+
+    test_reader_start(test_ctx, TEST_READER_HANG, NULL, 0);
+
+    assert_int_equal(test_search(test_ctx), ETIMEDOUT);
+
+    /* the stuck reader is killed */
+    assert_int_equal(test_ctx->pool->num_alive, 0);
+    assert_int_equal(test_ctx->pool->readers[0]->fd, -1);
+    assert_int_equal(kill(test_ctx->pool->readers[0]->pid, 0), -1);
+
+    assert_int_equal(test_search(test_ctx), EIO);
+}
+
+void test_reader_bad_length(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+    uint8_t reply[sizeof(uint32_t)];
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_reader_test_ctx);
+
+    /* shorter than the error and count fields */
+    SAFEALIGN_SETMEM_UINT32(reply, 1, NULL);
+    test_reader_start(test_ctx, TEST_READER_REPLY, reply, sizeof(reply));
+
+    assert_int_equal(test_search(test_ctx), EIO);
+    assert_int_equal(test_ctx->pool->num_alive, 0);
+}
+
+void test_reader_bad_ldif(void **state)
+{
+    struct cache_reader_test_ctx *test_ctx;
+    const char text[] = "garbage: value\n";
+    uint8_t reply[3 * sizeof(uint32_t) + sizeof(text)];
+    size_t pos = 0;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_reader_test_ctx);
+
+    SAFEALIGN_SETMEM_UINT32(reply + pos, sizeof(reply) - sizeof(uint32_t),
+                            &pos);
+    SAFEALIGN_SETMEM_UINT32(reply + pos, EOK, &pos);
+    SAFEALIGN_SETMEM_UINT32(reply + pos, 1, &pos);
+    memcpy(reply + pos, text, sizeof(text));
+
+    test_reader_start(test_ctx, TEST_READER_REPLY, reply, sizeof(reply));
+
+    assert_int_equal(test_search(test_ctx), EBADMSG);
+    assert_null(test_ctx->result);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_reader_reply,
+                                        test_cache_reader_setup,
+                                        test_cache_reader_teardown),
+        cmocka_unit_test_setup_teardown(test_reader_died,
+                                        test_cache_reader_setup,
+                                        test_cache_reader_teardown),
+        cmocka_unit_test_setup_teardown(test_reader_died_other_serves,
+                                        test_cache_reader_setup,
+                                        test_cache_reader_teardown),
+        cmocka_unit_test_setup_teardown(test_reader_timeout,
+                                        test_cache_reader_setup,
+                                        test_cache_reader_teardown),
+        cmocka_unit_test_setup_teardown(test_reader_bad_length,
+                                        test_cache_reader_setup,
+                                        test_cache_reader_teardown),
+        cmocka_unit_test_setup_teardown(test_reader_bad_ldif,
+                                        test_cache_reader_setup,
+                                        test_cache_reader_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+
+    return rv;
+}
@@ -569,6 +569,147 @@ void test_user_by_name_multiple_domains_notfound(void **state)
     assert_true(test_ctx->dp_called);
 }
 
+void test_user_by_name_parallel_domains_found(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+    struct sss_domain_info *domain = NULL;
+    struct sss_domain_info *first = NULL;
+    char *fqname;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+    test_ctx->rctx->parallel_domain_lookup = true;
+
+    /* Setup user. */
+    domain = find_domain_by_name(test_ctx->tctx->dom,
+                                 "responder_cache_req_test_d", true);
+    assert_non_null(domain);
+
+    prepare_user(domain, &users[0], 1000, time(NULL));
+
+    /* Mock values. */
+    will_return_always(__wrap_sss_dp_get_account_send, test_ctx);
+    will_return_always(sss_dp_get_account_recv, 0);
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+
+    /* Test. */
+    run_user_by_name(test_ctx, NULL, 0, ERR_OK);
+    assert_true(test_ctx->dp_called);
+    check_user(test_ctx, &users[0], domain);
+
+    /* The domains searched in parallel remember the negative answer. */
+    first = find_domain_by_name(test_ctx->tctx->dom,
+                                "responder_cache_req_test_a", true);
+    assert_non_null(first);
+
+    fqname = sss_create_internal_fqname(test_ctx, users[0].short_name,
+                                        first->name);
+    assert_non_null(fqname);
+
+    ret = sss_ncache_check_user(test_ctx->ncache, first, fqname);
+    talloc_free(fqname);
+    assert_int_equal(ret, EEXIST);
+}
+
+void test_user_by_name_parallel_domains_cached(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+    struct sss_domain_info *domain = NULL;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+    test_ctx->rctx->parallel_domain_lookup = true;
+
+    /* Setup user in the first domain. */
+    domain = find_domain_by_name(test_ctx->tctx->dom,
+                                 "responder_cache_req_test_a", true);
+    assert_non_null(domain);
+
+    prepare_user(domain, &users[0], 1000, time(NULL));
+
+    /* Mock values. */
+    /* DP should not be contacted in any domain */
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+
+    /* Test. */
+    run_user_by_name(test_ctx, NULL, 0, ERR_OK);
+    assert_false(test_ctx->dp_called);
+    check_user(test_ctx, &users[0], domain);
+}
+
+void test_user_by_name_parallel_domains_order(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+    struct sss_domain_info *domain = NULL;
+    struct sss_domain_info *first = NULL;
+    struct sss_domain_info *last = NULL;
+    char *fqname;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+    test_ctx->rctx->parallel_domain_lookup = true;
+
+    /* Setup user in two domains, the first one must win. */
+    domain = find_domain_by_name(test_ctx->tctx->dom,
+                                 "responder_cache_req_test_b", true);
+    assert_non_null(domain);
+
+    last = find_domain_by_name(test_ctx->tctx->dom,
+                               "responder_cache_req_test_d", true);
+    assert_non_null(last);
+
+    prepare_user(domain, &users[0], 1000, time(NULL));
+    prepare_user(last, &users[0], 1000, time(NULL));
+
+    /* Mock values. */
+    will_return_always(__wrap_sss_dp_get_account_send, test_ctx);
+    will_return_always(sss_dp_get_account_recv, 0);
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+
+    /* Test. */
+    run_user_by_name(test_ctx, NULL, 0, ERR_OK);
+    assert_true(test_ctx->dp_called);
+    check_user(test_ctx, &users[0], domain);
+
+    /* Only the domain that precedes the cached entry was asked, its
+     * negative answer is remembered. */
+    first = find_domain_by_name(test_ctx->tctx->dom,
+                                "responder_cache_req_test_a", true);
+    assert_non_null(first);
+
+    fqname = sss_create_internal_fqname(test_ctx, users[0].short_name,
+                                        first->name);
+    assert_non_null(fqname);
+
+    ret = sss_ncache_check_user(test_ctx->ncache, first, fqname);
+    talloc_free(fqname);
+    assert_int_equal(ret, EEXIST);
+
+    fqname = sss_create_internal_fqname(test_ctx, users[0].short_name,
+                                        last->name);
+    assert_non_null(fqname);
+
+    ret = sss_ncache_check_user(test_ctx->ncache, last, fqname);
+    talloc_free(fqname);
+    assert_int_equal(ret, ENOENT);
+}
+
+void test_user_by_name_parallel_domains_notfound(void **state)
+{
+    struct cache_req_test_ctx *test_ctx = NULL;
+
+    test_ctx = talloc_get_type_abort(*state, struct cache_req_test_ctx);
+    test_ctx->rctx->parallel_domain_lookup = true;
+
+    /* Mock values. */
+    will_return_always(__wrap_sss_dp_get_account_send, test_ctx);
+    will_return_always(sss_dp_get_account_recv, 0);
+    mock_parse_inp(users[0].short_name, NULL, ERR_OK);
+
+    /* Test. */
+    run_user_by_name(test_ctx, NULL, 0, ENOENT);
+    assert_true(test_ctx->dp_called);
+}
+
 void test_user_by_name_multiple_domains_parse(void **state)
 {
     struct cache_req_test_ctx *test_ctx = NULL;
@@ -2130,6 +2271,10 @@ int main(int argc, const char *argv[])
         new_multi_domain_test(user_by_name_multiple_domains_found),
         new_multi_domain_test(user_by_name_multiple_domains_notfound),
         new_multi_domain_test(user_by_name_multiple_domains_parse),
+        new_multi_domain_test(user_by_name_parallel_domains_found),
+        new_multi_domain_test(user_by_name_parallel_domains_cached),
+        new_multi_domain_test(user_by_name_parallel_domains_order),
+        new_multi_domain_test(user_by_name_parallel_domains_notfound),
 
         new_single_domain_test(user_by_upn_cache_valid),
         new_single_domain_test(user_by_upn_cache_expired),
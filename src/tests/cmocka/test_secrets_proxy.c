@@ -0,0 +1,429 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests: Connection pool of the secrets proxy provider
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* In order to access the static functions and structures */
+#include "responder/secrets/proxy.c"
+
+#include "tests/cmocka/common_mock.h"
+
+#define TEST_REPLY "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"
+
+struct test_server {
+    int fd;
+    int port;
+    struct tevent_fd *fde;
+
+    int accepted;
+    int requests;
+    /* the connection is closed instead of answering this request */
+    int drop_request;
+};
+
+struct test_server_conn {
+    struct test_server *srv;
+    int fd;
+    struct tevent_fd *fde;
+    char buf[1024];
+    size_t len;
+};
+
+struct proxy_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct proxy_context *pctx;
+    struct test_server *srv;
+};
+
+static int test_server_conn_destructor(struct test_server_conn *conn)
+{
+    talloc_zfree(conn->fde);
+    close(conn->fd);
+    return 0;
+}
+
+static void test_server_conn_handler(struct tevent_context *ev,
+                                     struct tevent_fd *fde,
+                                     uint16_t flags, void *pvt)
+{
+    struct test_server_conn *conn;
+    char *end;
+    ssize_t len;
+
+    conn = talloc_get_type(pvt, struct test_server_conn);
+
+    len = read(conn->fd, conn->buf + conn->len,
+               sizeof(conn->buf) - conn->len - 1);
+    if (len <= 0) {
+        talloc_free(conn);
+        return;
+    }
+    conn->len += len;
+    conn->buf[conn->len] = '\0';
+
+    /* requests of the tests do not carry a body */
+    while ((end = strstr(conn->buf, "\r\n\r\n")) != NULL) {
+        end += 4;
+        conn->len -= end - conn->buf;
+        memmove(conn->buf, end, conn->len + 1);
+
+        conn->srv->requests++;
+        if (conn->srv->requests == conn->srv->drop_request) {
+            talloc_free(conn);
+            return;
+        }
+
+        len = write(conn->fd, TEST_REPLY, sizeof(TEST_REPLY) - 1);
+        assert_int_equal(len, sizeof(TEST_REPLY) - 1);
+    }
+}
+
+static void test_server_accept(struct tevent_context *ev,
+                               struct tevent_fd *fde,
+                               uint16_t flags, void *pvt)
+{
+    struct test_server *srv;
+    struct test_server_conn *conn;
+
+    srv = talloc_get_type(pvt, struct test_server);
+
+    conn = talloc_zero(srv, struct test_server_conn);
+    assert_non_null(conn);
+
+    conn->srv = srv;
+    conn->fd = accept(srv->fd, NULL, NULL);
+    assert_true(conn->fd >= 0);
+    talloc_set_destructor(conn, test_server_conn_destructor);
+
+    conn->fde = tevent_add_fd(ev, conn, conn->fd, TEVENT_FD_READ,
+                              test_server_conn_handler, conn);
+    assert_non_null(conn->fde);
+
+    srv->accepted++;
+}
+
+static int test_server_destructor(struct test_server *srv)
+{
+    talloc_zfree(srv->fde);
+    close(srv->fd);
+    return 0;
+}
+
+static struct test_server *test_server_new(TALLOC_CTX *mem_ctx,
+                                           struct tevent_context *ev)
+{
+    struct test_server *srv;
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    int ret;
+
+    srv = talloc_zero(mem_ctx, struct test_server);
+    assert_non_null(srv);
+
+    srv->fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert_true(srv->fd >= 0);
+    talloc_set_destructor(srv, test_server_destructor);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    ret = bind(srv->fd, (struct sockaddr *) &addr, sizeof(addr));
+    assert_int_equal(ret, 0);
+
+    ret = listen(srv->fd, 5);
+    assert_int_equal(ret, 0);
+
+    ret = getsockname(srv->fd, (struct sockaddr *) &addr, &addrlen);
+    assert_int_equal(ret, 0);
+    srv->port = ntohs(addr.sin_port);
+
+    srv->fde = tevent_add_fd(ev, srv, srv->fd, TEVENT_FD_READ,
+                             test_server_accept, srv);
+    assert_non_null(srv->fde);
+
+    return srv;
+}
+
+static int test_proxy_setup(void **state)
+{
+    struct proxy_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct proxy_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_ev_test_ctx(test_ctx);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->pctx = talloc_zero(test_ctx, struct proxy_context);
+    assert_non_null(test_ctx->pctx);
+
+    ret = resolv_init(test_ctx->pctx, test_ctx->tctx->ev, 5,
+                      &test_ctx->pctx->resctx);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->pctx->max_conns = 2;
+    test_ctx->pctx->idle_timeout = 30;
+    test_ctx->pctx->max_payload_size = 1024;
+
+    test_ctx->srv = test_server_new(test_ctx, test_ctx->tctx->ev);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_proxy_teardown(void **state)
+{
+    struct proxy_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_test_ctx);
+
+    talloc_zfree(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_request_done(struct tevent_req *req)
+{
+    struct proxy_test_ctx *test_ctx;
+    struct proxy_http_reply *reply;
+    errno_t ret;
+
+    test_ctx = tevent_req_callback_data(req, struct proxy_test_ctx);
+
+    ret = proxy_http_req_recv(req, test_ctx, &reply);
+    talloc_free(req);
+    if (ret == EOK) {
+        assert_int_equal(reply->status_code, 200);
+        assert_int_equal(reply->body.length, 2);
+        talloc_free(reply);
+    }
+
+    test_ev_done(test_ctx->tctx, ret);
+}
+
+static errno_t test_request(struct proxy_test_ctx *test_ctx,
+                            enum http_method method)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sec_req_ctx *secreq;
+    struct sec_msg *msg;
+    struct tevent_req *req;
+    char *uri;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(test_ctx);
+    assert_non_null(tmp_ctx);
+
+    secreq = talloc_zero(tmp_ctx, struct sec_req_ctx);
+    assert_non_null(secreq);
+    secreq->method = method;
+
+    msg = talloc_zero(tmp_ctx, struct sec_msg);
+    assert_non_null(msg);
+    msg->head.data = talloc_asprintf(msg, "%s /secrets/test HTTP/1.1\r\n"
+                                     "Host: 127.0.0.1\r\n"
+                                     "Content-Length: 0\r\n\r\n",
+                                     http_method_str(method));
+    assert_non_null(msg->head.data);
+    msg->head.length = strlen(msg->head.data);
+
+    uri = talloc_asprintf(tmp_ctx, "http://127.0.0.1:%d/secrets/test",
+                          test_ctx->srv->port);
+    assert_non_null(uri);
+
+    req = proxy_http_req_send(test_ctx->pctx, tmp_ctx, test_ctx->tctx->ev,
+                              secreq, uri, msg);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_request_done, test_ctx);
+
+    test_ctx->tctx->done = false;
+    ret = test_ev_loop(test_ctx->tctx);
+
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+void test_connection_reused(void **state)
+{
+    struct proxy_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_test_ctx);
+
+    assert_int_equal(test_request(test_ctx, HTTP_GET), EOK);
+    assert_int_equal(test_request(test_ctx, HTTP_PUT), EOK);
+    assert_int_equal(test_request(test_ctx, HTTP_GET), EOK);
+
+    assert_int_equal(test_ctx->srv->requests, 3);
+    assert_int_equal(test_ctx->srv->accepted, 1);
+}
+
+void test_connection_not_reused(void **state)
+{
+    struct proxy_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_test_ctx);
+
+    test_ctx->pctx->idle_timeout = 0;
+
+    assert_int_equal(test_request(test_ctx, HTTP_GET), EOK);
+    assert_int_equal(test_request(test_ctx, HTTP_GET), EOK);
+
+    assert_int_equal(test_ctx->srv->accepted, 2);
+}
+
+void test_dropped_get_retried(void **state)
+{
+    struct proxy_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_test_ctx);
+
+    test_ctx->srv->drop_request = 2;
+
+    assert_int_equal(test_request(test_ctx, HTTP_GET), EOK);
+    assert_int_equal(test_request(test_ctx, HTTP_GET), EOK);
+
+    /* the dropped request was sent again on a new connection */
+    assert_int_equal(test_ctx->srv->requests, 3);
+    assert_int_equal(test_ctx->srv->accepted, 2);
+}
+
+void test_dropped_put_not_retried(void **state)
+{
+    struct proxy_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_test_ctx);
+
+    test_ctx->srv->drop_request = 2;
+
+    assert_int_equal(test_request(test_ctx, HTTP_GET), EOK);
+    assert_int_equal(test_request(test_ctx, HTTP_PUT), EIO);
+
+    /* the server may have stored the secret, it must not be sent twice */
+    assert_int_equal(test_ctx->srv->requests, 2);
+    assert_int_equal(test_ctx->srv->accepted, 1);
+}
+
+void test_may_retry(void **state)
+{
+    struct proxy_http_req_state *rs;
+    struct sec_msg *msg;
+
+    rs = talloc_zero(NULL, struct proxy_http_req_state);
+    assert_non_null(rs);
+    msg = talloc_zero(rs, struct sec_msg);
+    assert_non_null(msg);
+
+    msg->head.data = discard_const("PUT / HTTP/1.1\r\n\r\n");
+    msg->head.length = strlen(msg->head.data);
+    rs->request.msg = msg;
+    rs->request.method = HTTP_PUT;
+
+    /* nothing was written on a reused connection yet */
+    rs->request.pending = *msg;
+    rs->reused = true;
+    assert_true(proxy_http_req_may_retry(rs));
+
+    /* a new connection, or one that already failed once */
+    rs->reused = false;
+    assert_false(proxy_http_req_may_retry(rs));
+    rs->reused = true;
+    rs->retried = true;
+    assert_false(proxy_http_req_may_retry(rs));
+    rs->retried = false;
+
+    /* part of the reply arrived */
+    rs->got_data = true;
+    assert_false(proxy_http_req_may_retry(rs));
+    rs->got_data = false;
+
+    /* the request was written, only idempotent ones are repeated */
+    rs->request.pending.head.data += 4;
+    rs->request.pending.head.length -= 4;
+    assert_false(proxy_http_req_may_retry(rs));
+
+    rs->request.method = HTTP_POST;
+    assert_false(proxy_http_req_may_retry(rs));
+    rs->request.method = HTTP_DELETE;
+    assert_false(proxy_http_req_may_retry(rs));
+    rs->request.method = HTTP_GET;
+    assert_true(proxy_http_req_may_retry(rs));
+
+    talloc_free(rs);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_may_retry),
+        cmocka_unit_test_setup_teardown(test_connection_reused,
+                                        test_proxy_setup,
+                                        test_proxy_teardown),
+        cmocka_unit_test_setup_teardown(test_connection_not_reused,
+                                        test_proxy_setup,
+                                        test_proxy_teardown),
+        cmocka_unit_test_setup_teardown(test_dropped_get_retried,
+                                        test_proxy_setup,
+                                        test_proxy_teardown),
+        cmocka_unit_test_setup_teardown(test_dropped_put_not_retried,
+                                        test_proxy_setup,
+                                        test_proxy_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* the server side of the tests closes connections */
+    signal(SIGPIPE, SIG_IGN);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -348,6 +348,80 @@ void test_map_id(void **state)
     sss_idmap_free_sid(test_ctx->idmap_ctx, sid);
 }
 
+void test_map_id_bulk(void **state)
+{
+    struct test_ctx *test_ctx;
+    enum idmap_error_code err;
+    size_t num_mapped;
+    const char *sids[] = { TEST_DOM_SID"-0",
+                           TEST_DOM_SID"-"TEST_OFFSET_STR,
+                           TEST_DOM_SID"-400000",
+                           TEST_DOM_SID"-1",
+                           "S-1-5-32-544",
+                           TEST_2_DOM_SID"-0" };
+    uint32_t ids[sizeof(sids) / sizeof(sids[0])];
+    enum idmap_error_code errs[sizeof(sids) / sizeof(sids[0])];
+    char *out_sids[sizeof(sids) / sizeof(sids[0])];
+    size_t count = sizeof(sids) / sizeof(sids[0]);
+    size_t c;
+
+    test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    assert_non_null(test_ctx);
+
+    err = sss_idmap_sids_to_unix(test_ctx->idmap_ctx, NULL, count, ids, errs,
+                                 NULL);
+    assert_int_equal(err, IDMAP_ERROR);
+
+    err = sss_idmap_sids_to_unix(NULL, sids, count, ids, errs, NULL);
+    assert_int_equal(err, IDMAP_CONTEXT_INVALID);
+
+    err = sss_idmap_sids_to_unix(test_ctx->idmap_ctx, sids, count, ids, errs,
+                                 &num_mapped);
+    assert_int_equal(err, IDMAP_SUCCESS);
+    assert_int_equal(num_mapped, 3);
+
+    assert_int_equal(errs[0], IDMAP_SUCCESS);
+    assert_int_equal(ids[0], TEST_RANGE_MIN);
+    assert_int_equal(errs[1], IDMAP_SUCCESS);
+    assert_int_equal(ids[1], TEST_RANGE_MIN + TEST_OFFSET);
+    assert_int_equal(errs[2], IDMAP_NO_RANGE);
+    assert_int_equal(errs[3], IDMAP_SUCCESS);
+    assert_int_equal(ids[3], TEST_RANGE_MIN + 1);
+    assert_int_equal(errs[4], IDMAP_BUILTIN_SID);
+    assert_int_equal(errs[5], IDMAP_NO_DOMAIN);
+
+    /* the results must not differ from the single SID calls */
+    for (c = 0; c < count; c++) {
+        uint32_t id;
+
+        err = sss_idmap_sid_to_unix(test_ctx->idmap_ctx, sids[c], &id);
+        assert_int_equal(err, errs[c]);
+        if (err == IDMAP_SUCCESS) {
+            assert_int_equal(id, ids[c]);
+        }
+    }
+
+    ids[2] = TEST_OFFSET - 1;
+    err = sss_idmap_unix_to_sids(test_ctx->idmap_ctx, ids, 4, out_sids, errs,
+                                 &num_mapped);
+    assert_int_equal(err, IDMAP_SUCCESS);
+    assert_int_equal(num_mapped, 3);
+
+    assert_int_equal(errs[0], IDMAP_SUCCESS);
+    assert_string_equal(out_sids[0], sids[0]);
+    assert_int_equal(errs[1], IDMAP_SUCCESS);
+    assert_string_equal(out_sids[1], sids[1]);
+    assert_int_equal(errs[2], IDMAP_NO_DOMAIN);
+    assert_null(out_sids[2]);
+    assert_int_equal(errs[3], IDMAP_SUCCESS);
+    assert_string_equal(out_sids[3], sids[3]);
+
+    for (c = 0; c < 4; c++) {
+        sss_idmap_free_sid(test_ctx->idmap_ctx, out_sids[c]);
+    }
+}
+
 /* https://fedorahosted.org/sssd/ticket/2922 */
 /* ID mapping - bug in computing max id for slice range */
 void test_map_id_2922(void **state)
@@ -691,6 +765,9 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_map_id,
                                         test_sss_idmap_setup_with_domains,
                                         test_sss_idmap_teardown),
+        cmocka_unit_test_setup_teardown(test_map_id_bulk,
+                                        test_sss_idmap_setup_with_domains,
+                                        test_sss_idmap_teardown),
         cmocka_unit_test_setup_teardown(test_map_id_2922,
                                         test_sss_idmap_setup_with_domains_2922,
                                         test_sss_idmap_teardown),
@@ -0,0 +1,369 @@
+/*
+    Copyright (C) 2016 Red Hat
+
+    SSSD tests: Packed responses of the sudo rules index
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <popt.h>
+#include <talloc.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "db/sysdb_sudo.h"
+#include "responder/sudo/sudosrv_private.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_sudo_rules_index_conf.ldb"
+#define TEST_DOM_NAME "sudo_rules_index_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define TEST_USER_NAME "test_sudo_user"
+#define TEST_USER_UID 1001
+#define TEST_GROUP_NAME "test_sudo_group"
+#define TEST_GROUP_GID 2001
+
+#define TEST_BODY "packed response"
+
+struct sudo_index_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sudo_ctx *sudo_ctx;
+    char *username;
+    char *groupname;
+};
+
+static void set_initgr_expire(struct sudo_index_test_ctx *test_ctx,
+                              time_t expire)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+
+    ret = sysdb_attrs_add_time_t(attrs, SYSDB_INITGR_EXPIRE, expire);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_set_user_attr(test_ctx->tctx->dom, test_ctx->username,
+                              attrs, SYSDB_MOD_REP);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(attrs);
+}
+
+static int test_sudo_index_setup(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    struct sudosrv_rules_index *idx;
+    struct sss_domain_info *dom;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(global_talloc_context, struct sudo_index_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER, NULL);
+    assert_non_null(test_ctx->tctx);
+    dom = test_ctx->tctx->dom;
+
+    test_ctx->username = sss_create_internal_fqname(test_ctx, TEST_USER_NAME,
+                                                    dom->name);
+    assert_non_null(test_ctx->username);
+
+    test_ctx->groupname = sss_create_internal_fqname(test_ctx,
+                                                     TEST_GROUP_NAME,
+                                                     dom->name);
+    assert_non_null(test_ctx->groupname);
+
+    ret = sysdb_add_user(dom, test_ctx->username, TEST_USER_UID, 0, NULL,
+                         NULL, "/bin/sh", NULL, NULL, 300, time(NULL));
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_group(dom, test_ctx->groupname, TEST_GROUP_GID,
+                          NULL, 300, time(NULL));
+    assert_int_equal(ret, EOK);
+
+    set_initgr_expire(test_ctx, time(NULL) + 300);
+
+    ret = sysdb_sudo_bump_rules_generation(dom);
+    assert_int_equal(ret, EOK);
+
+    check_leaks_push(test_ctx);
+
+    /* the index and its packed responses are freed in teardown */
+    test_ctx->sudo_ctx = talloc_zero(test_ctx, struct sudo_ctx);
+    assert_non_null(test_ctx->sudo_ctx);
+
+    test_ctx->sudo_ctx->rctx = talloc_zero(test_ctx->sudo_ctx,
+                                           struct resp_ctx);
+    assert_non_null(test_ctx->sudo_ctx->rctx);
+    test_ctx->sudo_ctx->rctx->domains = dom;
+
+    /* packed responses are stored only in an existing index */
+    ret = sudosrv_rules_index_get(test_ctx->sudo_ctx, dom, &idx);
+    assert_int_equal(ret, EOK);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_sudo_index_teardown(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    talloc_zfree(test_ctx->sudo_ctx);
+    assert_true(check_leaks_pop(test_ctx));
+    talloc_zfree(test_ctx);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void store_response(struct sudo_index_test_ctx *test_ctx)
+{
+    struct sudosrv_user_stamp *user;
+    errno_t ret;
+
+    ret = sudosrv_user_stamp_get(test_ctx, test_ctx->tctx->dom,
+                                 test_ctx->username, &user);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_rules_index_set_response(test_ctx->sudo_ctx,
+                                           test_ctx->tctx->dom,
+                                           SSS_SUDO_USER, TEST_USER_UID,
+                                           TEST_USER_NAME, user,
+                                           discard_const(TEST_BODY),
+                                           sizeof(TEST_BODY),
+                                           time(NULL) + 300);
+    assert_int_equal(ret, EOK);
+}
+
+static errno_t lookup_response(struct sudo_index_test_ctx *test_ctx)
+{
+    uint8_t *body = NULL;
+    size_t len = 0;
+    errno_t ret;
+
+    ret = sudosrv_rules_index_get_response(test_ctx->sudo_ctx,
+                                           SSS_SUDO_USER, TEST_USER_UID,
+                                           TEST_USER_NAME, &body, &len);
+    if (ret == EOK) {
+        assert_int_equal(len, sizeof(TEST_BODY));
+        assert_memory_equal(body, TEST_BODY, len);
+    }
+
+    return ret;
+}
+
+void test_response_reused(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    assert_int_equal(lookup_response(test_ctx), ENOENT);
+
+    store_response(test_ctx);
+
+    assert_int_equal(lookup_response(test_ctx), EOK);
+    assert_int_equal(lookup_response(test_ctx), EOK);
+}
+
+void test_response_user_invalidated(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    struct ldb_message *msg;
+    const char *attrs[] = { SYSDB_NAME, NULL };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    store_response(test_ctx);
+    assert_int_equal(lookup_response(test_ctx), EOK);
+
+    /* what sss_cache -u does */
+    ret = sysdb_search_user_by_name(test_ctx, test_ctx->tctx->dom,
+                                    test_ctx->username, attrs, &msg);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_invalidate_cache_entries(test_ctx->tctx->dom, &msg, 1, true);
+    assert_int_equal(ret, EOK);
+    talloc_free(msg);
+
+    assert_int_equal(lookup_response(test_ctx), ENOENT);
+}
+
+void test_response_initgr_refreshed(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    store_response(test_ctx);
+    assert_int_equal(lookup_response(test_ctx), EOK);
+
+    /* initgroups refresh stores a new expiration timestamp */
+    set_initgr_expire(test_ctx, time(NULL) + 600);
+
+    assert_int_equal(lookup_response(test_ctx), ENOENT);
+}
+
+void test_response_groups_changed(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    store_response(test_ctx);
+    assert_int_equal(lookup_response(test_ctx), EOK);
+
+    /* a group refresh adds the user without touching the user entry's
+     * initgroups timestamp */
+    ret = sysdb_add_group_member(test_ctx->tctx->dom, test_ctx->groupname,
+                                 test_ctx->username, SYSDB_MEMBER_USER, false);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(lookup_response(test_ctx), ENOENT);
+
+    /* a response built with the new membership is reused again */
+    store_response(test_ctx);
+    assert_int_equal(lookup_response(test_ctx), EOK);
+
+    ret = sysdb_remove_group_member(test_ctx->tctx->dom, test_ctx->groupname,
+                                    test_ctx->username, SYSDB_MEMBER_USER,
+                                    false);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(lookup_response(test_ctx), ENOENT);
+}
+
+void test_rules_never_expire(void **state)
+{
+    struct sudo_index_test_ctx *test_ctx;
+    struct sudosrv_rules_index *idx;
+    struct sysdb_attrs **rules;
+    struct sysdb_attrs *rule;
+    uint32_t num_rules;
+    time_t expire;
+    time_t max_expire;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudo_index_test_ctx);
+
+    rule = sysdb_new_attrs(test_ctx);
+    assert_non_null(rule);
+
+    ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_CN, "never");
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_USER, "ALL");
+    assert_int_equal(ret, EOK);
+
+    /* entry_cache_sudo_timeout = 0 stores the rule with expiration 0 */
+    test_ctx->tctx->dom->sudo_timeout = 0;
+    ret = sysdb_sudo_store(test_ctx->tctx->dom, &rule, 1);
+    assert_int_equal(ret, EOK);
+    talloc_free(rule);
+
+    ret = sysdb_sudo_bump_rules_generation(test_ctx->tctx->dom);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_rules_index_get(test_ctx->sudo_ctx, test_ctx->tctx->dom,
+                                  &idx);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_rules_index_expired(test_ctx, idx, TEST_USER_UID,
+                                      TEST_USER_NAME, NULL,
+                                      &rules, &num_rules);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_rules, 0);
+    talloc_free(rules);
+
+    max_expire = time(NULL) + 300;
+    expire = max_expire;
+    ret = sudosrv_rules_index_lookup(test_ctx, idx, TEST_USER_UID,
+                                     TEST_USER_NAME, NULL,
+                                     &rules, &num_rules, &expire);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(num_rules, 1);
+    assert_int_equal(expire, max_expire);
+    talloc_free(rules);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_response_reused,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+        cmocka_unit_test_setup_teardown(test_response_user_invalidated,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+        cmocka_unit_test_setup_teardown(test_response_initgr_refreshed,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+        cmocka_unit_test_setup_teardown(test_response_groups_changed,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+        cmocka_unit_test_setup_teardown(test_rules_never_expire,
+                                        test_sudo_index_setup,
+                                        test_sudo_index_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+
+    return rv;
+}
@@ -283,6 +283,42 @@ void test_sudo_set_get_last_full_refresh(void **state)
     assert_int_equal(now, loaded_time);
 }
 
+void test_sudo_bump_rules_generation(void **state)
+{
+    errno_t ret;
+    uint64_t first;
+    uint64_t second;
+    uint64_t third;
+    struct sysdb_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                         struct sysdb_test_ctx);
+
+    ret = sysdb_sudo_get_rules_generation(test_ctx->tctx->dom, &first);
+    assert_int_equal(ret, EOK);
+    assert_true(first == 0);
+
+    ret = sysdb_sudo_bump_rules_generation(test_ctx->tctx->dom);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_get_rules_generation(test_ctx->tctx->dom, &second);
+    assert_int_equal(ret, EOK);
+    assert_true(second > first);
+
+    /* unrelated attributes of the container must not change it */
+    ret = sysdb_sudo_set_last_full_refresh(test_ctx->tctx->dom, time(NULL));
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_get_rules_generation(test_ctx->tctx->dom, &third);
+    assert_int_equal(ret, EOK);
+    assert_true(third == second);
+
+    ret = sysdb_sudo_bump_rules_generation(test_ctx->tctx->dom);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_get_rules_generation(test_ctx->tctx->dom, &third);
+    assert_int_equal(ret, EOK);
+    assert_true(third > second);
+}
+
 void test_get_sudo_user_info(void **state)
 {
     errno_t ret;
@@ -666,6 +702,14 @@ int main(int argc, const char *argv[])
                                         test_sysdb_setup,
                                         test_sysdb_teardown),
 
+        /*
+         * sysdb_sudo_bump_rules_generation()
+         * sysdb_sudo_get_rules_generation()
+         */
+        cmocka_unit_test_setup_teardown(test_sudo_bump_rules_generation,
+                                        test_sysdb_setup,
+                                        test_sysdb_teardown),
+
         /* sysdb_get_sudo_user_info() */
         cmocka_unit_test_setup_teardown(test_get_sudo_user_info,
                                         test_sysdb_setup,
@@ -26,6 +26,7 @@
 
 #include "tests/cmocka/common_mock.h"
 #include "util/sss_nss.h"
+#include "util/sss_metrics.h"
 #include "test_utils.h"
 
 #define TESTS_PATH "tp_" BASE_FILE_STEM
@@ -1861,6 +1862,42 @@ static void test_is_email_from_domain(void **state)
     assert_true(is_email_from_domain("hello@NaMe_0.DoM", d));
 }
 
+static void test_sss_metrics(void **state)
+{
+    TALLOC_CTX *tmp_ctx;
+    char *text;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    assert_non_null(tmp_ctx);
+
+    sss_metrics_reset();
+
+    ret = sss_metrics_dump(tmp_ctx, "test", &text);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(text, "");
+
+    sss_metrics_inc("cache", "hit");
+    sss_metrics_inc("cache", "hit");
+    sss_metrics_add_usec("cmd", "SSS_NSS_GETPWNAM", 50);
+    sss_metrics_add_usec("cmd", "SSS_NSS_GETPWNAM", 2000);
+    sss_metrics_add_usec("cmd", "SSS_NSS_GETPWNAM", 20000000);
+
+    ret = sss_metrics_dump(tmp_ctx, "test", &text);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(text,
+        "test cache.hit 2 0 0 0 0 0 0 0 0 0\n"
+        "test cmd.SSS_NSS_GETPWNAM 3 20002050 20000000 1 0 1 0 0 0 1\n");
+
+    sss_metrics_reset();
+
+    ret = sss_metrics_dump(tmp_ctx, "test", &text);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(text, "");
+
+    talloc_free(tmp_ctx);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -1957,6 +1994,7 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sss_get_domain_mappings_content,
                                         setup_dom_list_with_subdomains,
                                         teardown_dom_list),
+        cmocka_unit_test(test_sss_metrics),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
@@ -651,6 +651,77 @@ START_TEST(test_debug_is_set_false)
 }
 END_TEST
 
+START_TEST(test_debug_backtrace)
+{
+    char filename[24] = {'\0'};
+    char buf[1024];
+    char *expected;
+    size_t len;
+    mode_t old_umask;
+    FILE *file;
+    int fd;
+    int ret;
+
+    strncpy(filename, "sssd_debug_tests.XXXXXX", 24);
+
+    old_umask = umask(SSS_DFL_UMASK);
+    fd = mkstemp(filename);
+    umask(old_umask);
+    fail_if(fd == -1, "mkstemp failed");
+
+    file = fdopen(fd, "r");
+    fail_if(file == NULL, "fdopen failed");
+
+    ret = set_debug_file_from_fd(fd);
+    fail_unless(ret == EOK, "set_debug_file_from_fd failed");
+
+    debug_timestamps = 0;
+    debug_microseconds = 0;
+    debug_to_file = 1;
+    debug_prg_name = "sssd";
+    debug_level = SSSDBG_FATAL_FAILURE | SSSDBG_CRIT_FAILURE;
+    debug_backtrace = 1;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "hidden\n");
+
+    rewind(file);
+    len = fread(buf, 1, sizeof(buf) - 1, file);
+    fail_unless(len == 0, "Message below the debug level was written");
+
+    DEBUG(SSSDBG_CRIT_FAILURE, "failure\n");
+
+    rewind(file);
+    len = fread(buf, 1, sizeof(buf) - 1, file);
+    buf[len] = '\0';
+
+    expected = talloc_asprintf(NULL,
+                    "   *  ... messages not logged because of the debug level:\n"
+                    "[sssd] [%s] (%#.4x): hidden\n"
+                    "   *  ... end of messages not logged\n"
+                    "[sssd] [%s] (%#.4x): failure\n",
+                    __FUNCTION__, SSSDBG_TRACE_FUNC,
+                    __FUNCTION__, SSSDBG_CRIT_FAILURE);
+    fail_if(expected == NULL, "talloc_asprintf failed");
+    fail_unless(strcmp(buf, expected) == 0,
+                "Unexpected output [%s]", buf);
+
+    /* the backtrace is written only once */
+    DEBUG(SSSDBG_CRIT_FAILURE, "failure\n");
+    rewind(file);
+    len = fread(buf, 1, sizeof(buf) - 1, file);
+    buf[len] = '\0';
+    fail_unless(strncmp(buf, expected, strlen(expected)) == 0,
+                "Unexpected output [%s]", buf);
+    fail_unless(strstr(buf + strlen(expected), "hidden") == NULL,
+                "Backtrace written twice");
+
+    debug_backtrace = 0;
+    talloc_free(expected);
+    fclose(file);
+    remove(filename);
+}
+END_TEST
+
 Suite *debug_suite(void)
 {
     Suite *s = suite_create("debug");
@@ -667,6 +738,7 @@ Suite *debug_suite(void)
     tcase_add_test(tc_debug, test_debug_is_notset_timestamp_microseconds);
     tcase_add_test(tc_debug, test_debug_is_set_true);
     tcase_add_test(tc_debug, test_debug_is_set_false);
+    tcase_add_test(tc_debug, test_debug_backtrace);
     tcase_set_timeout(tc_debug, 60);
 
     suite_add_tcase(s, tc_debug);
@@ -58,7 +58,7 @@ struct task {
 };
 
 static struct test_ctx *
-setup_test(void)
+setup_test_ext(int latency_probe_interval)
 {
     struct test_ctx *ctx;
     struct fo_options fopts;
@@ -82,6 +82,7 @@ setup_test(void)
     memset(&fopts, 0, sizeof(fopts));
     fopts.retry_timeout = 30;
     fopts.family_order  = IPV4_FIRST;
+    fopts.latency_probe_interval = latency_probe_interval;
 
     ctx->fo_ctx = fo_context_init(ctx, &fopts);
     if (ctx->fo_ctx == NULL) {
@@ -92,6 +93,12 @@ setup_test(void)
     return ctx;
 }
 
+static struct test_ctx *
+setup_test(void)
+{
+    return setup_test_ext(0);
+}
+
 static void
 test_loop(struct test_ctx *data)
 {
@@ -268,6 +275,118 @@ START_TEST(test_fo_resolve_service)
 }
 END_TEST
 
+struct latency_task {
+    struct test_ctx *test_ctx;
+    struct fo_server *server;
+};
+
+static void
+test_latency_callback(struct tevent_req *req)
+{
+    struct latency_task *task;
+    int ret;
+
+    task = tevent_req_callback_data(req, struct latency_task);
+
+    task->test_ctx->tasks--;
+
+    ret = fo_resolve_service_recv(req, req, &task->server);
+    talloc_free(req);
+    fail_if(ret != EOK, "fo_resolve_service_recv() failed: %d", ret);
+}
+
+static struct fo_server *
+resolve_server(struct test_ctx *test_ctx, struct fo_service *service)
+{
+    struct tevent_req *req;
+    struct latency_task task = { test_ctx, NULL };
+
+    test_ctx->tasks++;
+    req = fo_resolve_service_send(test_ctx, test_ctx->ev,
+                                  test_ctx->resolv,
+                                  test_ctx->fo_ctx, service);
+    fail_if(req == NULL, "fo_resolve_service_send() failed");
+
+    tevent_req_set_callback(req, test_latency_callback, &task);
+    test_loop(test_ctx);
+
+    fail_if(task.server == NULL);
+    return task.server;
+}
+
+static void
+record_rtt(struct fo_server *server, uint64_t rtt_usec, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        fo_record_server_rtt(server, rtt_usec);
+    }
+}
+
+START_TEST(test_fo_latency)
+{
+    struct test_ctx *ctx;
+    struct fo_service *service;
+    struct fo_server *slow;
+    struct fo_server *fast;
+    struct fo_server *medium;
+    struct fo_server *server;
+
+    ctx = setup_test_ext(60);
+    fail_if(ctx == NULL);
+
+    fail_if(fo_new_service(ctx->fo_ctx, "ldap", NULL, &service) != EOK);
+    fail_if(fo_add_server(service, "127.0.0.1", 389, NULL, true) != EOK);
+    fail_if(fo_add_server(service, "127.0.0.1", 636, NULL, true) != EOK);
+    fail_if(fo_add_server(service, "127.0.0.1", 3268, NULL, true) != EOK);
+
+    /* Without statistics the configured order is used. */
+    slow = resolve_server(ctx, service);
+    fail_if(fo_get_server_port(slow) != 389);
+    record_rtt(slow, 50000, 1);
+    fo_set_port_status(slow, PORT_NOT_WORKING);
+
+    fast = resolve_server(ctx, service);
+    fail_if(fo_get_server_port(fast) != 636);
+    record_rtt(fast, 5000, 1);
+    fo_set_port_status(fast, PORT_NOT_WORKING);
+
+    medium = resolve_server(ctx, service);
+    fail_if(fo_get_server_port(medium) != 3268);
+    record_rtt(medium, 20000, 1);
+
+    fo_set_port_status(slow, PORT_NEUTRAL);
+    fo_set_port_status(fast, PORT_NEUTRAL);
+    fo_set_port_status(medium, PORT_WORKING);
+
+    /* The fastest server is preferred even to the active one. */
+    server = resolve_server(ctx, service);
+    fail_if(server != fast, "Expected port 636, got %d",
+            fo_get_server_port(server));
+    fo_set_port_status(fast, PORT_WORKING);
+
+    server = resolve_server(ctx, service);
+    fail_if(server != fast);
+
+    /* The active server slows down, the selection converges to the
+     * server that is now the fastest one. */
+    record_rtt(fast, 80000, 30);
+    server = resolve_server(ctx, service);
+    fail_if(server != medium, "Expected port 3268, got %d",
+            fo_get_server_port(server));
+    fo_set_port_status(medium, PORT_WORKING);
+
+    /* Servers that do not work are skipped however fast they are. */
+    fo_set_port_status(medium, PORT_NOT_WORKING);
+    server = resolve_server(ctx, service);
+    fail_if(server != slow, "Expected port 389, got %d",
+            fo_get_server_port(server));
+
+    talloc_free(ctx);
+}
+END_TEST
+
 Suite *
 create_suite(void)
 {
@@ -279,6 +398,7 @@ create_suite(void)
     /* Do some testing */
     tcase_add_test(tc, test_fo_new_service);
     tcase_add_test(tc, test_fo_resolve_service);
+    tcase_add_test(tc, test_fo_latency);
     if (use_net_test) {
     }
     /* Add all test cases to the test suite */
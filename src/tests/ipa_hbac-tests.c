@@ -20,10 +20,13 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <check.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <talloc.h>
 
 #include "tests/common_check.h"
@@ -843,6 +846,245 @@ START_TEST(ipa_hbac_test_incomplete)
 }
 END_TEST
 
+static struct hbac_rule *get_named_rule(TALLOC_CTX *mem_ctx,
+                                        const char *name,
+                                        const char *user,
+                                        const char *group,
+                                        const char *service)
+{
+    struct hbac_rule *rule;
+
+    get_allow_all_rule(mem_ctx, &rule);
+    rule->name = talloc_strdup(rule, name);
+    fail_if(rule->name == NULL);
+
+    if (user != NULL || group != NULL) {
+        rule->users->category = HBAC_CATEGORY_NULL;
+        rule->users->names = talloc_zero_array(rule, const char *, 2);
+        fail_if(rule->users->names == NULL);
+        rule->users->names[0] = user;
+        rule->users->groups = talloc_zero_array(rule, const char *, 2);
+        fail_if(rule->users->groups == NULL);
+        rule->users->groups[0] = group;
+    }
+
+    if (service != NULL) {
+        rule->services->category = HBAC_CATEGORY_NULL;
+        rule->services->names = talloc_zero_array(rule, const char *, 2);
+        fail_if(rule->services->names == NULL);
+        rule->services->names[0] = service;
+    }
+
+    return rule;
+}
+
+static void check_compiled_result(struct hbac_rule **rules,
+                                  struct hbac_compiled_rules *compiled,
+                                  struct hbac_eval_req *eval_req,
+                                  enum hbac_eval_result expected,
+                                  const char *expected_rule)
+{
+    enum hbac_eval_result result;
+    enum hbac_eval_result compiled_result;
+    struct hbac_info *info = NULL;
+    struct hbac_info *compiled_info = NULL;
+
+    result = hbac_evaluate(rules, eval_req, &info);
+    compiled_result = hbac_evaluate_compiled(compiled, eval_req,
+                                             &compiled_info);
+
+    fail_unless(result == expected,
+                "Expected [%s], got [%s]",
+                hbac_result_string(expected),
+                hbac_result_string(result));
+    fail_unless(compiled_result == result,
+                "Compiled evaluation returned [%s], expected [%s]",
+                hbac_result_string(compiled_result),
+                hbac_result_string(result));
+    fail_unless(compiled_info->code == info->code,
+                "Compiled evaluation returned [%s], expected [%s]",
+                hbac_error_string(compiled_info->code),
+                hbac_error_string(info->code));
+
+    if (expected_rule == NULL) {
+        fail_unless(info->rule_name == NULL);
+        fail_unless(compiled_info->rule_name == NULL);
+    } else {
+        fail_if(info->rule_name == NULL);
+        fail_if(compiled_info->rule_name == NULL);
+        fail_unless(strcmp(info->rule_name, expected_rule) == 0,
+                    "Expected rule [%s], got [%s]",
+                    expected_rule, info->rule_name);
+        fail_unless(strcmp(compiled_info->rule_name, expected_rule) == 0,
+                    "Expected rule [%s], got [%s]",
+                    expected_rule, compiled_info->rule_name);
+    }
+
+    hbac_free_info(info);
+    hbac_free_info(compiled_info);
+}
+
+START_TEST(ipa_hbac_test_compiled)
+{
+    TALLOC_CTX *test_ctx;
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled = NULL;
+    struct hbac_eval_req *eval_req;
+    enum hbac_error_code code;
+
+    test_ctx = talloc_new(global_talloc_context);
+
+    /* Create a request */
+    eval_req = talloc_zero(test_ctx, struct hbac_eval_req);
+    fail_if (eval_req == NULL);
+
+    get_test_user(eval_req, &eval_req->user);
+    get_test_service(eval_req, &eval_req->service);
+    get_test_srchost(eval_req, &eval_req->srchost);
+
+    rules = talloc_zero_array(test_ctx, struct hbac_rule *, 6);
+    fail_if (rules == NULL);
+
+    /* Never matches */
+    rules[0] = get_named_rule(rules, "Other user", "otheruser",
+                              HBAC_TEST_INVALID_GROUP, NULL);
+    /* Would match, but is disabled */
+    rules[1] = get_named_rule(rules, "Disabled", HBAC_TEST_USER, NULL, NULL);
+    rules[1]->enabled = false;
+    /* Matches through group membership, case-insensitively */
+    rules[2] = get_named_rule(rules, "Group", NULL, "TestGroup2",
+                              HBAC_TEST_SERVICE);
+    /* Would match as well, but comes later */
+    rules[3] = get_named_rule(rules, "User", HBAC_TEST_USER, NULL, NULL);
+    /* Incomplete rule */
+    rules[4] = get_named_rule(rules, "Incomplete", NULL, NULL, NULL);
+    rules[4]->srchosts = NULL;
+    rules[5] = NULL;
+
+    code = hbac_compile_rules(rules, &compiled);
+    fail_unless(code == HBAC_SUCCESS,
+                "hbac_compile_rules failed: [%s]", hbac_error_string(code));
+
+    check_compiled_result(rules, compiled, eval_req,
+                          HBAC_EVAL_ALLOW, "Group");
+
+    /* Without the group only the user rule matches */
+    eval_req->user->groups[1] = NULL;
+    check_compiled_result(rules, compiled, eval_req,
+                          HBAC_EVAL_ALLOW, "User");
+
+    /* Nothing matches before the incomplete rule is reached */
+    eval_req->user->name = HBAC_TEST_INVALID_USER;
+    check_compiled_result(rules, compiled, eval_req,
+                          HBAC_EVAL_ERROR, "Incomplete");
+
+    /* Non-ASCII requests are evaluated against all rules */
+    eval_req->user->name = (const char *) user_utf8_upcase;
+    check_compiled_result(rules, compiled, eval_req,
+                          HBAC_EVAL_ERROR, "Incomplete");
+
+    hbac_free_compiled_rules(compiled);
+
+    /* Without the incomplete rule the request is denied */
+    rules[4] = NULL;
+    code = hbac_compile_rules(rules, &compiled);
+    fail_unless(code == HBAC_SUCCESS,
+                "hbac_compile_rules failed: [%s]", hbac_error_string(code));
+
+    check_compiled_result(rules, compiled, eval_req, HBAC_EVAL_DENY, NULL);
+
+    hbac_free_compiled_rules(compiled);
+    talloc_free(test_ctx);
+}
+END_TEST
+
+#define HBAC_BENCH_ITERATIONS 50
+
+static double hbac_bench_elapsed(struct timeval *start)
+{
+    struct timeval end;
+
+    gettimeofday(&end, NULL);
+    return (end.tv_sec - start->tv_sec) * 1000.0
+            + (end.tv_usec - start->tv_usec) / 1000.0;
+}
+
+START_TEST(ipa_hbac_test_compiled_scaling)
+{
+    TALLOC_CTX *test_ctx;
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled = NULL;
+    struct hbac_eval_req *eval_req;
+    struct hbac_info *info;
+    enum hbac_eval_result result;
+    enum hbac_error_code code;
+    struct timeval start;
+    double linear_ms;
+    double compiled_ms;
+    const char *name;
+    size_t num_rules;
+    size_t i;
+    size_t j;
+
+    test_ctx = talloc_new(global_talloc_context);
+
+    /* Create a request */
+    eval_req = talloc_zero(test_ctx, struct hbac_eval_req);
+    fail_if (eval_req == NULL);
+
+    get_test_user(eval_req, &eval_req->user);
+    get_test_service(eval_req, &eval_req->service);
+    get_test_srchost(eval_req, &eval_req->srchost);
+
+    for (num_rules = 10; num_rules <= 10000; num_rules *= 10) {
+        rules = talloc_zero_array(test_ctx, struct hbac_rule *, num_rules + 1);
+        fail_if (rules == NULL);
+
+        /* Only the last rule grants access to the test user */
+        for (i = 0; i < num_rules; i++) {
+            name = talloc_asprintf(rules, "user%zu", i);
+            fail_if(name == NULL);
+            rules[i] = get_named_rule(rules, name,
+                                      i == num_rules - 1 ? HBAC_TEST_USER
+                                                         : name,
+                                      name, NULL);
+        }
+
+        code = hbac_compile_rules(rules, &compiled);
+        fail_unless(code == HBAC_SUCCESS,
+                    "hbac_compile_rules failed: [%s]",
+                    hbac_error_string(code));
+
+        gettimeofday(&start, NULL);
+        for (j = 0; j < HBAC_BENCH_ITERATIONS; j++) {
+            result = hbac_evaluate(rules, eval_req, &info);
+            fail_unless(result == HBAC_EVAL_ALLOW);
+            hbac_free_info(info);
+        }
+        linear_ms = hbac_bench_elapsed(&start);
+
+        gettimeofday(&start, NULL);
+        for (j = 0; j < HBAC_BENCH_ITERATIONS; j++) {
+            result = hbac_evaluate_compiled(compiled, eval_req, &info);
+            fail_unless(result == HBAC_EVAL_ALLOW);
+            fail_unless(strcmp(info->rule_name,
+                               rules[num_rules - 1]->name) == 0);
+            hbac_free_info(info);
+        }
+        compiled_ms = hbac_bench_elapsed(&start);
+
+        printf("%zu rules, %d evaluations: "
+               "hbac_evaluate %.2f ms, hbac_evaluate_compiled %.2f ms\n",
+               num_rules, HBAC_BENCH_ITERATIONS, linear_ms, compiled_ms);
+
+        hbac_free_compiled_rules(compiled);
+        talloc_free(rules);
+    }
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 Suite *hbac_test_suite (void)
 {
     Suite *s = suite_create ("HBAC");
@@ -861,6 +1103,8 @@ Suite *hbac_test_suite (void)
     tcase_add_test(tc_hbac, ipa_hbac_test_allow_srchostgroup);
     tcase_add_test(tc_hbac, ipa_hbac_test_allow_utf8);
     tcase_add_test(tc_hbac, ipa_hbac_test_incomplete);
+    tcase_add_test(tc_hbac, ipa_hbac_test_compiled);
+    tcase_add_test(tc_hbac, ipa_hbac_test_compiled_scaling);
 
     suite_add_tcase(s, tc_hbac);
     return s;
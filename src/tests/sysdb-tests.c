@@ -63,7 +63,8 @@ struct sysdb_test_ctx {
     size_t null_pointer_size;
 };
 
-static int _setup_sysdb_tests(struct sysdb_test_ctx **ctx, bool enumerate)
+static int _setup_sysdb_tests(struct sysdb_test_ctx **ctx, bool enumerate,
+                              const char *id_provider)
 {
     struct sysdb_test_ctx *test_ctx;
     char *conf_db;
@@ -121,7 +122,7 @@ static int _setup_sysdb_tests(struct sysdb_test_ctx **ctx, bool enumerate)
         return ret;
     }
 
-    val[0] = "local";
+    val[0] = id_provider;
     ret = confdb_add_param(test_ctx->confdb, true,
                            "config/domain/LOCAL", "id_provider", val);
     if (ret != EOK) {
@@ -179,7 +180,9 @@ static void fail_if_null_ctx_leaks(struct sysdb_test_ctx *ctx)
     }
 }
 
-#define setup_sysdb_tests(ctx) _setup_sysdb_tests((ctx), false)
+#define setup_sysdb_tests(ctx) _setup_sysdb_tests((ctx), false, "local")
+/* Only a domain with a remote provider keeps a timestamp cache */
+#define setup_sysdb_ts_tests(ctx) _setup_sysdb_tests((ctx), false, "ldap")
 
 struct test_data {
     struct tevent_context *ev;
@@ -3283,7 +3286,7 @@ START_TEST (test_sysdb_memberof_check_convert)
     /* Eplicitly disable enumeration during setup as converting the ghost
      * users into real ones work only when enumeration is disabled
      */
-    ret = _setup_sysdb_tests(&test_ctx, false);
+    ret = _setup_sysdb_tests(&test_ctx, false, "local");
     if (ret != EOK) {
         fail("Could not set up the test");
         return;
@@ -6505,6 +6508,127 @@ START_TEST(test_sysdb_mark_entry_as_expired_ldb_dn)
 }
 END_TEST
 
+static uint64_t get_raw_expire(struct sysdb_test_ctx *test_ctx,
+                               struct ldb_context *ldb,
+                               struct ldb_dn *dn,
+                               const char *attr)
+{
+    const char *attrs[] = { attr, NULL };
+    struct ldb_result *res;
+    uint64_t expire;
+    int lret;
+
+    lret = ldb_search(ldb, test_ctx, &res, dn, LDB_SCOPE_BASE, attrs, NULL);
+    ck_assert_int_eq(lret, LDB_SUCCESS);
+    ck_assert_int_eq(res->count, 1);
+
+    expire = ldb_msg_find_attr_as_uint64(res->msgs[0], attr, 0);
+    talloc_free(res);
+
+    return expire;
+}
+
+START_TEST(test_sysdb_invalidate_cache_entries)
+{
+    errno_t ret;
+    struct sysdb_test_ctx *test_ctx;
+    const char *attrs[] = { SYSDB_CACHE_EXPIRE, SYSDB_INITGR_EXPIRE, NULL };
+    struct test_data *ts_user;
+    struct test_data *plain_user;
+    struct test_data *gone_user;
+    struct ldb_message *msgs[3];
+    struct ldb_message *msg;
+    int lret;
+
+    ret = setup_sysdb_ts_tests(&test_ctx);
+    fail_if(ret != EOK, "Could not setup the test");
+    fail_if(test_ctx->sysdb->ldb_ts == NULL, "No timestamp cache");
+
+    ts_user = test_data_new_user(test_ctx, 2100);
+    fail_if(ts_user == NULL);
+    plain_user = test_data_new_user(test_ctx, 2101);
+    fail_if(plain_user == NULL);
+    gone_user = test_data_new_user(test_ctx, 2102);
+    fail_if(gone_user == NULL);
+
+    ret = test_add_user(ts_user);
+    ck_assert_int_eq(ret, EOK);
+    ret = test_add_user(plain_user);
+    ck_assert_int_eq(ret, EOK);
+    ret = test_add_user(gone_user);
+    ck_assert_int_eq(ret, EOK);
+
+    ret = sysdb_search_user_by_name(test_ctx, test_ctx->domain,
+                                    ts_user->username, attrs, &msgs[0]);
+    ck_assert_int_eq(ret, EOK);
+    ret = sysdb_search_user_by_name(test_ctx, test_ctx->domain,
+                                    plain_user->username, attrs, &msgs[1]);
+    ck_assert_int_eq(ret, EOK);
+    ret = sysdb_search_user_by_name(test_ctx, test_ctx->domain,
+                                    gone_user->username, attrs, &msgs[2]);
+    ck_assert_int_eq(ret, EOK);
+
+    /* An entry stored before the timestamp cache existed */
+    lret = ldb_delete(test_ctx->sysdb->ldb_ts, msgs[1]->dn);
+    ck_assert_int_eq(lret, LDB_SUCCESS);
+
+    /* An entry removed after it was looked up */
+    ret = test_remove_user(gone_user);
+    ck_assert_int_eq(ret, EOK);
+
+    /* Only the cache expiration is touched without initgroups */
+    ret = sysdb_invalidate_cache_entries(test_ctx->domain, &msgs[1], 1,
+                                         false);
+    ck_assert_int_eq(ret, EOK);
+    ck_assert_int_eq(get_raw_expire(test_ctx, test_ctx->sysdb->ldb,
+                                    msgs[1]->dn, SYSDB_CACHE_EXPIRE), 1);
+    ck_assert(get_raw_expire(test_ctx, test_ctx->sysdb->ldb,
+                             msgs[1]->dn, SYSDB_INITGR_EXPIRE) != 1);
+
+    ret = sysdb_invalidate_cache_entries(test_ctx->domain, msgs, 3, true);
+    ck_assert_int_eq(ret, EOK);
+
+    /* The timestamp cache is written and the persistent entry is left
+     * alone */
+    ck_assert_int_eq(get_raw_expire(test_ctx, test_ctx->sysdb->ldb_ts,
+                                    msgs[0]->dn, SYSDB_CACHE_EXPIRE), 1);
+    ck_assert_int_eq(get_raw_expire(test_ctx, test_ctx->sysdb->ldb_ts,
+                                    msgs[0]->dn, SYSDB_INITGR_EXPIRE), 1);
+    ck_assert(get_raw_expire(test_ctx, test_ctx->sysdb->ldb,
+                             msgs[0]->dn, SYSDB_CACHE_EXPIRE) != 1);
+
+    /* Without a timestamp record the entry itself is expired */
+    ck_assert_int_eq(get_raw_expire(test_ctx, test_ctx->sysdb->ldb,
+                                    msgs[1]->dn, SYSDB_CACHE_EXPIRE), 1);
+    ck_assert_int_eq(get_raw_expire(test_ctx, test_ctx->sysdb->ldb,
+                                    msgs[1]->dn, SYSDB_INITGR_EXPIRE), 1);
+
+    /* Both are seen as expired by regular lookups */
+    ret = sysdb_search_user_by_name(test_ctx, test_ctx->domain,
+                                    ts_user->username, attrs, &msg);
+    ck_assert_int_eq(ret, EOK);
+    ck_assert_int_eq(ldb_msg_find_attr_as_uint64(msg, SYSDB_CACHE_EXPIRE, 0),
+                     1);
+    ck_assert_int_eq(ldb_msg_find_attr_as_uint64(msg, SYSDB_INITGR_EXPIRE, 0),
+                     1);
+    talloc_free(msg);
+
+    ret = sysdb_search_user_by_name(test_ctx, test_ctx->domain,
+                                    plain_user->username, attrs, &msg);
+    ck_assert_int_eq(ret, EOK);
+    ck_assert_int_eq(ldb_msg_find_attr_as_uint64(msg, SYSDB_CACHE_EXPIRE, 0),
+                     1);
+    talloc_free(msg);
+
+    ret = test_remove_user(ts_user);
+    ck_assert_int_eq(ret, EOK);
+    ret = test_remove_user(plain_user);
+    ck_assert_int_eq(ret, EOK);
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 Suite *create_sysdb_suite(void)
 {
     Suite *s = suite_create("sysdb");
@@ -6729,6 +6853,7 @@ Suite *create_sysdb_suite(void)
 /* ===== Misc ===== */
     tcase_add_test(tc_sysdb, test_sysdb_set_get_bool);
     tcase_add_test(tc_sysdb, test_sysdb_mark_entry_as_expired_ldb_dn);
+    tcase_add_test(tc_sysdb, test_sysdb_invalidate_cache_entries);
 
 /* Add all test cases to the test suite */
     suite_add_tcase(s, tc_sysdb);
@@ -6930,6 +7055,9 @@ int main(int argc, const char *argv[]) {
     int no_cleanup = 0;
     Suite *sysdb_suite;
     SRunner *sr;
+    /* LOCAL_SYSDB_FILE is the local provider cache, TEST_DOM_NAME the caches
+     * of setup_sysdb_ts_tests() */
+    const char *test_domains[] = { LOCAL_SYSDB_FILE, TEST_DOM_NAME, NULL };
 
     struct poptOption long_options[] = {
         POPT_AUTOHELP
@@ -6964,7 +7092,7 @@ int main(int argc, const char *argv[]) {
     tests_set_cwd();
     talloc_enable_null_tracking();
 
-    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_FILE, LOCAL_SYSDB_FILE);
+    test_multidom_suite_cleanup(TESTS_PATH, TEST_CONF_FILE, test_domains);
 
     sysdb_suite = create_sysdb_suite();
     sr = srunner_create(sysdb_suite);
@@ -6973,7 +7101,8 @@ int main(int argc, const char *argv[]) {
     failure_count = srunner_ntests_failed(sr);
     srunner_free(sr);
     if (failure_count == 0 && !no_cleanup) {
-        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_FILE, LOCAL_SYSDB_FILE);
+        test_multidom_suite_cleanup(TESTS_PATH, TEST_CONF_FILE,
+                                    test_domains);
     }
     return (failure_count==0 ? EXIT_SUCCESS : EXIT_FAILURE);
 }
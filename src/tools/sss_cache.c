@@ -42,6 +42,10 @@
 #define INVALIDATE_SSH_HOSTS 32
 #define INVALIDATE_SUDO_RULES 64
 
+/* If more users and groups are invalidated, the whole memory cache is
+ * cleared instead of dropping the entries one by one */
+#define SSS_CACHE_MC_MAX_ENTRIES 1000
+
 #ifdef BUILD_AUTOFS
 #ifdef BUILD_SSH
 #define INVALIDATE_EVERYTHING (INVALIDATE_USERS | INVALIDATE_GROUPS | \
@@ -116,6 +120,10 @@ struct cache_tool_ctx {
     bool update_autofs_filter;
     bool update_ssh_host_filter;
     bool update_sudo_rule_filter;
+
+    /* users and groups to drop from the memory cache */
+    char *mc_entries;
+    size_t mc_entry_count;
 };
 
 static void free_input_values(struct input_values *values);
@@ -125,10 +133,7 @@ static errno_t init_domains(struct cache_tool_ctx *ctx,
                             const char *domain);
 static errno_t init_context(int argc, const char *argv[],
                             struct cache_tool_ctx **tctx);
-static errno_t invalidate_entry(TALLOC_CTX *ctx,
-                                struct sss_domain_info *domain,
-                                const char *name, int entry_type);
-static bool invalidate_entries(TALLOC_CTX *ctx,
+static bool invalidate_entries(struct cache_tool_ctx *tctx,
                                struct sss_domain_info *dinfo,
                                enum sss_cache_entry entry_type,
                                const char *filter, const char *name);
@@ -214,12 +219,19 @@ int main(int argc, const char *argv[])
         ERROR("No cache object matched the specified search\n");
         ret = ENOENT;
         goto done;
-    } else {
+    } else if (tctx->mc_entry_count > SSS_CACHE_MC_MAX_ENTRIES) {
         ret = sss_memcache_clear_all();
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Failed to clear memory cache.\n");
             goto done;
         }
+    } else if (tctx->mc_entry_count > 0) {
+        ret = sss_memcache_invalidate_entries(tctx->mc_entries);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Failed to invalidate memory cache entries.\n");
+            goto done;
+        }
     }
 
     ret = EOK;
@@ -416,11 +428,49 @@ static errno_t update_all_filters(struct cache_tool_ctx *tctx,
     return EOK;
 }
 
-static bool invalidate_entries(TALLOC_CTX *ctx,
+static errno_t add_mc_entry(struct cache_tool_ctx *tctx,
+                            struct sss_domain_info *dinfo,
+                            enum sss_cache_entry entry_type,
+                            const char *name)
+{
+    const char *mc_type;
+
+    switch (entry_type) {
+    case TYPE_USER:
+        mc_type = SSS_MC_ENTRY_PASSWD;
+        break;
+    case TYPE_GROUP:
+        mc_type = SSS_MC_ENTRY_GROUP;
+        break;
+    default:
+        /* not kept in the memory cache */
+        return EOK;
+    }
+
+    tctx->mc_entry_count++;
+    if (tctx->mc_entry_count > SSS_CACHE_MC_MAX_ENTRIES) {
+        /* the whole memory cache will be cleared */
+        talloc_zfree(tctx->mc_entries);
+        return EOK;
+    }
+
+    tctx->mc_entries = talloc_asprintf_append_buffer(tctx->mc_entries,
+                                                     "%s\t%s\t%s\n",
+                                                     mc_type, dinfo->name,
+                                                     name);
+    if (tctx->mc_entries == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static bool invalidate_entries(struct cache_tool_ctx *tctx,
                                struct sss_domain_info *dinfo,
                                enum sss_cache_entry entry_type,
                                const char *filter, const char *name)
 {
+    TALLOC_CTX *ctx = tctx;
     const char *attrs[] = {SYSDB_NAME, NULL};
     size_t msg_count;
     struct ldb_message **msgs;
@@ -497,91 +547,48 @@ static bool invalidate_entries(TALLOC_CTX *ctx,
                   SYSDB_NAME);
             ERROR("Couldn't invalidate %1$s\n", type_string);
             iret = false;
-        } else {
-            ret = invalidate_entry(ctx, dinfo, c_name, entry_type);
-            if (ret != EOK) {
-                DEBUG(SSSDBG_MINOR_FAILURE,
-                      "Couldn't invalidate %s %s\n", type_string, c_name);
-                ERROR("Couldn't invalidate %1$s %2$s\n", type_string, c_name);
-                iret = false;
-            }
+            continue;
+        }
+
+        ret = add_mc_entry(tctx, dinfo, entry_type, c_name);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Out of memory\n");
+            iret = false;
+            goto done;
         }
     }
-    talloc_zfree(msgs);
-    return iret;
-}
 
-static errno_t invalidate_entry(TALLOC_CTX *ctx,
-                                struct sss_domain_info *domain,
-                                const char *name, int entry_type)
-{
-    struct sysdb_attrs *sys_attrs = NULL;
-    errno_t ret;
+    /* All entries are expired at once */
+    ret = sysdb_invalidate_cache_entries(dinfo, msgs, msg_count,
+                                         entry_type == TYPE_USER);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Couldn't invalidate %s entries in domain %s\n",
+              type_string, dinfo->name);
+        ERROR("Couldn't invalidate %1$s\n", type_string);
+        iret = false;
+        goto done;
+    }
 
-    sys_attrs = sysdb_new_attrs(ctx);
-    if (sys_attrs) {
-        ret = sysdb_attrs_add_time_t(sys_attrs,
-                SYSDB_CACHE_EXPIRE, 1);
-        if (ret == EOK) {
-            switch (entry_type) {
-                case TYPE_USER:
-                    /* For users, we also need to reset the initgroups
-                     * cache expiry */
-                    ret = sysdb_attrs_add_time_t(sys_attrs,
-                            SYSDB_INITGR_EXPIRE, 1);
-                    if (ret != EOK) return ret;
-
-                    ret = sysdb_set_user_attr(domain, name, sys_attrs,
-                                              SYSDB_MOD_REP);
-                    break;
-                case TYPE_GROUP:
-                    ret = sysdb_set_group_attr(domain, name, sys_attrs,
-                                               SYSDB_MOD_REP);
-                    break;
-                case TYPE_NETGROUP:
-                    ret = sysdb_set_netgroup_attr(domain, name, sys_attrs,
-                                                  SYSDB_MOD_REP);
-                    break;
-                case TYPE_SERVICE:
-                    ret = sysdb_set_service_attr(domain, name,
-                                                 sys_attrs, SYSDB_MOD_REP);
-                    break;
-                case TYPE_AUTOFSMAP:
-                    ret = sysdb_set_autofsmap_attr(domain, name,
-                                                   sys_attrs, SYSDB_MOD_REP);
-                    break;
-                case TYPE_SSH_HOST:
-#ifdef BUILD_SSH
-                    ret = sysdb_set_ssh_host_attr(domain, name,
-                                                  sys_attrs, SYSDB_MOD_REP);
-#else  /* BUILD_SSH */
-                    ret = ENOSYS;
-#endif /* BUILD_SSH */
-                    break;
-                case TYPE_SUDO_RULE:
 #ifdef BUILD_SUDO
-                    ret = sysdb_set_sudo_rule_attr(domain, name,
-                                                   sys_attrs, SYSDB_MOD_REP);
-#else  /* BUILD_SUDO */
-                    ret = ENOSYS;
-#endif /* BUILD_SUDO */
-                    break;
-                default:
-                    return EINVAL;
-            }
-            if (ret != EOK) {
-                DEBUG(SSSDBG_MINOR_FAILURE, "Could not set entry attributes\n");
-            }
-        } else {
+    if (entry_type == TYPE_SUDO_RULE) {
+        /* The responder keeps an index of the rules that is only rebuilt
+         * when the generation changes, otherwise it would not notice the
+         * new expiration timestamps. */
+        ret = sysdb_sudo_bump_rules_generation(dinfo);
+        if (ret != EOK) {
             DEBUG(SSSDBG_MINOR_FAILURE,
-                  "Could not add expiration time to attributes\n");
+                  "Couldn't bump sudo rules generation in domain %s\n",
+                  dinfo->name);
+            ERROR("Couldn't invalidate %1$s\n", type_string);
+            iret = false;
         }
-        talloc_zfree(sys_attrs);
-    } else {
-        DEBUG(SSSDBG_MINOR_FAILURE, "Could not create sysdb attributes\n");
-        ret = ENOMEM;
     }
-    return ret;
+#endif /* BUILD_SUDO */
+
+done:
+    talloc_zfree(msgs);
+    return iret;
 }
 
 static errno_t init_domains(struct cache_tool_ctx *ctx,
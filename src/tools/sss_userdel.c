@@ -84,6 +84,7 @@ static int kick_user(struct tools_ctx *tctx)
         return ret;
     }
 
+    sss_debug_prepare_fork();
     errno = 0;
     pid = fork();
     if (pid == 0) {
@@ -0,0 +1,157 @@
+/*
+    SSSD
+
+    sssctl - print operation counters and latencies of running SSSD
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <popt.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "util/util.h"
+#include "util/sss_metrics.h"
+#include "tools/common/sss_tools.h"
+#include "tools/sssctl/sssctl.h"
+#include "sbus/sssd_dbus.h"
+#include "responder/ifp/ifp_iface.h"
+
+static void sssctl_stats_print_line(char *line, bool raw)
+{
+    char process[64];
+    char metric[256];
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint64_t b[SSS_METRICS_BUCKETS];
+    int ret;
+
+    if (raw) {
+        puts(line);
+        return;
+    }
+
+    ret = sscanf(line, "%63s %255s %"SCNu64" %"SCNu64" %"SCNu64
+                 " %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64
+                 " %"SCNu64" %"SCNu64" %"SCNu64,
+                 process, metric, &count, &total, &max,
+                 &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6]);
+    if (ret != 5 + SSS_METRICS_BUCKETS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Malformed line [%s]\n", line);
+        return;
+    }
+
+    if (total == 0 && max == 0) {
+        /* simple counter */
+        printf("%-16s %-48s %10"PRIu64"\n", process, metric, count);
+        return;
+    }
+
+    printf("%-16s %-48s %10"PRIu64" %10"PRIu64" %10"PRIu64
+           " %8"PRIu64" %8"PRIu64" %8"PRIu64" %8"PRIu64
+           " %8"PRIu64" %8"PRIu64" %8"PRIu64"\n",
+           process, metric, count, count == 0 ? 0 : total / count, max,
+           b[0], b[1], b[2], b[3], b[4], b[5], b[6]);
+}
+
+errno_t sssctl_stats(struct sss_cmdline *cmdline,
+                     struct sss_tool_ctx *tool_ctx,
+                     void *pvt)
+{
+    TALLOC_CTX *tmp_ctx;
+    sss_sifp_ctx *sifp;
+    sss_sifp_error error;
+    DBusMessage *reply;
+    const char *stats;
+    char *lines;
+    char *line;
+    char *next;
+    int start = 0;
+    int raw = 0;
+    errno_t ret;
+
+    /* Parse command line. */
+    struct poptOption options[] = {
+        {"start", 's', POPT_ARG_NONE, &start, 0, _("Start SSSD if it is not running"), NULL },
+        {"raw", 'r', POPT_ARG_NONE, &raw, 0, _("Print the values as reported by the services"), NULL },
+        POPT_TABLEEND
+    };
+
+    ret = sss_tool_popt(cmdline, options, SSS_TOOL_OPT_OPTIONAL, NULL, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse command arguments\n");
+        return ret;
+    }
+
+    if (!sssctl_start_sssd(start)) {
+        return ERR_SSSD_NOT_RUNNING;
+    }
+
+    error = sssctl_sifp_init(tool_ctx, &sifp);
+    if (error != SSS_SIFP_OK) {
+        sssctl_sifp_error(sifp, error, "Unable to connect to the InfoPipe");
+        return EFAULT;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    error = sssctl_sifp_send(tmp_ctx, sifp, &reply, IFP_PATH,
+                             IFACE_IFP, IFACE_IFP_GETSTATS);
+    if (error != SSS_SIFP_OK) {
+        sssctl_sifp_error(sifp, error, "Unable to get statistics");
+        ret = EIO;
+        goto done;
+    }
+
+    ret = sbus_parse_reply(reply, DBUS_TYPE_STRING, &stats);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    lines = talloc_strdup(tmp_ctx, stats);
+    if (lines == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (!raw) {
+        printf("%-16s %-48s %10s %10s %10s"
+               " %8s %8s %8s %8s %8s %8s %8s\n",
+               _("Process"), _("Metric"), _("Count"), _("Avg [us]"),
+               _("Max [us]"), "<100us", "<1ms", "<10ms", "<100ms",
+               "<1s", "<10s", ">=10s");
+    }
+
+    for (line = lines; line != NULL && *line != '\0'; line = next) {
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next = '\0';
+            next++;
+        }
+
+        sssctl_stats_print_line(line, raw);
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
@@ -192,7 +192,7 @@ static errno_t wait_till_nss_responder_invalidate_cache(void)
     return EAGAIN;
 }
 
-errno_t sss_memcache_clear_all(void)
+static errno_t sss_memcache_clear(const char *entries)
 {
     errno_t ret;
     bool sssd_nss_is_off = false;
@@ -212,6 +212,16 @@ errno_t sss_memcache_clear_all(void)
                    "Memory cache will not be cleared.\n");
             return EIO;
         }
+        if (entries != NULL && (fputs(entries, clear_mc_flag) == EOF
+                                    || fflush(clear_mc_flag) != 0)) {
+            /* an empty file makes the responder clear everything */
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Failed to write entries to clear_mc_flag file. "
+                   "Memory cache will be cleared.\n");
+            if (ftruncate(fileno(clear_mc_flag), 0) != 0) {
+                DEBUG(SSSDBG_MINOR_FAILURE, "Unable to truncate file.\n");
+            }
+        }
         ret = fclose(clear_mc_flag);
         if (ret != 0) {
             ret = errno;
@@ -238,6 +248,16 @@ errno_t sss_memcache_clear_all(void)
     return EOK;
 }
 
+errno_t sss_memcache_clear_all(void)
+{
+    return sss_memcache_clear(NULL);
+}
+
+errno_t sss_memcache_invalidate_entries(const char *entries)
+{
+    return sss_memcache_clear(entries);
+}
+
 enum sss_tools_ent {
     SSS_TOOLS_USER,
     SSS_TOOLS_GROUP
@@ -536,6 +536,7 @@ int run_userdel_cmd(struct tools_ctx *tctx)
         goto done;
     }
 
+    sss_debug_prepare_fork();
     errno = 0;
     pid = fork();
     if (pid == 0) {
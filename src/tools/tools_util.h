@@ -106,6 +106,9 @@ errno_t sss_memcache_invalidate(const char *mc_filename);
 
 errno_t sss_memcache_clear_all(void);
 
+/* entries is a list of lines as described with CLEAR_MC_FLAG */
+errno_t sss_memcache_invalidate_entries(const char *entries);
+
 errno_t sss_mc_refresh_user(const char *username);
 errno_t sss_mc_refresh_group(const char *groupname);
 errno_t sss_mc_refresh_grouplist(struct tools_ctx *tctx,
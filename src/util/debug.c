@@ -25,6 +25,7 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <inttypes.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -36,6 +37,16 @@
 
 #include "util/util.h"
 
+/* Messages of these levels are flushed immediately even if the output is
+ * buffered and they trigger the backtrace. */
+#define DEBUG_URGENT_LEVELS \
+    (SSSDBG_FATAL_FAILURE | SSSDBG_CRIT_FAILURE | SSSDBG_OP_FAILURE)
+
+#define DEBUG_PREFIX_MAX 256
+#define DEBUG_BUFFER_SIZE (64 * 1024)
+#define DEBUG_BACKTRACE_SIZE (1024 * 1024)
+#define DEBUG_BACKTRACE_LINE_MAX 2048
+
 const char *debug_prg_name = "sssd";
 
 int debug_level = SSSDBG_UNRESOLVED;
@@ -44,7 +55,22 @@ int debug_microseconds = SSSDBG_MICROSECONDS_UNRESOLVED;
 int debug_to_file = 0;
 int debug_to_stderr = 0;
 const char *debug_log_file = "sssd";
+int debug_buffered = 0;
+int debug_backtrace = 0;
 FILE *debug_file = NULL;
+uint64_t sss_trace_id = 0;
+
+uint64_t sss_trace_id_new(void)
+{
+    static uint32_t counter;
+
+    counter++;
+    if (counter == 0) {
+        counter++;
+    }
+
+    return ((uint64_t)getpid() << 32) | counter;
+}
 
 errno_t set_debug_file_from_fd(const int fd)
 {
@@ -157,6 +183,7 @@ errno_t journal_send(const char *file,
     char *code_file = NULL;
     char *code_line = NULL;
     const char *domain;
+    char trace_id[32];
 
     /* First, evaluate the message to be sent */
     ret = vasprintf(&message, format, ap);
@@ -185,6 +212,11 @@ errno_t journal_send(const char *file,
         domain = "";
     }
 
+    trace_id[0] = '\0';
+    if (sss_trace_id != 0) {
+        snprintf(trace_id, sizeof(trace_id), "%"PRIu64, sss_trace_id);
+    }
+
     /* Send the log message to journald, specifying the
      * source code location and other tracking data.
      */
@@ -195,6 +227,7 @@ errno_t journal_send(const char *file,
             "SSSD_DOMAIN=%s", domain,
             "SSSD_PRG_NAME=%s", debug_prg_name,
             "SSSD_DEBUG_LEVEL=%x", level,
+            "SSSD_TRACE_ID=%s", trace_id,
             NULL);
     ret = -res;
 
@@ -206,6 +239,175 @@ journal_done:
 }
 #endif /* WiTH_JOURNALD */
 
+/* Date and time without the year as printed by ctime(), formatting it is
+ * expensive and it changes only once per second. */
+static const char *debug_datetime(time_t sec, int *_year)
+{
+    static time_t cached_sec = -1;
+    static char datetime[20];
+    static int year;
+    struct tm *tm;
+
+    if (sec != cached_sec) {
+        tm = localtime(&sec);
+        year = tm->tm_year + 1900;
+        memcpy(datetime, ctime(&sec), 19);
+        datetime[19] = '\0';
+        cached_sec = sec;
+    }
+
+    *_year = year;
+    return datetime;
+}
+
+static void debug_prefix(char *buf, size_t size,
+                         const char *function, int level)
+{
+    struct timeval tv;
+    const char *datetime;
+    size_t len;
+    int year;
+
+    if (debug_timestamps) {
+        gettimeofday(&tv, NULL);
+        datetime = debug_datetime(tv.tv_sec, &year);
+        if (debug_microseconds) {
+            snprintf(buf, size, "(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
+                     datetime, tv.tv_usec,
+                     year, debug_prg_name,
+                     function, level);
+        } else {
+            snprintf(buf, size, "(%s %d) [%s] [%s] (%#.4x): ",
+                     datetime, year,
+                     debug_prg_name, function, level);
+        }
+    } else {
+        snprintf(buf, size, "[%s] [%s] (%#.4x): ",
+                 debug_prg_name, function, level);
+    }
+
+    if (sss_trace_id != 0) {
+        len = strlen(buf);
+        snprintf(buf + len, size - len, "[RID#%"PRIu64"] ", sss_trace_id);
+    }
+}
+
+/* Ring of the most recent messages which were not logged because of the
+ * debug level, allocated when the first message is stored. */
+static char *debug_backtrace_buf;
+static size_t debug_backtrace_pos;
+static bool debug_backtrace_wrapped;
+
+static void debug_backtrace_record(const char *function,
+                                   int level,
+                                   int flags,
+                                   const char *format,
+                                   va_list ap)
+{
+    char msg[DEBUG_BACKTRACE_LINE_MAX];
+    const char *data = msg;
+    size_t chunk;
+    size_t len;
+    int ret;
+
+#ifdef WITH_JOURNALD
+    if (!debug_file && !debug_to_stderr) {
+        /* the backtrace is only written to log files */
+        return;
+    }
+#endif
+
+    if (debug_backtrace_buf == NULL) {
+        debug_backtrace_buf = malloc(DEBUG_BACKTRACE_SIZE);
+        if (debug_backtrace_buf == NULL) {
+            return;
+        }
+    }
+
+    debug_prefix(msg, sizeof(msg), function, level);
+    len = strlen(msg);
+
+    ret = vsnprintf(msg + len, sizeof(msg) - len, format, ap);
+    if (ret < 0) {
+        return;
+    }
+
+    if (ret >= sizeof(msg) - len) {
+        /* truncated */
+        len = sizeof(msg) - 1;
+        msg[len - 1] = '\n';
+    } else {
+        len += ret;
+        if ((flags & APPEND_LINE_FEED) && len < sizeof(msg) - 1) {
+            msg[len++] = '\n';
+        }
+    }
+
+    while (len > 0) {
+        chunk = DEBUG_BACKTRACE_SIZE - debug_backtrace_pos;
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        memcpy(debug_backtrace_buf + debug_backtrace_pos, data, chunk);
+        debug_backtrace_pos += chunk;
+        data += chunk;
+        len -= chunk;
+
+        if (debug_backtrace_pos == DEBUG_BACKTRACE_SIZE) {
+            debug_backtrace_pos = 0;
+            debug_backtrace_wrapped = true;
+        }
+    }
+}
+
+static void debug_backtrace_dump(void)
+{
+    FILE *out = debug_file ? debug_file : stderr;
+    const char *end = debug_backtrace_buf + DEBUG_BACKTRACE_SIZE;
+    const char *start;
+    const char *nl;
+
+    if (debug_backtrace_pos == 0 && !debug_backtrace_wrapped) {
+        return;
+    }
+
+    fputs("   *  ... messages not logged because of the debug level:\n", out);
+
+    start = debug_backtrace_buf;
+    if (debug_backtrace_wrapped) {
+        /* the oldest message may have been partially overwritten */
+        start = debug_backtrace_buf + debug_backtrace_pos;
+        nl = memchr(start, '\n', end - start);
+        if (nl != NULL) {
+            fwrite(nl + 1, 1, end - nl - 1, out);
+            start = debug_backtrace_buf;
+        } else {
+            nl = memchr(debug_backtrace_buf, '\n', debug_backtrace_pos);
+            start = nl == NULL ? debug_backtrace_buf + debug_backtrace_pos
+                               : nl + 1;
+        }
+    }
+
+    fwrite(start, 1, debug_backtrace_buf + debug_backtrace_pos - start, out);
+    fputs("   *  ... end of messages not logged\n", out);
+
+    debug_backtrace_pos = 0;
+    debug_backtrace_wrapped = false;
+}
+
+void sss_debug_flush(void)
+{
+    debug_fflush();
+}
+
+void sss_debug_prepare_fork(void)
+{
+    /* Also covers stdout of the tools, which would be duplicated
+     * the same way. */
+    fflush(NULL);
+}
+
 void sss_vdebug_fn(const char *file,
                    long line,
                    const char *function,
@@ -214,15 +416,21 @@ void sss_vdebug_fn(const char *file,
                    const char *format,
                    va_list ap)
 {
-    struct timeval tv;
-    struct tm *tm;
-    char datetime[20];
-    int year;
-
+    char prefix[DEBUG_PREFIX_MAX];
 #ifdef WITH_JOURNALD
     errno_t ret;
     va_list ap_fallback;
+#endif
 
+    if (!DEBUG_IS_SET(level)) {
+        /* DEBUG() calls us only to remember the message */
+        if (debug_backtrace) {
+            debug_backtrace_record(function, level, flags, format, ap);
+        }
+        return;
+    }
+
+#ifdef WITH_JOURNALD
     if (!debug_file && !debug_to_stderr) {
         /* If we are not outputting logs to files, we should be sending them
          * to journald.
@@ -243,33 +451,21 @@ void sss_vdebug_fn(const char *file,
     }
 #endif
 
-    if (debug_timestamps) {
-        gettimeofday(&tv, NULL);
-        tm = localtime(&tv.tv_sec);
-        year = tm->tm_year + 1900;
-        /* get date time without year */
-        memcpy(datetime, ctime(&tv.tv_sec), 19);
-        datetime[19] = '\0';
-        if (debug_microseconds) {
-            debug_printf("(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
-                         datetime, tv.tv_usec,
-                         year, debug_prg_name,
-                         function, level);
-        } else {
-            debug_printf("(%s %d) [%s] [%s] (%#.4x): ",
-                         datetime, year,
-                         debug_prg_name, function, level);
-        }
-    } else {
-        debug_printf("[%s] [%s] (%#.4x): ",
-                     debug_prg_name, function, level);
+    if (debug_backtrace_buf != NULL && (level & DEBUG_URGENT_LEVELS)) {
+        debug_backtrace_dump();
     }
 
+    debug_prefix(prefix, sizeof(prefix), function, level);
+    debug_printf("%s", prefix);
+
     debug_vprintf(format, ap);
     if (flags & APPEND_LINE_FEED) {
         debug_printf("\n");
     }
-    debug_fflush();
+
+    if (!debug_buffered || (level & DEBUG_URGENT_LEVELS)) {
+        debug_fflush();
+    }
 }
 
 void sss_debug_fn(const char *file,
@@ -385,6 +581,10 @@ int open_debug_file_ex(const char *filename, FILE **filep, bool want_cloexec)
     }
     umask(old_umask);
 
+    if (debug_buffered) {
+        setvbuf(f, NULL, _IOFBF, DEBUG_BUFFER_SIZE);
+    }
+
     debug_fd = fileno(f);
     if (debug_fd == -1) {
         fclose(f);
@@ -23,6 +23,8 @@
 
 #include "config.h"
 
+#include <stdint.h>
+
 #ifdef HAVE_FUNCTION_ATTRIBUTE_FORMAT
 #define SSS_ATTRIBUTE_PRINTF(a1, a2) __attribute__((format (printf, a1, a2)))
 #else
@@ -37,7 +39,19 @@ extern int debug_timestamps;
 extern int debug_microseconds;
 extern int debug_to_file;
 extern int debug_to_stderr;
+extern int debug_buffered;
+extern int debug_backtrace;
 extern const char *debug_log_file;
+
+/* Identifier of the client request this process is working on right now,
+ * 0 if there is none. It is printed with every debug message. The value is
+ * only valid until the current tevent event is processed, code that
+ * continues a request from another event must restore it. */
+extern uint64_t sss_trace_id;
+
+/* Returns a new identifier unique across all SSSD processes. */
+uint64_t sss_trace_id_new(void);
+
 void sss_vdebug_fn(const char *file,
                    long line,
                    const char *function,
@@ -50,6 +64,11 @@ void sss_debug_fn(const char *file,
                   const char *function,
                   int level,
                   const char *format, ...) SSS_ATTRIBUTE_PRINTF(5, 6);
+/* Writes out messages held back by debug_buffered. */
+void sss_debug_flush(void);
+/* Must be called right before fork(), otherwise the messages held back
+ * by debug_buffered are written out by both processes. */
+void sss_debug_prepare_fork(void);
 int debug_convert_old_level(int old_level);
 errno_t set_debug_file_from_fd(const int fd);
 int get_fd_from_debug_file(void);
@@ -102,7 +121,7 @@ int get_fd_from_debug_file(void);
 */
 #define DEBUG(level, format, ...) do { \
     int __debug_macro_level = level; \
-    if (DEBUG_IS_SET(__debug_macro_level)) { \
+    if (DEBUG_IS_SET(__debug_macro_level) || debug_backtrace) { \
         sss_debug_fn(__FILE__, __LINE__, __FUNCTION__, \
                      __debug_macro_level, \
                      format, ##__VA_ARGS__); \
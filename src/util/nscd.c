@@ -56,6 +56,7 @@ int flush_nscd_cache(enum nscd_db flush_db)
             goto done;
     }
 
+    sss_debug_prepare_fork();
     nscd_pid = fork();
     switch (nscd_pid) {
     case 0:
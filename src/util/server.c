@@ -84,6 +84,7 @@ void become_daemon(bool Fork)
     int ret, error;
 
     if (Fork) {
+        sss_debug_prepare_fork();
         pid = fork();
         if (pid != 0) {
             /* Terminate parent process on demand so we can hold systemd
@@ -443,6 +444,27 @@ static const char *get_pid_path(void)
 #endif
 }
 
+static void server_tevent_trace(enum tevent_trace_point point,
+                                void *private_data)
+{
+    switch (point) {
+    case TEVENT_TRACE_BEFORE_WAIT:
+        /* write buffered debug messages before we go idle */
+        if (debug_buffered) {
+            sss_debug_flush();
+        }
+        break;
+    case TEVENT_TRACE_AFTER_LOOP_ONCE:
+        /* Every event belongs to a different request, do not let the
+         * identifier of one of them leak into debug messages of the next
+         * one. */
+        sss_trace_id = 0;
+        break;
+    default:
+        break;
+    }
+}
+
 int server_setup(const char *name, int flags,
                  uid_t uid, gid_t gid,
                  const char *conf_entry,
@@ -528,6 +550,8 @@ int server_setup(const char *name, int flags,
         return 1;
     }
 
+    tevent_set_trace_callback(event_ctx, server_tevent_trace, NULL);
+
     /* Set up an event handler for a SIGINT */
     tes = tevent_add_signal(event_ctx, event_ctx, SIGINT, 0,
                             default_quit, NULL);
@@ -622,6 +646,27 @@ int server_setup(const char *name, int flags,
         else debug_microseconds = 0;
     }
 
+    /* debug buffering and backtrace are only set in the config file */
+    ret = confdb_get_bool(ctx->confdb_ctx, conf_entry,
+                          CONFDB_SERVICE_DEBUG_BUFFERED,
+                          false, &dl);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Error reading from confdb (%d) [%s]\n",
+                                     ret, strerror(ret));
+        return ret;
+    }
+    debug_buffered = dl ? 1 : 0;
+
+    ret = confdb_get_bool(ctx->confdb_ctx, conf_entry,
+                          CONFDB_SERVICE_DEBUG_BACKTRACE,
+                          false, &dl);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Error reading from confdb (%d) [%s]\n",
+                                     ret, strerror(ret));
+        return ret;
+    }
+    debug_backtrace = dl ? 1 : 0;
+
     /* same for debug to file */
     dl = (debug_to_file != 0);
     ret = confdb_get_bool(ctx->confdb_ctx, conf_entry,
@@ -230,6 +230,10 @@ const char *sss_cmd2str(enum sss_cli_command cmd)
         return "SSS_NSS_GETIDBYSID";
     case SSS_NSS_GETORIGBYNAME:
         return "SSS_NSS_GETORIGBYNAME";
+    case SSS_NSS_GETNAMEBYCERT:
+        return "SSS_NSS_GETNAMEBYCERT";
+    case SSS_NSS_GETIDSBYSIDS:
+        return "SSS_NSS_GETIDSBYSIDS";
     default:
         DEBUG(SSSDBG_MINOR_FAILURE,
               "Translation's string is missing for command [%#x].\n", cmd);
@@ -0,0 +1,228 @@
+/*
+    SSSD
+
+    Per-process operation counters and latency histograms
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <talloc.h>
+#include <tevent.h>
+#include <dhash.h>
+
+#include "util/util.h"
+#include "util/sss_metrics.h"
+
+/* Bound the memory used by metrics keyed with names that are not known
+ * in advance, such as server names. */
+#define SSS_METRICS_MAX 1024
+#define SSS_METRICS_KEY_MAX 256
+
+struct sss_metric {
+    uint64_t count;
+    uint64_t total_usec;
+    uint64_t max_usec;
+    uint64_t buckets[SSS_METRICS_BUCKETS];
+};
+
+static const uint64_t sss_metrics_limits[SSS_METRICS_BUCKETS - 1] =
+    SSS_METRICS_BUCKET_LIMITS;
+
+/* this is intentionally a global variable, there is one set of metrics
+ * per process */
+static hash_table_t *sss_metrics_table;
+
+static struct sss_metric *sss_metrics_get(const char *group,
+                                          const char *name)
+{
+    struct sss_metric *metric;
+    char keystr[SSS_METRICS_KEY_MAX];
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (group == NULL || name == NULL) {
+        return NULL;
+    }
+
+    if (sss_metrics_table == NULL) {
+        ret = sss_hash_create(NULL, 128, &sss_metrics_table);
+        if (ret != EOK) {
+            return NULL;
+        }
+    }
+
+    ret = snprintf(keystr, sizeof(keystr), "%s.%s", group, name);
+    if (ret < 0 || ret >= sizeof(keystr)) {
+        return NULL;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = keystr;
+
+    hret = hash_lookup(sss_metrics_table, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        return value.ptr;
+    } else if (hret != HASH_ERROR_KEY_NOT_FOUND) {
+        return NULL;
+    }
+
+    if (hash_count(sss_metrics_table) >= SSS_METRICS_MAX) {
+        return NULL;
+    }
+
+    metric = talloc_zero(sss_metrics_table, struct sss_metric);
+    if (metric == NULL) {
+        return NULL;
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = metric;
+
+    hret = hash_enter(sss_metrics_table, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        talloc_free(metric);
+        return NULL;
+    }
+
+    return metric;
+}
+
+void sss_metrics_inc(const char *group, const char *name)
+{
+    struct sss_metric *metric;
+
+    metric = sss_metrics_get(group, name);
+    if (metric == NULL) {
+        return;
+    }
+
+    metric->count++;
+}
+
+void sss_metrics_add_usec(const char *group, const char *name, uint64_t usec)
+{
+    struct sss_metric *metric;
+    int i;
+
+    metric = sss_metrics_get(group, name);
+    if (metric == NULL) {
+        return;
+    }
+
+    metric->count++;
+    metric->total_usec += usec;
+    if (usec > metric->max_usec) {
+        metric->max_usec = usec;
+    }
+
+    for (i = 0; i < SSS_METRICS_BUCKETS - 1; i++) {
+        if (usec < sss_metrics_limits[i]) {
+            break;
+        }
+    }
+    metric->buckets[i]++;
+}
+
+void sss_metrics_add_time(const char *group, const char *name,
+                          const struct timeval *start)
+{
+    struct timeval now;
+    struct timeval diff;
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(start, &now);
+
+    sss_metrics_add_usec(group, name,
+                         diff.tv_sec * 1000000ULL + diff.tv_usec);
+}
+
+static int sss_metrics_cmp(const void *a, const void *b)
+{
+    const hash_entry_t *ea = a;
+    const hash_entry_t *eb = b;
+
+    return strcmp(ea->key.str, eb->key.str);
+}
+
+errno_t sss_metrics_dump(TALLOC_CTX *mem_ctx,
+                         const char *prefix,
+                         char **_text)
+{
+    struct sss_metric *metric;
+    hash_entry_t *entries = NULL;
+    unsigned long count = 0;
+    unsigned long i;
+    char *text;
+    errno_t ret;
+    int hret;
+    int j;
+
+    text = talloc_strdup(mem_ctx, "");
+    if (text == NULL) {
+        return ENOMEM;
+    }
+
+    if (sss_metrics_table != NULL) {
+        hret = hash_entries(sss_metrics_table, &count, &entries);
+        if (hret != HASH_SUCCESS) {
+            ret = EIO;
+            goto done;
+        }
+
+        qsort(entries, count, sizeof(hash_entry_t), sss_metrics_cmp);
+    }
+
+    for (i = 0; i < count; i++) {
+        metric = entries[i].value.ptr;
+
+        text = talloc_asprintf_append_buffer(text,
+                    "%s %s %"PRIu64" %"PRIu64" %"PRIu64,
+                    prefix, entries[i].key.str, metric->count,
+                    metric->total_usec, metric->max_usec);
+        for (j = 0; text != NULL && j < SSS_METRICS_BUCKETS; j++) {
+            text = talloc_asprintf_append_buffer(text, " %"PRIu64,
+                                                 metric->buckets[j]);
+        }
+        if (text != NULL) {
+            text = talloc_strdup_append_buffer(text, "\n");
+        }
+        if (text == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    *_text = text;
+    ret = EOK;
+
+done:
+    talloc_free(entries);
+    if (ret != EOK) {
+        talloc_free(text);
+    }
+    return ret;
+}
+
+void sss_metrics_reset(void)
+{
+    talloc_zfree(sss_metrics_table);
+}
@@ -0,0 +1,62 @@
+/*
+    SSSD
+
+    Per-process operation counters and latency histograms
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SSS_METRICS_H_
+#define _SSS_METRICS_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <talloc.h>
+
+#include "util/util_errors.h"
+
+/* Upper bounds of the latency buckets in microseconds, the last bucket
+ * holds everything slower. */
+#define SSS_METRICS_BUCKETS 7
+#define SSS_METRICS_BUCKET_LIMITS \
+    { 100, 1000, 10000, 100000, 1000000, 10000000 }
+
+/* Metrics are identified by "group.name". Both strings are copied, so
+ * they do not need to outlive the call. Recording never fails, a metric
+ * that cannot be stored is silently dropped. */
+
+/* Count one occurrence of an event without a duration. */
+void sss_metrics_inc(const char *group, const char *name);
+
+/* Count one operation which took usec microseconds. */
+void sss_metrics_add_usec(const char *group, const char *name, uint64_t usec);
+
+/* Count one operation which started at start and has just finished. */
+void sss_metrics_add_time(const char *group, const char *name,
+                          const struct timeval *start);
+
+/* Print all metrics of this process, one per line:
+ *
+ * <prefix> <group.name> <count> <total usec> <max usec> <buckets...>
+ */
+errno_t sss_metrics_dump(TALLOC_CTX *mem_ctx,
+                         const char *prefix,
+                         char **_text);
+
+/* Drop all metrics recorded so far. */
+void sss_metrics_reset(void);
+
+#endif /* _SSS_METRICS_H_ */
@@ -63,6 +63,12 @@
 
 #define CLEAR_MC_FLAG "clear_mc_flag"
 
+/* If CLEAR_MC_FLAG is not empty, it lists the entries that should be
+ * removed from the memory cache, one "<type>\t<domain>\t<name>" per line.
+ * Otherwise the whole memory cache is cleared. */
+#define SSS_MC_ENTRY_PASSWD "passwd"
+#define SSS_MC_ENTRY_GROUP "group"
+
 /** Default secure umask */
 #define SSS_DFL_UMASK 0177
 
@@ -74,6 +74,14 @@ safealign_memcpy(void *dest, const void *src, size_t n, size_t *counter)
 #define SAFEALIGN_SETMEM_INT64(dest, value, pctr) \
     SAFEALIGN_SETMEM_VALUE(dest, value, int64_t, pctr)
 
+/* SAFEALIGN_COPY_UINT64(void *dest, void *src, size_t *pctr) */
+#define SAFEALIGN_COPY_UINT64(dest, src, pctr) \
+    safealign_memcpy(dest, src, sizeof(uint64_t), pctr)
+
+/* SAFEALIGN_SETMEM_UINT64(void *dest, uint64_t value, size_t *pctr) */
+#define SAFEALIGN_SETMEM_UINT64(dest, value, pctr) \
+    SAFEALIGN_SETMEM_VALUE(dest, value, uint64_t, pctr)
+
 /* SAFEALIGN_COPY_UINT32(void *dest, void *src, size_t *pctr) */
 #define SAFEALIGN_COPY_UINT32(dest, src, pctr) \
     safealign_memcpy(dest, src, sizeof(uint32_t), pctr)
@@ -101,6 +109,12 @@ safealign_memcpy(void *dest, const void *src, size_t n, size_t *counter)
 /* These macros are the same as their equivalents without _CHECK suffix,
  * but additionally make the caller return EINVAL immediatelly if *pctr
  * would excceed len. */
+#define SAFEALIGN_COPY_UINT64_CHECK(dest, src, len, pctr) do { \
+    if ((*(pctr) + sizeof(uint64_t)) > (len) || \
+        SIZE_T_OVERFLOW(*(pctr), sizeof(uint64_t))) { return EINVAL; } \
+    safealign_memcpy(dest, src, sizeof(uint64_t), pctr); \
+} while(0)
+
 #define SAFEALIGN_COPY_UINT32_CHECK(dest, src, len, pctr) do { \
     if ((*(pctr) + sizeof(uint32_t)) > (len) || \
         SIZE_T_OVERFLOW(*(pctr), sizeof(uint32_t))) { return EINVAL; } \
@@ -122,6 +136,7 @@ safealign_memcpy(void *dest, const void *src, size_t n, size_t *counter)
 /* Aliases for backward compatibility. */
 #define SAFEALIGN_SET_VALUE SAFEALIGN_SETMEM_VALUE
 #define SAFEALIGN_SET_INT64 SAFEALIGN_SETMEM_INT64
+#define SAFEALIGN_SET_UINT64 SAFEALIGN_SETMEM_UINT64
 #define SAFEALIGN_SET_UINT32 SAFEALIGN_SETMEM_UINT32
 #define SAFEALIGN_SET_INT32 SAFEALIGN_SETMEM_INT32
 #define SAFEALIGN_SET_UINT16 SAFEALIGN_SETMEM_UINT16